@@ -9,6 +9,8 @@
 */
 
 #include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFont2Sound.cpp"
+#include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontDiskStreamer.cpp"
+#include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontSamplePool.cpp"
 #include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontSound.cpp"
 #include "../../Source/Core/Audio/BuiltIn/SoundFont/SoundFontSynth.cpp"
 #include "../../Source/Core/Audio/BuiltIn/InternalIODevicesPluginFormat.cpp"
@@ -17,18 +19,26 @@
 #include "../../Source/Core/Audio/BuiltIn/DefaultSynth.cpp"
 #include "../../Source/Core/Audio/BuiltIn/MetronomeSynthAudioPlugin.cpp"
 #include "../../Source/Core/Audio/BuiltIn/MetronomeSynth.cpp"
+#include "../../Source/Core/Audio/BuiltIn/PolyphonicSynth.cpp"
 #include "../../Source/Core/Audio/BuiltIn/SoundFontSynthAudioPlugin.cpp"
 #include "../../Source/Core/Audio/Instruments/Instrument.cpp"
+#include "../../Source/Core/Audio/Instruments/LatencyCompensator.cpp"
+#include "../../Source/Core/Audio/Instruments/MidiOutputScheduler.cpp"
 #include "../../Source/Core/Audio/Instruments/OrchestraPit.cpp"
+#include "../../Source/Core/Audio/Instruments/PluginInstantiationPool.cpp"
+#include "../../Source/Core/Audio/Instruments/PluginSandboxWorker.cpp"
 #include "../../Source/Core/Audio/Instruments/PluginScanner.cpp"
+#include "../../Source/Core/Audio/Instruments/SandboxedPluginInstance.cpp"
 #include "../../Source/Core/Audio/Instruments/SerializablePluginDescription.cpp"
 #include "../../Source/Core/Audio/Monitoring/AudioMonitor.cpp"
 #include "../../Source/Core/Audio/Monitoring/SpectrumAnalyzer.cpp"
+#include "../../Source/Core/Audio/Transport/MidiClockFollower.cpp"
 #include "../../Source/Core/Audio/Transport/MidiRecorder.cpp"
 #include "../../Source/Core/Audio/Transport/PlayerThread.cpp"
 #include "../../Source/Core/Audio/Transport/RendererThread.cpp"
 #include "../../Source/Core/Audio/Transport/Transport.cpp"
 #include "../../Source/Core/Audio/AudioCore.cpp"
+#include "../../Source/Core/Audio/RealtimeSafety.cpp"
 #include "../../Source/Core/Configuration/Resources/Models/Arpeggiator.cpp"
 #include "../../Source/Core/Configuration/Resources/Models/Chord.cpp"
 #include "../../Source/Core/Configuration/Resources/Models/ColourScheme.cpp"
@@ -68,10 +78,13 @@
 #include "../../Source/Core/Midi/Sequences/AutomationSequence.cpp"
 #include "../../Source/Core/Midi/Sequences/KeySignaturesSequence.cpp"
 #include "../../Source/Core/Midi/Sequences/MidiSequence.cpp"
+#include "../../Source/Core/Midi/Sequences/NoteIntervalIndex.cpp"
 #include "../../Source/Core/Midi/Sequences/PianoSequence.cpp"
+#include "../../Source/Core/Midi/Sequences/SequenceSnapshot.cpp"
 #include "../../Source/Core/Midi/Sequences/TimeSignaturesSequence.cpp"
 #include "../../Source/Core/Midi/Sequences/TimeSignaturesAggregator.cpp"
 #include "../../Source/Core/Midi/MidiTrack.cpp"
+#include "../../Source/Core/Midi/ParallelBatch.cpp"
 #include "../../Source/Core/Network/Requests/BackendRequest.cpp"
 #include "../../Source/Core/Network/Requests/UserConfigSyncThread.cpp"
 #include "../../Source/Core/Network/Requests/ProjectCloneThread.cpp"
@@ -114,6 +127,7 @@
 #include "../../Source/Core/Undo/Actions/PianoTrackActions.cpp"
 #include "../../Source/Core/Undo/Actions/ProjectMetadataActions.cpp"
 #include "../../Source/Core/Undo/Actions/TimeSignatureEventActions.cpp"
+#include "../../Source/Core/Undo/UndoJournal.cpp"
 #include "../../Source/Core/Undo/UndoStack.cpp"
 #include "../../Source/Core/VCS/DiffLogic/AutomationTrackDiffLogic.cpp"
 #include "../../Source/Core/VCS/DiffLogic/DiffLogic.cpp"
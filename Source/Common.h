@@ -43,6 +43,7 @@
 #include <climits>
 #include <cfloat>
 #include <cmath>
+#include <set>
 
 //===----------------------------------------------------------------------===//
 // A better hash map
@@ -147,6 +148,9 @@ namespace juce
     {
         // declare an additional category for all our tests 
         static const String helio { "Helio" };
+
+        // the long-running benchmarks, only run with --benchmarks
+        static const String helioBenchmarks { "Helio benchmarks" };
     }
 }
 #endif
@@ -17,6 +17,7 @@
 
 #include "Common.h"
 #include "AudioCore.h"
+#include "RealtimeSafety.h"
 #include "Network.h"
 #include "HelioTheme.h"
 #include "Config.h"
@@ -26,6 +27,7 @@
 #include "XmlSerializer.h"
 #include "SerializationKeys.h"
 #include "SerializablePluginDescription.h"
+#include "PluginSandboxWorker.h"
 
 #include "MainLayout.h"
 #include "ScaledComponentProxy.h"
@@ -507,7 +509,11 @@ void App::setTitleBarComponent(WeakReference<Component> component)
 
 void App::initialise(const String &commandLine)
 {
-    if (commandLine.isNotEmpty() &&
+    if (PluginSandboxWorker::isWorkerCommandLine(commandLine))
+    {
+        this->runMode = RunMode::PluginSandbox;
+    }
+    else if (commandLine.isNotEmpty() &&
         DocumentHelpers::getTempSlot(commandLine).existsAsFile())
     {
         this->runMode = RunMode::PluginCheck;
@@ -538,9 +544,20 @@ void App::initialise(const String &commandLine)
         // (we don't need a window, workspace and network services though)
         UnitTestRunner runner;
 
+        // any test which hits an allocation or a lock within
+        // a realtime region will crash the runner, so that it fails
+        RealtimeSafety::setPolicy(RealtimeSafety::Policy::abort);
+
         // we don't want to run JUCE's unit tests, just the ones in our category:
-        runner.runTestsInCategory(UnitTestCategories::helio,
-            Random::getSystemRandom().nextInt64());
+        auto tests = UnitTest::getTestsInCategory(UnitTestCategories::helio);
+
+        // the benchmarks take a while, and are only run on demand
+        if (commandLine.contains("--benchmarks"))
+        {
+            tests.addArray(UnitTest::getTestsInCategory(UnitTestCategories::helioBenchmarks));
+        }
+
+        runner.runTests(tests, Random::getSystemRandom().nextInt64());
 
         for (int i = 0; i < runner.getNumResults(); ++i)
         {
@@ -592,6 +609,10 @@ void App::initialise(const String &commandLine)
         this->checkPlugin(commandLine);
         this->quit();
     }
+    else if (this->runMode == RunMode::PluginSandbox)
+    {
+        this->runPluginSandbox(commandLine);
+    }
 }
 
 void App::shutdown()
@@ -624,6 +645,10 @@ void App::shutdown()
         Icons::clearPrerenderedCache();
         Icons::clearBuiltInImages();
     }
+    else if (this->runMode == RunMode::PluginSandbox)
+    {
+        this->sandboxWorker = nullptr;
+    }
 }
 
 const String App::getApplicationName()
@@ -632,6 +657,10 @@ const String App::getApplicationName()
     {
         return "Helio Plugin Check";
     }
+    else if (this->runMode == RunMode::PluginSandbox)
+    {
+        return "Helio Plugin Sandbox";
+    }
 
     return "Helio";
 }
@@ -722,19 +751,18 @@ void App::checkPlugin(const String &markerFile)
                 pluginList.scanAndAddFile(pluginPath, false, typesFound, *format);
             }
 
-            // let host know if we haven't crashed at the moment
-            if (typesFound.size() != 0)
-            {
-                SerializedData typesNode(Serialization::Core::instrumentsList);
+            // let host know if we haven't crashed at the moment;
+            // the results are written even if nothing is found,
+            // so that the host can tell that from a crash
+            SerializedData typesNode(Serialization::Core::instrumentsList);
 
-                for (const auto *description : typesFound)
-                {
-                    const SerializablePluginDescription sd(*description);
-                    typesNode.appendChild(sd.serialize());
-                }
-
-                DocumentHelpers::save<XmlSerializer>(tempFile, typesNode);
+            for (const auto *description : typesFound)
+            {
+                const SerializablePluginDescription sd(*description);
+                typesNode.appendChild(sd.serialize());
             }
+
+            DocumentHelpers::save<XmlSerializer>(tempFile, typesNode);
         }
     }
     catch (...)
@@ -743,6 +771,22 @@ void App::checkPlugin(const String &markerFile)
     }
 }
 
+void App::runPluginSandbox(const String &commandLine)
+{
+#if JUCE_MAC
+    Process::setDockIconVisible(false);
+#endif
+
+    // the worker will quit the app when the connection is lost
+    this->sandboxWorker = make<PluginSandboxWorker>();
+    if (!this->sandboxWorker->initialiseFromCommandLine(commandLine,
+        PluginSandbox::commandLineUid, PluginSandbox::launchTimeoutMs))
+    {
+        this->sandboxWorker = nullptr;
+        this->quit();
+    }
+}
+
 void App::handleAsyncUpdate()
 {
     JUCEApplication::quit();
@@ -109,6 +109,7 @@ private:
     UniquePointer<class Workspace> workspace;
     UniquePointer<class MainWindow> window;
     UniquePointer<class Network> network;
+    UniquePointer<class PluginSandboxWorker> sandboxWorker;
 
 private:
 
@@ -123,11 +124,13 @@ private:
 private:
 
     void checkPlugin(const String &markerFile);
+    void runPluginSandbox(const String &commandLine);
 
     enum class RunMode
     {
         Normal,
-        PluginCheck
+        PluginCheck,
+        PluginSandbox
     };
 
     RunMode runMode = RunMode::Normal;
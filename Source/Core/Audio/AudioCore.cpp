@@ -23,6 +23,9 @@
 #include "MetronomeSynthAudioPlugin.h"
 #include "SerializationKeys.h"
 #include "AudioMonitor.h"
+#include "MidiOutputScheduler.h"
+#include "MidiClockFollower.h"
+#include "PluginInstantiationPool.h"
 
 void AudioCore::initAudioFormats(AudioPluginFormatManager &formatManager)
 {
@@ -33,16 +36,32 @@ void AudioCore::initAudioFormats(AudioPluginFormatManager &formatManager)
 
 AudioCore::AudioCore()
 {
+    // the scheduler keeps track of the audio clock, and the instruments
+    // rely on it having seen the current block already, so it goes first
+    this->midiOutputScheduler = make<MidiOutputScheduler>(this->deviceManager);
+    this->deviceManager.addAudioCallback(this->midiOutputScheduler.get());
+
+    this->midiClockFollower = make<MidiClockFollower>();
+    this->deviceManager.addMidiInputDeviceCallback({}, this->midiClockFollower.get());
+
     this->audioMonitor = make<AudioMonitor>();
     this->deviceManager.addAudioCallback(this->audioMonitor.get());
     AudioCore::initAudioFormats(this->formatManager);
+    this->instantiationPool = make<PluginInstantiationPool>(this->formatManager);
+    this->latencyCompensationTimer.startTimer(AudioCore::latencyCompensationUpdateMs);
 }
 
 AudioCore::~AudioCore()
 {
+    this->latencyCompensationTimer.stopTimer();
+    this->cancelPendingUpdate();
     this->deviceManager.removeAudioCallback(this->audioMonitor.get());
     this->audioMonitor = nullptr;
+    this->deviceManager.removeMidiInputDeviceCallback({}, this->midiClockFollower.get());
+    this->deviceManager.removeAudioCallback(this->midiOutputScheduler.get());
     this->deviceManager.closeAudioDevice();
+    this->midiClockFollower = nullptr;
+    this->midiOutputScheduler = nullptr;
 }
 
 bool AudioCore::canSleepNow() noexcept
@@ -109,6 +128,16 @@ AudioMonitor *AudioCore::getMonitor() const noexcept
     return this->audioMonitor.get();
 }
 
+MidiOutputScheduler *AudioCore::getMidiOutputScheduler() const noexcept
+{
+    return this->midiOutputScheduler.get();
+}
+
+MidiClockFollower *AudioCore::getMidiClockFollower() const noexcept
+{
+    return this->midiClockFollower.get();
+}
+
 //===----------------------------------------------------------------------===//
 // Instruments
 //===----------------------------------------------------------------------===//
@@ -116,7 +145,8 @@ AudioMonitor *AudioCore::getMonitor() const noexcept
 void AudioCore::addInstrument(const PluginDescription &pluginDescription,
     const String &name, Instrument::InitializationCallback callback)
 {
-    auto *instrument = this->instruments.add(new Instrument(formatManager, name));
+    auto *instrument = this->instruments.add(new Instrument(this->formatManager, *this->instantiationPool, name));
+    instrument->setSandboxingPlugins(this->sandboxingPlugins);
     this->addInstrumentToAudioDevice(instrument);
     instrument->initializeFrom(pluginDescription,
         [this, callback](Instrument *instrument)
@@ -127,6 +157,7 @@ void AudioCore::addInstrument(const PluginDescription &pluginDescription,
                 callback(instrument);
             }
             this->broadcastAddInstrument(instrument);
+            this->updateLatencyCompensation();
             DBG("Loaded " + instrument->getName());
         });
 }
@@ -139,10 +170,31 @@ void AudioCore::removeInstrument(Instrument *instrument)
     this->removeInstrumentFromMidiDevice(instrument);
 
     this->instruments.removeObject(instrument, true);
+    this->updateLatencyCompensation();
 
     this->broadcastPostRemoveInstrument();
 }
 
+void AudioCore::updateLatencyCompensation()
+{
+    const auto getCompensatedLatency = [](const Instrument *instrument)
+    {
+        return LatencyCompensator::getCompensatedLatency(instrument->getLatencySamples());
+    };
+
+    int maxLatency = 0;
+    for (const auto *instrument : this->instruments)
+    {
+        maxLatency = jmax(maxLatency, getCompensatedLatency(instrument));
+    }
+
+    for (auto *instrument : this->instruments)
+    {
+        instrument->getProcessorPlayer()
+            .setLatencyCompensation(maxLatency - getCompensatedLatency(instrument));
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Audio & MIDI callbacks and MIDI filtering
 //===----------------------------------------------------------------------===//
@@ -192,6 +244,26 @@ void AudioCore::setFilteringMidiInput(bool isOn) noexcept
     this->isReadjustingMidiInput = isOn;
 }
 
+//===----------------------------------------------------------------------===//
+// Plugin sandboxing
+//===----------------------------------------------------------------------===//
+
+bool AudioCore::isSandboxingPlugins() const noexcept
+{
+    return this->sandboxingPlugins;
+}
+
+void AudioCore::setSandboxingPlugins(bool isOn)
+{
+#if PLATFORM_DESKTOP
+    this->sandboxingPlugins = isOn;
+    for (auto *instrument : this->instruments)
+    {
+        instrument->setSandboxingPlugins(isOn);
+    }
+#endif
+}
+
 void AudioCore::addInstrumentToMidiDevice(Instrument *instrument,
     int periodSize, Scale::Ptr chromaticMapping)
 {
@@ -208,6 +280,7 @@ void AudioCore::removeInstrumentFromMidiDevice(Instrument *instrument)
 
 void AudioCore::addInstrumentToAudioDevice(Instrument *instrument)
 {
+    instrument->getProcessorPlayer().setMidiOutputScheduler(this->midiOutputScheduler.get());
     this->deviceManager.addAudioCallback(&instrument->getProcessorPlayer());
 }
 
@@ -308,6 +381,41 @@ Instrument *AudioCore::findInstrumentById(const String &id) const
     return nullptr;
 }
 
+void AudioCore::prefetchInstrument(Instrument *instrument)
+{
+    if (instrument == nullptr || instrument->isLoaded())
+    {
+        return;
+    }
+
+    this->instrumentsToPrefetch.addIfNotAlreadyThere(instrument);
+    this->triggerAsyncUpdate();
+}
+
+void AudioCore::handleAsyncUpdate()
+{
+    // independent instruments are loaded concurrently,
+    // see PluginInstantiationPool for what that means
+    this->instrumentsBeingPrefetched.removeIf([](const WeakReference<Instrument> &instrument)
+    {
+        return instrument == nullptr || instrument->isLoaded();
+    });
+
+    while (!this->instrumentsToPrefetch.isEmpty() &&
+        this->instrumentsBeingPrefetched.size() < AudioCore::maxInstrumentsBeingPrefetched)
+    {
+        auto *instrument = this->instrumentsToPrefetch.removeAndReturn(0).get();
+        if (instrument != nullptr && !instrument->isLoaded())
+        {
+            this->instrumentsBeingPrefetched.add(instrument);
+            instrument->loadIfNeeded([this](Instrument *)
+            {
+                this->triggerAsyncUpdate();
+            });
+        }
+    }
+}
+
 Instrument *AudioCore::getDefaultInstrument() const noexcept
 {
     jassert(this->defaultInstrument != nullptr || !this->instruments.isEmpty());
@@ -488,12 +596,26 @@ SerializedData AudioCore::serializeDeviceManager() const
     tree.setProperty(Audio::midiInputReadjusting,
         this->isReadjustingMidiInput.get());
 
+    tree.setProperty(Audio::pluginSandboxing, this->sandboxingPlugins);
+
     if (auto *midiOutput = this->deviceManager.getDefaultMidiOutput())
     {
         tree.setProperty(Audio::midiOutputName, midiOutput->getName());
         tree.setProperty(Audio::midiOutputId, midiOutput->getIdentifier());
     }
 
+    tree.setProperty(Audio::midiClockOutput, this->midiOutputScheduler->isSendingMidiClock());
+    tree.setProperty(Audio::midiTimecodeOutput, this->midiOutputScheduler->isSendingMidiTimecode());
+    tree.setProperty(Audio::midiClockInput, this->midiClockFollower->isEnabled());
+
+    for (const auto &latency : this->midiOutputScheduler->getDeviceLatencies())
+    {
+        SerializedData latencyNode(Audio::midiOutputLatency);
+        latencyNode.setProperty(Audio::midiOutputId, latency.first);
+        latencyNode.setProperty(Audio::midiOutputLatencyMs, latency.second);
+        tree.appendChild(latencyNode);
+    }
+
     return tree;
 }
 
@@ -511,6 +633,31 @@ void AudioCore::deserializeDeviceManager(const SerializedData &tree)
         return;
     }
 
+#if PLATFORM_DESKTOP
+    // unlike the device settings below, this one doesn't depend on the hardware:
+    this->sandboxingPlugins = root.getProperty(Audio::pluginSandboxing,
+        this->sandboxingPlugins);
+#endif
+
+    this->midiOutputScheduler->setSendingMidiClock(root.getProperty(Audio::midiClockOutput,
+        this->midiOutputScheduler->isSendingMidiClock()));
+    this->midiOutputScheduler->setSendingMidiTimecode(root.getProperty(Audio::midiTimecodeOutput,
+        this->midiOutputScheduler->isSendingMidiTimecode()));
+    this->midiClockFollower->setEnabled(root.getProperty(Audio::midiClockInput,
+        this->midiClockFollower->isEnabled()));
+
+    // the calibrated latencies are kept for all devices, connected or not,
+    // and they need to be known before the MIDI output is opened below
+    for (const auto &childNode : root)
+    {
+        if (childNode.hasType(Audio::midiOutputLatency))
+        {
+            this->midiOutputScheduler->setDeviceLatency(
+                childNode.getProperty(Audio::midiOutputId).toString(),
+                double(childNode.getProperty(Audio::midiOutputLatencyMs)));
+        }
+    }
+
     // A hack: this will call scanDevicesIfNeeded():
     const auto &availableDeviceTypes = this->deviceManager.getAvailableDeviceTypes();
 
@@ -670,15 +817,18 @@ void AudioCore::deserialize(const SerializedData &data)
     {
         for (const auto &instrumentNode : orchestra)
         {
-            auto instrument = make<Instrument>(this->formatManager, "");
+            auto instrument = make<Instrument>(this->formatManager, *this->instantiationPool, "");
+            instrument->setSandboxingPlugins(this->sandboxingPlugins);
 
             // it's important to add audio processor to device
             // before actually creating nodes and connections:
             this->addInstrumentToAudioDevice(instrument.get());
             instrument->deserialize(instrumentNode);
 
-            // try to filter out the trash early:
-            if (instrument->getName().isEmpty() || instrument->getNumNodes() == 0)
+            // try to filter out the trash early
+            // (placeholders have no nodes until they are loaded):
+            if (instrument->getName().isEmpty() ||
+                (instrument->isLoaded() && instrument->getNumNodes() == 0))
             {
                 this->removeInstrumentFromAudioDevice(instrument.get());
             }
@@ -709,6 +859,10 @@ void AudioCore::reset()
     this->defaultInstrument = nullptr;
     this->metronomeInstrument = nullptr;
 
+    this->cancelPendingUpdate();
+    this->instrumentsToPrefetch.clearQuick();
+    this->instrumentsBeingPrefetched.clearQuick();
+
     while (!this->instruments.isEmpty())
     {
         this->removeInstrument(this->instruments[0]);
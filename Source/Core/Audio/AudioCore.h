@@ -18,6 +18,9 @@
 #pragma once
 
 class AudioMonitor;
+class MidiOutputScheduler;
+class MidiClockFollower;
+class PluginInstantiationPool;
 
 #include "Instrument.h"
 #include "OrchestraPit.h"
@@ -73,7 +76,8 @@ class AudioCore final :
     public Serializable,
     public ChangeBroadcaster,
     public OrchestraPit,
-    public SleepTimer
+    public SleepTimer,
+    private AsyncUpdater
 {
 public:
 
@@ -107,6 +111,8 @@ public:
     String getMetronomeInstrumentId() const noexcept;
     void initBuiltInInstrumentsIfNeeded();
 
+    void prefetchInstrument(Instrument *instrument) override;
+
     //===------------------------------------------------------------------===//
     // Setup
     //===------------------------------------------------------------------===//
@@ -117,6 +123,8 @@ public:
     AudioDeviceManager &getDevice() noexcept;
     AudioPluginFormatManager &getFormatManager() noexcept;
     AudioMonitor *getMonitor() const noexcept;
+    MidiOutputScheduler *getMidiOutputScheduler() const noexcept;
+    MidiClockFollower *getMidiClockFollower() const noexcept;
 
     //===------------------------------------------------------------------===//
     // MIDI input filtering
@@ -128,6 +136,15 @@ public:
     bool isFilteringMidiInput() const noexcept;
     void setFilteringMidiInput(bool isOn) noexcept;
 
+    //===------------------------------------------------------------------===//
+    // Plugin sandboxing
+    //===------------------------------------------------------------------===//
+
+    // runs third-party plugins in separate processes (desktop only),
+    // applies to the plugins loaded after this is changed
+    bool isSandboxingPlugins() const noexcept;
+    void setSandboxingPlugins(bool isOn);
+
     //===------------------------------------------------------------------===//
     // Serializable
     //===------------------------------------------------------------------===//
@@ -184,17 +201,52 @@ private:
     void addInstrumentToAudioDevice(Instrument *instrument);
     void removeInstrumentFromAudioDevice(Instrument *instrument);
 
+    // delays all instruments except the slowest one, so that they
+    // stay aligned with each other, see LatencyCompensator
+    void updateLatencyCompensation();
+
+    // plugins may change their latency at any time, e.g. when
+    // their look-ahead is switched on, so it is checked periodically
+    class LatencyCompensationTimer final : public Timer
+    {
+    public:
+
+        explicit LatencyCompensationTimer(AudioCore &audioCore) :
+            audioCore(audioCore) {}
+
+        void timerCallback() override
+        {
+            this->audioCore.updateLatencyCompensation();
+        }
+
+    private:
+
+        AudioCore &audioCore;
+    };
+
+    LatencyCompensationTimer latencyCompensationTimer { *this };
+    static constexpr auto latencyCompensationUpdateMs = 500;
+
     SerializedData serializeDeviceManager() const;
     void deserializeDeviceManager(const SerializedData &tree);
 
+    // loads the placeholder instruments, several at a time
+    void handleAsyncUpdate() override;
+    Array<WeakReference<Instrument>> instrumentsToPrefetch;
+    Array<WeakReference<Instrument>> instrumentsBeingPrefetched;
+    static constexpr auto maxInstrumentsBeingPrefetched = 4;
+
     OwnedArray<Instrument> instruments;
 
     WeakReference<Instrument> defaultInstrument;
     WeakReference<Instrument> metronomeInstrument;
 
     UniquePointer<AudioMonitor> audioMonitor;
+    UniquePointer<MidiOutputScheduler> midiOutputScheduler;
+    UniquePointer<MidiClockFollower> midiClockFollower;
 
     AudioPluginFormatManager formatManager;
+    UniquePointer<PluginInstantiationPool> instantiationPool;
     AudioDeviceManager deviceManager;
 
     Atomic<bool> isMuted = false;
@@ -240,15 +292,18 @@ private:
         {
             MidiMessage mappedMessage(message);
 
+            // keeps the timestamps, the recorder relies on them
             if (message.isNoteOn())
             {
                 mappedMessage = MidiMessage::noteOn(message.getChannel(),
-                    this->getMappedKey(message.getNoteNumber()), message.getVelocity());
+                    this->getMappedKey(message.getNoteNumber()), message.getVelocity())
+                    .withTimeStamp(message.getTimeStamp());
             }
             else if (message.isNoteOff())
             {
                 mappedMessage = MidiMessage::noteOff(message.getChannel(),
-                    this->getMappedKey(message.getNoteNumber()), message.getVelocity());
+                    this->getMappedKey(message.getNoteNumber()), message.getVelocity())
+                    .withTimeStamp(message.getTimeStamp());
             }
 
             this->targetInstrumentCallback->handleIncomingMidiMessage(source, mappedMessage);
@@ -281,6 +336,8 @@ private:
 
     MidiPlayerInfo lastActiveMidiPlayer;
 
+    bool sandboxingPlugins = false;
+
 private:
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioCore)
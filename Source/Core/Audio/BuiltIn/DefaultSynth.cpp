@@ -18,11 +18,48 @@
 #include "Common.h"
 #include "DefaultSynth.h"
 
+//===----------------------------------------------------------------------===//
+// Wavetable
+//===----------------------------------------------------------------------===//
+
+// a single cycle of a sine, shared by all voices; the sine has no harmonics
+// to alias, so one table is band-limited at any pitch, and the table lookup
+// is much cheaper than calling std::sin for each sample of each voice
+
+class DefaultSynthWavetable final
+{
+public:
+
+    static constexpr auto size = 2048;
+
+    DefaultSynthWavetable()
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            this->samples[i] = float(std::sin(MathConstants<double>::twoPi * i / size));
+        }
+
+        // the guard sample for the interpolation
+        this->samples[size] = this->samples[0];
+    }
+
+    float samples[size + 1];
+
+    JUCE_DECLARE_NON_COPYABLE(DefaultSynthWavetable)
+};
+
+static const DefaultSynthWavetable &getDefaultSynthWavetable()
+{
+    static DefaultSynthWavetable wavetable;
+    return wavetable;
+}
+
 //===----------------------------------------------------------------------===//
 // Voice
 //===----------------------------------------------------------------------===//
 
-DefaultSynth::Voice::Voice()
+DefaultSynth::Voice::Voice() :
+    envelopeBuffer(1, DefaultSynth::Voice::chunkSize)
 {
     ADSR::Parameters ap;
     ap.attack = 0.001f;
@@ -30,15 +67,6 @@ DefaultSynth::Voice::Voice()
     ap.sustain = 0.2f;
     ap.release = 0.5f;
     this->adsr.setParameters(ap);
-
-    Reverb::Parameters rp;
-    rp.roomSize = 0.0f;
-    rp.damping = 0.0f;
-    rp.wetLevel = 0.23f;
-    rp.dryLevel = 0.73f;
-    rp.width = 0.0f;
-    rp.freezeMode = 0.4f;
-    this->reverb.setParameters(rp);
 }
 
 bool DefaultSynth::Voice::canPlaySound(SynthesiserSound *)
@@ -51,7 +79,6 @@ void DefaultSynth::Voice::setCurrentPlaybackSampleRate(double sampleRate)
     if (sampleRate > 0)
     {
         this->adsr.setSampleRate(sampleRate);
-        this->reverb.setSampleRate(sampleRate);
         SynthesiserVoice::setCurrentPlaybackSampleRate(sampleRate);
     }
 }
@@ -62,13 +89,16 @@ void DefaultSynth::Voice::startNote(int midiNoteNumber, float velocity, Synthesi
     const int realNoteNumber = midiNoteNumber +
         Globals::twelveToneKeyboardSize * (channel - 1);
 
-    this->currentAngle = 0.0;
+    this->resetFadeOut();
+
+    this->phase = 0.0;
     this->level = velocity * 0.15;
 
     const auto cyclesPerSecond = this->getNoteInHertz(realNoteNumber);
-    const auto cyclesPerSample = cyclesPerSecond / this->getSampleRate();
-
-    this->angleDelta = cyclesPerSample * MathConstants<double>::twoPi;
+    // the highest keys of the wide temperaments can go way above Nyquist,
+    // which would only alias anyway, but the phase wrap in renderNextBlock
+    // also relies on the delta being less than one cycle per sample
+    this->phaseDelta = jmin(cyclesPerSecond / this->getSampleRate(), 0.5);
 
     this->adsr.noteOn();
 }
@@ -83,28 +113,69 @@ void DefaultSynth::Voice::stopNote(float, bool allowTailOff)
     {
         this->clearCurrentNote();
         this->adsr.reset();
-        this->reverb.reset();
+        this->lastAmplitude = 0.f;
     }
 }
 
 void DefaultSynth::Voice::renderNextBlock(AudioBuffer<float> &outputBuffer, int startSample, int numSamples)
 {
-    if (this->adsr.isActive())
+    // the voices are rendered dry into the synth's mono bus,
+    // see DefaultSynth::renderVoices
+    jassert(outputBuffer.getNumChannels() == 1);
+
+    if (!this->adsr.isActive())
     {
-        while (--numSamples >= 0)
-        {
-            const auto amplitude = this->adsr.getNextSample();
-            auto currentSample = (float)(std::sin(currentAngle) * level * amplitude);
-            this->reverb.processMono(&currentSample, 1);
+        return;
+    }
+
+    const auto &wavetable = getDefaultSynthWavetable();
+    static constexpr auto tableSize = DefaultSynthWavetable::size;
+
+    auto *envelope = this->envelopeBuffer.getWritePointer(0);
+    auto *out = outputBuffer.getWritePointer(0, startSample);
+
+    bool isFinished = false;
+    while (numSamples > 0 && !isFinished)
+    {
+        const auto numChunkFrames = jmin(numSamples, int(DefaultSynth::Voice::chunkSize));
 
-            for (auto i = outputBuffer.getNumChannels(); i --> 0 ;)
-            {
-                outputBuffer.addSample(i, startSample, currentSample);
-            }
+        // the envelope is rendered as a block of gains,
+        // which also makes its last value easy to pick up
+        FloatVectorOperations::fill(envelope, 1.f, numChunkFrames);
+        this->adsr.applyEnvelopeToBuffer(this->envelopeBuffer, 0, numChunkFrames);
+        const auto numFrames = this->applyFadeOut(envelope, numChunkFrames, isFinished);
 
-            this->currentAngle += this->angleDelta;
-            ++startSample;
+        double phase = this->phase;
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const auto position = phase * tableSize;
+            const auto index = int(position);
+            const auto fraction = float(position - index);
+            const auto s0 = wavetable.samples[index];
+            const auto s1 = wavetable.samples[index + 1];
+            this->oscillator[i] = s0 + (s1 - s0) * fraction;
+
+            phase += this->phaseDelta;
+            phase = (phase >= 1.0) ? (phase - 1.0) : phase;
         }
+
+        this->phase = phase;
+
+        FloatVectorOperations::multiply(this->oscillator, envelope, numFrames);
+        FloatVectorOperations::addWithMultiply(out, this->oscillator, float(this->level), numFrames);
+
+        this->lastAmplitude = envelope[numFrames - 1];
+        isFinished = isFinished || !this->adsr.isActive();
+
+        out += numFrames;
+        numSamples -= numFrames;
+    }
+
+    // free the voice as soon as it's silent, so that it can be reused
+    // without stealing (the reverb tail is the synth's business now)
+    if (isFinished)
+    {
+        this->stopNote(0.f, false);
     }
 }
 
@@ -125,6 +196,18 @@ double DefaultSynth::Voice::getNoteInHertz(int noteNumber, double frequencyOfA /
         (noteNumber - this->middleC) / double(this->periodSize));
 }
 
+bool DefaultSynth::Voice::isReleasing() const noexcept
+{
+    // the default synth ignores the pedals,
+    // so once the key is up, the voice is in its release stage
+    return !this->isKeyDown();
+}
+
+float DefaultSynth::Voice::getCurrentLevel() const noexcept
+{
+    return float(this->level) * this->lastAmplitude;
+}
+
 int DefaultSynth::Voice::getCurrentChannel() const noexcept
 {
     // the only way to access channel info in SynthesizerVoice :(
@@ -144,19 +227,72 @@ int DefaultSynth::Voice::getCurrentChannel() const noexcept
 // DefaultSynth
 //===----------------------------------------------------------------------===//
 
-DefaultSynth::DefaultSynth()
+DefaultSynth::DefaultSynth() :
+    dryBuffer(1, DefaultSynth::maxChunkSize)
+{
+    Reverb::Parameters rp;
+    rp.roomSize = 0.0f;
+    rp.damping = 0.0f;
+    rp.wetLevel = 0.23f;
+    rp.dryLevel = 0.73f;
+    rp.width = 0.0f;
+    rp.freezeMode = 0.4f;
+    this->reverb.setParameters(rp);
+
+    this->setPolyphony(PolyphonicSynth::defaultPolyphony);
+    this->addSound(new DefaultSynth::Sound());
+}
+
+void DefaultSynth::setCurrentPlaybackSampleRate(double sampleRate)
 {
-    for (int i = DefaultSynth::numVoices; i --> 0 ;)
+    PolyphonicSynth::setCurrentPlaybackSampleRate(sampleRate);
+
+    if (sampleRate > 0)
     {
-        this->addVoice(new DefaultSynth::Voice());
+        const ScopedLock sl(this->lock);
+        this->reverb.setSampleRate(sampleRate);
+        this->reverb.reset();
     }
+}
 
-    this->addSound(new DefaultSynth::Sound());
+void DefaultSynth::renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples)
+{
+    // all voices are mixed dry into the mono bus, which then goes through
+    // a single reverb, instead of each voice having its own one;
+    // the bus is preallocated, so larger blocks are rendered in chunks
+    while (numSamples > 0)
+    {
+        const auto numFrames = jmin(numSamples, this->dryBuffer.getNumSamples());
+
+        this->dryBuffer.clear(0, numFrames);
+        PolyphonicSynth::renderVoices(this->dryBuffer, 0, numFrames);
+        this->reverb.processMono(this->dryBuffer.getWritePointer(0), numFrames);
+
+        for (int c = 0; c < outputAudio.getNumChannels(); ++c)
+        {
+            outputAudio.addFrom(c, startSample, this->dryBuffer, 0, 0, numFrames);
+        }
+
+        startSample += numFrames;
+        numSamples -= numFrames;
+    }
+}
+
+PolyphonicSynthVoice *DefaultSynth::createVoice()
+{
+    auto *voice = new DefaultSynth::Voice();
+    voice->setPeriodSize(this->periodSize);
+    voice->setPeriodRange(this->periodRange);
+    return voice;
 }
 
 void DefaultSynth::setPeriodSizeAndRange(int periodSize, double periodRange)
 {
     //DBG("Setting octave size for the default synth: " + String(periodSize));
+    const ScopedLock sl(this->lock);
+    this->periodSize = periodSize;
+    this->periodRange = periodRange;
+
     for (int i = 0; i < this->getNumVoices(); ++i)
     {
         if (auto *voice = dynamic_cast<DefaultSynth::Voice *>(this->getVoice(i)))
@@ -18,13 +18,16 @@
 #pragma once
 
 #include "Temperament.h"
+#include "PolyphonicSynth.h"
 
-class DefaultSynth final : public Synthesiser
+class DefaultSynth final : public PolyphonicSynth
 {
 public:
 
     DefaultSynth();
 
+    void setCurrentPlaybackSampleRate(double sampleRate) override;
+
     // what we want here is to make all built-in temperaments
     // work out of the box with the built-in instrument, so that
     // all features are easily previewed even before the user
@@ -45,7 +48,7 @@ protected:
         bool appliesToChannel(int midiChannel) override { return true; }
     };
 
-    class Voice final : public SynthesiserVoice
+    class Voice final : public PolyphonicSynthVoice
     {
     public:
 
@@ -64,18 +67,26 @@ protected:
         void setPeriodSize(int size) noexcept;
         void setPeriodRange(double periodRange) noexcept;
 
+        bool isReleasing() const noexcept override;
+        float getCurrentLevel() const noexcept override;
+
     private:
 
-        double currentAngle = 0.0;
-        double angleDelta = 0.0;
+        // the oscillator phase, in cycles
+        double phase = 0.0;
+        double phaseDelta = 0.0;
         double level = 0.0;
+        float lastAmplitude = 0.f;
+
+        static constexpr auto chunkSize = 64;
+        AudioBuffer<float> envelopeBuffer;
+        float oscillator[chunkSize];
 
         int periodSize = Globals::twelveTonePeriodSize;
         double periodRange = 2.0;
         int middleC = Temperament::periodNumForMiddleC * Globals::twelveTonePeriodSize;
 
         ADSR adsr;
-        Reverb reverb;
 
         double getNoteInHertz(int noteNumber, double frequencyOfA = 440.0) noexcept;
         int getCurrentChannel() const noexcept;
@@ -84,7 +95,17 @@ protected:
     void handleSustainPedal(int midiChannel, bool isDown) override;
     void handleSostenutoPedal(int midiChannel, bool isDown) override;
 
-    static constexpr auto numVoices = 16;
+    PolyphonicSynthVoice *createVoice() override;
+
+    void renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples) override;
+
+    static constexpr auto maxChunkSize = 512;
+    AudioBuffer<float> dryBuffer;
+    Reverb reverb;
+
+    // the new voices in the pool should know the temperament too
+    int periodSize = Globals::twelveTonePeriodSize;
+    double periodRange = 2.0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DefaultSynth)
 };
@@ -0,0 +1,281 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "PolyphonicSynth.h"
+
+//===----------------------------------------------------------------------===//
+// PolyphonicSynthVoice
+//===----------------------------------------------------------------------===//
+
+void PolyphonicSynthVoice::fadeOut() noexcept
+{
+    if (this->fadingOut)
+    {
+        return;
+    }
+
+    const auto sampleRate = this->getSampleRate();
+    const auto numFadeOutSamples = jmax(1.0,
+        sampleRate * PolyphonicSynthVoice::fadeOutTimeMs / 1000.0);
+
+    this->fadingOut = true;
+    this->fadeOutLevel = 1.f;
+    this->fadeOutStep = float(1.0 / numFadeOutSamples);
+}
+
+void PolyphonicSynthVoice::resetFadeOut() noexcept
+{
+    this->fadingOut = false;
+    this->fadeOutLevel = 1.f;
+    this->fadeOutStep = 0.f;
+}
+
+int PolyphonicSynthVoice::applyFadeOut(float *gains, int numFrames, bool &isFinished) noexcept
+{
+    if (!this->fadingOut)
+    {
+        return numFrames;
+    }
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        this->fadeOutLevel -= this->fadeOutStep;
+        if (this->fadeOutLevel <= 0.f)
+        {
+            this->fadeOutLevel = 0.f;
+            gains[i] = 0.f;
+            isFinished = true;
+            return i + 1;
+        }
+
+        gains[i] *= this->fadeOutLevel;
+    }
+
+    return numFrames;
+}
+
+//===----------------------------------------------------------------------===//
+// PolyphonicSynth
+//===----------------------------------------------------------------------===//
+
+void PolyphonicSynth::setPolyphony(int newPolyphony)
+{
+    newPolyphony = jlimit(int(PolyphonicSynth::minPolyphony),
+        int(PolyphonicSynth::maxPolyphony), newPolyphony);
+
+    this->polyphony = newPolyphony;
+
+    // the voices may own some heavy resources, like the stream rings,
+    // so they are created and deleted outside the lock: the audio thread
+    // only waits for the voices array to change; the pool is only
+    // resized on this thread, so its size can be checked without the lock
+    const auto poolSize = newPolyphony + PolyphonicSynth::numSpareVoices;
+
+    OwnedArray<SynthesiserVoice> newVoices;
+    for (int i = this->getNumVoices(); i < poolSize; ++i)
+    {
+        newVoices.add(this->createVoice());
+    }
+
+    OwnedArray<SynthesiserVoice> removedVoices;
+
+    {
+        const ScopedLock sl(this->lock);
+
+        while (this->voices.size() > poolSize)
+        {
+            removedVoices.add(this->voices.removeAndReturn(this->voices.size() - 1));
+        }
+
+        while (!newVoices.isEmpty())
+        {
+            // addVoice also sets the voice's sample rate
+            this->addVoice(newVoices.removeAndReturn(0));
+        }
+    }
+}
+
+int PolyphonicSynth::getPolyphony() const noexcept
+{
+    return this->polyphony.get();
+}
+
+PolyphonicSynth::VoiceStats PolyphonicSynth::getVoiceStats() const noexcept
+{
+    VoiceStats stats;
+    stats.polyphony = this->polyphony.get();
+    stats.numActiveVoices = this->numActiveVoices.get();
+    stats.peakActiveVoices = this->peakActiveVoices.get();
+    stats.numStolenVoices = this->numStolenVoices.get();
+    return stats;
+}
+
+SynthesiserVoice *PolyphonicSynth::findFreeVoice(SynthesiserSound *soundToPlay,
+    int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    const ScopedLock sl(this->lock);
+
+    int numPlayingVoices = 0;
+    SynthesiserVoice *freeVoice = nullptr;
+    PolyphonicSynthVoice *oldestFadingVoice = nullptr;
+    for (auto *v : this->voices)
+    {
+        jassert(dynamic_cast<PolyphonicSynthVoice *>(v));
+        auto *voice = static_cast<PolyphonicSynthVoice *>(v);
+
+        if (!voice->isVoiceActive())
+        {
+            if (freeVoice == nullptr && voice->canPlaySound(soundToPlay))
+            {
+                freeVoice = voice;
+            }
+        }
+        else if (voice->isFadingOut())
+        {
+            if (oldestFadingVoice == nullptr || voice->wasStartedBefore(*oldestFadingVoice))
+            {
+                oldestFadingVoice = voice;
+            }
+        }
+        else
+        {
+            numPlayingVoices++;
+        }
+    }
+
+    if (numPlayingVoices < this->polyphony.get())
+    {
+        if (freeVoice != nullptr)
+        {
+            return freeVoice;
+        }
+
+        // all the spare voices are still fading out,
+        // so cutting the oldest of them is the least audible option
+        if (stealIfNoneAvailable && oldestFadingVoice != nullptr &&
+            oldestFadingVoice->canPlaySound(soundToPlay))
+        {
+            return oldestFadingVoice;
+        }
+    }
+
+    if (!stealIfNoneAvailable)
+    {
+        return nullptr;
+    }
+
+    auto *victim = static_cast<PolyphonicSynthVoice *>(this->findVoiceToSteal(soundToPlay,
+        midiChannel, midiNoteNumber));
+
+    if (victim == nullptr)
+    {
+        return freeVoice;
+    }
+
+    this->numStolenVoices += 1;
+
+    if (freeVoice != nullptr)
+    {
+        victim->fadeOut();
+        return freeVoice;
+    }
+
+    // no spare voices left, so the victim will be cut off by startVoice
+    return victim;
+}
+
+SynthesiserVoice *PolyphonicSynth::findVoiceToSteal(SynthesiserSound *soundToPlay,
+    int, int) const
+{
+    // the voice is the better one to steal if it is in its release stage,
+    // or, failing that, if its key is up (held by a pedal); then if it
+    // is quieter, and then if it is older; the levels are compared
+    // in 6 dB steps, otherwise the age would never matter
+    const auto getStealingTier = [](const PolyphonicSynthVoice *voice)
+    {
+        return voice->isReleasing() ? 0 : (voice->isKeyDown() ? 2 : 1);
+    };
+
+    const auto getLevelStep = [](const PolyphonicSynthVoice *voice)
+    {
+        return int(Decibels::gainToDecibels(voice->getCurrentLevel()) / 6.f);
+    };
+
+    const auto isBetterVictim = [&](const PolyphonicSynthVoice *a, const PolyphonicSynthVoice *b)
+    {
+        const auto aTier = getStealingTier(a);
+        const auto bTier = getStealingTier(b);
+        if (aTier != bTier)
+        {
+            return aTier < bTier;
+        }
+
+        const auto aLevel = getLevelStep(a);
+        const auto bLevel = getLevelStep(b);
+        if (aLevel != bLevel)
+        {
+            return aLevel < bLevel;
+        }
+
+        return a->wasStartedBefore(*b);
+    };
+
+    const ScopedLock sl(this->lock);
+
+    PolyphonicSynthVoice *result = nullptr;
+    PolyphonicSynthVoice *oldestFadingVoice = nullptr;
+    for (auto *v : this->voices)
+    {
+        auto *voice = static_cast<PolyphonicSynthVoice *>(v);
+        if (!voice->isVoiceActive() || !voice->canPlaySound(soundToPlay))
+        {
+            continue;
+        }
+
+        if (voice->isFadingOut())
+        {
+            if (oldestFadingVoice == nullptr || voice->wasStartedBefore(*oldestFadingVoice))
+            {
+                oldestFadingVoice = voice;
+            }
+        }
+        else if (result == nullptr || isBetterVictim(voice, result))
+        {
+            result = voice;
+        }
+    }
+
+    return result != nullptr ? result : oldestFadingVoice;
+}
+
+void PolyphonicSynth::renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples)
+{
+    Synthesiser::renderVoices(outputAudio, startSample, numSamples);
+
+    int numActive = 0;
+    for (auto *voice : this->voices)
+    {
+        numActive += voice->isVoiceActive() ? 1 : 0;
+    }
+
+    this->numActiveVoices = numActive;
+    if (numActive > this->peakActiveVoices.get())
+    {
+        this->peakActiveVoices = numActive;
+    }
+}
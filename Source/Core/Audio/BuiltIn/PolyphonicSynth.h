@@ -0,0 +1,110 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// The voices of the built-in synths can be stolen gracefully:
+// instead of being cut off (which clicks), the stolen voice fades out
+// for a few milliseconds, while the new note starts in a spare voice.
+
+class PolyphonicSynthVoice : public SynthesiserVoice
+{
+public:
+
+    PolyphonicSynthVoice() = default;
+
+    // the stealing priorities, see PolyphonicSynth::findVoiceToSteal
+    virtual bool isReleasing() const noexcept = 0;
+    virtual float getCurrentLevel() const noexcept = 0;
+
+    void fadeOut() noexcept;
+    bool isFadingOut() const noexcept { return this->fadingOut; }
+
+protected:
+
+    void resetFadeOut() noexcept;
+
+    // multiplies the gains by the fade-out ramp, if the voice is fading out;
+    // returns the number of frames to render, and sets the flag
+    // if the voice goes silent after that many frames
+    int applyFadeOut(float *gains, int numFrames, bool &isFinished) noexcept;
+
+    static constexpr auto fadeOutTimeMs = 5.0;
+
+private:
+
+    bool fadingOut = false;
+    float fadeOutLevel = 1.f;
+    float fadeOutStep = 0.f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphonicSynthVoice)
+};
+
+class PolyphonicSynth : public Synthesiser
+{
+public:
+
+    PolyphonicSynth() = default;
+
+    static constexpr auto minPolyphony = 1;
+    static constexpr auto maxPolyphony = 256;
+    static constexpr auto defaultPolyphony = 32;
+
+    // resizes the voice pool, creating and deleting the voices
+    // outside the synth lock, so this is not for the audio thread
+    void setPolyphony(int newPolyphony);
+    int getPolyphony() const noexcept;
+
+    struct VoiceStats final
+    {
+        int polyphony = 0;
+        int numActiveVoices = 0;
+        int peakActiveVoices = 0;
+        int numStolenVoices = 0;
+    };
+
+    // safe to call from any thread, e.g. by the UI timer
+    VoiceStats getVoiceStats() const noexcept;
+
+protected:
+
+    // all voices in the pool are of the same type, created by subclasses,
+    // which are expected to call setPolyphony to fill the pool
+    virtual PolyphonicSynthVoice *createVoice() = 0;
+
+    SynthesiserVoice *findFreeVoice(SynthesiserSound *soundToPlay,
+        int midiChannel, int midiNoteNumber, bool stealIfNoneAvailable) const override;
+
+    SynthesiserVoice *findVoiceToSteal(SynthesiserSound *soundToPlay,
+        int midiChannel, int midiNoteNumber) const override;
+
+    void renderVoices(AudioBuffer<float> &outputAudio, int startSample, int numSamples) override;
+
+private:
+
+    // the pool is a bit larger than the polyphony, so that the stolen
+    // voices can fade out while the new notes start in the spare ones
+    static constexpr auto numSpareVoices = 8;
+
+    Atomic<int> polyphony = 0;
+
+    Atomic<int> numActiveVoices = 0;
+    Atomic<int> peakActiveVoices = 0;
+    mutable Atomic<int> numStolenVoices = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphonicSynth)
+};
@@ -630,11 +630,12 @@ public:
 
     void read();
 
-    SharedAudioSampleBuffer::Ptr readSamples();
+    SharedPcmSampleData::Ptr mapSamples();
 
 private:
 
     SoundFont2Sound &sf2Sound;
+    const File file;
 
     UniquePointer<FileInputStream> fileInputStream;
 
@@ -645,6 +646,7 @@ private:
 
 SoundFont2Reader::SoundFont2Reader(SoundFont2Sound &soundIn, const File &fileIn) :
     sf2Sound(soundIn),
+    file(fileIn),
     fileInputStream(fileIn.createInputStream()) {}
 
 void SoundFont2Reader::read()
@@ -811,10 +813,8 @@ void SoundFont2Reader::read()
     }
 }
 
-SharedAudioSampleBuffer::Ptr SoundFont2Reader::readSamples()
+SharedPcmSampleData::Ptr SoundFont2Reader::mapSamples()
 {
-    static const int bufferSize = 32768;
-
     if (this->fileInputStream == nullptr)
     {
         this->sf2Sound.addError("Couldn't open file.");
@@ -858,38 +858,18 @@ SharedAudioSampleBuffer::Ptr SoundFont2Reader::readSamples()
         return nullptr;
     }
 
-    const int numSamples = (int)chunk.size / sizeof(short);
-    SharedAudioSampleBuffer::Ptr sampleBuffer(new SharedAudioSampleBuffer(1, numSamples));
+    // the stream is no longer needed, so that the file isn't kept open twice
+    const auto chunkStart = chunk.start;
+    const auto chunkSize = int64(chunk.size);
+    this->fileInputStream = nullptr;
 
-    // Read and convert.
-    HeapBlock<short> buffer(bufferSize);
-    int samplesLeft = numSamples;
-    float *out = sampleBuffer->getWritePointer(0);
-    while (samplesLeft > 0)
+    auto pcmData = SharedPcmSampleData::map(this->file, chunkStart, chunkSize);
+    if (pcmData == nullptr)
     {
-        // Read <= 32768 bytes at a time from the buffer
-        int samplesToRead = bufferSize;
-        if (samplesToRead > samplesLeft)
-        {
-            samplesToRead = samplesLeft;
-        }
-
-        this->fileInputStream->read(buffer.getData(), samplesToRead * sizeof(short));
-
-        // Convert from signed 16-bit to float.
-        int samplesToConvert = samplesToRead;
-        short *in = buffer.getData();
-        for (; samplesToConvert > 0; --samplesToConvert)
-        {
-            // If we ever need to compile for big-endian platforms, we'll need to
-            // byte-swap here.
-            *out++ = *in++ / 32767.0f;
-        }
-
-        samplesLeft -= samplesToRead;
+        this->sf2Sound.addError("Couldn't map the SF2 sample data.");
     }
 
-    return sampleBuffer;
+    return pcmData;
 }
 
 void SoundFont2Reader::addGeneratorToRegion(sf2word genOper, SF2::genAmountType *amount, SoundFontRegion *region)
@@ -1095,15 +1075,17 @@ void SoundFont2Sound::loadSamples(AudioFormatManager &formatManager)
         this reader adds any errors encountered while reading to the SoundFont2Sound object
     */
     SoundFont2Reader reader(*this, this->file);
-    const auto buffer = reader.readSamples();
+    this->pcmData = reader.mapSamples();
 
-    if (buffer)
+    if (this->pcmData != nullptr)
     {
-        // All the SFZSamples will share the buffer.
+        // All the SFZSamples will share the mapped data.
         for (auto &sample : this->samplesByRate)
         {
-            sample.second->setBuffer(buffer);
+            sample.second->setPcmData(this->pcmData);
         }
+
+        this->prefetchSelectedPreset();
     }
 }
 
@@ -1138,6 +1120,26 @@ void SoundFont2Sound::setSelectedPreset(int whichPreset)
     this->selectedPreset = whichPreset;
     this->regions.clear();
     this->regions.addArray(this->presets[whichPreset]->regions);
+    this->prefetchSelectedPreset();
+}
+
+// only the selected preset's samples are paged in, so switching presets
+// doesn't have to wait for anything, and the memory usage
+// doesn't depend on the size of the whole bank
+void SoundFont2Sound::prefetchSelectedPreset()
+{
+    if (this->pcmData == nullptr)
+    {
+        return;
+    }
+
+    Array<Range<int>> sampleRanges;
+    for (const auto *region : this->regions)
+    {
+        sampleRanges.add({ int(region->offset), int(region->end) + 1 });
+    }
+
+    this->prefetcher->prefetch(this->pcmData, sampleRanges);
 }
 
 int SoundFont2Sound::getSelectedPreset() const
@@ -42,6 +42,10 @@ public:
 
 private:
 
+    void prefetchSelectedPreset();
+    SharedPcmSampleData::Ptr pcmData;
+    SharedResourcePointer<SoundFontPrefetcher> prefetcher;
+
     friend class SoundFont2Reader;
     void addPreset(UniquePointer<Preset> &&preset);
 
@@ -0,0 +1,286 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "SoundFontDiskStreamer.h"
+#include "RealtimeSafety.h"
+
+static inline uint64 packStreamPosition(uint32 generation, int position) noexcept
+{
+    return (uint64(generation) << 32) | uint64(uint32(position));
+}
+
+//===----------------------------------------------------------------------===//
+// SoundFontStream
+//===----------------------------------------------------------------------===//
+
+SoundFontStream::SoundFontStream(SoundFontDiskStreamer &streamer) :
+    streamer(streamer),
+    ring(SoundFontStream::maxChannels, SoundFontStream::ringSize)
+{
+    this->ring.clear();
+    this->streamer.addStream(this);
+}
+
+SoundFontStream::~SoundFontStream()
+{
+    this->streamer.removeStream(this);
+}
+
+void SoundFontStream::start(SoundFontStreamSource::Ptr source, int startPosition) noexcept
+{
+    // the disk thread only holds this lock for as long as it takes
+    // to pick up the pending source, so it's fine to spin here;
+    // the sample holds a reference to the source too, so that
+    // replacing the pointer never deletes anything on the audio thread
+    const SpinLock::ScopedLockType lock(this->pendingSourceLock);
+    this->pendingSource = source;
+    this->pendingStartPosition = startPosition;
+    this->readPosition.store(startPosition);
+    this->lastWakeUpPosition = startPosition;
+    this->generation.fetch_add(1);
+    this->streamer.wakeUp();
+}
+
+void SoundFontStream::stop() noexcept
+{
+    const SpinLock::ScopedLockType lock(this->pendingSourceLock);
+    if (this->pendingSource != nullptr)
+    {
+        this->pendingSource = nullptr;
+        this->generation.fetch_add(1);
+    }
+}
+
+int SoundFontStream::getAvailableEnd() const noexcept
+{
+    const auto filled = this->filledEnd.load();
+    if (uint32(filled >> 32) != this->generation.load())
+    {
+        return 0; // the disk thread hasn't caught up with the restart yet
+    }
+
+    return int(uint32(filled & 0xffffffff));
+}
+
+void SoundFontStream::setReadPosition(int position) noexcept
+{
+    this->readPosition.store(position);
+
+    // the disk thread reads in chunks, so there's
+    // no need to wake it up before it can read one
+    if (position - this->lastWakeUpPosition >= SoundFontDiskStreamer::readChunkSize)
+    {
+        this->lastWakeUpPosition = position;
+        this->streamer.wakeUp();
+    }
+}
+
+bool SoundFontStream::waitUntilAvailable(int position, int timeoutMs) noexcept
+{
+    // the disk thread never reads further than the ring can hold
+    const auto endPosition = jmin(position, this->readPosition.load() +
+        SoundFontStream::ringSize - SoundFontStream::maxTapsBehind);
+
+    if (this->getAvailableEnd() >= endPosition)
+    {
+        return true;
+    }
+
+    // the renderer is free to block on the disk
+    const RealtimeSafety::ScopedAllowance waitingForTheDisk;
+
+    const auto deadline = Time::getMillisecondCounter() + uint32(timeoutMs);
+    while (this->getAvailableEnd() < endPosition)
+    {
+        const auto now = Time::getMillisecondCounter();
+        if (now >= deadline)
+        {
+            return false;
+        }
+
+        this->streamer.wakeUp();
+        this->filled.wait(int(deadline - now));
+    }
+
+    return true;
+}
+
+//===----------------------------------------------------------------------===//
+// SoundFontDiskStreamer
+//===----------------------------------------------------------------------===//
+
+SoundFontDiskStreamer::SoundFontDiskStreamer() :
+    Thread("SoundFont disk streamer"),
+    readBuffer(SoundFontStream::maxChannels, SoundFontDiskStreamer::readChunkSize)
+{
+    this->formatManager.registerBasicFormats();
+
+    // the voices can't wait for the disk, so this one runs
+    // with a higher priority than the other background threads
+    this->startThread(7);
+}
+
+SoundFontDiskStreamer::~SoundFontDiskStreamer()
+{
+    this->stopThread(1000);
+}
+
+void SoundFontDiskStreamer::addStream(SoundFontStream *stream)
+{
+    const ScopedLock sl(this->streamsLock);
+    this->streams.addIfNotAlreadyThere(stream);
+}
+
+void SoundFontDiskStreamer::removeStream(SoundFontStream *stream)
+{
+    while (true)
+    {
+        {
+            const ScopedLock sl(this->streamsLock);
+            this->streams.removeFirstMatchingValue(stream);
+            if (this->streamInService != stream)
+            {
+                return;
+            }
+        }
+
+        this->streamServiced.wait(SoundFontDiskStreamer::idleWaitMs);
+    }
+}
+
+void SoundFontDiskStreamer::wakeUp() noexcept
+{
+    // the event's lock is only held for a moment by this thread's waits
+    const RealtimeSafety::ScopedAllowance wakingUpTheStreamer;
+    this->notify();
+}
+
+void SoundFontDiskStreamer::run()
+{
+    while (!this->threadShouldExit())
+    {
+        bool hasReadAnything = false;
+
+        {
+            const ScopedLock sl(this->streamsLock);
+            this->streamsToService.clearQuick();
+            this->streamsToService.addArray(this->streams);
+        }
+
+        for (auto *stream : this->streamsToService)
+        {
+            {
+                // the stream might have been removed since the list was copied
+                const ScopedLock sl(this->streamsLock);
+                if (!this->streams.contains(stream))
+                {
+                    continue;
+                }
+
+                this->streamInService = stream;
+            }
+
+            hasReadAnything = this->serviceStream(*stream) || hasReadAnything;
+
+            {
+                const ScopedLock sl(this->streamsLock);
+                this->streamInService = nullptr;
+            }
+
+            this->streamServiced.signal();
+        }
+
+        if (!hasReadAnything)
+        {
+            this->wait(SoundFontDiskStreamer::idleWaitMs);
+        }
+    }
+}
+
+bool SoundFontDiskStreamer::serviceStream(SoundFontStream &stream)
+{
+    // first, check if the voice has restarted or stopped the stream
+    uint32 generation = 0;
+    SoundFontStreamSource::Ptr pendingSource;
+    int pendingStartPosition = 0;
+
+    {
+        const SpinLock::ScopedLockType lock(stream.pendingSourceLock);
+        generation = stream.generation.load();
+        if (generation != stream.servedGeneration)
+        {
+            pendingSource = stream.pendingSource;
+            pendingStartPosition = stream.pendingStartPosition;
+        }
+    }
+
+    if (generation != stream.servedGeneration)
+    {
+        if (pendingSource != stream.currentSource)
+        {
+            stream.reader = nullptr;
+            if (pendingSource != nullptr)
+            {
+                stream.reader.reset(this->formatManager.createReaderFor(pendingSource->file));
+            }
+        }
+
+        stream.currentSource = pendingSource;
+        stream.servedGeneration = generation;
+        stream.writePosition = pendingStartPosition;
+        stream.filledEnd.store(packStreamPosition(generation, pendingStartPosition));
+    }
+
+    if (stream.currentSource == nullptr || stream.reader == nullptr)
+    {
+        return false;
+    }
+
+    // then, read ahead as much as fits into the ring,
+    // keeping the samples behind the voice's position for its interpolation
+    const auto readPosition = stream.readPosition.load();
+    const auto numFree = SoundFontStream::ringSize - SoundFontStream::maxTapsBehind -
+        (stream.writePosition - readPosition);
+
+    const auto numRemaining = stream.currentSource->length - stream.writePosition;
+    const auto numToRead = jmin(int(SoundFontDiskStreamer::readChunkSize), numFree, numRemaining);
+    if (numToRead <= 0)
+    {
+        return false;
+    }
+
+    // mono files are copied into both channels by the reader
+    this->readBuffer.clear();
+    stream.reader->read(&this->readBuffer, 0, numToRead, stream.writePosition, true, true);
+
+    const auto ringStart = stream.writePosition & (SoundFontStream::ringSize - 1);
+    const auto numBeforeWrap = jmin(numToRead, SoundFontStream::ringSize - ringStart);
+    for (int c = 0; c < SoundFontStream::maxChannels; ++c)
+    {
+        stream.ring.copyFrom(c, ringStart, this->readBuffer, c, 0, numBeforeWrap);
+        if (numBeforeWrap < numToRead)
+        {
+            stream.ring.copyFrom(c, 0, this->readBuffer, c, numBeforeWrap, numToRead - numBeforeWrap);
+        }
+    }
+
+    stream.writePosition += numToRead;
+    stream.filledEnd.store(packStreamPosition(generation, stream.writePosition));
+    stream.filled.signal();
+    return true;
+}
@@ -0,0 +1,162 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Large sfz samples are not loaded into memory entirely: only their heads
+// are resident (see SoundFontSample::streamingPreloadTimeMs), and the rest
+// is read from the disk while they are played, so that the memory usage
+// doesn't depend on the size of the sample library.
+
+// Each voice owns a SoundFontStream, a ring buffer which is read by the voice
+// on the audio thread, and filled ahead of the voice's read position
+// by the disk thread shared by all synths, SoundFontDiskStreamer;
+// the voices wake it up when they start or have consumed a chunk,
+// so that it doesn't have to poll the streams when they don't need it.
+
+class SoundFontDiskStreamer;
+
+// what to stream: shared by the sample and the voices playing it
+class SoundFontStreamSource final : public ReferenceCountedObject
+{
+public:
+
+    using Ptr = ReferenceCountedObjectPtr<SoundFontStreamSource>;
+
+    SoundFontStreamSource(const File &file, int numChannels, int length, int headLength) :
+        file(file), numChannels(numChannels), length(length), headLength(headLength) {}
+
+    const File file;
+    const int numChannels;
+    const int length;
+    const int headLength; // the samples before this position are resident
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontStreamSource)
+};
+
+class SoundFontStream final
+{
+public:
+
+    explicit SoundFontStream(SoundFontDiskStreamer &streamer);
+    ~SoundFontStream();
+
+    static constexpr auto ringSize = 1 << 14; // in samples, per channel
+    static constexpr auto maxChannels = 2;
+
+    //===------------------------------------------------------------------===//
+    // Audio thread
+    //===------------------------------------------------------------------===//
+
+    // asks the disk thread to start reading the source from the given position
+    void start(SoundFontStreamSource::Ptr source, int startPosition) noexcept;
+    void stop() noexcept;
+
+    // the voice reads [readPosition, getAvailableEnd()) and tells
+    // the stream how far it got, so that the disk thread can reuse the rest
+    int getAvailableEnd() const noexcept;
+    void setReadPosition(int position) noexcept;
+
+    // the offline rendering can't afford to play silence when the disk is late,
+    // so it waits for the disk thread to fill the stream up to the given position,
+    // or as far as the ring allows; returns false if that took too long
+    bool waitUntilAvailable(int position, int timeoutMs) noexcept;
+
+    float getSample(int channel, int position) const noexcept
+    {
+        return this->ring.getSample(jmin(channel, this->ring.getNumChannels() - 1),
+            position & (SoundFontStream::ringSize - 1));
+    }
+
+    // the interpolation reads a few samples around the voice's position,
+    // so the disk thread keeps that many behind the read position intact
+    static constexpr auto maxTapsBehind = 4;
+
+private:
+
+    friend class SoundFontDiskStreamer;
+
+    SoundFontDiskStreamer &streamer;
+
+    AudioBuffer<float> ring;
+
+    // written by the audio thread:
+    SpinLock pendingSourceLock;
+    SoundFontStreamSource::Ptr pendingSource;
+    int pendingStartPosition = 0;
+    std::atomic<uint32> generation = { 0 };
+    std::atomic<int> readPosition = { 0 };
+    int lastWakeUpPosition = 0;
+
+    // written by the disk thread, the generation it was filled for
+    // in the high 32 bits, and the end of the valid data in the low ones:
+    std::atomic<uint64> filledEnd = { 0 };
+    WaitableEvent filled;
+
+    // only used by the disk thread:
+    uint32 servedGeneration = 0;
+    SoundFontStreamSource::Ptr currentSource;
+    UniquePointer<AudioFormatReader> reader;
+    int writePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontStream)
+};
+
+class SoundFontDiskStreamer final : private Thread
+{
+public:
+
+    SoundFontDiskStreamer();
+    ~SoundFontDiskStreamer() override;
+
+    void addStream(SoundFontStream *stream);
+
+    // if the disk thread is reading into this stream right now,
+    // waits for that read to finish, which is one chunk at most
+    void removeStream(SoundFontStream *stream);
+
+    // called by the streams on the audio thread
+    void wakeUp() noexcept;
+
+    static constexpr auto readChunkSize = 4096;
+
+private:
+
+    void run() override;
+
+    // returns true if there was anything to read
+    bool serviceStream(SoundFontStream &stream);
+
+    // the streams are normally woken up on demand,
+    // this is just in case a wake-up was missed
+    static constexpr auto idleWaitMs = 50;
+
+    // the list is only locked to add or remove the streams, and to pick
+    // the next stream to service, but not while reading from the disk
+    CriticalSection streamsLock;
+    Array<SoundFontStream *> streams;
+    SoundFontStream *streamInService = nullptr;
+    WaitableEvent streamServiced;
+
+    // the copy of the list for the disk thread to iterate
+    Array<SoundFontStream *> streamsToService;
+
+    AudioFormatManager formatManager;
+    AudioBuffer<float> readBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontDiskStreamer)
+};
@@ -21,17 +21,8 @@
 
 #pragma once
 
-class SharedAudioSampleBuffer final : public ReferenceCountedObject, public AudioSampleBuffer
-{
-public:
-
-    using Ptr = ReferenceCountedObjectPtr<SharedAudioSampleBuffer>;
-
-    explicit SharedAudioSampleBuffer(int numChannels, int numSamples) :
-        AudioSampleBuffer(numChannels, numSamples) {}
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedAudioSampleBuffer)
-};
+#include "SoundFontSamplePool.h"
+#include "SoundFontDiskStreamer.h"
 
 class SoundFontSample final
 {
@@ -46,49 +37,106 @@ public:
     File getFile() const noexcept { return this->file; }
     String getShortName() const noexcept { return this->file.getFileName(); }
 
+    // the sample data is either decoded into floats (sfz),
+    // or memory-mapped 16-bit mono pcm (sf2), see SharedPcmSampleData
+    bool hasData() const noexcept
+    {
+        return this->buffer != nullptr || this->pcmData != nullptr;
+    }
+
     const AudioSampleBuffer *getBuffer() const noexcept { return this->buffer.get(); }
-    void setBuffer(SharedAudioSampleBuffer::Ptr newBuffer)
+    const SharedPcmSampleData *getPcmData() const noexcept { return this->pcmData.get(); }
+
+    // if the sample is streamed, the buffer only contains its head,
+    // and the rest of it is read by the voices from the disk
+    const SoundFontStreamSource::Ptr &getStreamSource() const noexcept { return this->streamSource; }
+
+    void setPcmData(SharedPcmSampleData::Ptr newData)
     {
-        this->buffer = newBuffer;
-        if (this->buffer != nullptr)
-        {
-            this->sampleLength = this->buffer->getNumSamples();
-        }
-        else
-        {
-            this->sampleLength = 0;
-        }
+        this->buffer = nullptr;
+        this->pcmData = newData;
+        this->sampleLength = this->pcmData != nullptr ?
+            uint64(this->pcmData->getNumSamples()) : 0;
     }
 
     double getSampleRate() const noexcept { return this->sampleRate; }
     uint64 getSampleLength() const noexcept { return this->sampleLength; }
     uint64 getLoopStart() const noexcept { return this->loopStart; }
     uint64 getLoopEnd() const noexcept { return this->loopEnd; }
-    
-    bool load(AudioFormatManager &formatManager)
+
+    static constexpr auto streamingPreloadTimeMs = 250;
+    static constexpr auto streamingMinLengthSeconds = 2;
+
+    // the samples which might be looped are always loaded entirely,
+    // others are only streamed if they are long enough to bother
+    bool load(AudioFormatManager &formatManager,
+        SoundFontSamplePool &samplePool, bool allowStreaming)
     {
-        UniquePointer<AudioFormatReader> reader(formatManager.createReaderFor(this->file));
-        if (reader == nullptr)
+        const auto sourceFile = this->file;
+
+        // the pool key of a streamed sample is not the range it was read from
+        // (which is unknown until the file is opened), but an empty range,
+        // so that it's never mixed up with the same sample loaded entirely
+        const auto rangeLength = allowStreaming ? 0 : sourceFile.getSize();
+
+        this->buffer = samplePool.getOrLoad(sourceFile, 0, rangeLength,
+            [&formatManager, sourceFile, allowStreaming]() -> SharedAudioSampleBuffer::Ptr
+            {
+                UniquePointer<AudioFormatReader> reader(formatManager.createReaderFor(sourceFile));
+                if (reader == nullptr)
+                {
+                    return nullptr;
+                }
+
+                const auto length = uint64(reader->lengthInSamples);
+                jassert(length < std::numeric_limits<int>::max());
+
+                const auto *metadata = &reader->metadataValues;
+                const int numLoops = metadata->getValue("NumSampleLoops", "0").getIntValue();
+
+                auto numSamplesToRead = length;
+                if (allowStreaming && numLoops == 0 &&
+                    length > uint64(reader->sampleRate * SoundFontSample::streamingMinLengthSeconds))
+                {
+                    numSamplesToRead = uint64(reader->sampleRate *
+                        SoundFontSample::streamingPreloadTimeMs / 1000.0);
+                }
+
+                // Read some extra samples, which will be filled with zeros, so interpolation
+                // can be done without having to check for the edge all the time.
+                // (for the streamed samples, these are the actual samples after the head)
+                SharedAudioSampleBuffer::Ptr result(new SharedAudioSampleBuffer(reader->numChannels,
+                    static_cast<int>(numSamplesToRead + 4)));
+                reader->read(result.get(), 0, static_cast<int>(numSamplesToRead + 4), 0, true, true);
+
+                result->sourceSampleRate = reader->sampleRate;
+                result->sourceLength = length;
+
+                if (numLoops > 0)
+                {
+                    result->sourceLoopStart = metadata->getValue("Loop0Start", "0").getLargeIntValue();
+                    result->sourceLoopEnd = metadata->getValue("Loop0End", "0").getLargeIntValue();
+                }
+
+                return result;
+            });
+
+        if (this->buffer == nullptr)
         {
             return false;
         }
 
-        this->sampleRate = reader->sampleRate;
-        this->sampleLength = reader->lengthInSamples;
-
-        // Read some extra samples, which will be filled with zeros, so interpolation
-        // can be done without having to check for the edge all the time.
-        jassert(this->sampleLength < std::numeric_limits<int>::max());
-
-        this->buffer = new SharedAudioSampleBuffer(reader->numChannels, static_cast<int>(this->sampleLength + 4));
-        reader->read(this->buffer.get(), 0, static_cast<int>(this->sampleLength + 4), 0, true, true);
+        this->sampleRate = this->buffer->sourceSampleRate;
+        this->sampleLength = this->buffer->sourceLength;
+        this->loopStart = this->buffer->sourceLoopStart;
+        this->loopEnd = this->buffer->sourceLoopEnd;
 
-        const auto *metadata = &reader->metadataValues;
-        const int numLoops = metadata->getValue("NumSampleLoops", "0").getIntValue();
-        if (numLoops > 0)
+        const auto headLength = this->buffer->getNumSamples() - 4;
+        this->streamSource = nullptr;
+        if (uint64(headLength) < this->sampleLength)
         {
-            this->loopStart = metadata->getValue("Loop0Start", "0").getLargeIntValue();
-            this->loopEnd = metadata->getValue("Loop0End", "0").getLargeIntValue();
+            this->streamSource = new SoundFontStreamSource(this->file,
+                this->buffer->getNumChannels(), int(this->sampleLength), headLength);
         }
 
         return true;
@@ -98,9 +146,13 @@ private:
 
     File file;
 
-    // all samples share the single buffer:
     SharedAudioSampleBuffer::Ptr buffer;
 
+    // all sf2 samples share the single mapped chunk:
+    SharedPcmSampleData::Ptr pcmData;
+
+    SoundFontStreamSource::Ptr streamSource;
+
     double sampleRate = 0.0;
     uint64 sampleLength = 0;
     uint64 loopStart = 0;
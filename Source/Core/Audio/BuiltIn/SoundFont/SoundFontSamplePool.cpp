@@ -0,0 +1,206 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "SoundFontSamplePool.h"
+
+//===----------------------------------------------------------------------===//
+// SharedPcmSampleData
+//===----------------------------------------------------------------------===//
+
+SharedPcmSampleData::Ptr SharedPcmSampleData::map(const File &file,
+    int64 rangeStart, int64 rangeLength)
+{
+    Ptr result(new SharedPcmSampleData());
+
+    const Range<int64> range(rangeStart, rangeStart + rangeLength);
+    result->mappedFile = make<MemoryMappedFile>(file, range, MemoryMappedFile::readOnly);
+
+    // the mapped range is aligned to the page size,
+    // so it starts somewhat earlier than requested
+    const auto mappedRange = result->mappedFile->getRange();
+    if (result->mappedFile->getData() == nullptr || !mappedRange.contains(range))
+    {
+        return nullptr;
+    }
+
+    const auto offset = size_t(rangeStart - mappedRange.getStart());
+    const auto *bytes = static_cast<const char *>(result->mappedFile->getData());
+
+    // riff chunks are word-aligned, so this should be fine:
+    jassert((reinterpret_cast<pointer_sized_int>(bytes + offset) % sizeof(int16)) == 0);
+
+    result->data = reinterpret_cast<const int16 *>(bytes + offset);
+    result->numSamples = int(rangeLength / int64(sizeof(int16)));
+    return result;
+}
+
+//===----------------------------------------------------------------------===//
+// SoundFontPrefetcher
+//===----------------------------------------------------------------------===//
+
+SoundFontPrefetcher::SoundFontPrefetcher() : Thread("SoundFontPrefetcher")
+{
+    this->startThread(3);
+}
+
+SoundFontPrefetcher::~SoundFontPrefetcher()
+{
+    this->stopThread(1000);
+}
+
+void SoundFontPrefetcher::prefetch(SharedPcmSampleData::Ptr pcmData,
+    const Array<Range<int>> &sampleRanges)
+{
+    jassert(pcmData != nullptr);
+
+    // stops the job in progress for the same data, if any
+    const auto generation = ++pcmData->prefetchGeneration;
+
+    const ScopedLock sl(this->jobsLock);
+
+    for (int i = this->jobs.size(); --i >= 0;)
+    {
+        if (this->jobs.getReference(i).pcmData == pcmData)
+        {
+            this->jobs.remove(i);
+        }
+    }
+
+    if (!sampleRanges.isEmpty())
+    {
+        this->jobs.add({ move(pcmData), sampleRanges, generation });
+        this->notify();
+    }
+}
+
+void SoundFontPrefetcher::run()
+{
+    static constexpr auto samplesPerPage = 4096 / int(sizeof(int16));
+
+    while (!this->threadShouldExit())
+    {
+        Job job;
+
+        {
+            const ScopedLock sl(this->jobsLock);
+            if (!this->jobs.isEmpty())
+            {
+                job = this->jobs.getReference(0);
+                this->jobs.remove(0);
+            }
+        }
+
+        if (job.pcmData == nullptr)
+        {
+            this->wait(-1);
+            continue;
+        }
+
+        // the job holds a reference, so the mapping outlives it
+        const auto &pcm = *job.pcmData;
+        bool isCancelled = false;
+        volatile int16 touched = 0;
+        for (const auto &range : job.sampleRanges)
+        {
+            const auto start = jlimit(0, pcm.numSamples, range.getStart());
+            const auto end = jlimit(0, pcm.numSamples, range.getEnd());
+            for (int i = start; i < end && !isCancelled; i += samplesPerPage)
+            {
+                // another preset has been selected, or the app is quitting
+                isCancelled = pcm.prefetchGeneration.get() != job.generation ||
+                    this->threadShouldExit();
+
+                touched = pcm.data[i];
+            }
+        }
+
+        ignoreUnused(touched);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// SoundFontSamplePool
+//===----------------------------------------------------------------------===//
+
+SharedAudioSampleBuffer::Ptr SoundFontSamplePool::getOrLoad(const File &file,
+    int64 rangeStart, int64 rangeLength, const Loader &loader)
+{
+    const auto key = SoundFontSamplePool::makeKey(file, rangeStart, rangeLength);
+
+    {
+        const ScopedLock sl(this->lock);
+        const auto found = this->buffers.find(key);
+        if (found != this->buffers.end())
+        {
+            return found->second;
+        }
+    }
+
+    SharedAudioSampleBuffer::Ptr buffer = loader();
+    if (buffer == nullptr)
+    {
+        return nullptr;
+    }
+
+    const ScopedLock sl(this->lock);
+
+    // someone might have loaded the same range in the meanwhile,
+    // in which case let's keep theirs and drop ours
+    const auto found = this->buffers.find(key);
+    if (found != this->buffers.end())
+    {
+        return found->second;
+    }
+
+    this->buffers[key] = buffer;
+    return buffer;
+}
+
+void SoundFontSamplePool::releaseUnused()
+{
+    // all the new references are only handed out under the lock,
+    // so the buffer only referenced by the pool can't be picked up
+    // by anyone else while we're deleting it
+    const ScopedLock sl(this->lock);
+
+    for (auto it = this->buffers.begin(); it != this->buffers.end();)
+    {
+        if (it->second->getReferenceCount() == 1)
+        {
+            DBG("Releasing the sound font samples: " + it->first);
+            it = this->buffers.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+int SoundFontSamplePool::getNumBuffers() const
+{
+    const ScopedLock sl(this->lock);
+    return int(this->buffers.size());
+}
+
+String SoundFontSamplePool::makeKey(const File &file, int64 rangeStart, int64 rangeLength)
+{
+    return file.getFullPathName() + ":" +
+        String(file.getLastModificationTime().toMilliseconds()) + ":" +
+        String(rangeStart) + ":" + String(rangeLength);
+}
@@ -0,0 +1,140 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+class SharedAudioSampleBuffer final : public ReferenceCountedObject, public AudioSampleBuffer
+{
+public:
+
+    using Ptr = ReferenceCountedObjectPtr<SharedAudioSampleBuffer>;
+
+    explicit SharedAudioSampleBuffer(int numChannels, int numSamples) :
+        AudioSampleBuffer(numChannels, numSamples) {}
+
+    // the source file properties, if the buffer holds a single sample file
+    double sourceSampleRate = 0.0;
+    uint64 sourceLength = 0;
+    uint64 sourceLoopStart = 0;
+    uint64 sourceLoopEnd = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedAudioSampleBuffer)
+};
+
+// SF2 banks store all samples as a single chunk of 16-bit mono PCM;
+// instead of converting it to floats, which would double its size, it is
+// memory-mapped and converted by the voices on the fly, so that only
+// the pages which are actually played become resident in memory
+
+class SharedPcmSampleData final : public ReferenceCountedObject
+{
+public:
+
+    using Ptr = ReferenceCountedObjectPtr<SharedPcmSampleData>;
+
+    // maps the given byte range of the file, returns nullptr on failure
+    static Ptr map(const File &file, int64 rangeStart, int64 rangeLength);
+
+    const int16 *getData() const noexcept { return this->data; }
+    int getNumSamples() const noexcept { return this->numSamples; }
+
+private:
+
+    SharedPcmSampleData() = default;
+
+    UniquePointer<MemoryMappedFile> mappedFile;
+    const int16 *data = nullptr;
+    int numSamples = 0;
+
+    friend class SoundFontPrefetcher;
+    Atomic<int> prefetchGeneration = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedPcmSampleData)
+};
+
+// Pages in the sample ranges of the mapped banks on a background thread,
+// so that the audio thread doesn't have to wait for the disk when they're
+// played; all sounds share one thread via SharedResourcePointer, and
+// a new prefetch of the same data (e.g. the next preset switch) cancels
+// the previous one, whether it's still queued or already in progress
+
+class SoundFontPrefetcher final : private Thread
+{
+public:
+
+    SoundFontPrefetcher();
+    ~SoundFontPrefetcher() override;
+
+    void prefetch(SharedPcmSampleData::Ptr pcmData, const Array<Range<int>> &sampleRanges);
+
+private:
+
+    void run() override;
+
+    struct Job final
+    {
+        SharedPcmSampleData::Ptr pcmData;
+        Array<Range<int>> sampleRanges;
+        int generation = 0;
+    };
+
+    CriticalSection jobsLock;
+    Array<Job> jobs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontPrefetcher)
+};
+
+// Several instruments often use the same sound bank (e.g. different programs
+// of the same GM bank on different tracks), and there's no point in keeping
+// a decoded copy of it for each of them, so all SoundFontSounds share their
+// sample buffers through this pool, keyed by the file, its modification time
+// and the range of the file the samples were read from.
+
+// The pool is shared by all sounds via SharedResourcePointer, and each buffer
+// is dropped as soon as the last sound using it is deleted.
+
+// (SF2 banks don't need the pool since they are memory-mapped,
+// and the mapped pages are shared by the OS, see SharedPcmSampleData)
+
+class SoundFontSamplePool final
+{
+public:
+
+    SoundFontSamplePool() = default;
+
+    using Loader = Function<SharedAudioSampleBuffer::Ptr()>;
+
+    // returns the buffer loaded earlier for the same file range, if any,
+    // or calls the loader otherwise; the loader is called without the lock,
+    // so it can take its time, and several files can be loaded at once
+    SharedAudioSampleBuffer::Ptr getOrLoad(const File &file,
+        int64 rangeStart, int64 rangeLength, const Loader &loader);
+
+    // drops the buffers which are only referenced by the pool
+    void releaseUnused();
+
+    int getNumBuffers() const;
+
+private:
+
+    static String makeKey(const File &file, int64 rangeStart, int64 rangeLength);
+
+    CriticalSection lock;
+    FlatHashMap<String, SharedAudioSampleBuffer::Ptr, StringHash> buffers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontSamplePool)
+};
@@ -669,7 +669,13 @@ SoundFontSound::SoundFontSound(const File &fileIn) : file(fileIn)
     this->preset = make<Preset>();
 }
 
-SoundFontSound::~SoundFontSound() = default;
+SoundFontSound::~SoundFontSound()
+{
+    // the subclasses have already released their samples by now,
+    // so the buffers nobody else uses can go away with ours:
+    this->samples.clear();
+    this->samplePool->releaseUnused();
+}
 
 bool SoundFontSound::appliesToNote(int /*midiNoteNumber*/)
 {
@@ -731,9 +737,22 @@ void SoundFontSound::loadRegions()
 
 void SoundFontSound::loadSamples(AudioFormatManager &formatManager)
 {
+    // the looped samples are loaded entirely, since the voices jump back
+    // and forth within them, and the rest are streamed from the disk
+    Array<const SoundFontSample *> loopedSamples;
+    for (const auto *region : this->regions)
+    {
+        if (region->loopMode == SoundFontRegion::LoopMode::loopContinuous ||
+            region->loopMode == SoundFontRegion::LoopMode::loopSustain)
+        {
+            loopedSamples.addIfNotAlreadyThere(region->sample.get());
+        }
+    }
+
     for (auto &it : this->samples)
     {
-        const bool ok = it.second->load(formatManager);
+        const auto allowStreaming = !loopedSamples.contains(it.second.get());
+        const bool ok = it.second->load(formatManager, *this->samplePool, allowStreaming);
         if (!ok)
         {
             this->addError("Couldn't load sample \"" + it.second->getShortName() + "\"");
@@ -741,6 +760,19 @@ void SoundFontSound::loadSamples(AudioFormatManager &formatManager)
     }
 }
 
+bool SoundFontSound::hasStreamedSamples() const
+{
+    for (const auto &it : this->samples)
+    {
+        if (it.second->getStreamSource() != nullptr)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 SoundFontRegion *SoundFontSound::getRegionFor(int note, int velocity, SoundFontRegion::Trigger trigger) const
 {
     for (auto *region : this->regions)
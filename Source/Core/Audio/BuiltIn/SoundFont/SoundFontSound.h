@@ -22,6 +22,7 @@
 #pragma once
 
 #include "SoundFontRegion.h"
+#include "SoundFontSamplePool.h"
 
 class SoundFontSample;
 
@@ -40,6 +41,9 @@ public:
     virtual void loadRegions();
     virtual void loadSamples(AudioFormatManager &formatManager);
 
+    // if any, the voices need the streams to play them
+    bool hasStreamedSamples() const;
+
     SoundFontRegion *getRegionFor(int note, int velocity,
         SoundFontRegion::Trigger trigger = SoundFontRegion::Trigger::attack) const;
 
@@ -57,6 +61,11 @@ public:
     void addError(const String &message);
     void addUnsupportedOpcode(const String &opcode);
 
+    SoundFontSamplePool &getSamplePool() noexcept
+    {
+        return *this->samplePool;
+    }
+
     struct Preset final
     {
         const String name;
@@ -83,6 +92,8 @@ protected:
 
     Array<SoundFontRegion *> regions;
 
+    SharedResourcePointer<SoundFontSamplePool> samplePool;
+
 private:
 
     friend class SoundFontReader;
@@ -24,6 +24,7 @@
 #include "SoundFontSound.h"
 #include "SoundFontRegion.h"
 #include "SoundFontSample.h"
+#include "SoundFontDiskStreamer.h"
 #include "SerializationKeys.h"
 
 class SoundFontEnvelope final
@@ -292,11 +293,127 @@ const float SoundFontEnvelope::BottomLevel = 0.001f;
 // SoundFontVoice
 //===----------------------------------------------------------------------===//
 
-class SoundFontVoice final : public SynthesiserVoice
+// The voice renders samples from one of these readers, depending on
+// how the sample data is stored (see SoundFontSample::hasData)
+
+class SoundFontBufferReader final
+{
+public:
+
+    explicit SoundFontBufferReader(const AudioSampleBuffer &buffer) noexcept :
+        left(buffer.getReadPointer(0, 0)),
+        right(buffer.getNumChannels() > 1 ? buffer.getReadPointer(1, 0) : nullptr),
+        numSamples(buffer.getNumSamples()) {}
+
+    int getNumSamples() const noexcept { return this->numSamples; }
+    bool isStereo() const noexcept { return this->right != nullptr; }
+    float getLeft(int position) const noexcept { return this->left[position]; }
+    float getRight(int position) const noexcept { return this->right[position]; }
+
+    // the positions before this end can be read directly, see fillTaps
+    int getDirectEnd() const noexcept { return this->numSamples; }
+    const float *getDirectData(int channel) const noexcept { return channel == 0 ? this->left : this->right; }
+    static float toFloat(float sample) noexcept { return sample; }
+
+private:
+
+    const float *left;
+    const float *right;
+    const int numSamples;
+};
+
+class SoundFontPcmReader final
+{
+public:
+
+    // sf2 samples are 16-bit mono, converted on the fly
+    explicit SoundFontPcmReader(const SharedPcmSampleData &pcmData) noexcept :
+        data(pcmData.getData()),
+        numSamples(pcmData.getNumSamples()) {}
+
+    int getNumSamples() const noexcept { return this->numSamples; }
+    bool isStereo() const noexcept { return false; }
+    float getLeft(int position) const noexcept { return toFloat(this->data[position]); }
+    float getRight(int position) const noexcept { return this->getLeft(position); }
+
+    int getDirectEnd() const noexcept { return this->numSamples; }
+    const int16 *getDirectData(int) const noexcept { return this->data; }
+    static float toFloat(int16 sample) noexcept { return float(sample) * scale; }
+
+private:
+
+    static constexpr float scale = 1.f / 32767.f;
+
+    const int16 *data;
+    const int numSamples;
+};
+
+class SoundFontStreamReader final
+{
+public:
+
+    // reads the resident head of the sample from the buffer,
+    // and the rest of it from the stream, as far as it's been filled
+    SoundFontStreamReader(const AudioSampleBuffer &head,
+        const SoundFontStreamSource &source, const SoundFontStream &stream) noexcept :
+        head(head),
+        stream(stream),
+        headLength(head.getNumSamples()),
+        availableEnd(stream.getAvailableEnd()),
+        numSamples(source.length),
+        stereo(source.numChannels > 1) {}
+
+    int getNumSamples() const noexcept { return this->numSamples; }
+    bool isStereo() const noexcept { return this->stereo; }
+    float getLeft(int position) const noexcept { return this->getSample(0, position); }
+    float getRight(int position) const noexcept { return this->getSample(1, position); }
+
+    int getAvailableEnd() const noexcept { return this->availableEnd; }
+
+    // only the resident head is contiguous, the stream is a ring
+    int getDirectEnd() const noexcept { return this->headLength; }
+    const float *getDirectData(int channel) const noexcept
+    {
+        return this->head.getReadPointer(jmin(channel, this->head.getNumChannels() - 1));
+    }
+    static float toFloat(float sample) noexcept { return sample; }
+
+private:
+
+    float getSample(int channel, int position) const noexcept
+    {
+        if (position < this->headLength)
+        {
+            return this->head.getSample(jmin(channel, this->head.getNumChannels() - 1), position);
+        }
+
+        if (position < this->availableEnd)
+        {
+            return this->stream.getSample(channel, position);
+        }
+
+        // either the disk is late, so let's play silence rather than wait for it
+        // (unless rendering offline, where the voice waits for it beforehand),
+        // or it's just the interpolation taps reaching a bit further than the data
+        // (the voice only counts the first case as an underrun, see renderNextBlock)
+        return 0.f;
+    }
+
+    const AudioSampleBuffer &head;
+    const SoundFontStream &stream;
+    const int headLength;
+    const int availableEnd;
+    const int numSamples;
+    const bool stereo;
+};
+
+class SoundFontVoice final : public PolyphonicSynthVoice
 {
 public:
 
-    SoundFontVoice()
+    SoundFontVoice(UniquePointer<SoundFontStream> stream, Atomic<int> &numStreamUnderruns) :
+        stream(move(stream)),
+        numStreamUnderruns(numStreamUnderruns)
     {
         this->envelope.setExponentialDecay(true);
     }
@@ -312,12 +429,26 @@ public:
     bool isPlayingNoteDown();
     bool isPlayingOneShot();
 
+    bool isReleasing() const noexcept override;
+    float getCurrentLevel() const noexcept override;
+
     int getGroup();
     uint64 getOffBy();
 
     // Set the region to be used by the next startNote().
     void setRegion(SoundFontRegion *nextRegion);
 
+    void setInterpolation(SoundFontSynth::Interpolation newInterpolation) noexcept;
+
+    // when rendering offline, the voice waits for the disk streamer
+    // instead of playing silence where it's late, see renderNextBlock
+    void setNonRealtime(bool isNonRealtime) noexcept;
+
+    // the streams are only allocated while the loaded sound has any streamed
+    // samples; they are swapped under the synth lock, and freed outside it
+    bool hasStream() const noexcept;
+    void swapStream(UniquePointer<SoundFontStream> &other) noexcept;
+
     String infoString();
 
 private:
@@ -335,6 +466,15 @@ private:
     int64 loopStart = 0;
     int64 loopEnd = 0;
 
+    // the rest of the streamed samples is read here:
+    UniquePointer<SoundFontStream> stream;
+    Atomic<int> &numStreamUnderruns;
+    bool nonRealtime = false;
+
+    // if the disk doesn't deliver for this long, it's probably not going to,
+    // so the offline rendering gives up and renders silence as the realtime one
+    static constexpr auto offlineStreamTimeoutMs = 1000;
+
     // Info only.
     int numLoops = 0;
     int currentVelocity = 0;
@@ -342,6 +482,55 @@ private:
     void calcPitchRatio();
     void killNote();
 
+    //===------------------------------------------------------------------===//
+    // Rendering
+    //===------------------------------------------------------------------===//
+
+    // the block is rendered in chunks: first, the envelope gains
+    // and the source positions for the whole chunk are precomputed,
+    // then the interpolation kernel fills the channel buffers,
+    // and finally the gains are applied with the vector operations
+
+    SoundFontSynth::Interpolation interpolation = SoundFontSynth::Interpolation::linear;
+
+    template <typename ReaderType>
+    void renderSamples(const ReaderType &reader,
+        AudioSampleBuffer &outputBuffer, int startSample, int numSamples);
+
+    // both return the number of frames to render, and set the flag
+    // if the voice is done after that many frames
+    int fillEnvelopeGains(int numFrames, bool &isFinished) noexcept;
+    int fillSourcePositions(int numFrames, bool &isFinished) noexcept;
+
+    template <typename ReaderType>
+    void fillTaps(const ReaderType &reader, int channel,
+        int firstTapOffset, int numTaps, int numFrames) noexcept;
+    template <typename ReaderType>
+    void fillTapsChecked(const ReaderType &reader, int channel,
+        int firstTapOffset, int numTaps, int startFrame, int endFrame) noexcept;
+
+    template <typename ReaderType>
+    void interpolateLinear(const ReaderType &reader, int channel, float *dest, int numFrames) noexcept;
+    template <typename ReaderType>
+    void interpolateCubic(const ReaderType &reader, int channel, float *dest, int numFrames) noexcept;
+    template <typename ReaderType>
+    void interpolateSinc(const ReaderType &reader, int channel, float *dest, int numFrames) noexcept;
+
+    int getTapPosition(int position, int offset, int numSamples) const noexcept;
+
+    static constexpr auto chunkSize = 64;
+    static constexpr auto maxTaps = 8;
+
+    float envelopeGains[chunkSize];
+    int positions[chunkSize];
+    float fractions[chunkSize];
+    // the first frames after the loop wraps, the positions only grow between them
+    int loopWrapFrames[chunkSize];
+    int numLoopWraps = 0;
+    float taps[maxTaps][chunkSize];
+    float left[chunkSize];
+    float right[chunkSize];
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontVoice)
 };
 
@@ -363,6 +552,8 @@ void SoundFontVoice::startNote(int midiNoteNumber, float floatVelocity, Synthesi
         return;
     }
 
+    this->resetFadeOut();
+
     const int velocity = static_cast<int>(floatVelocity * 127.0);
     this->currentVelocity = velocity;
     if (this->region == nullptr)
@@ -370,7 +561,7 @@ void SoundFontVoice::startNote(int midiNoteNumber, float floatVelocity, Synthesi
         this->region = sound->getRegionFor(midiNoteNumber, velocity);
     }
 
-    if ((this->region == nullptr) || (this->region->sample == nullptr) || (this->region->sample->getBuffer() == nullptr))
+    if ((this->region == nullptr) || (this->region->sample == nullptr) || !this->region->sample->hasData())
     {
         this->killNote();
         return;
@@ -441,6 +632,27 @@ void SoundFontVoice::startNote(int midiNoteNumber, float floatVelocity, Synthesi
         }
     }
 
+    // the samples which might loop are never streamed (see SoundFontSound::loadSamples),
+    // so the streamed ones are only read forward, starting from the end of the head
+    if (const auto &streamSource = this->region->sample->getStreamSource())
+    {
+        jassert(this->loopStart >= this->loopEnd);
+
+        if (this->stream == nullptr)
+        {
+            jassertfalse; // the sound has changed, but the voices haven't yet?
+            this->killNote();
+            return;
+        }
+
+        this->stream->start(streamSource,
+            jmax(streamSource->headLength, int(this->region->offset)));
+    }
+    else if (this->stream != nullptr)
+    {
+        this->stream->stop();
+    }
+
     this->numLoops = 0;
 }
 
@@ -498,6 +710,13 @@ void SoundFontVoice::renderNextBlock(AudioSampleBuffer &outputBuffer, int startS
         return;
     }
 
+    if (const auto *pcmData = this->region->sample->getPcmData())
+    {
+        this->renderSamples(SoundFontPcmReader(*pcmData),
+            outputBuffer, startSample, numSamples);
+        return;
+    }
+
     const auto *buffer = this->region->sample->getBuffer();
     if (buffer == nullptr)
     {
@@ -505,96 +724,412 @@ void SoundFontVoice::renderNextBlock(AudioSampleBuffer &outputBuffer, int startS
         return;
     }
 
-    const float *inL = buffer->getReadPointer(0, 0);
-    const float *inR = buffer->getNumChannels() > 1 ? buffer->getReadPointer(1, 0) : nullptr;
+    if (const auto *streamSource = this->region->sample->getStreamSource().get())
+    {
+        jassert(this->stream != nullptr); // checked in startNote
 
-    float *outL = outputBuffer.getWritePointer(0, startSample);
-    float *outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+        if (this->nonRealtime)
+        {
+            // the frames this block might read, including the taps ahead
+            const auto blockEnd = jmin(streamSource->length,
+                int(this->sourceSamplePosition + this->pitchRatio * numSamples) +
+                    SoundFontStream::maxTapsBehind);
 
-    const int bufferNumSamples = buffer->getNumSamples();
+            if (blockEnd > streamSource->headLength)
+            {
+                this->stream->waitUntilAvailable(blockEnd,
+                    SoundFontVoice::offlineStreamTimeoutMs);
+            }
+        }
 
-    // Cache some values, to give them at least some chance of ending up in registers.
-    double sourceSamplePosition = this->sourceSamplePosition;
-    float ampegGain = this->envelope.getLevel();
-    float ampegSlope = this->envelope.getSlope();
-    int samplesUntilNextAmpSegment = this->envelope.getSamplesUntilNextSegment();
-    bool ampSegmentIsExponential = this->envelope.getSegmentIsExponential();
+        const SoundFontStreamReader reader(*buffer, *streamSource, *this->stream);
+        this->renderSamples(reader, outputBuffer, startSample, numSamples);
+
+        // the last frame's position is what matters, not its taps
+        const auto lastFramePosition = int(this->sourceSamplePosition - this->pitchRatio);
+        if (lastFramePosition >= reader.getAvailableEnd() &&
+            lastFramePosition < streamSource->length)
+        {
+            this->numStreamUnderruns += 1;
+        }
+
+        // let the disk thread reuse the part of the ring we're done with
+        // (the voice might have been killed while rendering, which is fine)
+        this->stream->setReadPosition(int(this->sourceSamplePosition));
+        return;
+    }
+
+    this->renderSamples(SoundFontBufferReader(*buffer),
+        outputBuffer, startSample, numSamples);
+}
+
+// Blackman-windowed sinc kernels for the fractional positions between
+// the samples, computed once for all voices; the kernel is not scaled
+// for the pitch ratio, so there's no extra anti-aliasing when the samples
+// are pitched up, but it's still way cleaner than the linear interpolation
+
+class SoundFontSincTable final
+{
+public:
 
-    const float loopStart = float(this->loopStart);
-    const float loopEnd = float(this->loopEnd);
-    const float sampleEnd = float(this->sampleEnd);
+    static constexpr auto numTaps = 8;
+    static constexpr auto numPhases = 256;
 
-    while (--numSamples >= 0)
+    SoundFontSincTable()
     {
-        int pos = int(sourceSamplePosition);
-        jassert(pos >= 0 && pos < bufferNumSamples);
-        float alpha = float(sourceSamplePosition - pos);
-        float invAlpha = 1.0f - alpha;
-        int nextPos = pos + 1;
-        if ((loopStart < loopEnd) && (nextPos > loopEnd))
+        const auto pi = MathConstants<double>::pi;
+        const auto halfWidth = double(numTaps / 2);
+
+        for (int phase = 0; phase <= numPhases; ++phase)
         {
-            nextPos = int(loopStart);
+            const auto fraction = double(phase) / double(numPhases);
+
+            double sum = 0.0;
+            for (int t = 0; t < numTaps; ++t)
+            {
+                // the taps are at [position - 3, position + 4]
+                const auto x = double(t + 1) - halfWidth - fraction;
+                const auto sinc = (x == 0.0) ? 1.0 : std::sin(pi * x) / (pi * x);
+                const auto w = (x + halfWidth) / (2.0 * halfWidth);
+                const auto window = 0.42 - 0.5 * std::cos(2.0 * pi * w) + 0.08 * std::cos(4.0 * pi * w);
+                this->weights[phase][t] = float(sinc * window);
+                sum += sinc * window;
+            }
+
+            // normalize, so that the constant signal stays the same
+            for (int t = 0; t < numTaps; ++t)
+            {
+                this->weights[phase][t] = float(this->weights[phase][t] / sum);
+            }
         }
+    }
 
-        // Simple linear interpolation with buffer overrun check
-        float nextL = nextPos < bufferNumSamples ? inL[nextPos] : inL[pos];
-        float nextR = inR ? (nextPos < bufferNumSamples ? inR[nextPos] : inR[pos]) : nextL;
-        float l = (inL[pos] * invAlpha + nextL * alpha);
-        float r = inR ? (inR[pos] * invAlpha + nextR * alpha) : l;
+    float weights[numPhases + 1][numTaps];
+
+    JUCE_DECLARE_NON_COPYABLE(SoundFontSincTable)
+};
+
+static const SoundFontSincTable &getSoundFontSincTable()
+{
+    static SoundFontSincTable table;
+    return table;
+}
+
+template <typename ReaderType>
+void SoundFontVoice::renderSamples(const ReaderType &reader,
+    AudioSampleBuffer &outputBuffer, int startSample, int numSamples)
+{
+    float *outL = outputBuffer.getWritePointer(0, startSample);
+    float *outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+
+    const bool isStereo = reader.isStereo();
+    const float *sourceRight = isStereo ? this->right : this->left;
+
+    while (numSamples > 0)
+    {
+        bool isFinished = false;
+        const auto numChunkFrames = jmin(numSamples, int(SoundFontVoice::chunkSize));
+        const auto numEnvelopeFrames = this->fillEnvelopeGains(numChunkFrames, isFinished);
+        const auto numAudibleFrames = this->applyFadeOut(this->envelopeGains, numEnvelopeFrames, isFinished);
+        const auto numFrames = this->fillSourcePositions(numAudibleFrames, isFinished);
+
+        switch (this->interpolation)
+        {
+            case SoundFontSynth::Interpolation::linear:
+                this->interpolateLinear(reader, 0, this->left, numFrames);
+                if (isStereo)
+                {
+                    this->interpolateLinear(reader, 1, this->right, numFrames);
+                }
+                break;
+            case SoundFontSynth::Interpolation::cubic:
+                this->interpolateCubic(reader, 0, this->left, numFrames);
+                if (isStereo)
+                {
+                    this->interpolateCubic(reader, 1, this->right, numFrames);
+                }
+                break;
+            case SoundFontSynth::Interpolation::sinc:
+                this->interpolateSinc(reader, 0, this->left, numFrames);
+                if (isStereo)
+                {
+                    this->interpolateSinc(reader, 1, this->right, numFrames);
+                }
+                break;
+        }
+
+        FloatVectorOperations::multiply(this->left, this->envelopeGains, numFrames);
+        if (isStereo)
+        {
+            FloatVectorOperations::multiply(this->right, this->envelopeGains, numFrames);
+        }
 
-        float gainLeft = this->noteGainLeft * ampegGain;
-        float gainRight = this->noteGainRight * ampegGain;
-        l *= gainLeft;
-        r *= gainRight;
         // Shouldn't we dither here?
+        if (outR != nullptr)
+        {
+            FloatVectorOperations::addWithMultiply(outL, this->left, this->noteGainLeft, numFrames);
+            FloatVectorOperations::addWithMultiply(outR, sourceRight, this->noteGainRight, numFrames);
+            outR += numFrames;
+        }
+        else
+        {
+            FloatVectorOperations::addWithMultiply(outL, this->left, this->noteGainLeft * 0.5f, numFrames);
+            FloatVectorOperations::addWithMultiply(outL, sourceRight, this->noteGainRight * 0.5f, numFrames);
+        }
+
+        outL += numFrames;
+        numSamples -= numFrames;
+
+        if (isFinished)
+        {
+            this->killNote();
+            break;
+        }
+    }
+}
 
-        if (outR)
+int SoundFontVoice::fillEnvelopeGains(int numFrames, bool &isFinished) noexcept
+{
+    float gain = this->envelope.getLevel();
+    float slope = this->envelope.getSlope();
+    int samplesUntilNextSegment = this->envelope.getSamplesUntilNextSegment();
+    bool isExponential = this->envelope.getSegmentIsExponential();
+
+    int i = 0;
+    while (i < numFrames)
+    {
+        // the segment ends after samplesUntilNextSegment + 1 frames,
+        // and all the gains up to that point follow the same formula
+        const auto numRemaining = numFrames - i;
+        const auto numSegmentFrames = (samplesUntilNextSegment < numRemaining) ?
+            jmax(1, samplesUntilNextSegment + 1) : numRemaining;
+
+        if (isExponential)
         {
-            *outL++ += l;
-            *outR++ += r;
+            for (int j = 0; j < numSegmentFrames; ++j)
+            {
+                this->envelopeGains[i + j] = gain;
+                gain *= slope;
+            }
         }
         else
         {
-            *outL++ += (l + r) * 0.5f;
+            for (int j = 0; j < numSegmentFrames; ++j)
+            {
+                this->envelopeGains[i + j] = gain + slope * float(j);
+            }
+
+            gain += slope * float(numSegmentFrames);
         }
 
+        i += numSegmentFrames;
+        samplesUntilNextSegment -= numSegmentFrames;
+
+        if (samplesUntilNextSegment < 0)
+        {
+            this->envelope.setLevel(gain);
+            this->envelope.nextSegment();
+            gain = this->envelope.getLevel();
+            slope = this->envelope.getSlope();
+            samplesUntilNextSegment = this->envelope.getSamplesUntilNextSegment();
+            isExponential = this->envelope.getSegmentIsExponential();
+
+            if (this->envelope.isDone())
+            {
+                isFinished = true;
+                break;
+            }
+        }
+    }
+
+    this->envelope.setLevel(gain);
+    this->envelope.setSamplesUntilNextSegment(samplesUntilNextSegment);
+    return i;
+}
+
+int SoundFontVoice::fillSourcePositions(int numFrames, bool &isFinished) noexcept
+{
+    double sourceSamplePosition = this->sourceSamplePosition;
+
+    const auto loopStart = double(this->loopStart);
+    const auto loopEnd = double(this->loopEnd);
+    const auto sampleEnd = double(this->sampleEnd);
+    const bool isLooping = loopStart < loopEnd;
+
+    this->numLoopWraps = 0;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        const int pos = int(sourceSamplePosition);
+        this->positions[i] = pos;
+        this->fractions[i] = float(sourceSamplePosition - pos);
+
         // Next sample.
         sourceSamplePosition += this->pitchRatio;
-        if ((loopStart < loopEnd) && (sourceSamplePosition > loopEnd))
+        if (isLooping && (sourceSamplePosition > loopEnd))
         {
             sourceSamplePosition = loopStart;
             this->numLoops += 1;
+            this->loopWrapFrames[this->numLoopWraps++] = i + 1;
         }
 
-        // Update EG.
-        if (ampSegmentIsExponential)
+        if (sourceSamplePosition >= sampleEnd)
         {
-            ampegGain *= ampegSlope;
+            isFinished = true;
+            this->sourceSamplePosition = sourceSamplePosition;
+            return i + 1;
         }
-        else
+    }
+
+    this->sourceSamplePosition = sourceSamplePosition;
+    return numFrames;
+}
+
+int SoundFontVoice::getTapPosition(int position, int offset, int numSamples) const noexcept
+{
+    auto tapPosition = position + offset;
+
+    // the taps past the loop end continue from the loop start
+    if (offset > 0 && this->loopStart < this->loopEnd &&
+        position <= this->loopEnd && tapPosition > this->loopEnd)
+    {
+        tapPosition = int(this->loopStart + (tapPosition - this->loopEnd - 1));
+    }
+
+    // the buffers are padded, but not for the taps before the first sample
+    return jlimit(0, numSamples - 1, tapPosition);
+}
+
+template <typename ReaderType>
+void SoundFontVoice::fillTaps(const ReaderType &reader, int channel,
+    int firstTapOffset, int numTaps, int numFrames) noexcept
+{
+    jassert(numTaps <= SoundFontVoice::maxTaps);
+
+    // the frames whose taps are all within the directly readable data,
+    // and don't reach past the loop end, need no checks; the positions only
+    // grow between the loop wraps, so within each of those segments
+    // such frames are a contiguous run found by two binary searches,
+    // and only the frames at the edges go through the checked path
+    const auto lastTapOffset = firstTapOffset + numTaps - 1;
+    const auto isLooping = this->loopStart < this->loopEnd;
+    const auto directEnd = isLooping ?
+        jmin(reader.getDirectEnd(), int(this->loopEnd) + 1) : reader.getDirectEnd();
+    const auto minDirectPosition = -firstTapOffset;
+    const auto maxDirectPosition = directEnd - 1 - lastTapOffset;
+    const auto *data = reader.getDirectData(channel);
+
+    int segmentStart = 0;
+    for (int w = 0; w <= this->numLoopWraps && segmentStart < numFrames; ++w)
+    {
+        const auto segmentEnd = (w < this->numLoopWraps) ?
+            jmin(this->loopWrapFrames[w], numFrames) : numFrames;
+
+        const auto *segmentBegin = this->positions + segmentStart;
+        const auto *segmentLast = this->positions + segmentEnd;
+        const auto *directBegin = std::lower_bound(segmentBegin, segmentLast, minDirectPosition);
+        const auto *directLast = std::upper_bound(directBegin, segmentLast, maxDirectPosition);
+        const auto directStartFrame = int(directBegin - this->positions);
+        const auto directEndFrame = int(directLast - this->positions);
+
+        this->fillTapsChecked(reader, channel, firstTapOffset, numTaps, segmentStart, directStartFrame);
+
+        for (int t = 0; t < numTaps; ++t)
         {
-            ampegGain += ampegSlope;
+            const auto offset = firstTapOffset + t;
+            auto *tap = this->taps[t];
+            for (int i = directStartFrame; i < directEndFrame; ++i)
+            {
+                tap[i] = ReaderType::toFloat(data[this->positions[i] + offset]);
+            }
         }
-        if (--samplesUntilNextAmpSegment < 0)
+
+        this->fillTapsChecked(reader, channel, firstTapOffset, numTaps, directEndFrame, segmentEnd);
+        segmentStart = segmentEnd;
+    }
+}
+
+template <typename ReaderType>
+void SoundFontVoice::fillTapsChecked(const ReaderType &reader, int channel,
+    int firstTapOffset, int numTaps, int startFrame, int endFrame) noexcept
+{
+    const auto numSamples = reader.getNumSamples();
+
+    for (int i = startFrame; i < endFrame; ++i)
+    {
+        const auto pos = this->positions[i];
+        jassert(pos >= 0 && pos < numSamples);
+
+        for (int t = 0; t < numTaps; ++t)
         {
-            this->envelope.setLevel(ampegGain);
-            this->envelope.nextSegment();
-            ampegGain = this->envelope.getLevel();
-            ampegSlope = this->envelope.getSlope();
-            samplesUntilNextAmpSegment = this->envelope.getSamplesUntilNextSegment();
-            ampSegmentIsExponential = this->envelope.getSegmentIsExponential();
+            const auto tapPosition = this->getTapPosition(pos, firstTapOffset + t, numSamples);
+            this->taps[t][i] = (channel == 0) ? reader.getLeft(tapPosition) : reader.getRight(tapPosition);
         }
+    }
+}
 
-        if ((sourceSamplePosition >= sampleEnd) || this->envelope.isDone())
+template <typename ReaderType>
+void SoundFontVoice::interpolateLinear(const ReaderType &reader,
+    int channel, float *dest, int numFrames) noexcept
+{
+    this->fillTaps(reader, channel, 0, 2, numFrames);
+
+    // dest = x0 + (x1 - x0) * t
+    FloatVectorOperations::copy(dest, this->taps[0], numFrames);
+    FloatVectorOperations::subtract(this->taps[1], this->taps[0], numFrames);
+    FloatVectorOperations::addWithMultiply(dest, this->taps[1], this->fractions, numFrames);
+}
+
+template <typename ReaderType>
+void SoundFontVoice::interpolateCubic(const ReaderType &reader,
+    int channel, float *dest, int numFrames) noexcept
+{
+    this->fillTaps(reader, channel, -1, 4, numFrames);
+
+    const auto *xm1 = this->taps[0];
+    const auto *x0 = this->taps[1];
+    const auto *x1 = this->taps[2];
+    const auto *x2 = this->taps[3];
+
+    // 4-point, 3rd-order Hermite; no branches here,
+    // so that the compiler can vectorize this loop
+    for (int i = 0; i < numFrames; ++i)
+    {
+        const auto t = this->fractions[i];
+        const auto c1 = 0.5f * (x1[i] - xm1[i]);
+        const auto c2 = xm1[i] - 2.5f * x0[i] + 2.f * x1[i] - 0.5f * x2[i];
+        const auto c3 = 0.5f * (x2[i] - xm1[i]) + 1.5f * (x0[i] - x1[i]);
+        dest[i] = ((c3 * t + c2) * t + c1) * t + x0[i];
+    }
+}
+
+template <typename ReaderType>
+void SoundFontVoice::interpolateSinc(const ReaderType &reader,
+    int channel, float *dest, int numFrames) noexcept
+{
+    static constexpr auto numTaps = SoundFontSincTable::numTaps;
+    static constexpr auto numPhases = SoundFontSincTable::numPhases;
+    static_assert(numTaps <= SoundFontVoice::maxTaps, "Not enough taps");
+
+    const auto &table = getSoundFontSincTable();
+    this->fillTaps(reader, channel, 1 - numTaps / 2, numTaps, numFrames);
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        // the kernels for the nearest phases are interpolated too
+        const auto phase = this->fractions[i] * float(numPhases);
+        const auto phaseIndex = jmin(int(phase), numPhases - 1);
+        const auto phaseFraction = phase - float(phaseIndex);
+        const auto *w0 = table.weights[phaseIndex];
+        const auto *w1 = table.weights[phaseIndex + 1];
+
+        float sum = 0.f;
+        for (int t = 0; t < numTaps; ++t)
         {
-            this->killNote();
-            break;
+            sum += this->taps[t][i] * (w0[t] + (w1[t] - w0[t]) * phaseFraction);
         }
-    }
 
-    this->sourceSamplePosition = sourceSamplePosition;
-    this->envelope.setLevel(ampegGain);
-    this->envelope.setSamplesUntilNextSegment(samplesUntilNextAmpSegment);
+        dest[i] = sum;
+    }
 }
 
 bool SoundFontVoice::isPlayingNoteDown()
@@ -607,6 +1142,16 @@ bool SoundFontVoice::isPlayingOneShot()
     return this->region && this->region->loopMode == SoundFontRegion::LoopMode::oneShot;
 }
 
+bool SoundFontVoice::isReleasing() const noexcept
+{
+    return this->envelope.isReleasing();
+}
+
+float SoundFontVoice::getCurrentLevel() const noexcept
+{
+    return this->envelope.getLevel() * jmax(this->noteGainLeft, this->noteGainRight);
+}
+
 int SoundFontVoice::getGroup()
 {
     return this->region ? this->region->group : 0;
@@ -622,6 +1167,16 @@ void SoundFontVoice::setRegion(SoundFontRegion *nextRegion)
     this->region = nextRegion;
 }
 
+void SoundFontVoice::setInterpolation(SoundFontSynth::Interpolation newInterpolation) noexcept
+{
+    this->interpolation = newInterpolation;
+}
+
+void SoundFontVoice::setNonRealtime(bool isNonRealtime) noexcept
+{
+    this->nonRealtime = isNonRealtime;
+}
+
 String SoundFontVoice::infoString()
 {
     const char *egSegmentNames[] = {"delay", "attack", "hold", "decay", "sustain", "release", "done"};
@@ -681,14 +1236,42 @@ void SoundFontVoice::calcPitchRatio()
 
 void SoundFontVoice::killNote()
 {
+    if (this->stream != nullptr)
+    {
+        this->stream->stop();
+    }
+
     this->region = nullptr;
     this->clearCurrentNote();
 }
 
+bool SoundFontVoice::hasStream() const noexcept
+{
+    return this->stream != nullptr;
+}
+
+void SoundFontVoice::swapStream(UniquePointer<SoundFontStream> &other) noexcept
+{
+    if (this->isVoiceActive())
+    {
+        this->killNote();
+    }
+
+    std::swap(this->stream, other);
+}
+
 //===----------------------------------------------------------------------===//
 // SoundFontSynth
 //===----------------------------------------------------------------------===//
 
+SoundFontSynth::SoundFontSynth() = default;
+
+SoundFontSynth::~SoundFontSynth()
+{
+    // the voices' streams must unregister before the disk streamer goes away
+    this->clearVoices();
+}
+
 void SoundFontSynth::initSynth(const Parameters &parameters)
 {
     const File file(parameters.filePath);
@@ -697,39 +1280,117 @@ void SoundFontSynth::initSynth(const Parameters &parameters)
         return;
     }
 
-    ScopedLock locker(this->lock);
+    // the voices don't depend on the sound, so they are only
+    // added or removed if the polyphony has changed
+    this->setPolyphony(parameters.polyphony);
+
+    {
+        ScopedLock locker(this->lock);
 
-    this->allNotesOff(0, false);
+        this->allNotesOff(0, false);
 
-    this->clearVoices();
-    for (int i = SoundFontSynth::numVoices; i --> 0 ;)
+        this->clearSounds();
+        this->hasStreamedSamples = false;
+
+        AudioFormatManager audioFormatManager;
+        audioFormatManager.registerBasicFormats();
+
+        if (file.getFullPathName().endsWithIgnoreCase("sf2"))
+        {
+            auto sound = make<SoundFont2Sound>(file);
+            sound->loadRegions();
+            sound->loadSamples(audioFormatManager);
+            this->hasStreamedSamples = sound->hasStreamedSamples();
+            this->sounds.add(sound.release());
+        }
+        else if (file.getFullPathName().endsWithIgnoreCase("sbk"))
+        {
+            auto sound = make<SoundFontSound>(file);
+            sound->loadRegions();
+            sound->loadSamples(audioFormatManager);
+            this->hasStreamedSamples = sound->hasStreamedSamples();
+            this->sounds.add(sound.release());
+        }
+
+        // new file has been loaded so we need to set the program anyway
+        jassert(parameters.programIndex < this->getNumPrograms());
+        this->setCurrentProgram(parameters.programIndex);
+    }
+
+    this->updateVoiceStreams();
+}
+
+PolyphonicSynthVoice *SoundFontSynth::createVoice()
+{
+    auto *voice = new SoundFontVoice(this->hasStreamedSamples ?
+        make<SoundFontStream>(*this->diskStreamer) : nullptr, this->numStreamUnderruns);
+
+    voice->setInterpolation(this->interpolation);
+    voice->setNonRealtime(this->nonRealtime);
+    return voice;
+}
+
+void SoundFontSynth::updateVoiceStreams()
+{
+    // each stream has a ring of 128 KB, so they are allocated only if needed,
+    // and, like the voices themselves, created and deleted outside the lock;
+    // the voices are only added and removed on this thread (see setPolyphony),
+    // so it's fine to check which of them need a stream without the lock
+    std::vector<UniquePointer<SoundFontStream>> streams(size_t(this->getNumVoices()));
+    for (size_t i = 0; i < streams.size(); ++i)
     {
-        this->addVoice(new SoundFontVoice());
+        const auto *voice = static_cast<SoundFontVoice *>(this->getVoice(int(i)));
+        if (this->hasStreamedSamples && !voice->hasStream())
+        {
+            streams[i] = make<SoundFontStream>(*this->diskStreamer);
+        }
     }
 
-    this->clearSounds();
+    {
+        const ScopedLock locker(this->lock);
+        for (size_t i = 0; i < streams.size(); ++i)
+        {
+            auto *voice = static_cast<SoundFontVoice *>(this->voices.getUnchecked(int(i)));
+            if (voice->hasStream() != this->hasStreamedSamples)
+            {
+                voice->swapStream(streams[i]);
+            }
+        }
+    }
 
-    AudioFormatManager audioFormatManager;
-    audioFormatManager.registerBasicFormats();
+    // the replaced streams are deleted here
+}
+
+void SoundFontSynth::setInterpolation(Interpolation newInterpolation)
+{
+    // make sure the kernels are not computed on the audio thread
+    getSoundFontSincTable();
+
+    const ScopedLock locker(this->lock);
 
-    if (file.getFullPathName().endsWithIgnoreCase("sf2"))
+    this->interpolation = newInterpolation;
+    for (auto *v : this->voices)
     {
-        auto sound = make<SoundFont2Sound>(file);
-        sound->loadRegions();
-        sound->loadSamples(audioFormatManager);
-        this->sounds.add(sound.release());
+        jassert(dynamic_cast<SoundFontVoice *>(v));
+        static_cast<SoundFontVoice *>(v)->setInterpolation(newInterpolation);
     }
-    else if (file.getFullPathName().endsWithIgnoreCase("sbk"))
+}
+
+void SoundFontSynth::setNonRealtime(bool isNonRealtime)
+{
+    const ScopedLock locker(this->lock);
+
+    this->nonRealtime = isNonRealtime;
+    for (auto *v : this->voices)
     {
-        auto sound = make<SoundFontSound>(file);
-        sound->loadRegions();
-        sound->loadSamples(audioFormatManager);
-        this->sounds.add(sound.release());
+        jassert(dynamic_cast<SoundFontVoice *>(v));
+        static_cast<SoundFontVoice *>(v)->setNonRealtime(isNonRealtime);
     }
+}
 
-    // new file has been loaded so we need to set the program anyway
-    jassert(parameters.programIndex < this->getNumPrograms());
-    this->setCurrentProgram(parameters.programIndex);
+int SoundFontSynth::getNumStreamUnderruns() const noexcept
+{
+    return this->numStreamUnderruns.get();
 }
 
 void SoundFontSynth::noteOn(int midiChannel, int midiNoteNumber, float velocity)
@@ -898,6 +1559,27 @@ SoundFontSynth::Parameters SoundFontSynth::Parameters::withProgramIndex(int newP
     return other;
 }
 
+SoundFontSynth::Parameters SoundFontSynth::Parameters::withPolyphony(int newPolyphony) const noexcept
+{
+    Parameters other(*this);
+    other.polyphony = newPolyphony;
+    return other;
+}
+
+SoundFontSynth::Parameters SoundFontSynth::Parameters::withLiveInterpolation(Interpolation newInterpolation) const noexcept
+{
+    Parameters other(*this);
+    other.liveInterpolation = newInterpolation;
+    return other;
+}
+
+SoundFontSynth::Parameters SoundFontSynth::Parameters::withRenderInterpolation(Interpolation newInterpolation) const noexcept
+{
+    Parameters other(*this);
+    other.renderInterpolation = newInterpolation;
+    return other;
+}
+
 SerializedData SoundFontSynth::Parameters::serialize() const
 {
     using namespace Serialization::Audio;
@@ -905,6 +1587,9 @@ SerializedData SoundFontSynth::Parameters::serialize() const
     SerializedData data(SoundFont::soundFontConfig);
     data.setProperty(SoundFont::filePath, this->filePath);
     data.setProperty(SoundFont::programIndex, this->programIndex);
+    data.setProperty(SoundFont::polyphony, this->polyphony);
+    data.setProperty(SoundFont::liveInterpolation, int(this->liveInterpolation));
+    data.setProperty(SoundFont::renderInterpolation, int(this->renderInterpolation));
 
     return data;
 }
@@ -924,10 +1609,99 @@ void SoundFontSynth::Parameters::deserialize(const SerializedData &data)
 
     this->filePath = root.getProperty(SoundFont::filePath);
     this->programIndex = root.getProperty(SoundFont::programIndex);
+    this->polyphony = root.getProperty(SoundFont::polyphony, int(PolyphonicSynth::defaultPolyphony));
+
+    const auto readInterpolation = [&root](const Identifier &key, Interpolation defaultValue)
+    {
+        const int value = root.getProperty(key, int(defaultValue));
+        return value >= int(Interpolation::linear) && value <= int(Interpolation::sinc) ?
+            Interpolation(value) : defaultValue;
+    };
+
+    this->liveInterpolation = readInterpolation(SoundFont::liveInterpolation, Interpolation::linear);
+    this->renderInterpolation = readInterpolation(SoundFont::renderInterpolation, Interpolation::sinc);
 }
 
 void SoundFontSynth::Parameters::reset()
 {
     this->filePath.clear();
     this->programIndex = 0;
+    this->polyphony = PolyphonicSynth::defaultPolyphony;
+    this->liveInterpolation = Interpolation::linear;
+    this->renderInterpolation = Interpolation::sinc;
 }
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class SoundFontSynthTests final : public UnitTest
+{
+public:
+    SoundFontSynthTests() : UnitTest("Sound font synth tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        const auto sampleRate = 44100.0;
+        const auto directory = File::createTempFile("sfz");
+        directory.createDirectory();
+
+        // a sine long enough to be streamed, and an sfz with a single region
+        const auto sampleFile = directory.getChildFile("sine.wav");
+        {
+            WavAudioFormat format;
+            UniquePointer<AudioFormatWriter> writer(format.createWriterFor(
+                new FileOutputStream(sampleFile), sampleRate, 1, 16, {}, 0));
+
+            AudioSampleBuffer sine(1, int(sampleRate) * 4);
+            for (int i = 0; i < sine.getNumSamples(); ++i)
+            {
+                sine.setSample(0, i, 0.5f * std::sin(MathConstants<float>::twoPi * 441.f * i / float(sampleRate)));
+            }
+
+            writer->writeFromAudioSampleBuffer(sine, 0, sine.getNumSamples());
+        }
+
+        const auto soundFontFile = directory.getChildFile("sine.sbk");
+        soundFontFile.replaceWithText("<region> sample=sine.wav\n");
+
+        beginTest("Offline rendering waits for the streamed samples");
+        {
+            SoundFontSynth synth;
+            synth.setCurrentPlaybackSampleRate(sampleRate);
+            synth.initSynth(SoundFontSynth::Parameters().withSoundFontFile(soundFontFile.getFullPathName()));
+            synth.setNonRealtime(true);
+
+            const auto blockSize = 512;
+            AudioSampleBuffer output(2, blockSize);
+            MidiBuffer noMidi;
+
+            synth.noteOn(1, 60, 1.f);
+
+            // renders way faster than the disk streamer would keep up with,
+            // and the head only covers the first quarter of a second
+            int numSilentBlocks = 0;
+            const auto numBlocks = int(sampleRate * 3.5) / blockSize;
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                output.clear();
+                synth.renderNextBlock(output, noMidi, 0, blockSize);
+                if (output.getMagnitude(0, 0, blockSize) < 0.1f)
+                {
+                    numSilentBlocks++;
+                }
+            }
+
+            expectEquals(numSilentBlocks, 0);
+            expectEquals(synth.getNumStreamUnderruns(), 0);
+        }
+
+        directory.deleteRecursively();
+    }
+};
+
+static SoundFontSynthTests soundFontSynthTests;
+
+#endif
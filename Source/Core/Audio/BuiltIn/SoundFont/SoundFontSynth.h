@@ -21,11 +21,16 @@
 
 #pragma once
 
-class SoundFontSynth final : public Synthesiser
+#include "PolyphonicSynth.h"
+
+class SoundFontDiskStreamer;
+
+class SoundFontSynth final : public PolyphonicSynth
 {
 public:
 
-    SoundFontSynth() = default;
+    SoundFontSynth();
+    ~SoundFontSynth() override;
 
     void noteOn(int midiChannel, int midiNoteNumber, float velocity) override;
     void noteOff(int midiChannel, int midiNoteNumber, float velocity, bool allowTailOff) override;
@@ -34,13 +39,30 @@ public:
     // Synth parameters
     //===------------------------------------------------------------------===//
 
+    // linear interpolation is the cheapest one, cubic is somewhat better,
+    // and windowed sinc is the cleanest, which is the default for rendering
+    enum class Interpolation : int8
+    {
+        linear,
+        cubic,
+        sinc
+    };
+
     struct Parameters final : Serializable
     {
         String filePath;
         int programIndex = 0;
+        int polyphony = PolyphonicSynth::defaultPolyphony;
+
+        // the plugin switches between these two, see setNonRealtime
+        Interpolation liveInterpolation = Interpolation::linear;
+        Interpolation renderInterpolation = Interpolation::sinc;
 
         Parameters withSoundFontFile(const String &newFilePath) const noexcept;
         Parameters withProgramIndex(int newProgramIndex) const noexcept;
+        Parameters withPolyphony(int newPolyphony) const noexcept;
+        Parameters withLiveInterpolation(Interpolation newInterpolation) const noexcept;
+        Parameters withRenderInterpolation(Interpolation newInterpolation) const noexcept;
 
         SerializedData serialize() const override;
         void deserialize(const SerializedData &data) override;
@@ -49,6 +71,16 @@ public:
 
     void initSynth(const Parameters &parameters);
 
+    void setInterpolation(Interpolation newInterpolation);
+
+    // the offline rendering waits for the disk streamer
+    // where it's late, instead of playing silence
+    void setNonRealtime(bool isNonRealtime);
+
+    // how many times the voices have played silence
+    // because the disk didn't keep up with them
+    int getNumStreamUnderruns() const noexcept;
+
     //===------------------------------------------------------------------===//
     // Presets
     //===------------------------------------------------------------------===//
@@ -59,11 +91,25 @@ public:
     const String getProgramName(int index) const;
     void changeProgramName(int index, const String &newName);
 
+protected:
+
+    PolyphonicSynthVoice *createVoice() override;
+
 private:
 
-    static constexpr auto numVoices = 16;
+    // gives the streams to the voices if the sound has any streamed samples,
+    // or frees them otherwise; called on the same thread as setPolyphony
+    void updateVoiceStreams();
+    bool hasStreamedSamples = false;
+
+    Atomic<int> numStreamUnderruns = 0;
 
     int noteVelocities[128];
 
+    SharedResourcePointer<SoundFontDiskStreamer> diskStreamer;
+
+    Interpolation interpolation = Interpolation::linear;
+    bool nonRealtime = false;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontSynth)
 };
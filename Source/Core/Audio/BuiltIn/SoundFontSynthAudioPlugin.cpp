@@ -32,7 +32,7 @@ const String SoundFontSynthAudioPlugin::instrumentName = "SoundFont Player";
 // A simple UI allowing to pick a file and switch between presets, if any
 //===----------------------------------------------------------------------===//
 
-class SoundFontSynthEditor final : public AudioProcessorEditor
+class SoundFontSynthEditor final : public AudioProcessorEditor, private Timer
 {
 public:
 
@@ -64,8 +64,48 @@ public:
         this->programNameLabel->setJustificationType(Justification::centred);
         this->addAndMakeVisible(this->programNameLabel.get());
 
+        this->polyphonyLabel = make<Label>();
+        this->polyphonyLabel->setFont(Globals::UI::Fonts::S);
+        this->polyphonyLabel->setJustificationType(Justification::centredLeft);
+        this->polyphonyLabel->setText(TRANS(I18n::Instruments::polyphony), dontSendNotification);
+        this->addAndMakeVisible(this->polyphonyLabel.get());
+
+        this->polyphonySlider = make<Slider>();
+        this->polyphonySlider->setSliderStyle(Slider::IncDecButtons);
+        this->polyphonySlider->setTextBoxStyle(Slider::TextBoxLeft, false, 48, 24);
+        this->polyphonySlider->setRange(PolyphonicSynth::minPolyphony, PolyphonicSynth::maxPolyphony, 1.0);
+        // resizing the voice pool is not free, so it's not done for each step while dragging
+        this->polyphonySlider->setChangeNotificationOnlyOnRelease(true);
+        this->polyphonySlider->onValueChange = [this]()
+        {
+            const auto newParams = this->audioPlugin->getSynthParameters()
+                .withPolyphony(int(this->polyphonySlider->getValue()));
+
+            this->audioPlugin->applySynthParameters(newParams);
+        };
+        this->addAndMakeVisible(this->polyphonySlider.get());
+
+        this->voiceStatsLabel = make<Label>();
+        this->voiceStatsLabel->setFont(Globals::UI::Fonts::S);
+        this->voiceStatsLabel->setJustificationType(Justification::centredRight);
+        this->addAndMakeVisible(this->voiceStatsLabel.get());
+
+        this->liveInterpolationLabel = this->makeInterpolationRow(
+            TRANS(I18n::Instruments::interpolationLive), this->liveInterpolationButtons, false);
+
+        this->renderInterpolationLabel = this->makeInterpolationRow(
+            TRANS(I18n::Instruments::interpolationRender), this->renderInterpolationButtons, true);
+
         this->syncDataWithAudioPlugin();
-        this->setSize(640, 120);
+        this->setSize(640, 300);
+
+        this->updateVoiceStats();
+        this->startTimer(250);
+    }
+
+    ~SoundFontSynthEditor() override
+    {
+        this->stopTimer();
     }
 
     void syncDataWithAudioPlugin()
@@ -87,6 +127,16 @@ public:
         this->programNameLabel->setText(this->audioPlugin->getCurrentProgramName(), dontSendNotification);
 
         const auto synthParams = this->audioPlugin->getSynthParameters();
+        this->polyphonySlider->setValue(synthParams.polyphony, dontSendNotification);
+
+        for (int i = 0; i < this->liveInterpolationButtons.size(); ++i)
+        {
+            this->liveInterpolationButtons.getUnchecked(i)->setToggleState(
+                int(synthParams.liveInterpolation) == i, dontSendNotification);
+            this->renderInterpolationButtons.getUnchecked(i)->setToggleState(
+                int(synthParams.renderInterpolation) == i, dontSendNotification);
+        }
+
         if (synthParams.filePath.isNotEmpty())
         {
             this->filePath->setAlpha(1.f);
@@ -115,15 +165,36 @@ public:
         constexpr auto iconMarginX = 8;
         constexpr auto paddingX = 6;
 
-        auto browseFileArea = getRowArea(0.15f, rowHeight);
+        auto browseFileArea = getRowArea(0.1f, rowHeight);
         this->browseButton->setBounds(browseFileArea.removeFromRight(iconWidth).reduced(paddingX, 2).translated(iconMarginX, 0));
         this->filePath->setBounds(browseFileArea.reduced(paddingX, 0));
 
-        auto selectProgramArea = getRowArea(0.7f, rowHeight).reduced(iconWidth + paddingX, 0);
+        auto selectProgramArea = getRowArea(0.45f, rowHeight).reduced(iconWidth + paddingX, 0);
         this->leftArrow->setBounds(selectProgramArea.removeFromLeft(iconWidth).reduced(paddingX, 2).translated(-iconMarginX, 0));
         this->rightArrow->setBounds(selectProgramArea.removeFromRight(iconWidth).reduced(paddingX, 2).translated(iconMarginX, 0));
         this->programNameLabel->setBounds(selectProgramArea.reduced(paddingX, 0));
         this->programIndexIndicator->setBounds(selectProgramArea.translated(0, rowHeight));
+
+        auto voicesArea = getRowArea(0.68f, rowHeight).reduced(paddingX, 0);
+        this->polyphonyLabel->setBounds(voicesArea.removeFromLeft(100));
+        this->polyphonySlider->setBounds(voicesArea.removeFromLeft(120).reduced(0, 2));
+        this->voiceStatsLabel->setBounds(voicesArea);
+
+        const auto layoutInterpolationRow = [](Rectangle<int> area,
+            Label &label, OwnedArray<ToggleButton> &buttons)
+        {
+            label.setBounds(area.removeFromLeft(160));
+            for (auto *button : buttons)
+            {
+                button->setBounds(area.removeFromLeft(100));
+            }
+        };
+
+        layoutInterpolationRow(getRowArea(0.84f, rowHeight).reduced(paddingX, 0),
+            *this->liveInterpolationLabel, this->liveInterpolationButtons);
+
+        layoutInterpolationRow(getRowArea(1.f, rowHeight).reduced(paddingX, 0),
+            *this->renderInterpolationLabel, this->renderInterpolationButtons);
     }
 
     void paint(Graphics &g) override
@@ -178,6 +249,68 @@ public:
 
 private:
 
+    void timerCallback() override
+    {
+        this->updateVoiceStats();
+    }
+
+    // the buttons are in the order of SoundFontSynth::Interpolation
+    UniquePointer<Label> makeInterpolationRow(const String &title,
+        OwnedArray<ToggleButton> &buttons, bool isForRendering)
+    {
+        auto label = make<Label>();
+        label->setFont(Globals::UI::Fonts::S);
+        label->setJustificationType(Justification::centredLeft);
+        label->setText(title, dontSendNotification);
+        this->addAndMakeVisible(label.get());
+
+        const auto addButton = [this, &buttons, isForRendering]
+            (const String &name, SoundFontSynth::Interpolation interpolation)
+        {
+            auto *button = buttons.add(new ToggleButton(name));
+            button->onClick = [this, isForRendering, interpolation]()
+            {
+                const auto &synthParams = this->audioPlugin->getSynthParameters();
+                this->audioPlugin->applySynthParameters(isForRendering ?
+                    synthParams.withRenderInterpolation(interpolation) :
+                    synthParams.withLiveInterpolation(interpolation));
+                this->syncDataWithAudioPlugin();
+            };
+            this->addAndMakeVisible(button);
+        };
+
+        addButton(TRANS(I18n::Instruments::interpolationLinear), SoundFontSynth::Interpolation::linear);
+        addButton(TRANS(I18n::Instruments::interpolationCubic), SoundFontSynth::Interpolation::cubic);
+        addButton(TRANS(I18n::Instruments::interpolationSinc), SoundFontSynth::Interpolation::sinc);
+
+        return label;
+    }
+
+    void updateVoiceStats()
+    {
+        if (this->audioPlugin == nullptr)
+        {
+            return;
+        }
+
+        const auto stats = this->audioPlugin->getVoiceStats();
+
+        String text;
+        text << TRANS(I18n::Instruments::voices) << ": "
+            << stats.numActiveVoices << " / " << stats.polyphony << ", "
+            << TRANS(I18n::Instruments::voicesPeak) << ": " << stats.peakActiveVoices << ", "
+            << TRANS(I18n::Instruments::voicesStolen) << ": " << stats.numStolenVoices;
+
+        // only the large sfz samples are streamed, so this is mostly zero and hidden
+        const auto numUnderruns = this->audioPlugin->getNumStreamUnderruns();
+        if (numUnderruns > 0)
+        {
+            text << ", " << TRANS(I18n::Instruments::voicesUnderruns) << ": " << numUnderruns;
+        }
+
+        this->voiceStatsLabel->setText(text, dontSendNotification);
+    }
+
     WeakReference<SoundFontSynthAudioPlugin> audioPlugin;
 
     // soundfont file picker
@@ -193,6 +326,17 @@ private:
     UniquePointer<Label> programNameLabel;
     UniquePointer<ModeIndicatorComponent> programIndexIndicator;
 
+    // polyphony and voice stats
+    UniquePointer<Label> polyphonyLabel;
+    UniquePointer<Slider> polyphonySlider;
+    UniquePointer<Label> voiceStatsLabel;
+
+    // interpolation for the playback and for rendering
+    UniquePointer<Label> liveInterpolationLabel;
+    OwnedArray<ToggleButton> liveInterpolationButtons;
+    UniquePointer<Label> renderInterpolationLabel;
+    OwnedArray<ToggleButton> renderInterpolationButtons;
+
     const Colour fillColour = findDefaultColour(ColourIDs::BackgroundA::fill);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SoundFontSynthEditor)
@@ -244,6 +388,21 @@ void SoundFontSynthAudioPlugin::reset()
 }
 
 void SoundFontSynthAudioPlugin::releaseResources() {}
+
+void SoundFontSynthAudioPlugin::setNonRealtime(bool isNonRealtime) noexcept
+{
+    AudioPluginInstance::setNonRealtime(isNonRealtime);
+    this->synth.setInterpolation(this->getCurrentInterpolation());
+    this->synth.setNonRealtime(isNonRealtime);
+}
+
+SoundFontSynth::Interpolation SoundFontSynthAudioPlugin::getCurrentInterpolation() const noexcept
+{
+    // rendering to a file can afford the better quality
+    return this->isNonRealtime() ?
+        this->synthParameters.renderInterpolation :
+        this->synthParameters.liveInterpolation;
+}
 double SoundFontSynthAudioPlugin::getTailLengthSeconds() const { return 3.0; } // hopefully enough?
 
 bool SoundFontSynthAudioPlugin::acceptsMidi() const { return true; }
@@ -323,17 +482,36 @@ void SoundFontSynthAudioPlugin::applySynthParameters(const SoundFontSynth::Param
     {
         this->synth.initSynth(newParameters);
     }
-    else if (this->synthParameters.programIndex != newParameters.programIndex)
+    else
     {
-        // just the program # changed
-        jassert(newParameters.programIndex < this->getNumPrograms());
-        this->setCurrentProgram(newParameters.programIndex);
+        if (this->synthParameters.programIndex != newParameters.programIndex)
+        {
+            // just the program # changed
+            jassert(newParameters.programIndex < this->getNumPrograms());
+            this->setCurrentProgram(newParameters.programIndex);
+        }
+
+        if (this->synthParameters.polyphony != newParameters.polyphony)
+        {
+            this->synth.setPolyphony(newParameters.polyphony);
+        }
     }
 
     this->synthParameters = newParameters;
+    this->synth.setInterpolation(this->getCurrentInterpolation());
 }
 
 const SoundFontSynth::Parameters &SoundFontSynthAudioPlugin::getSynthParameters() const noexcept
 {
     return this->synthParameters;
 }
+
+PolyphonicSynth::VoiceStats SoundFontSynthAudioPlugin::getVoiceStats() const noexcept
+{
+    return this->synth.getVoiceStats();
+}
+
+int SoundFontSynthAudioPlugin::getNumStreamUnderruns() const noexcept
+{
+    return this->synth.getNumStreamUnderruns();
+}
@@ -44,6 +44,7 @@ public:
     //===------------------------------------------------------------------===//
 
     void releaseResources() override;
+    void setNonRealtime(bool isNonRealtime) noexcept override;
     double getTailLengthSeconds() const override;
     bool acceptsMidi() const override;
     bool producesMidi() const override;
@@ -76,10 +77,15 @@ public:
     void applySynthParameters(const SoundFontSynth::Parameters &params);
     const SoundFontSynth::Parameters &getSynthParameters() const noexcept;
 
+    PolyphonicSynth::VoiceStats getVoiceStats() const noexcept;
+    int getNumStreamUnderruns() const noexcept;
+
 private:
 
     static const String instrumentName;
 
+    SoundFontSynth::Interpolation getCurrentInterpolation() const noexcept;
+
     SoundFontSynth synth;
     SoundFontSynth::Parameters synthParameters;
 
@@ -25,9 +25,15 @@
 #include "MetronomeSynthAudioPlugin.h"
 #include "BuiltInSynthsPluginFormat.h"
 #include "KeyboardMapping.h"
+#include "SandboxedPluginInstance.h"
+#include "PluginInstantiationPool.h"
+#include "RealtimeSafety.h"
+#include "MidiOutputScheduler.h"
 
-Instrument::Instrument(AudioPluginFormatManager &formatManager, const String &name) :
+Instrument::Instrument(AudioPluginFormatManager &formatManager,
+    PluginInstantiationPool &instantiationPool, const String &name) :
     formatManager(formatManager),
+    instantiationPool(instantiationPool),
     instrumentName(name),
     instrumentId()
 {
@@ -63,6 +69,11 @@ String Instrument::getInstrumentId() const noexcept
 
 String Instrument::getInstrumentHash() const
 {
+    if (this->pendingState.isValid())
+    {
+        return Instrument::getInstrumentHash(this->pendingState);
+    }
+
     String idAndHash;
     const int numNodes = this->processorGraph->getNumNodes();
     
@@ -75,6 +86,36 @@ String Instrument::getInstrumentHash() const
     return String(constexprHash(idAndHash.toUTF8()));
 }
 
+// a placeholder should have the same hash as the loaded instrument will have,
+// so this takes the nodes in the order they are added to the graph on loading:
+// the ones loaded synchronously go first, and then all the rest
+String Instrument::getInstrumentHash(const SerializedData &instrumentState)
+{
+    using namespace Serialization;
+
+    String syncNodesHash;
+    String asyncNodesHash;
+
+    forEachChildWithType(instrumentState, nodeState, Audio::node)
+    {
+        SerializablePluginDescription desc;
+        desc.deserialize(nodeState.getChild(0)); // "node"/"plugin"
+
+        const String nodeHash = nodeState.getProperty(Audio::nodeHash);
+        if (Instrument::isLoadedSynchronously(desc))
+        {
+            syncNodesHash += nodeHash;
+        }
+        else
+        {
+            asyncNodesHash += nodeHash;
+        }
+    }
+
+    const auto idAndHash = syncNodesHash + asyncNodesHash;
+    return String(constexprHash(idAndHash.toUTF8()));
+}
+
 String Instrument::getIdAndHash() const
 {
     return this->getInstrumentId() + this->getInstrumentHash();
@@ -110,6 +151,7 @@ bool Instrument::isMetronomeInstrument() const noexcept
 
 void Instrument::initializeFrom(const PluginDescription &pluginDescription, InitializationCallback initCallback)
 {
+    jassert(this->isLoaded());
     this->processorGraph->clear();
 
     this->addNodeAsync(pluginDescription, 0.5f, 0.5f, 
@@ -241,7 +283,7 @@ const AudioProcessorGraph::Node::Ptr Instrument::findMainPluginNode() const
 void Instrument::addNodeAsync(const PluginDescription &desc, double x, double y, AddNodeCallback f)
 {
     const auto callback = [this, desc, x, y, f]
-    (UniquePointer<AudioPluginInstance> instance, const String &error)
+    (UniquePointer<AudioPluginInstance> instance, const String &error, double loadTimeMs)
     {
         AudioProcessorGraph::Node::Ptr node = nullptr;
 
@@ -257,13 +299,11 @@ void Instrument::addNodeAsync(const PluginDescription &desc, double x, double y,
         }
 
         this->configureNode(node, desc, x, y);
+        node->properties.set(Serialization::Audio::nodeLoadTime, loadTimeMs);
         f(node);
     };
 
-    this->formatManager.createPluginInstanceAsync(desc,
-        this->processorGraph->getSampleRate(),
-        this->processorGraph->getBlockSize(),
-        callback);
+    this->createPluginInstanceAsync(desc, callback);
 }
 
 void Instrument::removeNode(AudioProcessorGraph::NodeID id)
@@ -296,6 +336,55 @@ void Instrument::removeIllegalConnections()
     this->sendChangeMessage();
 }
 
+//===----------------------------------------------------------------------===//
+// Latency
+//===----------------------------------------------------------------------===//
+
+int Instrument::getLatencySamples() const noexcept
+{
+    // the graph sums up its nodes' latencies when it rebuilds
+    // the rendering sequence, and reports the longest path
+    return this->processorGraph->getLatencySamples();
+}
+
+int Instrument::getLatencyCompensation() const noexcept
+{
+    return this->audioCallback.getLatencyCompensation();
+}
+
+//===----------------------------------------------------------------------===//
+// Sandboxing
+//===----------------------------------------------------------------------===//
+
+bool Instrument::isSandboxingPlugins() const noexcept
+{
+    return this->sandboxingPlugins;
+}
+
+// only affects the plugins loaded after this call
+void Instrument::setSandboxingPlugins(bool shouldSandbox) noexcept
+{
+    this->sandboxingPlugins = shouldSandbox;
+}
+
+bool Instrument::shouldSandboxPlugin(const PluginDescription &desc) const noexcept
+{
+    // built-in stuff is safe and cheap to host in-process
+    return this->sandboxingPlugins &&
+        desc.pluginFormatName != BuiltInSynthsPluginFormat::formatName &&
+        desc.pluginFormatName != InternalIODevicesPluginFormat::formatName;
+}
+
+void Instrument::createPluginInstanceAsync(const PluginDescription &desc,
+    PluginCreationCallback callback)
+{
+    this->instantiationPool.createInstanceAsync(desc,
+        this->processorGraph->getSampleRate(),
+        this->processorGraph->getBlockSize(),
+        this->shouldSandboxPlugin(desc),
+        callback);
+}
+
 void Instrument::setNodePosition(AudioProcessorGraph::NodeID id, double x, double y)
 {
     const AudioProcessorGraph::Node::Ptr n(this->processorGraph->getNodeForId(id));
@@ -491,9 +580,63 @@ void Instrument::reset()
     PluginWindow::closeAllCurrentlyOpenWindows();
     this->processorGraph->clear();
     this->instrumentName.clear();
+    this->pendingState = {};
     this->sendChangeMessage();
 }
 
+//===----------------------------------------------------------------------===//
+// Lazy loading
+//===----------------------------------------------------------------------===//
+
+bool Instrument::isLoaded() const noexcept
+{
+    return !this->pendingState.isValid() && !this->isLoadingNodes;
+}
+
+void Instrument::loadIfNeeded(InitializationCallback onLoaded)
+{
+    if (this->isLoaded())
+    {
+        if (onLoaded != nullptr)
+        {
+            onLoaded(this);
+        }
+
+        return;
+    }
+
+    if (onLoaded != nullptr)
+    {
+        this->onLoadedCallbacks.add(onLoaded);
+    }
+
+    if (this->isLoadingNodes)
+    {
+        return; // will be notified when done
+    }
+
+    DBG("Loading instrument " + this->instrumentName);
+
+    // the pending state is kept until all nodes are added, since the graph
+    // is incomplete meanwhile, and the instrument's hash and serialized state
+    // must be the same as they were before the loading has started
+    this->isLoadingNodes = true;
+
+    const auto root = this->pendingState;
+    this->deserializeGraph(root, [this]()
+    {
+        this->isLoadingNodes = false;
+        this->pendingState = {};
+
+        const auto callbacks = this->onLoadedCallbacks;
+        this->onLoadedCallbacks.clearQuick();
+        for (const auto &callback : callbacks)
+        {
+            callback(this);
+        }
+    });
+}
+
 
 //===----------------------------------------------------------------------===//
 // Serializable
@@ -503,6 +646,12 @@ SerializedData Instrument::serialize() const
 {
     using namespace Serialization;
 
+    if (this->pendingState.isValid())
+    {
+        // the instrument hasn't been needed so far:
+        return this->pendingState;
+    }
+
     if (!this->lastValidStateFallback.isEmpty())
     {
         // the instrument hasn't been loaded correctly before:
@@ -571,8 +720,6 @@ void Instrument::deserialize(const SerializedData &data)
 
     if (!root.isValid() || root.getNumChildren() == 0) { return; }
 
-    this->lastValidStateFallback = root.createCopy();
-
     this->instrumentId = root.getProperty(Audio::instrumentId, this->instrumentId.toString());
     this->instrumentName = root.getProperty(Audio::instrumentName, this->instrumentName);
     if (this->instrumentName == DefaultSynthAudioPlugin::instrumentNameOld)
@@ -583,6 +730,25 @@ void Instrument::deserialize(const SerializedData &data)
 
     this->keyboardMapping->deserialize(root);
 
+    // instantiating third-party plugins may take ages, and most of them
+    // are not used by the project at hand, so here we only keep the state,
+    // and the nodes will be created on the first loadIfNeeded() call;
+    // the built-in instruments are cheap, and they need to be loaded anyway
+    if (Instrument::hasAsyncNodes(root))
+    {
+        this->pendingState = root.createCopy();
+        return;
+    }
+
+    this->deserializeGraph(root, nullptr);
+}
+
+void Instrument::deserializeGraph(const SerializedData &root, DeserializeNodesCallback onLoaded)
+{
+    using namespace Serialization;
+
+    this->lastValidStateFallback = root.createCopy();
+
     // Fill up the connections info for further processing
     struct ConnectionDescription final
     {
@@ -615,8 +781,7 @@ void Instrument::deserialize(const SerializedData &data)
         SerializablePluginDescription desc;
         desc.deserialize(nodeState.getChild(0)); // "node"/"plugin"
 
-        if (desc.pluginFormatName == BuiltInSynthsPluginFormat::formatName ||
-            desc.pluginFormatName == InternalIODevicesPluginFormat::formatName)
+        if (Instrument::isLoadedSynchronously(desc))
         {
             String error;
             auto instance = this->formatManager.createPluginInstance(desc,
@@ -642,7 +807,7 @@ void Instrument::deserialize(const SerializedData &data)
         }
     }
 
-    this->deserializeNodesAsync(nodesToDeserializeAsync, [this, connectionDescriptions]()
+    this->deserializeNodesAsync(nodesToDeserializeAsync, [this, connectionDescriptions, onLoaded]()
     {
         for (const auto &connectionInfo : connectionDescriptions)
         {
@@ -673,9 +838,35 @@ void Instrument::deserialize(const SerializedData &data)
         }
 
         this->sendChangeMessage();
+
+        if (onLoaded != nullptr)
+        {
+            onLoaded();
+        }
     });
 }
 
+bool Instrument::isLoadedSynchronously(const PluginDescription &desc) noexcept
+{
+    return desc.pluginFormatName == BuiltInSynthsPluginFormat::formatName ||
+        desc.pluginFormatName == InternalIODevicesPluginFormat::formatName;
+}
+
+bool Instrument::hasAsyncNodes(const SerializedData &root)
+{
+    forEachChildWithType(root, nodeState, Serialization::Audio::node)
+    {
+        SerializablePluginDescription desc;
+        desc.deserialize(nodeState.getChild(0)); // "node"/"plugin"
+        if (!Instrument::isLoadedSynchronously(desc))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void Instrument::deserializeNodesAsync(Array<SerializedData> nodesToDeserialize,
     DeserializeNodesCallback allDoneCallback)
 {
@@ -686,31 +877,82 @@ void Instrument::deserializeNodesAsync(Array<SerializedData> nodesToDeserialize,
         return;
     }
 
-    const auto tree = nodesToDeserialize.removeAndReturn(0);
-
-    SerializablePluginDescription desc;
-    desc.deserialize(tree.getChild(0)); // "node"/"plugin"
-    
-    const auto callback = [this, nodesToDeserialize, tree, allDoneCallback]
-    (UniquePointer<AudioPluginInstance> instance, const String &error)
+    // all plugins are requested at once, but the nodes are only added
+    // when everything is loaded, in the original order, so that the graph
+    // doesn't depend on which plugin happens to load faster
+    struct LoadedNodes final
     {
-        this->addNode(move(instance), tree);
-        this->deserializeNodesAsync(nodesToDeserialize, allDoneCallback);
+        Array<SerializedData> states;
+        std::vector<UniquePointer<AudioPluginInstance>> instances;
+        Array<double> loadTimes;
+        int numPending = 0;
     };
 
-    this->formatManager.createPluginInstanceAsync(desc,
-        this->processorGraph->getSampleRate(),
-        this->processorGraph->getBlockSize(),
-        callback);
+    auto loadedNodes = std::make_shared<LoadedNodes>();
+    loadedNodes->states = nodesToDeserialize;
+    loadedNodes->instances.resize(size_t(nodesToDeserialize.size()));
+    loadedNodes->loadTimes.insertMultiple(0, 0.0, nodesToDeserialize.size());
+    loadedNodes->numPending = nodesToDeserialize.size();
+
+    WeakReference<Instrument> weakThis(this);
+
+    for (int i = 0; i < nodesToDeserialize.size(); ++i)
+    {
+        SerializablePluginDescription desc;
+        desc.deserialize(nodesToDeserialize.getReference(i).getChild(0)); // "node"/"plugin"
+
+        const auto callback = [weakThis, loadedNodes, i, allDoneCallback, pluginName = desc.name]
+        (UniquePointer<AudioPluginInstance> instance, const String &error, double loadTimeMs)
+        {
+            DBG("Loaded " + pluginName + " in " + String(roundToInt(loadTimeMs)) + " ms" +
+                (error.isNotEmpty() ? (", error: " + error) : String()));
+
+            loadedNodes->instances[size_t(i)] = move(instance);
+            loadedNodes->loadTimes.set(i, loadTimeMs);
+
+            loadedNodes->numPending--;
+            if (loadedNodes->numPending > 0 || weakThis == nullptr)
+            {
+                return;
+            }
+
+            for (int n = 0; n < loadedNodes->states.size(); ++n)
+            {
+                const auto node = weakThis->addNode(move(loadedNodes->instances[size_t(n)]),
+                    loadedNodes->states.getReference(n));
+
+                if (node != nullptr)
+                {
+                    node->properties.set(Audio::nodeLoadTime, loadedNodes->loadTimes[n]);
+                }
+            }
+
+            allDoneCallback();
+        };
+
+        this->createPluginInstanceAsync(desc, callback);
+    }
 }
 
 AudioProcessorGraph::Node::Ptr Instrument::addNode(const PluginDescription &desc, double x, double y)
 {
     String errorMessage;
-    auto instance = this->formatManager.createPluginInstance(desc,
-        this->processorGraph->getSampleRate(),
-        this->processorGraph->getBlockSize(),
-        errorMessage);
+    UniquePointer<AudioPluginInstance> instance;
+
+    if (this->shouldSandboxPlugin(desc))
+    {
+        instance = SandboxedPluginInstance::create(desc,
+            this->processorGraph->getSampleRate(),
+            this->processorGraph->getBlockSize(),
+            errorMessage);
+    }
+    else
+    {
+        instance = this->formatManager.createPluginInstance(desc,
+            this->processorGraph->getSampleRate(),
+            this->processorGraph->getBlockSize(),
+            errorMessage);
+    }
 
     AudioProcessorGraph::Node::Ptr node = nullptr;
     
@@ -825,10 +1067,18 @@ void Instrument::AudioCallback::audioDeviceIOCallback(const float** const inputC
     const int numInputChannels, float **const outputChannelData,
     const int numOutputChannels, const int numSamples)
 {
+    const RealtimeSafety::ScopedRealtimeRegion realtimeRegion;
     jassert(this->sampleRate > 0 && this->blockSize > 0);
 
     this->incomingMidi.clear();
-    this->messageCollector.removeNextBlockOfMessages(this->incomingMidi, numSamples);
+
+    {
+        // the collector's lock is only held by the MIDI input
+        // and the player thread for as long as it takes to add a message
+        const RealtimeSafety::ScopedAllowance collectingMidi;
+        this->messageCollector.removeNextBlockOfMessages(this->incomingMidi, numSamples);
+    }
+
     int totalNumChans = 0;
 
     if (numInputChannels > numOutputChannels)
@@ -869,15 +1119,34 @@ void Instrument::AudioCallback::audioDeviceIOCallback(const float** const inputC
     AudioBuffer<float> buffer(this->channels, totalNumChans, numSamples);
 
     {
-        const ScopedLock sl(this->lock);
+        // both locks are only contended while the processor is being replaced,
+        // the device is restarting, or the graph swaps its rendering sequence,
+        // and a block of silence is better than waiting for any of that
+        const ScopedTryLock sl(this->lock);
 
-        if (this->processor != nullptr)
+        if (sl.isLocked() && this->processor != nullptr)
         {
-            const ScopedLock sl2(this->processor->getCallbackLock());
+            const ScopedTryLock sl2(this->processor->getCallbackLock());
 
-            if (!this->processor->isSuspended())
+            if (sl2.isLocked() && !this->processor->isSuspended())
             {
                 this->processor->processBlock(buffer, this->incomingMidi);
+
+                if (this->latencyCompensator != nullptr)
+                {
+                    this->latencyCompensator->process(outputChannelData,
+                        numOutputChannels, numSamples);
+                }
+
+                // after processing, the buffer holds the graph's MIDI output,
+                // which is delayed just like the audio
+                auto *scheduler = this->midiOutputScheduler.get();
+                if (scheduler != nullptr && !this->incomingMidi.isEmpty())
+                {
+                    scheduler->scheduleBlock(this->incomingMidi,
+                        this->latencyCompensation.get());
+                }
+
                 return;
             }
         }
@@ -906,6 +1175,9 @@ void Instrument::AudioCallback::audioDeviceAboutToStart(AudioIODevice *const dev
     this->messageCollector.reset(sampleRate);
     this->channels.calloc(jmax(numChansIn, numChansOut) + 2);
 
+    this->latencyCompensator = make<LatencyCompensator>(numChansOut,
+        this->latencyCompensation.get(), newBlockSize);
+
     if (this->processor != nullptr)
     {
         if (this->isPrepared)
@@ -938,3 +1210,41 @@ void Instrument::AudioCallback::handleIncomingMidiMessage(MidiInput *, const Mid
 {
     this->messageCollector.addMessageToQueue(message);
 }
+
+void Instrument::AudioCallback::setLatencyCompensation(int delaySamples)
+{
+    if (this->latencyCompensation.get() == delaySamples)
+    {
+        return;
+    }
+
+    this->latencyCompensation = delaySamples;
+
+    int numChannels = 0;
+    int maxBlockSize = 0;
+
+    {
+        const ScopedLock sl(this->lock);
+        numChannels = this->numOutputChans;
+        maxBlockSize = this->blockSize;
+    }
+
+    // the delay line is allocated outside of the lock,
+    // and the old one is freed outside of it too
+    auto newCompensator = make<LatencyCompensator>(numChannels, delaySamples, maxBlockSize);
+
+    {
+        const ScopedLock sl(this->lock);
+        this->latencyCompensator.swap(newCompensator);
+    }
+}
+
+int Instrument::AudioCallback::getLatencyCompensation() const noexcept
+{
+    return this->latencyCompensation.get();
+}
+
+void Instrument::AudioCallback::setMidiOutputScheduler(MidiOutputScheduler *scheduler) noexcept
+{
+    this->midiOutputScheduler = scheduler;
+}
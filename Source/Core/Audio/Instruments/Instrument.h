@@ -17,7 +17,11 @@
 
 #pragma once
 
+#include "LatencyCompensator.h"
+
 class KeyboardMapping;
+class MidiOutputScheduler;
+class PluginInstantiationPool;
 
 class Instrument final :
     public Serializable,
@@ -25,7 +29,8 @@ class Instrument final :
 {
 public:
 
-    Instrument(AudioPluginFormatManager &formatManager, const String &name);
+    Instrument(AudioPluginFormatManager &formatManager,
+        PluginInstantiationPool &instantiationPool, const String &name);
     ~Instrument() override;
 
     String getName() const noexcept;
@@ -43,6 +48,14 @@ public:
     void initializeFrom(const PluginDescription &pluginDescription, InitializationCallback initCallback);
     void addNodeToFreeSpace(const PluginDescription &pluginDescription, InitializationCallback initCallback);
 
+    // instruments with third-party plugins are deserialized as placeholders,
+    // which only keep their serialized state and don't instantiate anything
+    // until they are actually needed, i.e. played, previewed or edited;
+    // the callback is called when all nodes are loaded (immediately, if they are);
+    // until then, the instrument is still hashed and serialized as a placeholder
+    bool isLoaded() const noexcept;
+    void loadIfNeeded(InitializationCallback onLoaded = nullptr);
+
     class AudioCallback final : public AudioIODeviceCallback, public MidiInputCallback
     {
     public:
@@ -57,6 +70,14 @@ public:
         void audioDeviceStopped() override;
         void handleIncomingMidiMessage(MidiInput *, const MidiMessage&) override;
 
+        // delays the output to align it with the instruments
+        // which have more latency, see AudioCore::updateLatencyCompensation
+        void setLatencyCompensation(int delaySamples);
+        int getLatencyCompensation() const noexcept;
+
+        // the graph's MIDI output is sent to the hardware through this
+        void setMidiOutputScheduler(MidiOutputScheduler *scheduler) noexcept;
+
     private:
 
         AudioProcessor *processor = nullptr;
@@ -73,6 +94,11 @@ public:
         MidiBuffer incomingMidi;
         MidiMessageCollector messageCollector;
 
+        Atomic<int> latencyCompensation = 0;
+        UniquePointer<LatencyCompensator> latencyCompensator;
+
+        Atomic<MidiOutputScheduler *> midiOutputScheduler = nullptr;
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioCallback)
     };
 
@@ -91,6 +117,16 @@ public:
         return this->keyboardMapping.get();
     }
 
+    // the latency of the graph's slowest path, in samples
+    int getLatencySamples() const noexcept;
+    // the delay added to align this instrument with the slower ones
+    int getLatencyCompensation() const noexcept;
+
+    // if enabled, third-party plugins are loaded in separate processes,
+    // see SandboxedPluginInstance
+    bool isSandboxingPlugins() const noexcept;
+    void setSandboxingPlugins(bool shouldSandbox) noexcept;
+
     //===------------------------------------------------------------------===//
     // Nodes
     //===------------------------------------------------------------------===//
@@ -162,17 +198,25 @@ private:
 
     String getInstrumentId() const noexcept; // will differ between platforms
     String getInstrumentHash() const; // should be the same on all platforms
+    static String getInstrumentHash(const SerializedData &instrumentState);
     
     AudioProcessorGraph::Node::Ptr addNode(const PluginDescription &, double x, double y);
     AudioProcessorGraph::Node::Ptr addNode(UniquePointer<AudioPluginInstance> instance, const SerializedData &data);
     void configureNode(AudioProcessorGraph::Node::Ptr, const PluginDescription &, double x, double y);
 
+    bool shouldSandboxPlugin(const PluginDescription &desc) const noexcept;
+
+    using PluginCreationCallback = Function<void(UniquePointer<AudioPluginInstance>,
+        const String &errorMessage, double loadTimeMs)>;
+    void createPluginInstanceAsync(const PluginDescription &desc, PluginCreationCallback callback);
+
     friend class Transport;
     friend class AudioCore;
     
 private:
 
     AudioPluginFormatManager &formatManager;
+    PluginInstantiationPool &instantiationPool;
     Instrument::AudioCallback audioCallback;
     UniquePointer<AudioProcessorGraph> processorGraph;
 
@@ -180,9 +224,20 @@ private:
 
     using DeserializeNodesCallback = Function<void()>;
     void deserializeNodesAsync(Array<SerializedData> nodesToDeserialize, DeserializeNodesCallback f);
+    void deserializeGraph(const SerializedData &root, DeserializeNodesCallback f);
+
+    static bool isLoadedSynchronously(const PluginDescription &desc) noexcept;
+    static bool hasAsyncNodes(const SerializedData &root);
 
     SerializedData lastValidStateFallback;
 
+    // the state of a placeholder instrument, see loadIfNeeded()
+    SerializedData pendingState;
+    bool isLoadingNodes = false;
+    Array<InitializationCallback> onLoadedCallbacks;
+
+    bool sandboxingPlugins = false;
+
 private:
 
     UniquePointer<KeyboardMapping> keyboardMapping;
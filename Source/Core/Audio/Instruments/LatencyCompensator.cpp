@@ -0,0 +1,75 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "LatencyCompensator.h"
+
+LatencyCompensator::LatencyCompensator(int numChannels, int delaySamples, int maxBlockSize) :
+    delay(jlimit(0, int(LatencyCompensator::maxDelaySamples), delaySamples))
+{
+    if (this->delay > 0)
+    {
+        this->delayLine.setSize(jmax(1, numChannels),
+            nextPowerOfTwo(this->delay + jmax(1, maxBlockSize)));
+        this->delayLine.clear();
+    }
+}
+
+int LatencyCompensator::getCompensatedLatency(int latencySamples) noexcept
+{
+    return latencySamples > LatencyCompensator::maxDelaySamples ? 0 : jmax(0, latencySamples);
+}
+
+void LatencyCompensator::process(float *const *channels, int numChannels, int numSamples) noexcept
+{
+    if (this->delay == 0)
+    {
+        return;
+    }
+
+    const auto size = this->delayLine.getNumSamples();
+    const auto mask = size - 1;
+    numChannels = jmin(numChannels, this->delayLine.getNumChannels());
+
+    // the input is written first and the output is read right after it,
+    // which is fine as long as a chunk doesn't overwrite the samples
+    // which are yet to be read, so larger blocks are processed in chunks
+    const auto maxChunkSize = size - this->delay;
+
+    for (int offset = 0; offset < numSamples;)
+    {
+        const auto numFrames = jmin(numSamples - offset, maxChunkSize);
+        const auto readPosition = (this->writePosition - this->delay) & mask;
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            auto *line = this->delayLine.getWritePointer(c);
+            auto *data = channels[c] + offset;
+
+            const auto numBeforeWrap = jmin(numFrames, size - this->writePosition);
+            FloatVectorOperations::copy(line + this->writePosition, data, numBeforeWrap);
+            FloatVectorOperations::copy(line, data + numBeforeWrap, numFrames - numBeforeWrap);
+
+            const auto numBeforeReadWrap = jmin(numFrames, size - readPosition);
+            FloatVectorOperations::copy(data, line + readPosition, numBeforeReadWrap);
+            FloatVectorOperations::copy(data + numBeforeReadWrap, line, numFrames - numBeforeReadWrap);
+        }
+
+        this->writePosition = (this->writePosition + numFrames) & mask;
+        offset += numFrames;
+    }
+}
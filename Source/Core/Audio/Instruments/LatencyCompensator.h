@@ -0,0 +1,54 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Each instrument is a separate graph, and some plugins (e.g. look-ahead
+// limiters) delay their output; to keep all instruments sample-aligned,
+// the ones with less latency are delayed by the difference between
+// the largest latency and their own, see AudioCore::updateLatencyCompensation
+// for the playback, and RendererThread::run for the rendering.
+
+class LatencyCompensator final
+{
+public:
+
+    // allocates the delay line, so this is not for the audio thread
+    LatencyCompensator(int numChannels, int delaySamples, int maxBlockSize);
+
+    // plugins may report nonsense, and anything longer than this is not
+    // a look-ahead, but a bug, which is better to hear than to compensate
+    static constexpr auto maxDelaySamples = 1 << 17;
+
+    // the latency to align the instrument by: the ones too long to compensate
+    // are ignored, so that they don't delay everything else, both in
+    // the playback and in the rendering, which need to agree on that
+    static int getCompensatedLatency(int latencySamples) noexcept;
+
+    int getDelay() const noexcept { return this->delay; }
+
+    // delays the channels in place, any block size will do
+    void process(float *const *channels, int numChannels, int numSamples) noexcept;
+
+private:
+
+    AudioBuffer<float> delayLine; // the size is a power of two
+    const int delay;
+    int writePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatencyCompensator)
+};
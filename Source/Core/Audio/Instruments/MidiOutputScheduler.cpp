@@ -0,0 +1,692 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "MidiOutputScheduler.h"
+#include "RealtimeSafety.h"
+
+MidiOutputScheduler::MidiOutputScheduler(AudioDeviceManager &deviceManager) :
+    Thread("MidiOutputScheduler"),
+    deviceManager(deviceManager)
+{
+    this->queuedMessages.calloc(MidiOutputScheduler::queueSize);
+    this->syncCommands.calloc(MidiOutputScheduler::syncQueueSize);
+    this->pendingMessages.ensureStorageAllocated(MidiOutputScheduler::queueSize);
+}
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+    this->stopTimer();
+    this->stopThread(1000);
+}
+
+//===----------------------------------------------------------------------===//
+// Audio thread
+//===----------------------------------------------------------------------===//
+
+void MidiOutputScheduler::scheduleBlock(const MidiBuffer &buffer, int delaySamples) noexcept
+{
+    if (!this->hasOutput.get() || this->sampleRate <= 0.0 || buffer.isEmpty())
+    {
+        return;
+    }
+
+    const auto msPerSample = 1000.0 / this->sampleRate;
+    const auto blockHeardMs = this->blockStartMs + this->outputLatencyMs +
+        delaySamples * msPerSample - this->currentDeviceLatencyMs.get();
+
+    for (const auto metadata : buffer)
+    {
+        // the meta events, like tempo changes, are only meant for the plugins,
+        // and sysex is not something to send in the middle of the playback
+        if (metadata.numBytes > 3 || metadata.data[0] == 0xff)
+        {
+            continue;
+        }
+
+        this->enqueue(metadata.data, metadata.numBytes,
+            blockHeardMs + metadata.samplePosition * msPerSample);
+    }
+
+    this->wakeUpSenderIfNeeded();
+}
+
+void MidiOutputScheduler::enqueue(const uint8 *data, int size, double timeMs) noexcept
+{
+    // if the queue is full, the sender thread is hopelessly late,
+    // and dropping the message is all that can be done here
+    this->queue.write(1).forEach([this, data, size, timeMs](int index)
+    {
+        auto &message = this->queuedMessages[index];
+        message.timeMs = timeMs;
+        message.size = size;
+        memcpy(message.data, data, size_t(size));
+        this->earliestQueuedMs = jmin(this->earliestQueuedMs, timeMs);
+    });
+}
+
+void MidiOutputScheduler::wakeUpSenderIfNeeded() noexcept
+{
+    // the sender sleeps until its next pending message is due, and only
+    // the messages due before that need to wake it up, which is at most
+    // once per block, when it has nothing pending, or even less often
+    if (this->earliestQueuedMs < this->senderWakeUpMs.load())
+    {
+        // the event's lock is never held for long, see run()
+        const RealtimeSafety::ScopedAllowance wakingUpTheSender;
+        this->notify();
+    }
+
+    this->earliestQueuedMs = std::numeric_limits<double>::max();
+}
+
+//===----------------------------------------------------------------------===//
+// Sender thread
+//===----------------------------------------------------------------------===//
+
+void MidiOutputScheduler::run()
+{
+    while (!this->threadShouldExit())
+    {
+        // the instruments' blocks overlap in time, so the new messages
+        // are merged into the sorted list, mostly at its end
+        this->queue.read(this->queue.getNumReady()).forEach([this](int index)
+        {
+            const auto &message = this->queuedMessages[index];
+            int position = this->pendingMessages.size();
+            while (position > 0 &&
+                this->pendingMessages.getReference(position - 1).timeMs > message.timeMs)
+            {
+                position--;
+            }
+
+            this->pendingMessages.insert(position, message);
+        });
+
+        const auto now = Time::getMillisecondCounterHiRes();
+
+        int numDueMessages = 0;
+        while (numDueMessages < this->pendingMessages.size() &&
+            this->pendingMessages.getReference(numDueMessages).timeMs <= now)
+        {
+            numDueMessages++;
+        }
+
+        if (numDueMessages > 0)
+        {
+            const ScopedLock sl(this->outputLock);
+            if (this->output != nullptr)
+            {
+                for (int i = 0; i < numDueMessages; ++i)
+                {
+                    const auto &message = this->pendingMessages.getReference(i);
+                    this->output->sendMessageNow(MidiMessage(message.data, message.size));
+                }
+            }
+
+            this->pendingMessages.removeRange(0, numDueMessages);
+        }
+
+        // tell the producers when this thread is going to wake up by itself,
+        // then check for the messages queued in the meantime: either they are
+        // seen here, or the producer sees the new wake up time and signals
+        const auto nextMessageMs = this->pendingMessages.isEmpty() ?
+            std::numeric_limits<double>::max() : this->pendingMessages.getReference(0).timeMs;
+
+        this->senderWakeUpMs.store(nextMessageMs);
+        if (this->queue.getNumReady() > 0)
+        {
+            continue;
+        }
+
+        if (this->pendingMessages.isEmpty())
+        {
+            this->wait(-1);
+            continue;
+        }
+
+        // sleeping is only precise to a millisecond or so,
+        // so the last millisecond before the next message is spent yielding
+        const auto timeToNextMessageMs = nextMessageMs - Time::getMillisecondCounterHiRes();
+        if (timeToNextMessageMs >= 1.0)
+        {
+            this->wait(jmax(1, int(timeToNextMessageMs) - 1));
+        }
+        else if (timeToNextMessageMs > 0.0)
+        {
+            Thread::yield();
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Device latency
+//===----------------------------------------------------------------------===//
+
+void MidiOutputScheduler::setDeviceLatency(const String &deviceId, double latencyMs)
+{
+    latencyMs = jmax(0.0, latencyMs);
+    this->deviceLatencies[deviceId] = latencyMs;
+
+    const ScopedLock sl(this->outputLock);
+    if (this->outputId == deviceId)
+    {
+        this->currentDeviceLatencyMs = latencyMs;
+    }
+}
+
+double MidiOutputScheduler::getDeviceLatency(const String &deviceId) const
+{
+    const auto found = this->deviceLatencies.find(deviceId);
+    return found != this->deviceLatencies.end() ? found->second : 0.0;
+}
+
+const MidiOutputScheduler::DeviceLatencies &MidiOutputScheduler::getDeviceLatencies() const noexcept
+{
+    return this->deviceLatencies;
+}
+
+//===----------------------------------------------------------------------===//
+// AudioIODeviceCallback
+//===----------------------------------------------------------------------===//
+
+void MidiOutputScheduler::audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
+    float **outputChannelData, int numOutputChannels, int numSamples)
+{
+    const RealtimeSafety::ScopedRealtimeRegion realtimeRegion;
+
+    const auto now = Time::getMillisecondCounterHiRes();
+    const auto predictedStartMs = this->blockStartMs + this->blockDurationMs;
+    const auto errorMs = now - predictedStartMs;
+
+    if (this->blockDurationMs == 0.0 ||
+        std::abs(errorMs) > jmax(double(MidiOutputScheduler::clockResetThresholdMs), this->blockDurationMs * 2.0))
+    {
+        this->blockStartMs = now;
+    }
+    else
+    {
+        this->blockStartMs = predictedStartMs + errorMs * MidiOutputScheduler::clockCorrection;
+    }
+
+    this->blockDurationMs = numSamples * 1000.0 / this->sampleRate;
+
+    this->processSyncCommands();
+    this->generateSync(this->blockStartMs);
+
+    this->processCalibration(inputChannelData, numInputChannels, numSamples);
+    this->wakeUpSenderIfNeeded();
+
+    for (int i = 0; i < numOutputChannels; ++i)
+    {
+        FloatVectorOperations::clear(outputChannelData[i], numSamples);
+    }
+}
+
+void MidiOutputScheduler::audioDeviceAboutToStart(AudioIODevice *device)
+{
+    this->sampleRate = device->getCurrentSampleRate();
+    this->outputLatencyMs = device->getOutputLatencyInSamples() * 1000.0 / this->sampleRate;
+    this->inputLatencyMs = device->getInputLatencyInSamples() * 1000.0 / this->sampleRate;
+    this->blockStartMs = 0.0;
+    this->blockDurationMs = 0.0;
+
+    // the device manager stops all callbacks before it changes
+    // the default MIDI output, and restarts them after that
+    auto *newOutput = this->deviceManager.getDefaultMidiOutput();
+
+    {
+        const ScopedLock sl(this->outputLock);
+        this->output = newOutput;
+        this->outputId = newOutput != nullptr ? newOutput->getIdentifier() : String();
+        this->currentDeviceLatencyMs = this->getDeviceLatency(this->outputId);
+    }
+
+    this->hasOutput = newOutput != nullptr;
+
+    if (newOutput != nullptr && !this->isThreadRunning())
+    {
+        this->startThread(9);
+    }
+}
+
+void MidiOutputScheduler::audioDeviceStopped()
+{
+    this->hasOutput = false;
+
+    if (this->isCalibrating())
+    {
+        this->calibrationState = CalibrationState::failed;
+    }
+
+    const ScopedLock sl(this->outputLock);
+    this->output = nullptr;
+    this->outputId = {};
+}
+
+//===----------------------------------------------------------------------===//
+// Calibration
+//===----------------------------------------------------------------------===//
+
+bool MidiOutputScheduler::startCalibration(CalibrationCallback callback)
+{
+    auto *device = this->deviceManager.getCurrentAudioDevice();
+    if (this->isCalibrating() || !this->hasOutput.get() ||
+        device == nullptr || device->getActiveInputChannels().isZero())
+    {
+        return false;
+    }
+
+    this->calibrationCallback = callback;
+    this->numMeasurements = 0;
+    this->calibrationState = CalibrationState::sendingPing;
+    this->startTimer(100);
+    return true;
+}
+
+bool MidiOutputScheduler::isCalibrating() const noexcept
+{
+    return this->calibrationState.load() != CalibrationState::idle;
+}
+
+void MidiOutputScheduler::processCalibration(const float **inputChannelData,
+    int numInputChannels, int numSamples) noexcept
+{
+    static constexpr uint8 noteOn[] = { 0x90, 60, 127 };
+    static constexpr uint8 noteOff[] = { 0x80, 60, 0 };
+
+    const auto findOnset = [&]()
+    {
+        for (int c = 0; c < numInputChannels; ++c)
+        {
+            if (inputChannelData[c] == nullptr)
+            {
+                continue;
+            }
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                if (std::abs(inputChannelData[c][i]) > MidiOutputScheduler::calibrationThreshold)
+                {
+                    return i;
+                }
+            }
+        }
+
+        return -1;
+    };
+
+    switch (this->calibrationState.load())
+    {
+    case CalibrationState::sendingPing:
+        // the ping is sent when this block will be heard,
+        // without any latency compensation
+        this->pingTimeMs = this->blockStartMs + this->outputLatencyMs;
+        this->calibrationDeadlineMs = this->pingTimeMs + MidiOutputScheduler::calibrationTimeoutMs;
+        this->enqueue(noteOn, 3, this->pingTimeMs);
+        this->calibrationState = CalibrationState::listening;
+        break;
+
+    case CalibrationState::listening:
+    {
+        const auto onset = findOnset();
+        if (onset >= 0)
+        {
+            // the input block was recorded before the callback,
+            // by about the input latency
+            const auto onsetMs = this->blockStartMs - this->inputLatencyMs +
+                onset * 1000.0 / this->sampleRate;
+
+            this->measurements[this->numMeasurements++] = onsetMs - this->pingTimeMs;
+            this->enqueue(noteOff, 3, this->blockStartMs);
+            this->calibrationDeadlineMs = this->blockStartMs + MidiOutputScheduler::calibrationSilenceMs;
+            this->calibrationState = CalibrationState::waitingForSilence;
+        }
+        else if (this->blockStartMs > this->calibrationDeadlineMs)
+        {
+            this->enqueue(noteOff, 3, this->blockStartMs);
+            this->calibrationState = CalibrationState::failed;
+        }
+        break;
+    }
+
+    case CalibrationState::waitingForSilence:
+        if (findOnset() >= 0)
+        {
+            this->calibrationDeadlineMs = this->blockStartMs + MidiOutputScheduler::calibrationSilenceMs;
+        }
+        else if (this->blockStartMs > this->calibrationDeadlineMs)
+        {
+            this->calibrationState =
+                this->numMeasurements == MidiOutputScheduler::numCalibrationPings ?
+                CalibrationState::done : CalibrationState::sendingPing;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void MidiOutputScheduler::timerCallback()
+{
+    const auto state = this->calibrationState.load();
+    if (state != CalibrationState::done && state != CalibrationState::failed)
+    {
+        return;
+    }
+
+    this->stopTimer();
+
+    const auto callback = this->calibrationCallback;
+    this->calibrationCallback = nullptr;
+
+    if (state == CalibrationState::failed)
+    {
+        this->calibrationState = CalibrationState::idle;
+        if (callback != nullptr)
+        {
+            callback(false, 0.0);
+        }
+        return;
+    }
+
+    // the median is robust to the occasional ping
+    // which was detected too late because of a dropout
+    std::sort(this->measurements, this->measurements + this->numMeasurements);
+    const auto latencyMs = jmax(0.0, this->measurements[this->numMeasurements / 2]);
+
+    String deviceId;
+
+    {
+        const ScopedLock sl(this->outputLock);
+        deviceId = this->outputId;
+    }
+
+    this->setDeviceLatency(deviceId, latencyMs);
+    this->calibrationState = CalibrationState::idle;
+
+    if (callback != nullptr)
+    {
+        callback(true, latencyMs);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Sync
+//===----------------------------------------------------------------------===//
+
+void MidiOutputScheduler::setSendingMidiClock(bool shouldSend) noexcept
+{
+    this->sendsMidiClock = shouldSend;
+}
+
+bool MidiOutputScheduler::isSendingMidiClock() const noexcept
+{
+    return this->sendsMidiClock.get();
+}
+
+void MidiOutputScheduler::setSendingMidiTimecode(bool shouldSend) noexcept
+{
+    this->sendsMidiTimecode = shouldSend;
+}
+
+bool MidiOutputScheduler::isSendingMidiTimecode() const noexcept
+{
+    return this->sendsMidiTimecode.get();
+}
+
+int MidiOutputScheduler::startSync(double beat, double songTimeMs, double msPerQuarter) noexcept
+{
+    const auto session = ++this->lastSyncSession;
+    this->pushSyncCommand({ SyncCommand::Type::start, session,
+        Time::getMillisecondCounterHiRes(), beat, songTimeMs, msPerQuarter });
+    return session;
+}
+
+void MidiOutputScheduler::changeSyncTempo(int session,
+    double beat, double songTimeMs, double msPerQuarter) noexcept
+{
+    this->pushSyncCommand({ SyncCommand::Type::tempo, session,
+        Time::getMillisecondCounterHiRes(), beat, songTimeMs, msPerQuarter });
+}
+
+void MidiOutputScheduler::seekSync(int session, double beat, double songTimeMs) noexcept
+{
+    this->pushSyncCommand({ SyncCommand::Type::seek, session,
+        Time::getMillisecondCounterHiRes(), beat, songTimeMs, 0.0 });
+}
+
+void MidiOutputScheduler::stopSync(int session) noexcept
+{
+    this->pushSyncCommand({ SyncCommand::Type::stop, session,
+        Time::getMillisecondCounterHiRes(), 0.0, 0.0, 0.0 });
+}
+
+void MidiOutputScheduler::pushSyncCommand(const SyncCommand &command) noexcept
+{
+    const SpinLock::ScopedLockType lock(this->syncQueueLock);
+    this->syncQueue.write(1).forEach([this, &command](int index)
+    {
+        this->syncCommands[index] = command;
+    });
+}
+
+void MidiOutputScheduler::processSyncCommands() noexcept
+{
+    this->syncQueue.read(this->syncQueue.getNumReady()).forEach([this](int index)
+    {
+        const auto &command = this->syncCommands[index];
+
+        // everything before the command goes by the previous anchor
+        this->generateSync(command.timeMs);
+        this->applySyncCommand(command);
+    });
+}
+
+void MidiOutputScheduler::applySyncCommand(const SyncCommand &command) noexcept
+{
+    if (command.type == SyncCommand::Type::start)
+    {
+        this->syncSession = command.session;
+        this->isSyncRunning = true;
+        this->anchorSync(command);
+        this->sendSongPosition(command.timeMs);
+        return;
+    }
+
+    if (!this->isSyncRunning || command.session != this->syncSession)
+    {
+        return;
+    }
+
+    switch (command.type)
+    {
+    case SyncCommand::Type::tempo:
+        this->anchorSync(command);
+        break;
+
+    case SyncCommand::Type::seek:
+        if (this->sendsMidiClock.get())
+        {
+            this->sendSync({ 0xfc }, command.timeMs);
+        }
+
+        this->syncAnchorMs = command.timeMs;
+        this->syncAnchorBeat = command.beat;
+        this->syncAnchorSongTimeMs = command.songTimeMs;
+        this->sendSongPosition(command.timeMs);
+        break;
+
+    case SyncCommand::Type::stop:
+        if (this->sendsMidiClock.get())
+        {
+            this->sendSync({ 0xfc }, command.timeMs);
+        }
+
+        this->isSyncRunning = false;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void MidiOutputScheduler::anchorSync(const SyncCommand &command) noexcept
+{
+    this->syncAnchorMs = command.timeMs;
+    this->syncAnchorBeat = command.beat;
+    this->syncAnchorSongTimeMs = command.songTimeMs;
+    this->syncMsPerQuarter = command.msPerQuarter;
+}
+
+void MidiOutputScheduler::sendSongPosition(double timeMs) noexcept
+{
+    const auto beat = jmax(0.0, this->syncAnchorBeat);
+    const auto songTimeMs = jmax(0.0, this->syncAnchorSongTimeMs);
+
+    // the position pointer is in 16th notes, and the clock resumes
+    // from the first tick after the playback position
+    const auto songPosition = int(beat * 4.0) & 0x3fff;
+    this->nextClockTick = int64(std::ceil(beat * MidiOutputScheduler::clockTicksPerQuarter - 0.001));
+
+    // the quarter frames are sent in full sequences only,
+    // starting from the next sequence after the playback position
+    const auto quarterFrameMs = 1000.0 / (MidiOutputScheduler::timecodeFramesPerSecond * 4);
+    const auto firstQuarterFrame = int64(std::ceil(songTimeMs / quarterFrameMs - 0.001));
+    this->nextQuarterFrame = (firstQuarterFrame + MidiOutputScheduler::quarterFramesPerSequence - 1) /
+        MidiOutputScheduler::quarterFramesPerSequence * MidiOutputScheduler::quarterFramesPerSequence;
+
+    if (this->sendsMidiClock.get())
+    {
+        if (songPosition == 0)
+        {
+            this->sendSync({ 0xfa }, timeMs);
+        }
+        else
+        {
+            this->sendSync({ 0xf2, uint8(songPosition & 0x7f), uint8(songPosition >> 7) }, timeMs);
+            this->sendSync({ 0xfb }, timeMs);
+        }
+    }
+
+    if (this->sendsMidiTimecode.get())
+    {
+        const auto fps = MidiOutputScheduler::timecodeFramesPerSecond;
+        const auto frame = int64(songTimeMs * fps / 1000.0);
+        const auto seconds = frame / fps;
+
+        this->sendSync({ 0xf0, 0x7f, 0x7f, 0x01, 0x01,
+            uint8((MidiOutputScheduler::timecodeRateCode << 5) | (seconds / 3600) % 24),
+            uint8((seconds / 60) % 60), uint8(seconds % 60), uint8(frame % fps), 0xf7 }, timeMs);
+    }
+}
+
+void MidiOutputScheduler::generateSync(double untilMs) noexcept
+{
+    if (!this->isSyncRunning || this->syncMsPerQuarter <= 0.0)
+    {
+        return;
+    }
+
+    const auto catchUpMs = untilMs - MidiOutputScheduler::maxSyncCatchUpMs;
+
+    // clock ticks, 24 per quarter note, follow the tempo
+    const auto msPerTick = this->syncMsPerQuarter / MidiOutputScheduler::clockTicksPerQuarter;
+    const auto getTickTime = [this, msPerTick](int64 tick)
+    {
+        return this->syncAnchorMs + (tick - this->syncAnchorBeat *
+            MidiOutputScheduler::clockTicksPerQuarter) * msPerTick;
+    };
+
+    if (getTickTime(this->nextClockTick) < catchUpMs)
+    {
+        this->nextClockTick = int64(std::ceil((catchUpMs - this->syncAnchorMs) / msPerTick +
+            this->syncAnchorBeat * MidiOutputScheduler::clockTicksPerQuarter));
+    }
+
+    const auto sendsClock = this->sendsMidiClock.get();
+    for (auto tickMs = getTickTime(this->nextClockTick);
+        tickMs < untilMs; tickMs = getTickTime(++this->nextClockTick))
+    {
+        if (sendsClock)
+        {
+            this->sendSync({ 0xf8 }, tickMs);
+        }
+    }
+
+    // quarter frames, 4 per frame, follow the song time
+    const auto fps = MidiOutputScheduler::timecodeFramesPerSecond;
+    const auto quarterFrameMs = 1000.0 / (fps * 4);
+    const auto getQuarterFrameTime = [this, quarterFrameMs](int64 quarterFrame)
+    {
+        return this->syncAnchorMs + quarterFrame * quarterFrameMs - this->syncAnchorSongTimeMs;
+    };
+
+    if (getQuarterFrameTime(this->nextQuarterFrame) < catchUpMs)
+    {
+        const auto sequenceSize = MidiOutputScheduler::quarterFramesPerSequence;
+        const auto quarterFrame = int64(std::ceil((catchUpMs -
+            this->syncAnchorMs + this->syncAnchorSongTimeMs) / quarterFrameMs));
+        this->nextQuarterFrame = (quarterFrame + sequenceSize - 1) / sequenceSize * sequenceSize;
+    }
+
+    const auto sendsTimecode = this->sendsMidiTimecode.get();
+    for (auto quarterFrameTimeMs = getQuarterFrameTime(this->nextQuarterFrame);
+        quarterFrameTimeMs < untilMs;
+        quarterFrameTimeMs = getQuarterFrameTime(++this->nextQuarterFrame))
+    {
+        if (!sendsTimecode || this->nextQuarterFrame < 0)
+        {
+            continue;
+        }
+
+        // each sequence of 8 quarter frames describes the time of its first one
+        const auto piece = int(this->nextQuarterFrame % MidiOutputScheduler::quarterFramesPerSequence);
+        const auto frame = (this->nextQuarterFrame - piece) / 4;
+        const auto seconds = frame / fps;
+        const auto hours = (seconds / 3600) % 24;
+
+        int value = 0;
+        switch (piece)
+        {
+        case 0: value = int(frame % fps) & 0x0f; break;
+        case 1: value = int(frame % fps) >> 4; break;
+        case 2: value = int(seconds % 60) & 0x0f; break;
+        case 3: value = int(seconds % 60) >> 4; break;
+        case 4: value = int((seconds / 60) % 60) & 0x0f; break;
+        case 5: value = int((seconds / 60) % 60) >> 4; break;
+        case 6: value = int(hours) & 0x0f; break;
+        default: value = (int(hours) >> 4) | (MidiOutputScheduler::timecodeRateCode << 1); break;
+        }
+
+        this->sendSync({ 0xf1, uint8((piece << 4) | value) }, quarterFrameTimeMs);
+    }
+}
+
+void MidiOutputScheduler::sendSync(std::initializer_list<uint8> data, double timeMs) noexcept
+{
+    if (!this->hasOutput.get())
+    {
+        return;
+    }
+
+    // the sync messages are timed like the notes sent by the player thread
+    // at the same moment, which are rendered in the next block
+    this->enqueue(data.begin(), int(data.size()), timeMs + this->blockDurationMs +
+        this->outputLatencyMs - this->currentDeviceLatencyMs.get());
+}
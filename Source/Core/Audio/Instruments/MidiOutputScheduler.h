@@ -0,0 +1,240 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Sends the MIDI coming out of the instruments' graphs (i.e. routed to
+// their MIDI output nodes) to the hardware MIDI output, at the moment
+// when the audio rendered in the same block is heard, so that the external
+// gear plays in time with the built-in synths and plugins.
+
+// The instruments' audio callbacks queue the messages with timestamps
+// derived from the audio clock, which is smoothed to remove the jitter
+// of the callbacks, and a high-priority thread sends them when they are due.
+// The external gear's own latency can be measured by the loopback calibration,
+// which sends a note and listens for it on the audio input.
+
+class MidiOutputScheduler final :
+    public AudioIODeviceCallback,
+    private Thread,
+    private Timer // checks the calibration progress
+{
+public:
+
+    explicit MidiOutputScheduler(AudioDeviceManager &deviceManager);
+    ~MidiOutputScheduler() override;
+
+    //===------------------------------------------------------------------===//
+    // Audio thread
+    //===------------------------------------------------------------------===//
+
+    // queues the messages of the block which an instrument has just rendered;
+    // the scheduler is registered as the first audio callback,
+    // so it has already seen the same block and knows its time
+    void scheduleBlock(const MidiBuffer &buffer, int delaySamples) noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Device latency
+    //===------------------------------------------------------------------===//
+
+    // how long it takes the external gear to sound after receiving a message,
+    // in ms; the messages are sent that much earlier, as far as
+    // the audio output latency allows
+    void setDeviceLatency(const String &deviceId, double latencyMs);
+    double getDeviceLatency(const String &deviceId) const;
+
+    using DeviceLatencies = FlatHashMap<String, double, StringHash>;
+    const DeviceLatencies &getDeviceLatencies() const noexcept;
+
+    // the calibration needs the external gear's audio output to be
+    // connected to the audio input; on success, the callback receives
+    // the measured latency, which is also set for the current device
+    using CalibrationCallback = Function<void(bool success, double latencyMs)>;
+    bool startCalibration(CalibrationCallback callback);
+    bool isCalibrating() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Sync
+    //===------------------------------------------------------------------===//
+
+    // MIDI clock with song position pointers, and MIDI timecode,
+    // generated from the playback position and the audio clock
+    void setSendingMidiClock(bool shouldSend) noexcept;
+    bool isSendingMidiClock() const noexcept;
+    void setSendingMidiTimecode(bool shouldSend) noexcept;
+    bool isSendingMidiTimecode() const noexcept;
+
+    // called by the player thread as the playback goes, see PlayerThread::run;
+    // beats are counted from the project start, and the song time is in ms;
+    // each playback is a separate session, so that the player thread
+    // which is still stopping doesn't stop the clock of the next one
+    int startSync(double beat, double songTimeMs, double msPerQuarter) noexcept;
+    void changeSyncTempo(int session, double beat, double songTimeMs, double msPerQuarter) noexcept;
+    void seekSync(int session, double beat, double songTimeMs) noexcept;
+    void stopSync(int session) noexcept;
+
+    //===------------------------------------------------------------------===//
+    // AudioIODeviceCallback
+    //===------------------------------------------------------------------===//
+
+    void audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
+        float **outputChannelData, int numOutputChannels, int numSamples) override;
+    void audioDeviceAboutToStart(AudioIODevice *device) override;
+    void audioDeviceStopped() override;
+
+private:
+
+    void run() override;
+    void timerCallback() override;
+
+    // the longest one is the MIDI timecode full frame sysex
+    static constexpr auto maxMessageSize = 10;
+
+    struct ScheduledMessage final
+    {
+        double timeMs;
+        uint8 data[maxMessageSize];
+        int size;
+    };
+
+    void enqueue(const uint8 *data, int size, double timeMs) noexcept;
+    void wakeUpSenderIfNeeded() noexcept;
+    void processCalibration(const float **inputChannelData,
+        int numInputChannels, int numSamples) noexcept;
+
+    AudioDeviceManager &deviceManager;
+
+    // written by the audio thread, read by the sender thread
+    static constexpr auto queueSize = 4096;
+    AbstractFifo queue { MidiOutputScheduler::queueSize };
+    HeapBlock<ScheduledMessage> queuedMessages;
+
+    // the earliest message queued since the last wake up check,
+    // only used by the audio thread, and the time when the sender thread
+    // is going to wake up by itself, written by the sender thread
+    double earliestQueuedMs = std::numeric_limits<double>::max();
+    std::atomic<double> senderWakeUpMs = { std::numeric_limits<double>::max() };
+
+    // only used by the sender thread, sorted by time
+    Array<ScheduledMessage> pendingMessages;
+
+    CriticalSection outputLock; // never taken by the audio thread
+    MidiOutput *output = nullptr; // owned by the device manager
+    String outputId;
+    Atomic<bool> hasOutput = false;
+
+    DeviceLatencies deviceLatencies;
+    Atomic<double> currentDeviceLatencyMs = 0.0;
+
+    // the audio clock, only used by the audio thread
+    double sampleRate = 0.0;
+    double outputLatencyMs = 0.0;
+    double inputLatencyMs = 0.0;
+    double blockStartMs = 0.0;
+    double blockDurationMs = 0.0;
+
+    // the clock follows the callbacks' times slowly, which removes
+    // their jitter, but still follows the drift of the audio clock;
+    // the errors larger than that are dropouts, which reset the clock
+    static constexpr auto clockCorrection = 0.02;
+    static constexpr auto clockResetThresholdMs = 20.0;
+
+    //===------------------------------------------------------------------===//
+    // Calibration
+    //===------------------------------------------------------------------===//
+
+    enum class CalibrationState : int
+    {
+        idle,
+        sendingPing,
+        listening,
+        waitingForSilence,
+        done,
+        failed
+    };
+
+    std::atomic<CalibrationState> calibrationState = { CalibrationState::idle };
+    CalibrationCallback calibrationCallback;
+
+    static constexpr auto numCalibrationPings = 5;
+    static constexpr auto calibrationTimeoutMs = 1000.0;
+    static constexpr auto calibrationSilenceMs = 300.0;
+    static constexpr auto calibrationThreshold = 0.05f;
+
+    // only used by the audio thread while calibrating
+    double pingTimeMs = 0.0;
+    double calibrationDeadlineMs = 0.0;
+    int numMeasurements = 0;
+    double measurements[MidiOutputScheduler::numCalibrationPings];
+
+    //===------------------------------------------------------------------===//
+    // Sync
+    //===------------------------------------------------------------------===//
+
+    struct SyncCommand final
+    {
+        enum class Type : int8 { start, tempo, seek, stop };
+        Type type;
+        int session;
+        double timeMs; // when it happened, by the hi-res ms counter
+        double beat;
+        double songTimeMs;
+        double msPerQuarter;
+    };
+
+    void pushSyncCommand(const SyncCommand &command) noexcept;
+    void processSyncCommands() noexcept;
+    void applySyncCommand(const SyncCommand &command) noexcept;
+    void anchorSync(const SyncCommand &command) noexcept;
+    void generateSync(double untilMs) noexcept;
+    void sendSongPosition(double timeMs) noexcept;
+    void sendSync(std::initializer_list<uint8> data, double timeMs) noexcept;
+
+    static constexpr auto syncQueueSize = 256;
+    AbstractFifo syncQueue { MidiOutputScheduler::syncQueueSize };
+    HeapBlock<SyncCommand> syncCommands;
+
+    // for a moment, there may be two player threads, when restarting
+    SpinLock syncQueueLock;
+    Atomic<int> lastSyncSession = 0;
+
+    Atomic<bool> sendsMidiClock = false;
+    Atomic<bool> sendsMidiTimecode = false;
+
+    // only used by the audio thread: the sync position is extrapolated
+    // from the last anchor, i.e. the last start, seek or tempo change
+    bool isSyncRunning = false;
+    int syncSession = 0;
+    double syncAnchorMs = 0.0;
+    double syncAnchorBeat = 0.0;
+    double syncAnchorSongTimeMs = 0.0;
+    double syncMsPerQuarter = 0.0;
+    int64 nextClockTick = 0;
+    int64 nextQuarterFrame = 0;
+
+    static constexpr auto clockTicksPerQuarter = 24;
+    static constexpr auto clockTicksPerSongPosition = 6;
+    static constexpr auto timecodeFramesPerSecond = 25;
+    static constexpr auto timecodeRateCode = 1; // 25 fps
+    static constexpr auto quarterFramesPerSequence = 8;
+
+    // if the audio device has been stopped for a while, the ticks
+    // which are hopelessly late are skipped instead of sent at once
+    static constexpr auto maxSyncCatchUpMs = 250.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiOutputScheduler)
+};
@@ -42,6 +42,10 @@ public:
     virtual Instrument *getDefaultInstrument() const = 0;
     virtual Instrument *getMetronomeInstrument() const = 0;
 
+    // schedules loading the placeholder instrument in the background,
+    // see Instrument::loadIfNeeded
+    virtual void prefetchInstrument(Instrument *instrument) = 0;
+
 public:
 
     void addOrchestraListener(OrchestraListener *listener);
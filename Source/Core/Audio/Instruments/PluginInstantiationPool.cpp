@@ -0,0 +1,143 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "PluginInstantiationPool.h"
+#include "SandboxedPluginInstance.h"
+
+class PluginInstantiationPool::SandboxedInstantiationJob final : public ThreadPoolJob
+{
+public:
+
+    SandboxedInstantiationJob(const PluginDescription &description,
+        double sampleRate, int blockSize, Callback callback) :
+        ThreadPoolJob("Loading " + description.name),
+        description(description),
+        sampleRate(sampleRate),
+        blockSize(blockSize),
+        callback(callback) {}
+
+    JobStatus runJob() override
+    {
+        const auto startTime = Time::getMillisecondCounterHiRes();
+
+        String errorMessage;
+        UniquePointer<AudioPluginInstance> instance =
+            SandboxedPluginInstance::create(this->description,
+                this->sampleRate, this->blockSize, errorMessage,
+                [this]() { return this->shouldExit(); });
+
+        const auto loadTimeMs = Time::getMillisecondCounterHiRes() - startTime;
+
+        // the lambda has to be copyable, hence the shared holder;
+        // if the message never gets delivered, the instance is still deleted
+        const auto holder = std::make_shared<UniquePointer<AudioPluginInstance>>(move(instance));
+        const auto callback = this->callback;
+        MessageManager::callAsync([holder, errorMessage, loadTimeMs, callback]()
+        {
+            callback(move(*holder), errorMessage, loadTimeMs);
+        });
+
+        return jobHasFinished;
+    }
+
+private:
+
+    const PluginDescription description;
+    const double sampleRate;
+    const int blockSize;
+    const Callback callback;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxedInstantiationJob)
+};
+
+PluginInstantiationPool::PluginInstantiationPool(AudioPluginFormatManager &formatManager) :
+    formatManager(formatManager) {}
+
+PluginInstantiationPool::~PluginInstantiationPool()
+{
+    if (this->threadPool != nullptr)
+    {
+        // the jobs stop waiting for their workers when asked to exit
+        this->threadPool->removeAllJobs(true, PluginInstantiationPool::shutdownTimeoutMs);
+    }
+}
+
+void PluginInstantiationPool::createInstanceAsync(const PluginDescription &description,
+    double sampleRate, int blockSize, bool sandboxed, Callback callback)
+{
+    jassert(callback != nullptr);
+
+    if (sandboxed)
+    {
+        if (this->threadPool == nullptr)
+        {
+            this->threadPool = make<ThreadPool>(jlimit(2,
+                int(PluginInstantiationPool::maxThreads), SystemStats::getNumCpus()));
+        }
+
+        this->threadPool->addJob(new SandboxedInstantiationJob(description,
+            sampleRate, blockSize, callback), true);
+        return;
+    }
+
+    this->createInstanceOnMessageThread(description, sampleRate, blockSize, callback);
+}
+
+void PluginInstantiationPool::createInstanceOnMessageThread(const PluginDescription &description,
+    double sampleRate, int blockSize, Callback callback)
+{
+    bool requiresUnblockedMessageThread = false;
+    for (int i = 0; i < this->formatManager.getNumFormats(); ++i)
+    {
+        auto *format = this->formatManager.getFormat(i);
+        if (format->getName() == description.pluginFormatName)
+        {
+            requiresUnblockedMessageThread =
+                format->requiresUnblockedMessageThreadDuringCreation(description);
+            break;
+        }
+    }
+
+    if (requiresUnblockedMessageThread)
+    {
+        // the load time will include the time spent in the queue,
+        // but there's no way to create these plugins synchronously
+        const auto startTime = Time::getMillisecondCounterHiRes();
+        this->formatManager.createPluginInstanceAsync(description, sampleRate, blockSize,
+            [startTime, callback](UniquePointer<AudioPluginInstance> instance, const String &error)
+            {
+                callback(move(instance), error, Time::getMillisecondCounterHiRes() - startTime);
+            });
+
+        return;
+    }
+
+    // each plugin is created in a separate message, so that other instruments'
+    // plugins, as well as the UI, get their turns in between
+    auto &formatManagerRef = this->formatManager;
+    MessageManager::callAsync([&formatManagerRef, description, sampleRate, blockSize, callback]()
+    {
+        const auto startTime = Time::getMillisecondCounterHiRes();
+
+        String errorMessage;
+        auto instance = formatManagerRef.createPluginInstance(description,
+            sampleRate, blockSize, errorMessage);
+
+        callback(move(instance), errorMessage, Time::getMillisecondCounterHiRes() - startTime);
+    });
+}
@@ -0,0 +1,61 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Creates plugin instances for all instruments, so that independent
+// instruments don't have to wait for each other while loading.
+
+// The blocking part of creating a sandboxed plugin (launching a worker
+// process and waiting for it to load the plugin) runs on the pool threads;
+// in-process plugins are created on the message thread, because that's
+// what the plugin formats require (juce marshals their creation there anyway),
+// but each of them is a separate message, so the UI stays responsive.
+
+// So the threads are only started when the first sandboxed plugin is created.
+
+// Callbacks are always called on the message thread.
+
+class PluginInstantiationPool final
+{
+public:
+
+    explicit PluginInstantiationPool(AudioPluginFormatManager &formatManager);
+    ~PluginInstantiationPool();
+
+    using Callback = Function<void(UniquePointer<AudioPluginInstance> instance,
+        const String &errorMessage, double loadTimeMs)>;
+
+    void createInstanceAsync(const PluginDescription &description,
+        double sampleRate, int blockSize, bool sandboxed, Callback callback);
+
+    static constexpr auto maxThreads = 8;
+    static constexpr auto shutdownTimeoutMs = 1000;
+
+private:
+
+    void createInstanceOnMessageThread(const PluginDescription &description,
+        double sampleRate, int blockSize, Callback callback);
+
+    AudioPluginFormatManager &formatManager;
+
+    UniquePointer<ThreadPool> threadPool;
+
+    class SandboxedInstantiationJob;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginInstantiationPool)
+};
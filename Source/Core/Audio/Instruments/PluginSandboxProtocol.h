@@ -0,0 +1,288 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// The stuff shared by the host and the sandbox worker process:
+// audio and midi go through a pair of lock-free single-producer single-consumer
+// ring buffers placed in a memory-mapped file, and everything else
+// (setup, state, parameters, editor commands) goes through the side channel,
+// which is the juce's ChildProcessCoordinator/ChildProcessWorker pipe
+
+namespace PluginSandbox
+{
+    static constexpr auto commandLineUid = "helio-plugin-sandbox";
+
+    static constexpr auto maxChannels = 8;
+    static constexpr auto maxBlockSize = 4096;
+    static constexpr auto maxMidiDataSize = 16 * 1024;
+    static constexpr auto numBlocksInRing = 4u;
+
+    static constexpr auto launchTimeoutMs = 5000;
+    static constexpr auto initialiseTimeoutMs = 30000; // plugins may take a while to load
+    static constexpr auto abortCheckIntervalMs = 100; // while waiting for that
+    static constexpr auto replyTimeoutMs = 3000;
+    static constexpr auto hangTimeoutMs = 3000;
+    static constexpr auto timerIntervalMs = 50;
+
+    static constexpr uint32 layoutMagic = 0x484c5342; // "HLSB"
+
+    enum class Message : int32
+    {
+        // host -> worker
+        initialise = 1,     // description xml, shared memory path, sample rate, block size
+        prepare,            // sample rate, block size
+        release,
+        setState,           // state memory block
+        getState,
+        setParameter,       // index, value
+        setProgram,         // index
+        showEditor,
+
+        // worker -> host
+        ready = 100,        // see SandboxedPluginInstance::handleReady
+        failed,             // error message
+        state,              // state memory block
+        parameterChanged,   // index, value
+        latencyChanged      // latency in samples
+    };
+
+    struct AudioBlock final
+    {
+        int32 numSamples;
+        int32 numChannels;
+        int32 midiDataSize;
+        float audio[maxChannels * maxBlockSize];
+        uint8 midi[maxMidiDataSize];
+    };
+
+    struct BlockRing final
+    {
+        alignas(64) std::atomic<uint32> numWritten;
+        alignas(64) std::atomic<uint32> numRead;
+        AudioBlock blocks[numBlocksInRing];
+
+        // returns nullptr if the ring is full
+        AudioBlock *startWriting() noexcept
+        {
+            const auto w = this->numWritten.load(std::memory_order_relaxed);
+            if (w - this->numRead.load(std::memory_order_acquire) >= numBlocksInRing)
+            {
+                return nullptr;
+            }
+
+            return &this->blocks[w % numBlocksInRing];
+        }
+
+        void finishWriting() noexcept
+        {
+            const auto w = this->numWritten.load(std::memory_order_relaxed);
+            this->numWritten.store(w + 1, std::memory_order_release);
+        }
+
+        // returns nullptr if the ring is empty
+        AudioBlock *startReading() noexcept
+        {
+            const auto r = this->numRead.load(std::memory_order_relaxed);
+            if (r == this->numWritten.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+
+            return &this->blocks[r % numBlocksInRing];
+        }
+
+        void finishReading() noexcept
+        {
+            const auto r = this->numRead.load(std::memory_order_relaxed);
+            this->numRead.store(r + 1, std::memory_order_release);
+        }
+
+        uint32 getNumPending() const noexcept
+        {
+            return this->numWritten.load(std::memory_order_acquire) -
+                this->numRead.load(std::memory_order_acquire);
+        }
+    };
+
+    struct SharedMemoryLayout final
+    {
+        uint32 magic;
+        BlockRing toWorker;
+        BlockRing toHost;
+    };
+
+    static_assert(ATOMIC_INT_LOCK_FREE == 2,
+        "Sandbox rings need lock-free atomics to be shared between processes");
+
+    static constexpr auto sharedMemorySize = sizeof(SharedMemoryLayout);
+
+    // the shared memory is backed by a temporary file, which is mapped
+    // by both processes; on linux, /dev/shm keeps it off the disk
+    inline File createSharedMemoryFile()
+    {
+#if JUCE_LINUX
+        const File shm("/dev/shm");
+        if (shm.isDirectory())
+        {
+            return shm.getNonexistentChildFile("helio-sandbox-" + Uuid().toString(), ".tmp");
+        }
+#endif
+
+        return File::createTempFile(".sandbox");
+    }
+
+    //===------------------------------------------------------------------===//
+    // Block helpers
+    //===------------------------------------------------------------------===//
+
+    // copies numSamples samples starting from startSample,
+    // and the midi events within that range, into the block;
+    // midi events that don't fit into the block are dropped
+    inline void writeBlock(AudioBlock &block, const AudioBuffer<float> &audio,
+        int startSample, int numSamples, const MidiBuffer &midi) noexcept
+    {
+        jassert(numSamples <= maxBlockSize);
+
+        block.numSamples = numSamples;
+        block.numChannels = jmin(audio.getNumChannels(), maxChannels);
+
+        for (int c = 0; c < block.numChannels; ++c)
+        {
+            FloatVectorOperations::copy(block.audio + c * maxBlockSize,
+                audio.getReadPointer(c, startSample), numSamples);
+        }
+
+        int midiDataSize = 0;
+        const auto endSample = startSample + numSamples;
+        for (auto it = midi.findNextSamplePosition(startSample); it != midi.cend(); ++it)
+        {
+            const auto event = *it;
+            if (event.samplePosition >= endSample)
+            {
+                break;
+            }
+
+            const auto eventSize = int(sizeof(int32) * 2) + event.numBytes;
+            if (midiDataSize + eventSize > maxMidiDataSize)
+            {
+                break;
+            }
+
+            const int32 header[2] = { event.samplePosition - startSample, event.numBytes };
+            memcpy(block.midi + midiDataSize, header, sizeof(header));
+            memcpy(block.midi + midiDataSize + sizeof(header), event.data, size_t(event.numBytes));
+            midiDataSize += eventSize;
+        }
+
+        block.midiDataSize = midiDataSize;
+    }
+
+    // the opposite of the above; adds the midi events to the buffer,
+    // clears the channels that the block doesn't have
+    inline void readBlock(const AudioBlock &block, AudioBuffer<float> &audio,
+        int startSample, int numSamples, MidiBuffer &midi) noexcept
+    {
+        const auto numSamplesToCopy = jmin(numSamples, block.numSamples);
+        const auto numChannelsToCopy = jmin(audio.getNumChannels(), block.numChannels);
+
+        for (int c = 0; c < audio.getNumChannels(); ++c)
+        {
+            if (c < numChannelsToCopy)
+            {
+                FloatVectorOperations::copy(audio.getWritePointer(c, startSample),
+                    block.audio + c * maxBlockSize, numSamplesToCopy);
+
+                if (numSamplesToCopy < numSamples)
+                {
+                    audio.clear(c, startSample + numSamplesToCopy, numSamples - numSamplesToCopy);
+                }
+            }
+            else
+            {
+                audio.clear(c, startSample, numSamples);
+            }
+        }
+
+        int offset = 0;
+        while (offset + int(sizeof(int32) * 2) <= block.midiDataSize)
+        {
+            int32 header[2];
+            memcpy(header, block.midi + offset, sizeof(header));
+            offset += int(sizeof(header));
+
+            if (header[1] <= 0 || offset + header[1] > block.midiDataSize)
+            {
+                jassertfalse;
+                break;
+            }
+
+            midi.addEvent(block.midi + offset, header[1], startSample + header[0]);
+            offset += header[1];
+        }
+    }
+
+    //===------------------------------------------------------------------===//
+    // Side channel helpers
+    //===------------------------------------------------------------------===//
+
+    // the message is the type followed by whatever the caller writes;
+    // not using SerializedData here, since messages are decoded
+    // on the connection thread, and binary parsing there is not thread-safe
+    template <typename WriteFn>
+    inline MemoryBlock makeMessage(Message type, WriteFn fillMessage)
+    {
+        MemoryOutputStream out;
+        out.writeInt(int(type));
+        fillMessage(out);
+        return out.getMemoryBlock();
+    }
+
+    inline MemoryBlock makeMessage(Message type)
+    {
+        return makeMessage(type, [](MemoryOutputStream &) {});
+    }
+
+    inline void writeMemoryBlock(MemoryOutputStream &out, const MemoryBlock &data)
+    {
+        out.writeInt(int(data.getSize()));
+        out.write(data.getData(), data.getSize());
+    }
+
+    inline MemoryBlock readMemoryBlock(MemoryInputStream &in)
+    {
+        MemoryBlock data;
+        const auto size = in.readInt();
+        if (size > 0)
+        {
+            in.readIntoMemoryBlock(data, size);
+        }
+
+        return data;
+    }
+
+    inline void writeDescription(MemoryOutputStream &out, const PluginDescription &description)
+    {
+        out.writeString(description.createXml()->toString());
+    }
+
+    inline bool readDescription(MemoryInputStream &in, PluginDescription &description)
+    {
+        const auto xml = parseXML(in.readString());
+        return xml != nullptr && description.loadFromXml(*xml);
+    }
+}
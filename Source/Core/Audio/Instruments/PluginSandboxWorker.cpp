@@ -0,0 +1,419 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "PluginSandboxWorker.h"
+#include "AudioCore.h"
+
+//===----------------------------------------------------------------------===//
+// Editor window
+//===----------------------------------------------------------------------===//
+
+class PluginSandboxWorker::EditorWindow final : public DocumentWindow
+{
+public:
+
+    explicit EditorWindow(AudioProcessorEditor *editor) :
+        DocumentWindow(editor->getName(), Colours::darkgrey, DocumentWindow::closeButton)
+    {
+        this->setUsingNativeTitleBar(true);
+        this->setContentOwned(editor, true);
+        this->setResizable(editor->isResizable(), false);
+        this->centreWithSize(this->getWidth(), this->getHeight());
+    }
+
+    ~EditorWindow() override
+    {
+        this->clearContentComponent();
+    }
+
+    void closeButtonPressed() override
+    {
+        this->setVisible(false);
+    }
+
+private:
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EditorWindow)
+};
+
+//===----------------------------------------------------------------------===//
+// Worker
+//===----------------------------------------------------------------------===//
+
+// spin for a while before sleeping, when waiting for the next block:
+// with typical buffer sizes the next block comes in a couple of milliseconds,
+// and sleeping for the whole millisecond tick would eat up most of that time
+static constexpr auto numSandboxSpinIterations = 2000;
+
+PluginSandboxWorker::PluginSandboxWorker() : Thread("Plugin Sandbox")
+{
+    AudioCore::initAudioFormats(this->formatManager);
+    this->midiBuffer.ensureSize(PluginSandbox::maxMidiDataSize);
+}
+
+PluginSandboxWorker::~PluginSandboxWorker()
+{
+    this->stopTimer();
+    this->stopThread(500);
+
+    // the editor must die before its processor:
+    this->editorWindow = nullptr;
+    this->plugin = nullptr;
+    this->sharedMemory = nullptr;
+}
+
+bool PluginSandboxWorker::isWorkerCommandLine(const String &commandLine)
+{
+    return commandLine.contains(PluginSandbox::commandLineUid);
+}
+
+PluginSandbox::SharedMemoryLayout *PluginSandboxWorker::getSharedMemory() const noexcept
+{
+    return this->sharedMemory != nullptr ?
+        static_cast<PluginSandbox::SharedMemoryLayout *>(this->sharedMemory->getData()) : nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// ChildProcessWorker
+//===----------------------------------------------------------------------===//
+
+void PluginSandboxWorker::handleMessageFromCoordinator(const MemoryBlock &message)
+{
+    // called on the connection thread; all plugin calls
+    // except processing should be done on the message thread:
+    MessageManager::callAsync([self = WeakReference<PluginSandboxWorker>(this), message]()
+    {
+        if (self != nullptr)
+        {
+            self->handleMessage(message);
+        }
+    });
+}
+
+void PluginSandboxWorker::handleConnectionLost()
+{
+    // the host has quit, or has killed us, or has crashed
+    MessageManager::callAsync([]()
+    {
+        JUCEApplication::quit();
+    });
+}
+
+void PluginSandboxWorker::handleMessage(const MemoryBlock &message)
+{
+    MemoryInputStream in(message, false);
+    const auto type = PluginSandbox::Message(in.readInt());
+
+    if (type == PluginSandbox::Message::initialise)
+    {
+        PluginDescription description;
+        if (!PluginSandbox::readDescription(in, description))
+        {
+            this->fail("Invalid plugin description");
+            return;
+        }
+
+        const File sharedMemoryPath(in.readString());
+        const auto sampleRate = in.readDouble();
+        const auto blockSize = in.readInt();
+        this->initialise(description, sharedMemoryPath, sampleRate, blockSize);
+        return;
+    }
+
+    if (this->plugin == nullptr)
+    {
+        jassertfalse;
+        return;
+    }
+
+    switch (type)
+    {
+    case PluginSandbox::Message::prepare:
+    {
+        const auto sampleRate = in.readDouble();
+        const auto blockSize = in.readInt();
+        this->prepare(sampleRate, blockSize);
+        break;
+    }
+    case PluginSandbox::Message::release:
+    {
+        const ScopedLock lock(this->plugin->getCallbackLock());
+        this->isPrepared = false;
+        this->plugin->releaseResources();
+        break;
+    }
+    case PluginSandbox::Message::setState:
+    {
+        const auto state = PluginSandbox::readMemoryBlock(in);
+        this->plugin->setStateInformation(state.getData(), int(state.getSize()));
+        break;
+    }
+    case PluginSandbox::Message::getState:
+    {
+        MemoryBlock state;
+        this->plugin->getStateInformation(state);
+        this->sendMessageToCoordinator(PluginSandbox::makeMessage(PluginSandbox::Message::state,
+            [&state](MemoryOutputStream &out)
+            {
+                PluginSandbox::writeMemoryBlock(out, state);
+            }));
+        break;
+    }
+    case PluginSandbox::Message::setParameter:
+    {
+        const auto index = in.readInt();
+        const auto value = in.readFloat();
+        if (auto *parameter = this->plugin->getParameters()[index])
+        {
+            // don't echo it back to the host:
+            this->lastSentParameterValues.set(index, value);
+            parameter->setValueNotifyingHost(value);
+        }
+        break;
+    }
+    case PluginSandbox::Message::setProgram:
+        this->plugin->setCurrentProgram(in.readInt());
+        break;
+    case PluginSandbox::Message::showEditor:
+        this->showEditor();
+        break;
+    default:
+        jassertfalse;
+        break;
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Setup
+//===----------------------------------------------------------------------===//
+
+void PluginSandboxWorker::initialise(const PluginDescription &description,
+    const File &sharedMemoryPath, double sampleRate, int blockSize)
+{
+    this->sharedMemory = make<MemoryMappedFile>(sharedMemoryPath, MemoryMappedFile::readWrite);
+    if (this->sharedMemory->getSize() < PluginSandbox::sharedMemorySize ||
+        this->getSharedMemory()->magic != PluginSandbox::layoutMagic)
+    {
+        this->sharedMemory = nullptr;
+        this->fail("Cannot map the shared memory file");
+        return;
+    }
+
+    const auto callback = [this, sampleRate, blockSize]
+        (UniquePointer<AudioPluginInstance> instance, const String &error)
+    {
+        if (instance == nullptr)
+        {
+            this->fail(error);
+            return;
+        }
+
+        this->plugin = move(instance);
+
+        const auto numChannels = jmin(PluginSandbox::maxChannels,
+            jmax(this->plugin->getTotalNumInputChannels(), this->plugin->getTotalNumOutputChannels()));
+        this->audioBuffer.setSize(numChannels, PluginSandbox::maxBlockSize);
+
+        this->prepare(sampleRate, blockSize);
+
+        const auto &parameters = this->plugin->getParameters();
+        for (const auto *parameter : parameters)
+        {
+            this->lastSentParameterValues.add(parameter->getValue());
+        }
+
+        this->lastSentLatency = this->plugin->getLatencySamples();
+
+        this->sendMessageToCoordinator(PluginSandbox::makeMessage(PluginSandbox::Message::ready,
+            [this, &parameters](MemoryOutputStream &out)
+            {
+                out.writeString(this->plugin->getName());
+                out.writeInt(this->plugin->getTotalNumInputChannels());
+                out.writeInt(this->plugin->getTotalNumOutputChannels());
+                out.writeBool(this->plugin->acceptsMidi());
+                out.writeBool(this->plugin->producesMidi());
+                out.writeBool(this->plugin->hasEditor() || !parameters.isEmpty());
+                out.writeDouble(this->plugin->getTailLengthSeconds());
+                out.writeInt(this->lastSentLatency);
+
+                out.writeInt(this->plugin->getNumPrograms());
+                out.writeInt(this->plugin->getCurrentProgram());
+                for (int i = 0; i < this->plugin->getNumPrograms(); ++i)
+                {
+                    out.writeString(this->plugin->getProgramName(i));
+                }
+
+                out.writeInt(parameters.size());
+                for (const auto *parameter : parameters)
+                {
+                    out.writeString(parameter->getName(1024));
+                    out.writeString(parameter->getLabel());
+                    out.writeFloat(parameter->getDefaultValue());
+                    out.writeFloat(parameter->getValue());
+                    out.writeInt(parameter->getNumSteps());
+                    out.writeBool(parameter->isDiscrete());
+                }
+            }));
+
+        this->startThread(9);
+        this->startTimer(PluginSandbox::timerIntervalMs);
+    };
+
+    this->formatManager.createPluginInstanceAsync(description,
+        sampleRate, blockSize, callback);
+}
+
+void PluginSandboxWorker::prepare(double sampleRate, int blockSize)
+{
+    const ScopedLock lock(this->plugin->getCallbackLock());
+    this->plugin->setRateAndBufferSizeDetails(sampleRate, blockSize);
+    this->plugin->prepareToPlay(sampleRate, blockSize);
+    this->isPrepared = true;
+}
+
+void PluginSandboxWorker::fail(const String &errorMessage)
+{
+    this->sendMessageToCoordinator(PluginSandbox::makeMessage(PluginSandbox::Message::failed,
+        [&errorMessage](MemoryOutputStream &out)
+        {
+            out.writeString(errorMessage);
+        }));
+}
+
+void PluginSandboxWorker::showEditor()
+{
+    if (this->editorWindow == nullptr)
+    {
+        AudioProcessorEditor *editor = nullptr;
+
+        if (this->plugin->hasEditor())
+        {
+            editor = this->plugin->createEditorIfNeeded();
+        }
+
+        if (editor == nullptr && !this->plugin->getParameters().isEmpty())
+        {
+            editor = new GenericAudioProcessorEditor(*this->plugin);
+        }
+
+        if (editor == nullptr)
+        {
+            return;
+        }
+
+        editor->setName(this->plugin->getName());
+        this->editorWindow = make<EditorWindow>(editor);
+    }
+
+    this->editorWindow->setVisible(true);
+    Process::makeForegroundProcess();
+    this->editorWindow->toFront(true);
+}
+
+//===----------------------------------------------------------------------===//
+// Timer
+//===----------------------------------------------------------------------===//
+
+// sends back the changes made in the plugin's own editor
+void PluginSandboxWorker::timerCallback()
+{
+    const auto &parameters = this->plugin->getParameters();
+    for (int i = 0; i < parameters.size(); ++i)
+    {
+        const auto value = parameters.getUnchecked(i)->getValue();
+        if (value != this->lastSentParameterValues[i])
+        {
+            this->lastSentParameterValues.set(i, value);
+            this->sendMessageToCoordinator(PluginSandbox::makeMessage(PluginSandbox::Message::parameterChanged,
+                [i, value](MemoryOutputStream &out)
+                {
+                    out.writeInt(i);
+                    out.writeFloat(value);
+                }));
+        }
+    }
+
+    const auto latency = this->plugin->getLatencySamples();
+    if (latency != this->lastSentLatency)
+    {
+        this->lastSentLatency = latency;
+        this->sendMessageToCoordinator(PluginSandbox::makeMessage(PluginSandbox::Message::latencyChanged,
+            [latency](MemoryOutputStream &out)
+            {
+                out.writeInt(latency);
+            }));
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Thread
+//===----------------------------------------------------------------------===//
+
+void PluginSandboxWorker::run()
+{
+    auto *memory = this->getSharedMemory();
+    int numIdleIterations = 0;
+
+    while (!this->threadShouldExit())
+    {
+        auto *input = memory->toWorker.startReading();
+        if (input == nullptr)
+        {
+            if (++numIdleIterations < numSandboxSpinIterations)
+            {
+                Thread::yield();
+            }
+            else
+            {
+                Thread::sleep(1);
+            }
+
+            continue;
+        }
+
+        numIdleIterations = 0;
+
+        const auto numSamples = jlimit(0, PluginSandbox::maxBlockSize, input->numSamples);
+        AudioBuffer<float> block(this->audioBuffer.getArrayOfWritePointers(),
+            this->audioBuffer.getNumChannels(), numSamples);
+
+        this->midiBuffer.clear();
+        PluginSandbox::readBlock(*input, block, 0, numSamples, this->midiBuffer);
+        memory->toWorker.finishReading();
+
+        {
+            const ScopedLock lock(this->plugin->getCallbackLock());
+            if (this->isPrepared.get() && !this->plugin->isSuspended())
+            {
+                this->plugin->processBlock(block, this->midiBuffer);
+            }
+            else
+            {
+                block.clear();
+                this->midiBuffer.clear();
+            }
+        }
+
+        // if the host doesn't pick up the results, just drop them
+        if (auto *output = memory->toHost.startWriting())
+        {
+            PluginSandbox::writeBlock(*output, block, 0, numSamples, this->midiBuffer);
+            memory->toHost.finishWriting();
+        }
+    }
+}
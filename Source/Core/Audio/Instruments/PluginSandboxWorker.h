@@ -0,0 +1,79 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "PluginSandboxProtocol.h"
+
+// The other end of SandboxedPluginInstance: this lives in a separate
+// app instance, launched in the PluginSandbox run mode, hosts a single plugin,
+// and processes the blocks from the shared memory on its own thread.
+
+class PluginSandboxWorker final :
+    public ChildProcessWorker,
+    private Thread,
+    private Timer
+{
+public:
+
+    PluginSandboxWorker();
+    ~PluginSandboxWorker() override;
+
+    static bool isWorkerCommandLine(const String &commandLine);
+
+    //===------------------------------------------------------------------===//
+    // ChildProcessWorker
+    //===------------------------------------------------------------------===//
+
+    void handleMessageFromCoordinator(const MemoryBlock &message) override;
+    void handleConnectionLost() override;
+
+private:
+
+    void handleMessage(const MemoryBlock &message);
+
+    void initialise(const PluginDescription &description,
+        const File &sharedMemoryPath, double sampleRate, int blockSize);
+    void prepare(double sampleRate, int blockSize);
+    void showEditor();
+    void fail(const String &errorMessage);
+
+    void run() override;
+    void timerCallback() override;
+
+    PluginSandbox::SharedMemoryLayout *getSharedMemory() const noexcept;
+
+private:
+
+    AudioPluginFormatManager formatManager;
+    UniquePointer<AudioPluginInstance> plugin;
+
+    UniquePointer<MemoryMappedFile> sharedMemory;
+
+    Atomic<bool> isPrepared = false;
+    AudioBuffer<float> audioBuffer;
+    MidiBuffer midiBuffer;
+
+    Array<float> lastSentParameterValues;
+    int lastSentLatency = 0;
+
+    class EditorWindow;
+    UniquePointer<EditorWindow> editorWindow;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginSandboxWorker)
+    JUCE_DECLARE_WEAK_REFERENCEABLE(PluginSandboxWorker)
+};
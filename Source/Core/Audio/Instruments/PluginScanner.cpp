@@ -118,6 +118,7 @@ void PluginScanner::runInitialScan()
 
     this->filesToScan.clearQuick();
     this->searchPath = this->getCommonFolders();
+    this->retryingBlacklistedFiles = false;
 
     // built-in synths to be added first:
     this->filesToScan.addIfNotAlreadyThere(DefaultSynthAudioPlugin::instrumentId);
@@ -166,6 +167,7 @@ void PluginScanner::scanFolderAndAddResults(const File &dir)
 
     this->filesToScan.clearQuick();
     this->searchPath = dir.getFullPathName();
+    this->retryingBlacklistedFiles = true;
 
     Array<File> subPaths;
     this->searchPath.findChildFiles(subPaths, File::findDirectories, false);
@@ -216,108 +218,279 @@ void PluginScanner::run()
 
         try
         {
-            const auto myPath(File::getSpecialLocation(File::currentExecutableFile).getFullPathName());
+            const auto pluginPaths = this->findFilesToScan();
 
-            for (const auto &pluginPath : this->filesToScan)
+#if SAFE_SCAN
+            this->scanInCheckerProcesses(pluginPaths);
+#else
+            this->scanInProcess(pluginPaths, formatManager);
+#endif
+        }
+        catch (...) {}
+
+        {
+            this->cancelled = false;
+            this->working = false;
+            
+            DBG("Done scanning for audio plugins");
+            this->sendChangeMessage();
+        }
+        
+        WaitableEvent::wait();
+    }
+}
+
+void PluginScanner::scanInCheckerProcesses(const StringArray &pluginPaths)
+{
+    struct CheckerJob final
+    {
+        String pluginPath;
+        File tempFile;
+        ChildProcess process;
+        uint32 startTime = 0;
+    };
+
+    const auto myPath(File::getSpecialLocation(File::currentExecutableFile).getFullPathName());
+    const auto maxJobs = jlimit(1, int(PluginScanner::maxCheckerProcesses), SystemStats::getNumCpus() / 2);
+
+    OwnedArray<CheckerJob> jobs;
+    int nextPathIndex = 0;
+
+    while (nextPathIndex < pluginPaths.size() || !jobs.isEmpty())
+    {
+        if (this->cancelled.get() || this->threadShouldExit())
+        {
+            DBG("Plugin scanning canceled");
+            for (auto *job : jobs)
             {
-                if (this->cancelled.get())
-                {
-                    DBG("Plugin scanning canceled");
-                    break;
-                }
+                job->process.kill();
+                job->tempFile.deleteFile();
+            }
 
-#if SAFE_SCAN
-                DBG("Safe scanning: " + pluginPath);
+            return;
+        }
 
-                const Uuid tempFileName;
-                const File tempFile(DocumentHelpers::getTempSlot(tempFileName.toString()));
-                tempFile.appendText(pluginPath, false, false);
+        while (jobs.size() < maxJobs && nextPathIndex < pluginPaths.size())
+        {
+            const auto &pluginPath = pluginPaths.getReference(nextPathIndex++);
+            DBG("Safe scanning: " + pluginPath);
 
-                Thread::sleep(50);
+            auto job = make<CheckerJob>();
+            job->pluginPath = pluginPath;
 
-                ChildProcess checkerProcess;
-                const String commandLine(myPath + " " + tempFileName.toString());
-                checkerProcess.start(commandLine);
+            const Uuid tempFileName;
+            job->tempFile = DocumentHelpers::getTempSlot(tempFileName.toString());
+            job->tempFile.appendText(pluginPath, false, false);
 
-                if (!checkerProcess.waitForProcessToFinish(60000))
-                {
-                    checkerProcess.kill();
-                }
-                else
+            // not capturing the output, so that a chatty plugin
+            // doesn't block on a full pipe and gets treated as hanging
+            const String commandLine(myPath + " " + tempFileName.toString());
+            if (!job->process.start(commandLine, 0))
+            {
+                job->tempFile.deleteFile();
+                continue;
+            }
+
+            job->startTime = Time::getMillisecondCounter();
+            jobs.add(job.release());
+        }
+
+        Thread::sleep(PluginScanner::checkerPollIntervalMs);
+
+        for (int i = jobs.size(); --i >= 0;)
+        {
+            auto *job = jobs.getUnchecked(i);
+
+            if (job->process.isRunning())
+            {
+                if (Time::getMillisecondCounter() - job->startTime > PluginScanner::checkerTimeoutMs)
                 {
-                    if (this->cancelled.get())
-                    {
-                        DBG("Plugin scanning canceled");
-                        tempFile.deleteFile();
-                        break;
-                    }
-
-                    Thread::sleep(50);
-
-                    if (tempFile.existsAsFile())
-                    {
-                        try
-                        {
-                            const auto tree(DocumentHelpers::load<XmlSerializer>(tempFile));
-                            if (tree.isValid())
-                            {
-                                forEachChildWithType(tree, e, Serialization::Audio::plugin)
-                                {
-                                    SerializablePluginDescription pluginDescription;
-                                    pluginDescription.deserialize(e);
-                                    this->pluginsList.addType(pluginDescription);
-                                }
-                                    
-                                this->sendChangeMessage();
-                            }
-                        }
-                        catch (...) {}
-                    }
+                    DBG("Plugin check timed out, blacklisting: " + job->pluginPath);
+                    job->process.kill();
+                    job->tempFile.deleteFile();
+                    this->updateScanCache(job->pluginPath, ScanResult::TimedOut, 0);
+                    jobs.remove(i);
                 }
 
-                tempFile.deleteFile();
-#else
-                DBG("Unsafe scanning: " + pluginPath);
+                continue;
+            }
 
-                KnownPluginList knownPluginList;
-                OwnedArray<PluginDescription> typesFound;
-                    
+            // the checker deletes the temp file as soon as it has read the path,
+            // and always writes the results back, even if nothing was found,
+            // so if there are no valid results, it has crashed on the way
+            SerializedData tree;
+            if (job->tempFile.existsAsFile())
+            {
                 try
                 {
-                    for (int j = 0; j < formatManager.getNumFormats(); ++j)
-                    {
-                        AudioPluginFormat *format = formatManager.getFormat(j);
-                        knownPluginList.scanAndAddFile(pluginPath, false, typesFound, *format);
-                    }
+                    tree = DocumentHelpers::load<XmlSerializer>(job->tempFile);
                 }
                 catch (...) {}
-                    
-                // at this point we are still alive and plugin haven't crashed the app
-                if (typesFound.size() != 0)
+            }
+
+            if (tree.isValid())
+            {
+                int numPlugins = 0;
+                forEachChildWithType(tree, e, Serialization::Audio::plugin)
                 {
-                    for (auto *type : typesFound)
-                    {
-                        this->pluginsList.addType(*type);
-                    }
+                    SerializablePluginDescription pluginDescription;
+                    pluginDescription.deserialize(e);
+                    this->pluginsList.addType(pluginDescription);
+                    numPlugins++;
                 }
-                    
-                this->sendChangeMessage();
-                Thread::sleep(150);
-#endif
+
+                this->updateScanCache(job->pluginPath, ScanResult::Scanned, numPlugins);
+
+                if (numPlugins > 0)
+                {
+                    this->sendChangeMessage();
+                }
+            }
+            else
+            {
+                DBG("Plugin check crashed, blacklisting: " + job->pluginPath);
+                this->updateScanCache(job->pluginPath, ScanResult::Crashed, 0);
             }
+
+            job->tempFile.deleteFile();
+            jobs.remove(i);
         }
-        catch (...) {}
+    }
+}
 
+void PluginScanner::scanInProcess(const StringArray &pluginPaths,
+    AudioPluginFormatManager &formatManager)
+{
+    for (const auto &pluginPath : pluginPaths)
+    {
+        if (this->cancelled.get())
         {
-            this->cancelled = false;
-            this->working = false;
+            DBG("Plugin scanning canceled");
+            break;
+        }
+
+        DBG("Unsafe scanning: " + pluginPath);
+
+        KnownPluginList knownPluginList;
+        OwnedArray<PluginDescription> typesFound;
             
-            DBG("Done scanning for audio plugins");
-            this->sendChangeMessage();
+        try
+        {
+            for (int j = 0; j < formatManager.getNumFormats(); ++j)
+            {
+                AudioPluginFormat *format = formatManager.getFormat(j);
+                knownPluginList.scanAndAddFile(pluginPath, false, typesFound, *format);
+            }
+        }
+        catch (...) {}
+            
+        // at this point we are still alive and plugin haven't crashed the app
+        for (auto *type : typesFound)
+        {
+            this->pluginsList.addType(*type);
+        }
+
+        this->updateScanCache(pluginPath, ScanResult::Scanned, typesFound.size());
+            
+        this->sendChangeMessage();
+        Thread::sleep(150);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Scan cache
+//===----------------------------------------------------------------------===//
+
+bool PluginScanner::describeFile(const String &pluginPath, ScannedFile &outDescription)
+{
+    // built-in plugins and the identifiers like AU ones are not files,
+    // there's no way to tell if they have changed, so they are always re-checked
+    if (!File::isAbsolutePath(pluginPath))
+    {
+        return false;
+    }
+
+    const File file(pluginPath);
+    if (!file.exists())
+    {
+        return false;
+    }
+
+    outDescription.size = file.getSize();
+    outDescription.modTime = file.getLastModificationTime().toMilliseconds();
+    return true;
+}
+
+StringArray PluginScanner::findFilesToScan() const
+{
+    FlatHashMap<String, int, StringHash> numKnownPluginsPerFile;
+    for (const auto &description : this->getPlugins())
+    {
+        numKnownPluginsPerFile[description.fileOrIdentifier]++;
+    }
+
+    StringArray result;
+    FlatHashSet<String, StringHash> addedPaths;
+
+    const ScopedLock lock(this->scanCacheLock);
+
+    for (const auto &pluginPath : this->filesToScan)
+    {
+        if (!addedPaths.insert(pluginPath).second)
+        {
+            continue;
+        }
+
+        ScannedFile current;
+        const auto cached = this->scanCache.find(pluginPath);
+        if (!PluginScanner::describeFile(pluginPath, current) ||
+            cached == this->scanCache.end() ||
+            cached->second.size != current.size ||
+            cached->second.modTime != current.modTime)
+        {
+            result.add(pluginPath);
+            continue;
+        }
+
+        if (cached->second.result != ScanResult::Scanned)
+        {
+            if (this->retryingBlacklistedFiles)
+            {
+                result.add(pluginPath);
+            }
+            else
+            {
+                DBG("Skipping blacklisted plugin: " + pluginPath);
+            }
+
+            continue;
+        }
+
+        // the file hasn't changed, but its plugins might have been removed from the list
+        const auto known = numKnownPluginsPerFile.find(pluginPath);
+        const auto numKnownPlugins = known != numKnownPluginsPerFile.end() ? known->second : 0;
+        if (numKnownPlugins < cached->second.numPlugins)
+        {
+            result.add(pluginPath);
         }
-        
-        WaitableEvent::wait();
     }
+
+    return result;
+}
+
+void PluginScanner::updateScanCache(const String &pluginPath, ScanResult result, int numPlugins)
+{
+    ScannedFile scannedFile;
+    if (!PluginScanner::describeFile(pluginPath, scannedFile))
+    {
+        return;
+    }
+
+    scannedFile.result = result;
+    scannedFile.numPlugins = numPlugins;
+
+    const ScopedLock lock(this->scanCacheLock);
+    this->scanCache[pluginPath] = scannedFile;
 }
 
 FileSearchPath PluginScanner::getCommonFolders()
@@ -390,7 +563,8 @@ void PluginScanner::scanPossibleSubfolders(const StringArray &possibleSubfolders
 
 SerializedData PluginScanner::serialize() const
 {
-    SerializedData tree(Serialization::Audio::pluginsList);
+    using namespace Serialization;
+    SerializedData tree(Audio::pluginsList);
 
     for (const auto &type : this->getPlugins())
     {
@@ -398,19 +572,38 @@ SerializedData PluginScanner::serialize() const
         tree.appendChild(pd.serialize());
     }
 
+    SerializedData cacheNode(Audio::pluginsScanCache);
+
+    {
+        const ScopedLock lock(this->scanCacheLock);
+        for (const auto &it : this->scanCache)
+        {
+            SerializedData fileNode(Audio::scannedFile);
+            fileNode.setProperty(Audio::pluginFile, it.first);
+            fileNode.setProperty(Audio::scannedFileSize, it.second.size);
+            fileNode.setProperty(Audio::pluginFileModTime, String::toHexString(it.second.modTime));
+            fileNode.setProperty(Audio::scannedNumPlugins, it.second.numPlugins);
+            fileNode.setProperty(Audio::scanResult, int(it.second.result));
+            cacheNode.appendChild(fileNode);
+        }
+    }
+
+    tree.appendChild(cacheNode);
+
     return tree;
 }
 
 void PluginScanner::deserialize(const SerializedData &data)
 {
+    using namespace Serialization;
     this->reset();
 
-    const auto root = data.hasType(Serialization::Audio::pluginsList) ?
-        data : data.getChildWithName(Serialization::Audio::pluginsList);
+    const auto root = data.hasType(Audio::pluginsList) ?
+        data : data.getChildWithName(Audio::pluginsList);
 
     if (!root.isValid()) { return; }
     
-    for (const auto &child : root)
+    forEachChildWithType(root, child, Audio::plugin)
     {
         SerializablePluginDescription pluginDescription;
         pluginDescription.deserialize(child);
@@ -420,11 +613,37 @@ void PluginScanner::deserialize(const SerializedData &data)
         }
     }
 
+    {
+        const ScopedLock lock(this->scanCacheLock);
+        const auto cacheNode = root.getChildWithName(Audio::pluginsScanCache);
+        forEachChildWithType(cacheNode, fileNode, Audio::scannedFile)
+        {
+            const String path = fileNode.getProperty(Audio::pluginFile);
+            if (path.isEmpty())
+            {
+                continue;
+            }
+
+            ScannedFile scannedFile;
+            scannedFile.size = fileNode.getProperty(Audio::scannedFileSize);
+            scannedFile.modTime = fileNode.getProperty(Audio::pluginFileModTime).toString().getHexValue64();
+            scannedFile.numPlugins = fileNode.getProperty(Audio::scannedNumPlugins);
+            scannedFile.result = ScanResult(int(fileNode.getProperty(Audio::scanResult)));
+            this->scanCache[path] = scannedFile;
+        }
+    }
+
     this->sendChangeMessage();
 }
 
 void PluginScanner::reset()
 {
     this->pluginsList.clear();
+
+    {
+        const ScopedLock lock(this->scanCacheLock);
+        this->scanCache.clear();
+    }
+
     this->sendChangeMessage();
 }
@@ -74,6 +74,49 @@ private:
     FileSearchPath searchPath;
     StringArray filesToScan;
 
+    // explicit folder scans will also retry the blacklisted files:
+    bool retryingBlacklistedFiles = false;
+
+    static constexpr auto maxCheckerProcesses = 8;
+    static constexpr auto checkerTimeoutMs = 60000u;
+    static constexpr auto checkerPollIntervalMs = 20;
+
+    void scanInCheckerProcesses(const StringArray &pluginPaths);
+    void scanInProcess(const StringArray &pluginPaths, AudioPluginFormatManager &formatManager);
+
+private:
+
+    //===------------------------------------------------------------------===//
+    // Scan cache
+    //===------------------------------------------------------------------===//
+
+    // the results of checking each plugin file are kept between the sessions,
+    // so that a rescan only checks the new or changed files, and never retries
+    // the files which have crashed or hung the checker, unless they change
+
+    enum class ScanResult : int
+    {
+        Scanned = 0,
+        Crashed = 1,
+        TimedOut = 2
+    };
+
+    struct ScannedFile final
+    {
+        int64 size = 0;
+        int64 modTime = 0;
+        int numPlugins = 0;
+        ScanResult result = ScanResult::Scanned;
+    };
+
+    static bool describeFile(const String &pluginPath, ScannedFile &outDescription);
+
+    StringArray findFilesToScan() const;
+    void updateScanCache(const String &pluginPath, ScanResult result, int numPlugins);
+
+    FlatHashMap<String, ScannedFile, StringHash> scanCache;
+    CriticalSection scanCacheLock;
+
     FileSearchPath getCommonFolders();
     void scanPossibleSubfolders(const StringArray &possibleSubfolders,
         const File &currentSystemFolder, FileSearchPath &foldersOut);
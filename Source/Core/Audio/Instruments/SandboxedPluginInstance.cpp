@@ -0,0 +1,688 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "SandboxedPluginInstance.h"
+
+//===----------------------------------------------------------------------===//
+// Parameter
+//===----------------------------------------------------------------------===//
+
+// Values are only cached here: the ones changed by the host are flushed
+// to the worker on timer, and the ones changed in the plugin's own editor
+// are sent back by the worker, so that the generic editor and automation
+// on the host side see the same values as the plugin itself
+class SandboxedPluginInstance::Parameter final : public AudioProcessorParameter
+{
+public:
+
+    Parameter(const String &name, const String &label,
+        float defaultValue, float value, int numSteps, bool discrete) :
+        name(name),
+        label(label),
+        defaultValue(defaultValue),
+        numSteps(numSteps),
+        discrete(discrete),
+        value(value) {}
+
+    float getValue() const override
+    {
+        return this->value.get();
+    }
+
+    void setValue(float newValue) override
+    {
+        this->value = newValue;
+        this->hasChangesToSend = true;
+    }
+
+    float getDefaultValue() const override
+    {
+        return this->defaultValue;
+    }
+
+    String getName(int maximumStringLength) const override
+    {
+        return this->name.substring(0, maximumStringLength);
+    }
+
+    String getLabel() const override
+    {
+        return this->label;
+    }
+
+    float getValueForText(const String &text) const override
+    {
+        return text.getFloatValue();
+    }
+
+    int getNumSteps() const override
+    {
+        return this->numSteps;
+    }
+
+    bool isDiscrete() const override
+    {
+        return this->discrete;
+    }
+
+    bool fetchChangesToSend() noexcept
+    {
+        return this->hasChangesToSend.compareAndSetBool(false, true);
+    }
+
+    void updateFromWorker(float newValue)
+    {
+        this->value = newValue;
+        this->sendValueChangedMessageToListeners(newValue);
+    }
+
+private:
+
+    const String name;
+    const String label;
+    const float defaultValue;
+    const int numSteps;
+    const bool discrete;
+
+    Atomic<float> value;
+    Atomic<bool> hasChangesToSend = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Parameter)
+};
+
+//===----------------------------------------------------------------------===//
+// Lifecycle
+//===----------------------------------------------------------------------===//
+
+UniquePointer<SandboxedPluginInstance> SandboxedPluginInstance::create(
+    const PluginDescription &description,
+    double initialSampleRate, int initialBufferSize, String &errorMessage,
+    AbortCheck shouldAbort /*= nullptr*/)
+{
+    UniquePointer<SandboxedPluginInstance> instance(new SandboxedPluginInstance(description));
+    if (!instance->launch(initialSampleRate, initialBufferSize, errorMessage, move(shouldAbort)))
+    {
+        DBG("Failed to load " + description.name + " in a sandbox: " + errorMessage);
+        return nullptr;
+    }
+
+    return instance;
+}
+
+SandboxedPluginInstance::SandboxedPluginInstance(const PluginDescription &description) :
+    description(description),
+    readyEvent(true),
+    stateEvent(true)
+{
+    this->outputMidi.ensureSize(PluginSandbox::maxMidiDataSize);
+}
+
+SandboxedPluginInstance::~SandboxedPluginInstance()
+{
+    this->stopTimer();
+
+    // this will also stop the connection thread, so that
+    // no more messages are handled while we're being destroyed
+    this->killWorkerProcess();
+    this->workerAlive = false;
+
+    this->sharedMemory = nullptr;
+    this->sharedMemoryFile.deleteFile();
+}
+
+bool SandboxedPluginInstance::launch(double sampleRate, int blockSize,
+    String &errorMessage, AbortCheck shouldAbort)
+{
+    this->sharedMemoryFile = PluginSandbox::createSharedMemoryFile();
+
+    {
+        const MemoryBlock zeros(PluginSandbox::sharedMemorySize, true);
+        if (!this->sharedMemoryFile.replaceWithData(zeros.getData(), zeros.getSize()))
+        {
+            errorMessage = "Cannot create the shared memory file";
+            return false;
+        }
+    }
+
+    this->sharedMemory = make<MemoryMappedFile>(this->sharedMemoryFile, MemoryMappedFile::readWrite);
+    if (this->sharedMemory->getData() == nullptr ||
+        this->sharedMemory->getSize() < PluginSandbox::sharedMemorySize)
+    {
+        this->sharedMemory = nullptr;
+        errorMessage = "Cannot map the shared memory file";
+        return false;
+    }
+
+    this->getSharedMemory()->magic = PluginSandbox::layoutMagic;
+
+    const auto executable = File::getSpecialLocation(File::currentExecutableFile);
+    if (!this->launchWorkerProcess(executable, PluginSandbox::commandLineUid, PluginSandbox::launchTimeoutMs, 0))
+    {
+        errorMessage = "Cannot launch the worker process";
+        return false;
+    }
+
+    this->workerAlive = true;
+
+    const auto initMessage = PluginSandbox::makeMessage(PluginSandbox::Message::initialise, [&](MemoryOutputStream &out)
+    {
+        PluginSandbox::writeDescription(out, this->description);
+        out.writeString(this->sharedMemoryFile.getFullPathName());
+        out.writeDouble(sampleRate);
+        out.writeInt(jmin(blockSize, PluginSandbox::maxBlockSize));
+    });
+
+    if (!this->sendMessageToWorker(initMessage))
+    {
+        errorMessage = "The worker process didn't respond";
+        return false;
+    }
+
+    // the worker is killed by the destructor, if we give up on it
+    for (int waitedMs = 0; !this->readyEvent.wait(PluginSandbox::abortCheckIntervalMs);
+        waitedMs += PluginSandbox::abortCheckIntervalMs)
+    {
+        if (shouldAbort != nullptr && shouldAbort())
+        {
+            errorMessage = "Cancelled";
+            return false;
+        }
+
+        if (waitedMs >= PluginSandbox::initialiseTimeoutMs)
+        {
+            errorMessage = "The worker process didn't respond";
+            return false;
+        }
+    }
+
+    MemoryBlock message;
+    {
+        const ScopedLock lock(this->receivedDataLock);
+        message = this->readyMessage;
+        errorMessage = this->failureMessage;
+    }
+
+    if (message.isEmpty())
+    {
+        if (errorMessage.isEmpty())
+        {
+            errorMessage = "The worker process has quit unexpectedly";
+        }
+
+        return false;
+    }
+
+    this->applyReadyMessage(message);
+    this->currentBlockSize = blockSize;
+    this->setPlayConfigDetails(this->numInputs, this->numOutputs, sampleRate, blockSize);
+    this->updateLatency();
+
+    this->isReady = true;
+    this->startTimer(PluginSandbox::timerIntervalMs);
+    return true;
+}
+
+void SandboxedPluginInstance::applyReadyMessage(const MemoryBlock &message)
+{
+    MemoryInputStream in(message, false);
+    in.readInt(); // the message type
+
+    this->pluginName = in.readString();
+    this->numInputs = jlimit(0, PluginSandbox::maxChannels, in.readInt());
+    this->numOutputs = jlimit(0, PluginSandbox::maxChannels, in.readInt());
+    this->pluginAcceptsMidi = in.readBool();
+    this->pluginProducesMidi = in.readBool();
+    this->pluginHasEditor = in.readBool();
+    this->tailLengthSeconds = in.readDouble();
+    this->remoteLatency = in.readInt();
+
+    const auto numPrograms = in.readInt();
+    this->currentProgram = in.readInt();
+    for (int i = 0; i < numPrograms; ++i)
+    {
+        this->programNames.add(in.readString());
+    }
+
+    const auto numParameters = in.readInt();
+    for (int i = 0; i < numParameters; ++i)
+    {
+        const auto name = in.readString();
+        const auto label = in.readString();
+        const auto defaultValue = in.readFloat();
+        const auto value = in.readFloat();
+        const auto numSteps = in.readInt();
+        const auto discrete = in.readBool();
+
+        auto *parameter = new Parameter(name, label, defaultValue, value, numSteps, discrete);
+        this->sandboxedParameters.add(parameter);
+        this->addParameter(parameter);
+    }
+}
+
+bool SandboxedPluginInstance::isWorkerAlive() const noexcept
+{
+    return this->workerAlive.get();
+}
+
+uint32 SandboxedPluginInstance::getNumUnderruns() const noexcept
+{
+    return this->numUnderruns.get();
+}
+
+uint32 SandboxedPluginInstance::getNumDroppedBlocks() const noexcept
+{
+    return this->numDroppedBlocks.get();
+}
+
+PluginSandbox::SharedMemoryLayout *SandboxedPluginInstance::getSharedMemory() const noexcept
+{
+    return this->sharedMemory != nullptr ?
+        static_cast<PluginSandbox::SharedMemoryLayout *>(this->sharedMemory->getData()) : nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// AudioPluginInstance
+//===----------------------------------------------------------------------===//
+
+const String SandboxedPluginInstance::getName() const
+{
+    return this->pluginName.isNotEmpty() ? this->pluginName : this->description.name;
+}
+
+void SandboxedPluginInstance::fillInPluginDescription(PluginDescription &outDescription) const
+{
+    outDescription = this->description;
+}
+
+void SandboxedPluginInstance::processBlock(AudioSampleBuffer &buffer, MidiBuffer &midiMessages)
+{
+    auto *memory = this->getSharedMemory();
+    if (memory == nullptr || !this->workerAlive.get())
+    {
+        buffer.clear();
+        midiMessages.clear();
+        return;
+    }
+
+    const auto numSamples = buffer.getNumSamples();
+    const auto numChunks = uint32((numSamples + PluginSandbox::maxBlockSize - 1) / PluginSandbox::maxBlockSize);
+
+    // the first block after preparing has no results to pick up, and it
+    // skips whatever is left from before; since then, the results of the
+    // previous block are expected to be pending, and if the worker has stalled
+    // for a moment and then caught up, the stale ones are skipped, so that
+    // the latency is always one block
+    const auto isPrimed = this->isPipelinePrimed.get();
+    const auto numResultsToKeep = isPrimed ? numChunks : 0;
+    while (memory->toHost.getNumPending() > numResultsToKeep)
+    {
+        memory->toHost.startReading();
+        memory->toHost.finishReading();
+    }
+
+    this->outputMidi.clear();
+
+    for (int start = 0; start < numSamples; start += PluginSandbox::maxBlockSize)
+    {
+        const auto chunkSize = jmin(PluginSandbox::maxBlockSize, numSamples - start);
+
+        if (auto *input = memory->toWorker.startWriting())
+        {
+            PluginSandbox::writeBlock(*input, buffer, start, chunkSize, midiMessages);
+            memory->toWorker.finishWriting();
+        }
+        else
+        {
+            this->numDroppedBlocks += 1;
+        }
+
+        if (!isPrimed)
+        {
+            buffer.clear(start, chunkSize);
+        }
+        else if (auto *output = memory->toHost.startReading())
+        {
+            PluginSandbox::readBlock(*output, buffer, start, chunkSize, this->outputMidi);
+            memory->toHost.finishReading();
+        }
+        else
+        {
+            buffer.clear(start, chunkSize);
+            this->numUnderruns += 1;
+        }
+    }
+
+    midiMessages.swapWith(this->outputMidi);
+    this->isPipelinePrimed = true;
+}
+
+void SandboxedPluginInstance::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
+{
+    this->currentBlockSize = estimatedSamplesPerBlock;
+    this->isPipelinePrimed = false;
+    this->updateLatency();
+
+    this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::prepare, [&](MemoryOutputStream &out)
+    {
+        out.writeDouble(sampleRate);
+        out.writeInt(jmin(estimatedSamplesPerBlock, PluginSandbox::maxBlockSize));
+    }));
+}
+
+void SandboxedPluginInstance::releaseResources()
+{
+    this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::release));
+}
+
+void SandboxedPluginInstance::updateLatency()
+{
+    // one block for the pipelining plus whatever the plugin reports
+    this->setLatencySamples(this->currentBlockSize + this->remoteLatency.get());
+}
+
+//===----------------------------------------------------------------------===//
+// AudioProcessor
+//===----------------------------------------------------------------------===//
+
+double SandboxedPluginInstance::getTailLengthSeconds() const
+{
+    return this->tailLengthSeconds;
+}
+
+bool SandboxedPluginInstance::acceptsMidi() const
+{
+    return this->pluginAcceptsMidi;
+}
+
+bool SandboxedPluginInstance::producesMidi() const
+{
+    return this->pluginProducesMidi;
+}
+
+AudioProcessorEditor *SandboxedPluginInstance::createEditor()
+{
+    return nullptr;
+}
+
+bool SandboxedPluginInstance::hasEditor() const
+{
+    return false;
+}
+
+bool SandboxedPluginInstance::hasRemoteEditor() const noexcept
+{
+    return this->pluginHasEditor && this->workerAlive.get();
+}
+
+void SandboxedPluginInstance::showRemoteEditor()
+{
+    this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::showEditor));
+}
+
+int SandboxedPluginInstance::getNumPrograms()
+{
+    return this->programNames.size();
+}
+
+int SandboxedPluginInstance::getCurrentProgram()
+{
+    return this->currentProgram;
+}
+
+void SandboxedPluginInstance::setCurrentProgram(int index)
+{
+    if (isPositiveAndBelow(index, this->programNames.size()))
+    {
+        this->currentProgram = index;
+        this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::setProgram, [index](MemoryOutputStream &out)
+        {
+            out.writeInt(index);
+        }));
+    }
+}
+
+const String SandboxedPluginInstance::getProgramName(int index)
+{
+    return this->programNames[index];
+}
+
+void SandboxedPluginInstance::changeProgramName(int, const String &) {}
+
+// if the worker has crashed, this returns the last state we know of,
+// so that saving the project doesn't lose the plugin's settings
+void SandboxedPluginInstance::getStateInformation(MemoryBlock &destData)
+{
+    const ScopedLock requestLock(this->stateRequestLock);
+
+    if (this->workerAlive.get())
+    {
+        this->stateEvent.reset();
+        if (this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::getState)))
+        {
+            this->stateEvent.wait(PluginSandbox::replyTimeoutMs);
+        }
+    }
+
+    const ScopedLock lock(this->receivedDataLock);
+    destData = this->lastKnownState;
+}
+
+void SandboxedPluginInstance::setStateInformation(const void *data, int sizeInBytes)
+{
+    MemoryBlock state(data, size_t(sizeInBytes));
+
+    {
+        const ScopedLock lock(this->receivedDataLock);
+        this->lastKnownState = state;
+    }
+
+    this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::setState, [&state](MemoryOutputStream &out)
+    {
+        PluginSandbox::writeMemoryBlock(out, state);
+    }));
+}
+
+//===----------------------------------------------------------------------===//
+// ChildProcessCoordinator
+//===----------------------------------------------------------------------===//
+
+// called on the connection thread
+void SandboxedPluginInstance::handleMessageFromWorker(const MemoryBlock &message)
+{
+    MemoryInputStream in(message, false);
+    const auto type = PluginSandbox::Message(in.readInt());
+
+    switch (type)
+    {
+    case PluginSandbox::Message::ready:
+    {
+        const ScopedLock lock(this->receivedDataLock);
+        this->readyMessage = message;
+        this->readyEvent.signal();
+        break;
+    }
+    case PluginSandbox::Message::failed:
+    {
+        const ScopedLock lock(this->receivedDataLock);
+        this->failureMessage = in.readString();
+        this->readyEvent.signal();
+        break;
+    }
+    case PluginSandbox::Message::state:
+    {
+        const auto state = PluginSandbox::readMemoryBlock(in);
+        const ScopedLock lock(this->receivedDataLock);
+        this->lastKnownState = state;
+        this->stateEvent.signal();
+        break;
+    }
+    case PluginSandbox::Message::parameterChanged:
+    {
+        const auto index = in.readInt();
+        const auto value = in.readFloat();
+        if (this->isReady.get())
+        {
+            if (auto *parameter = this->sandboxedParameters[index])
+            {
+                parameter->updateFromWorker(value);
+            }
+        }
+        break;
+    }
+    case PluginSandbox::Message::latencyChanged:
+        this->remoteLatency = in.readInt();
+        break;
+    default:
+        jassertfalse;
+        break;
+    }
+}
+
+void SandboxedPluginInstance::handleConnectionLost()
+{
+    DBG("Sandboxed plugin " + this->description.name + " has lost its worker process");
+
+    this->workerAlive = false;
+
+    // don't let anyone wait for the replies that won't come
+    this->readyEvent.signal();
+    this->stateEvent.signal();
+}
+
+//===----------------------------------------------------------------------===//
+// Timer
+//===----------------------------------------------------------------------===//
+
+void SandboxedPluginInstance::timerCallback()
+{
+    if (!this->workerAlive.get())
+    {
+        this->stopTimer();
+        return;
+    }
+
+    for (int i = 0; i < this->sandboxedParameters.size(); ++i)
+    {
+        auto *parameter = this->sandboxedParameters.getUnchecked(i);
+        if (parameter->fetchChangesToSend())
+        {
+            const auto value = parameter->getValue();
+            this->sendMessageToWorker(PluginSandbox::makeMessage(PluginSandbox::Message::setParameter, [i, value](MemoryOutputStream &out)
+            {
+                out.writeInt(i);
+                out.writeFloat(value);
+            }));
+        }
+    }
+
+    if (this->getLatencySamples() != this->currentBlockSize + this->remoteLatency.get())
+    {
+        this->updateLatency();
+    }
+
+    // the hang watchdog: if there are blocks waiting for the worker,
+    // and it hasn't picked up any of them for a while, it's stuck
+    auto *memory = this->getSharedMemory();
+    const auto numRead = memory->toWorker.numRead.load(std::memory_order_acquire);
+    const auto now = Time::getMillisecondCounter();
+
+    if (numRead != this->lastWorkerReadCount || memory->toWorker.getNumPending() == 0)
+    {
+        this->lastWorkerReadCount = numRead;
+        this->lastWorkerProgressTime = now;
+    }
+    else if (now - this->lastWorkerProgressTime > uint32(PluginSandbox::hangTimeoutMs))
+    {
+        DBG("Sandboxed plugin " + this->description.name + " seems to hang, killing its worker process");
+        this->workerAlive = false;
+        this->killWorkerProcess();
+        this->stopTimer();
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+#include "DefaultSynthAudioPlugin.h"
+
+class SandboxedPluginInstanceTests final : public UnitTest
+{
+public:
+
+    SandboxedPluginInstanceTests() :
+        UnitTest("Sandboxed plugin instance tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        beginTest("Built-in synth running in a worker process");
+
+        DefaultSynthAudioPlugin localSynth;
+        PluginDescription description;
+        localSynth.fillInPluginDescription(description);
+
+        const auto sampleRate = 44100.0;
+        const auto blockSize = 512;
+
+        String error;
+        auto sandboxed = SandboxedPluginInstance::create(description, sampleRate, blockSize, error);
+        expect(sandboxed != nullptr, error);
+        if (sandboxed == nullptr)
+        {
+            return;
+        }
+
+        expect(sandboxed->isWorkerAlive());
+        expect(sandboxed->acceptsMidi());
+        expectEquals(sandboxed->getTotalNumOutputChannels(), 2);
+        expectEquals(sandboxed->getPluginDescription().pluginFormatName, description.pluginFormatName);
+        expectEquals(sandboxed->getLatencySamples(), blockSize);
+
+        sandboxed->prepareToPlay(sampleRate, blockSize);
+
+        AudioBuffer<float> buffer(2, blockSize);
+        MidiBuffer midi;
+
+        // the output comes one block later, and the worker needs
+        // some time to start up, so give it a few dozen blocks
+        float magnitude = 0.f;
+        for (int i = 0; i < 50 && magnitude == 0.f; ++i)
+        {
+            buffer.clear();
+            midi.clear();
+            midi.addEvent(MidiMessage::noteOn(1, 60, 1.f), 0);
+            sandboxed->processBlock(buffer, midi);
+            magnitude = buffer.getMagnitude(0, blockSize);
+            Thread::sleep(20);
+        }
+
+        expect(magnitude > 0.f, "The sandboxed synth should produce some sound");
+
+        MemoryBlock state;
+        sandboxed->getStateInformation(state);
+        expect(sandboxed->isWorkerAlive());
+
+        sandboxed = nullptr;
+    }
+};
+
+static SandboxedPluginInstanceTests sandboxedPluginInstanceTests;
+
+#endif
@@ -0,0 +1,162 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "PluginSandboxProtocol.h"
+
+// A host-side proxy for a plugin running in a separate worker process
+// (see PluginSandboxWorker): if the plugin crashes or hangs, the worker dies,
+// and this proxy just keeps outputting silence instead of taking the app down.
+
+// Audio is pipelined by one block: processBlock() never waits for the worker,
+// it pushes the current block and picks up the result of the previous one,
+// which is compensated for by reporting one more block of latency; the first
+// block after preparing has nothing to pick up, so it's silent, and that keeps
+// the latency the same however fast the worker is.
+
+// The proxy pretends to be the wrapped plugin in fillInPluginDescription(),
+// so that instruments are saved exactly as if the plugin was hosted directly.
+
+class SandboxedPluginInstance final :
+    public AudioPluginInstance,
+    private ChildProcessCoordinator,
+    private Timer
+{
+public:
+
+    // launches a worker, loads the plugin there and blocks until it's ready,
+    // or until shouldAbort returns true, e.g. when the app is quitting;
+    // returns nullptr and fills in the error message on failure
+    using AbortCheck = Function<bool()>;
+    static UniquePointer<SandboxedPluginInstance> create(const PluginDescription &description,
+        double initialSampleRate, int initialBufferSize, String &errorMessage,
+        AbortCheck shouldAbort = nullptr);
+
+    ~SandboxedPluginInstance() override;
+
+    bool isWorkerAlive() const noexcept;
+
+    // the blocks the worker didn't process in time, which were replaced with
+    // silence, and the ones which didn't fit in the queue to the worker;
+    // shown in the instrument editor, see InstrumentEditor::updateLatencyLabel
+    uint32 getNumUnderruns() const noexcept;
+    uint32 getNumDroppedBlocks() const noexcept;
+
+    // the plugin's own editor lives in the worker process,
+    // the host only can ask it to be shown in a separate window there
+    bool hasRemoteEditor() const noexcept;
+    void showRemoteEditor();
+
+    //===------------------------------------------------------------------===//
+    // AudioPluginInstance
+    //===------------------------------------------------------------------===//
+
+    const String getName() const override;
+    void fillInPluginDescription(PluginDescription &description) const override;
+
+    void processBlock(AudioSampleBuffer &buffer, MidiBuffer &midiMessages) override;
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock) override;
+    void releaseResources() override;
+
+    //===------------------------------------------------------------------===//
+    // AudioProcessor
+    //===------------------------------------------------------------------===//
+
+    double getTailLengthSeconds() const override;
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+
+    AudioProcessorEditor *createEditor() override;
+    bool hasEditor() const override;
+
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram(int index) override;
+    const String getProgramName(int index) override;
+    void changeProgramName(int index, const String &newName) override;
+
+    void getStateInformation(MemoryBlock &destData) override;
+    void setStateInformation(const void *data, int sizeInBytes) override;
+
+private:
+
+    explicit SandboxedPluginInstance(const PluginDescription &description);
+
+    bool launch(double sampleRate, int blockSize, String &errorMessage, AbortCheck shouldAbort);
+    void applyReadyMessage(const MemoryBlock &message);
+
+    void handleMessageFromWorker(const MemoryBlock &message) override;
+    void handleConnectionLost() override;
+
+    void timerCallback() override;
+
+    void updateLatency();
+
+    PluginSandbox::SharedMemoryLayout *getSharedMemory() const noexcept;
+
+private:
+
+    const PluginDescription description;
+
+    File sharedMemoryFile;
+    UniquePointer<MemoryMappedFile> sharedMemory;
+
+    Atomic<bool> workerAlive = false;
+    Atomic<bool> isReady = false;
+    Atomic<uint32> numUnderruns = 0;
+    Atomic<uint32> numDroppedBlocks = 0;
+
+    MidiBuffer outputMidi;
+
+    // the stuff received on the connection thread:
+    CriticalSection receivedDataLock;
+    WaitableEvent readyEvent;
+    MemoryBlock readyMessage;
+    String failureMessage;
+
+    CriticalSection stateRequestLock;
+    WaitableEvent stateEvent;
+    MemoryBlock lastKnownState;
+
+    // the stuff reported by the plugin on startup:
+    String pluginName;
+    int numInputs = 0;
+    int numOutputs = 0;
+    bool pluginAcceptsMidi = false;
+    bool pluginProducesMidi = false;
+    bool pluginHasEditor = false;
+    double tailLengthSeconds = 0.0;
+
+    StringArray programNames;
+    int currentProgram = 0;
+
+    Atomic<int> remoteLatency = 0;
+    int currentBlockSize = 0;
+
+    // reset when preparing, see processBlock
+    Atomic<bool> isPipelinePrimed = false;
+
+    // the hang watchdog
+    uint32 lastWorkerReadCount = 0;
+    uint32 lastWorkerProgressTime = 0;
+
+    class Parameter;
+    Array<Parameter *> sandboxedParameters; // owned by the AudioProcessor
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SandboxedPluginInstance)
+};
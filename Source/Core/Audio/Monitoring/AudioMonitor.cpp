@@ -18,6 +18,7 @@
 #include "Common.h"
 #include "AudioMonitor.h"
 #include "AudioCore.h"
+#include "RealtimeSafety.h"
 
 class ClippingWarningAsyncCallback final : public AsyncUpdater
 {
@@ -77,6 +78,7 @@ void AudioMonitor::audioDeviceAboutToStart(AudioIODevice *device)
 void AudioMonitor::audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
     float **outputChannelData, int numOutputChannels, int numSamples)
 {
+    const RealtimeSafety::ScopedRealtimeRegion realtimeRegion;
     const int minNumChannels = jmin(AudioMonitor::numChannels, numOutputChannels);
     
     for (int channel = 0; channel < minNumChannels; ++channel)
@@ -0,0 +1,385 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "RealtimeSafety.h"
+
+static std::atomic<int> realtimeSafetyPolicy = { int(RealtimeSafety::Policy::log) };
+static std::atomic<int> realtimeSafetyNumViolations = { 0 };
+
+void RealtimeSafety::setPolicy(Policy policy) noexcept
+{
+    realtimeSafetyPolicy.store(int(policy));
+}
+
+RealtimeSafety::Policy RealtimeSafety::getPolicy() noexcept
+{
+    return Policy(realtimeSafetyPolicy.load());
+}
+
+int RealtimeSafety::getNumViolations() noexcept
+{
+    return realtimeSafetyNumViolations.load();
+}
+
+#if HELIO_REALTIME_SAFETY_CHECKS
+
+//===----------------------------------------------------------------------===//
+// Checks
+//===----------------------------------------------------------------------===//
+
+// this is accessed from within malloc, so it has to be trivially
+// constructible, otherwise the first access would allocate itself
+struct RealtimeSafetyThreadState final
+{
+    int numRegions;
+    int numAllowances;
+};
+
+static thread_local RealtimeSafetyThreadState realtimeSafetyThreadState;
+
+// the call sites already reported, so that a violation in a callback isn't
+// logged on every block; the sites are identified by the return addresses,
+// and only a new site takes the full stack trace, which is slow to capture
+// and to symbolize, and which allocates by itself
+static constexpr auto realtimeSafetyMaxReportedCallSites = 256;
+static std::atomic<uint64> realtimeSafetyReportedCallSites[realtimeSafetyMaxReportedCallSites];
+
+static bool markRealtimeSafetyCallSiteAsReported(uint64 hash) noexcept
+{
+    hash = jmax(uint64(1), hash); // zero marks the empty slots
+
+    for (int i = 0; i < realtimeSafetyMaxReportedCallSites; ++i)
+    {
+        auto &slot = realtimeSafetyReportedCallSites[(hash + i) % realtimeSafetyMaxReportedCallSites];
+        uint64 expected = 0;
+        if (slot.compare_exchange_strong(expected, hash))
+        {
+            return true;
+        }
+
+        if (expected == hash)
+        {
+            return false;
+        }
+    }
+
+    return true; // too many call sites to remember, so just keep reporting
+}
+
+#if JUCE_LINUX && defined (__GLIBC__)
+
+#include <execinfo.h>
+
+// the libc functions are called from operator new etc., so the immediate
+// return address is the same for most of the call sites, and a few frames
+// more are needed; the unwinder is loaded lazily, which allocates, so
+// it's loaded here once, at the startup, and not within a realtime region
+static constexpr auto realtimeSafetyCallSiteDepth = 8;
+static const int realtimeSafetyUnwinderWarmUp = []()
+{
+    void *frames[1];
+    return backtrace(frames, 1);
+}();
+
+#endif
+
+static uint64 getRealtimeSafetyCallSite(void *returnAddress) noexcept
+{
+    if (returnAddress != nullptr)
+    {
+        return uint64(pointer_sized_uint(returnAddress));
+    }
+
+#if JUCE_LINUX && defined (__GLIBC__)
+
+    ignoreUnused(realtimeSafetyUnwinderWarmUp);
+
+    void *frames[realtimeSafetyCallSiteDepth];
+    const auto numFrames = backtrace(frames, realtimeSafetyCallSiteDepth);
+
+    uint64 hash = 14695981039346656037ull;
+    for (int i = 0; i < numFrames; ++i)
+    {
+        hash = (hash ^ uint64(pointer_sized_uint(frames[i]))) * 1099511628211ull;
+    }
+
+    return hash;
+
+#else
+
+    return 0;
+
+#endif
+}
+
+static void checkRealtimeSafety(const char *operation, void *returnAddress = nullptr) noexcept
+{
+    auto &state = realtimeSafetyThreadState;
+    if (state.numRegions == 0 || state.numAllowances > 0)
+    {
+        return;
+    }
+
+    // reporting allocates and locks too, so it has to be exempt itself
+    state.numAllowances++;
+
+    realtimeSafetyNumViolations.fetch_add(1);
+
+    const auto policy = RealtimeSafety::getPolicy();
+    if (policy != RealtimeSafety::Policy::ignore)
+    {
+        const auto isNewCallSite =
+            markRealtimeSafetyCallSiteAsReported(getRealtimeSafetyCallSite(returnAddress));
+
+        if (isNewCallSite || policy == RealtimeSafety::Policy::abort)
+        {
+            Logger::writeToLog("Realtime safety violation: " + String(operation) +
+                " called on thread " + Thread::getCurrentThreadName() +
+                "\n" + SystemStats::getStackBacktrace());
+        }
+
+        if (policy == RealtimeSafety::Policy::abort)
+        {
+            std::abort();
+        }
+    }
+
+    state.numAllowances--;
+}
+
+RealtimeSafety::ScopedRealtimeRegion::ScopedRealtimeRegion() noexcept
+{
+    realtimeSafetyThreadState.numRegions++;
+}
+
+RealtimeSafety::ScopedRealtimeRegion::~ScopedRealtimeRegion() noexcept
+{
+    jassert(realtimeSafetyThreadState.numRegions > 0);
+    realtimeSafetyThreadState.numRegions--;
+}
+
+RealtimeSafety::ScopedAllowance::ScopedAllowance() noexcept
+{
+    realtimeSafetyThreadState.numAllowances++;
+}
+
+RealtimeSafety::ScopedAllowance::~ScopedAllowance() noexcept
+{
+    jassert(realtimeSafetyThreadState.numAllowances > 0);
+    realtimeSafetyThreadState.numAllowances--;
+}
+
+//===----------------------------------------------------------------------===//
+// Interception
+//===----------------------------------------------------------------------===//
+
+#if JUCE_LINUX && defined (__GLIBC__)
+
+#include <dlfcn.h>
+
+// these override the libc's functions for the whole process, including
+// the calls made from the shared libraries, e.g. libstdc++'s operator new,
+// so they need to be exported despite -fvisibility=hidden; the allocator
+// is called directly, and the other ones are looked up lazily
+
+#define HELIO_REALTIME_SAFETY_EXPORT __attribute__ ((visibility ("default")))
+
+extern "C"
+{
+    void *__libc_malloc(size_t size) noexcept;
+    void *__libc_calloc(size_t numElements, size_t elementSize) noexcept;
+    void *__libc_realloc(void *ptr, size_t size) noexcept;
+    void __libc_free(void *ptr) noexcept;
+
+    HELIO_REALTIME_SAFETY_EXPORT void *malloc(size_t size) noexcept
+    {
+        checkRealtimeSafety("malloc");
+        return __libc_malloc(size);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT void *calloc(size_t numElements, size_t elementSize) noexcept
+    {
+        checkRealtimeSafety("calloc");
+        return __libc_calloc(numElements, elementSize);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT void *realloc(void *ptr, size_t size) noexcept
+    {
+        checkRealtimeSafety("realloc");
+        return __libc_realloc(ptr, size);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT void free(void *ptr) noexcept
+    {
+        if (ptr != nullptr)
+        {
+            checkRealtimeSafety("free");
+        }
+
+        __libc_free(ptr);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT int pthread_mutex_lock(pthread_mutex_t *mutex) noexcept
+    {
+        using Function = int (*)(pthread_mutex_t *);
+        static const auto original = (Function) dlsym(RTLD_NEXT, "pthread_mutex_lock");
+        checkRealtimeSafety("pthread_mutex_lock");
+        return original(mutex);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT int nanosleep(const struct timespec *duration, struct timespec *remaining)
+    {
+        using Function = int (*)(const struct timespec *, struct timespec *);
+        static const auto original = (Function) dlsym(RTLD_NEXT, "nanosleep");
+        checkRealtimeSafety("nanosleep");
+        return original(duration, remaining);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT int clock_nanosleep(clockid_t clock, int flags,
+        const struct timespec *duration, struct timespec *remaining)
+    {
+        using Function = int (*)(clockid_t, int, const struct timespec *, struct timespec *);
+        static const auto original = (Function) dlsym(RTLD_NEXT, "clock_nanosleep");
+        checkRealtimeSafety("clock_nanosleep");
+        return original(clock, flags, duration, remaining);
+    }
+
+    HELIO_REALTIME_SAFETY_EXPORT int usleep(useconds_t duration)
+    {
+        using Function = int (*)(useconds_t);
+        static const auto original = (Function) dlsym(RTLD_NEXT, "usleep");
+        checkRealtimeSafety("usleep");
+        return original(duration);
+    }
+}
+
+#undef HELIO_REALTIME_SAFETY_EXPORT
+
+#else
+
+// elsewhere, there's no portable way to intercept the libc functions,
+// but at least the allocations made by operator new can be caught
+
+#if JUCE_MSVC
+#   include <intrin.h>
+#   define HELIO_REALTIME_SAFETY_CALLER _ReturnAddress()
+#else
+#   define HELIO_REALTIME_SAFETY_CALLER __builtin_return_address(0)
+#endif
+
+void *operator new(std::size_t size)
+{
+    checkRealtimeSafety("operator new", HELIO_REALTIME_SAFETY_CALLER);
+    if (auto *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr != nullptr)
+    {
+        checkRealtimeSafety("operator delete", HELIO_REALTIME_SAFETY_CALLER);
+    }
+
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+#undef HELIO_REALTIME_SAFETY_CALLER
+
+#endif
+
+#endif
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS && HELIO_REALTIME_SAFETY_CHECKS
+
+class RealtimeSafetyTests final : public UnitTest
+{
+public:
+
+    RealtimeSafetyTests() : UnitTest("Realtime safety tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        // the runner sets the policy to abort, so this counts silently
+        const auto previousPolicy = RealtimeSafety::getPolicy();
+        RealtimeSafety::setPolicy(RealtimeSafety::Policy::ignore);
+
+        beginTest("Allocations outside of realtime regions are fine");
+        auto numViolations = RealtimeSafety::getNumViolations();
+        this->allocated = make<String>("outside");
+        this->allocated = nullptr;
+        expectEquals(RealtimeSafety::getNumViolations(), numViolations);
+
+        beginTest("Allocations within realtime regions are caught");
+        {
+            const RealtimeSafety::ScopedRealtimeRegion region;
+            this->allocated = make<String>("inside");
+        }
+        expectGreaterThan(RealtimeSafety::getNumViolations(), numViolations);
+        this->allocated = nullptr;
+
+        beginTest("Allowances lift the checks");
+        numViolations = RealtimeSafety::getNumViolations();
+        {
+            const RealtimeSafety::ScopedRealtimeRegion region;
+            const RealtimeSafety::ScopedAllowance allowance;
+            this->allocated = make<String>("allowed");
+            this->allocated = nullptr;
+        }
+        expectEquals(RealtimeSafety::getNumViolations(), numViolations);
+
+        RealtimeSafety::setPolicy(previousPolicy);
+    }
+
+private:
+
+    // a member, so that the compiler can't elide the allocations
+    UniquePointer<String> allocated;
+};
+
+static RealtimeSafetyTests realtimeSafetyTests;
+
+#endif
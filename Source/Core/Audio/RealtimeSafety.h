@@ -0,0 +1,91 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// A debugging aid which catches the code that must not run in realtime:
+// the audio callbacks, the player and the renderer threads mark their
+// realtime regions, and while a thread is inside one, heap allocations,
+// mutex locks and sleeps are reported with a stack trace (once per call site),
+// or abort the app, depending on the policy; the unit tests runner sets it
+// to abort, so that a test which hits any of those fails.
+
+// What is intercepted depends on the platform: on Linux with glibc,
+// that's malloc/calloc/realloc/free (operator new and delete included),
+// pthread_mutex_lock (which is what CriticalSection and WaitableEvent use),
+// nanosleep, clock_nanosleep and usleep; on other platforms, only
+// the global operator new and delete are replaced.
+
+#if !defined HELIO_REALTIME_SAFETY_CHECKS
+#   define HELIO_REALTIME_SAFETY_CHECKS (JUCE_DEBUG || JUCE_UNIT_TESTS)
+#endif
+
+struct RealtimeSafety final
+{
+    enum class Policy : int8
+    {
+        ignore, // only count the violations
+        log,
+        abort
+    };
+
+    static void setPolicy(Policy policy) noexcept;
+    static Policy getPolicy() noexcept;
+
+    // the number of violations so far, including the ones not reported
+    // because their call site has already been reported
+    static int getNumViolations() noexcept;
+
+#if HELIO_REALTIME_SAFETY_CHECKS
+
+    // a realtime region, normally the whole callback or thread loop
+    class ScopedRealtimeRegion final
+    {
+    public:
+        ScopedRealtimeRegion() noexcept;
+        ~ScopedRealtimeRegion() noexcept;
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeRegion)
+    };
+
+    // lifts the checks within a realtime region for the things
+    // which block by design, e.g. the player thread waiting for the next event
+    class ScopedAllowance final
+    {
+    public:
+        ScopedAllowance() noexcept;
+        ~ScopedAllowance() noexcept;
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllowance)
+    };
+
+#else
+
+    class ScopedRealtimeRegion final
+    {
+    public:
+        ScopedRealtimeRegion() noexcept {}
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeRegion)
+    };
+
+    class ScopedAllowance final
+    {
+    public:
+        ScopedAllowance() noexcept {}
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllowance)
+    };
+
+#endif
+};
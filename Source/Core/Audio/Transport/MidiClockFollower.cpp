@@ -0,0 +1,207 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "MidiClockFollower.h"
+#include "Transport.h"
+
+MidiClockFollower::~MidiClockFollower()
+{
+    this->cancelPendingUpdate();
+}
+
+void MidiClockFollower::setEnabled(bool shouldFollow) noexcept
+{
+    this->enabled = shouldFollow;
+}
+
+bool MidiClockFollower::isEnabled() const noexcept
+{
+    return this->enabled.get();
+}
+
+void MidiClockFollower::setTransport(Transport *newTransport)
+{
+    this->transport = newTransport;
+}
+
+void MidiClockFollower::detachTransport(Transport *oldTransport)
+{
+    if (this->transport == oldTransport)
+    {
+        this->transport = nullptr;
+    }
+}
+
+bool MidiClockFollower::getTempoAndPosition(double timeMs, double &msPerQuarter,
+    double &beat, bool &isPlaying) const noexcept
+{
+    const SpinLock::ScopedLockType lock(this->stateLock);
+
+    if (!this->enabled.get() || !this->state.isLocked ||
+        timeMs - this->state.lastTickMs > MidiClockFollower::lockTimeoutMs)
+    {
+        return false;
+    }
+
+    msPerQuarter = this->state.msPerQuarter;
+    isPlaying = this->state.isMasterPlaying;
+    beat = this->state.anchorBeat +
+        (timeMs - this->state.anchorMs) / this->state.msPerQuarter;
+
+    return true;
+}
+
+//===----------------------------------------------------------------------===//
+// MidiInputCallback
+//===----------------------------------------------------------------------===//
+
+void MidiClockFollower::handleIncomingMidiMessage(MidiInput *, const MidiMessage &message)
+{
+    if (!this->enabled.get())
+    {
+        return;
+    }
+
+    // the timestamps are taken when the messages arrive, so they
+    // are not affected by how busy this thread is
+    const auto timeMs = message.getTimeStamp() > 0.0 ?
+        message.getTimeStamp() * 1000.0 : Time::getMillisecondCounterHiRes();
+
+    if (message.isMidiClock())
+    {
+        this->processClockTick(timeMs);
+    }
+    else if (message.isMidiStart())
+    {
+        // the first tick after the start is the song start
+        this->songPositionTicks = -1;
+        this->isMasterPlaying = true;
+        this->pendingStartBeat = 0.0;
+        this->pendingCommand = int(Command::start);
+        this->publishState();
+        this->triggerAsyncUpdate();
+    }
+    else if (message.isMidiContinue())
+    {
+        // the first tick after continuing is the last song position
+        this->pendingStartBeat = double(this->songPositionTicks) /
+            MidiClockFollower::ticksPerQuarter;
+        this->songPositionTicks--;
+        this->isMasterPlaying = true;
+        this->pendingCommand = int(Command::start);
+        this->publishState();
+        this->triggerAsyncUpdate();
+    }
+    else if (message.isMidiStop())
+    {
+        this->isMasterPlaying = false;
+        this->pendingCommand = int(Command::stop);
+        this->publishState();
+        this->triggerAsyncUpdate();
+    }
+    else if (message.isSongPositionPointer())
+    {
+        this->songPositionTicks = int64(message.getSongPositionPointerMidiBeat()) *
+            MidiClockFollower::ticksPerSongPosition;
+        this->publishState();
+    }
+}
+
+void MidiClockFollower::processClockTick(double tickMs) noexcept
+{
+    const auto sinceLastTickMs = tickMs - this->lastTickMs;
+    this->lastTickMs = tickMs;
+
+    if (this->isMasterPlaying)
+    {
+        this->songPositionTicks++;
+    }
+
+    if (sinceLastTickMs <= 0.0 || sinceLastTickMs > MidiClockFollower::lockTimeoutMs)
+    {
+        // the clock has just appeared, or has resumed after a pause
+        this->tickPeriodMs = 0.0;
+        this->numTicksSinceLock = 0;
+        this->publishState();
+        return;
+    }
+
+    const auto expectedTickMs = this->tickPhaseMs + this->tickPeriodMs;
+    const auto errorMs = tickMs - expectedTickMs;
+
+    if (this->tickPeriodMs == 0.0 ||
+        std::abs(errorMs) > this->tickPeriodMs * MidiClockFollower::maxTickErrors)
+    {
+        this->tickPeriodMs = sinceLastTickMs;
+        this->tickPhaseMs = tickMs;
+        this->numTicksSinceLock = 0;
+    }
+    else
+    {
+        this->tickPhaseMs = expectedTickMs + errorMs * MidiClockFollower::phaseGain;
+        this->tickPeriodMs += errorMs * MidiClockFollower::periodGain;
+        this->numTicksSinceLock++;
+    }
+
+    this->publishState();
+}
+
+void MidiClockFollower::publishState() noexcept
+{
+    const SpinLock::ScopedLockType lock(this->stateLock);
+
+    this->state.isLocked = this->tickPeriodMs > 0.0 &&
+        this->numTicksSinceLock >= MidiClockFollower::numTicksToLock;
+
+    this->state.isMasterPlaying = this->isMasterPlaying;
+    this->state.lastTickMs = this->lastTickMs;
+    this->state.anchorMs = this->tickPhaseMs;
+    this->state.anchorBeat = double(jmax(int64(0), this->songPositionTicks)) /
+        MidiClockFollower::ticksPerQuarter;
+    this->state.msPerQuarter = this->tickPeriodMs * MidiClockFollower::ticksPerQuarter;
+}
+
+//===----------------------------------------------------------------------===//
+// AsyncUpdater
+//===----------------------------------------------------------------------===//
+
+void MidiClockFollower::handleAsyncUpdate()
+{
+    const auto command = Command(this->pendingCommand.exchange(int(Command::none)));
+
+    auto *target = this->transport.get();
+    if (target == nullptr || !this->enabled.get())
+    {
+        return;
+    }
+
+    switch (command)
+    {
+    case Command::start:
+        target->startPlayback(target->getProjectFirstBeat() +
+            float(this->pendingStartBeat.get()));
+        break;
+
+    case Command::stop:
+        target->stopPlaybackAndRecording();
+        break;
+
+    default:
+        break;
+    }
+}
@@ -0,0 +1,123 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+class Transport;
+
+// Follows the MIDI clock coming from a drum machine or another DAW:
+// start, stop, continue and song position pointers control the transport
+// of the active project, and the clock ticks drive the playback tempo.
+
+// The ticks arrive with the jitter of the MIDI interface, the drivers
+// and the sender, so they go through a phase-locked loop, which tracks
+// the tick phase and period, and the tempo is derived from the period,
+// which only follows the long-term changes. The player thread reads
+// the tempo and the master's position, see PlayerThread::run.
+
+class MidiClockFollower final : public MidiInputCallback, private AsyncUpdater
+{
+public:
+
+    MidiClockFollower() = default;
+    ~MidiClockFollower() override;
+
+    void setEnabled(bool shouldFollow) noexcept;
+    bool isEnabled() const noexcept;
+
+    // the transport of the active project, if any
+    void setTransport(Transport *transport);
+    void detachTransport(Transport *transport);
+
+    // returns false, if the clock is not locked; the beat is the master's
+    // position at the given time, counted from the song start, valid only
+    // while the master is playing; any thread
+    bool getTempoAndPosition(double timeMs, double &msPerQuarter,
+        double &beat, bool &isPlaying) const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // MidiInputCallback
+    //===------------------------------------------------------------------===//
+
+    void handleIncomingMidiMessage(MidiInput *source, const MidiMessage &message) override;
+
+private:
+
+    void handleAsyncUpdate() override;
+
+    void processClockTick(double tickMs) noexcept;
+    void publishState() noexcept;
+
+    Atomic<bool> enabled = false;
+
+    WeakReference<Transport> transport;
+
+    enum class Command : int
+    {
+        none,
+        start,
+        stop
+    };
+
+    Atomic<int> pendingCommand = int(Command::none);
+    Atomic<double> pendingStartBeat = 0.0;
+
+    // the loop filter, only used by the MIDI thread
+    double lastTickMs = 0.0;
+    double tickPhaseMs = 0.0;
+    double tickPeriodMs = 0.0;
+    int numTicksSinceLock = 0;
+
+    // the position in clock ticks, set by the song position pointers,
+    // and counted only while the master is playing
+    int64 songPositionTicks = 0;
+    bool isMasterPlaying = false;
+
+    // the phase correction gain removes the jitter, and the much smaller
+    // period correction gain follows the tempo; together they make
+    // a critically damped loop, which settles in a beat or two
+    static constexpr auto phaseGain = 0.1;
+    static constexpr auto periodGain = 0.0025;
+
+    // the errors larger than a few ticks mean that the master
+    // has jumped to a different tempo, so the loop restarts
+    static constexpr auto maxTickErrors = 4.0;
+
+    // the master stops sending the clock when it's stopped
+    // or disconnected, and the loop needs a few ticks to settle
+    static constexpr auto lockTimeoutMs = 500.0;
+    static constexpr auto numTicksToLock = 12;
+
+    static constexpr auto ticksPerQuarter = 24;
+    static constexpr auto ticksPerSongPosition = 6;
+
+    // published for the player thread
+    struct State final
+    {
+        bool isLocked = false;
+        bool isMasterPlaying = false;
+        double lastTickMs = 0.0;
+        double anchorMs = 0.0;
+        double anchorBeat = 0.0;
+        double msPerQuarter = 0.0;
+    };
+
+    State state;
+    mutable SpinLock stateLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiClockFollower)
+};
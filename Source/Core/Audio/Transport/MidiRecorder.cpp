@@ -39,8 +39,10 @@
 MidiRecorder::MidiRecorder(ProjectNode &project) :
     project(project)
 {
-    this->lastUpdateTime = Time::getMillisecondCounterHiRes();
-    this->lastCorrectPosition = this->getTransport().getSeekBeat();
+    this->recordedEvents.calloc(MidiRecorder::eventQueueSize);
+
+    this->addTempoAnchor(Time::getMillisecondCounterHiRes(),
+        this->getTransport().getSeekBeat(), Globals::Defaults::msPerBeat);
 
     this->getTransport().addTransportListener(this);
 }
@@ -63,7 +65,7 @@ void MidiRecorder::setTargetScope(const Clip *clip, const String &instrumentId)
     {
         if (this->activeTrack != nullptr)
         {
-            this->finaliseAllHoldingNotes();
+            this->finaliseAllHoldingNotes(this->getBeatAtTime(Time::getMillisecondCounterHiRes()));
         }
 
         this->activeTrack = track;
@@ -74,27 +76,46 @@ void MidiRecorder::setTargetScope(const Clip *clip, const String &instrumentId)
 
 void MidiRecorder::onSeek(float beatPosition, double, double) noexcept
 {
-    // handle the loop rewind:
-    if (this->isPlaying.get() &&
-        beatPosition < this->lastCorrectPosition.get())
+    const auto timeMs = Time::getMillisecondCounterHiRes();
+    const SpinLock::ScopedLockType lock(this->tempoAnchorsLock);
+
+    const auto &last = this->tempoAnchors[this->lastTempoAnchor.load()];
+    const auto expectedBeat = last.beat + (timeMs - last.timeMs) / last.msPerQuarter;
+
+    // handle the loop rewind: this callback comes from the player thread,
+    // so the holding notes will be finalised later by the message thread;
+    // the last anchor may be a few milliseconds old, so the notes are cut
+    // where the playback has got to since then, but not past the loop end
+    if (this->isPlaying.get() && beatPosition < last.beat)
     {
-        // this callback clearly comes from the player thread,
-        // and we are going to do some changes, which the UI
-        // will reflect immediately, so let's lock the message thread:
-        MessageManagerLock mml(Thread::getCurrentThread());
-        jassert(mml.lockWasGained());
+        const auto rewindBeat = this->hasLoop.get() ?
+            jmin(expectedBeat, double(this->loopEndBeat.get())) : expectedBeat;
 
-        this->finaliseAllHoldingNotes();
+        this->pendingRewind = { timeMs, jmax(rewindBeat, last.beat) };
+        this->hasPendingRewind = true;
     }
 
-    this->lastCorrectPosition = beatPosition;
-    this->lastUpdateTime = Time::getMillisecondCounterHiRes();
+    if (!this->isPlaying.get() ||
+        timeMs - last.timeMs >= MidiRecorder::minTempoAnchorIntervalMs ||
+        std::abs(beatPosition - expectedBeat) > MidiRecorder::maxTempoAnchorErrorBeats)
+    {
+        this->addTempoAnchor(timeMs, beatPosition, last.msPerQuarter);
+    }
 }
 
 void MidiRecorder::onTempoChanged(double msPerQuarter) noexcept
 {
-    this->msPerQuarterNote = jmax(msPerQuarter, 0.01);
-    this->lastUpdateTime = Time::getMillisecondCounterHiRes();
+    const auto timeMs = Time::getMillisecondCounterHiRes();
+    const auto beat = this->getBeatAtTime(timeMs);
+
+    const SpinLock::ScopedLockType lock(this->tempoAnchorsLock);
+    this->addTempoAnchor(timeMs, beat, jmax(msPerQuarter, 0.01));
+}
+
+void MidiRecorder::onLoopModeChanged(bool hasLoop, float, float endBeat)
+{
+    this->loopEndBeat = endBeat;
+    this->hasLoop = hasLoop;
 }
 
 void MidiRecorder::onRecord()
@@ -120,8 +141,14 @@ void MidiRecorder::onPlay() noexcept
 {
     if (!this->isPlaying.get())
     {
+        {
+            const SpinLock::ScopedLockType lock(this->tempoAnchorsLock);
+            const auto &last = this->tempoAnchors[this->lastTempoAnchor.load()];
+            this->addTempoAnchor(Time::getMillisecondCounterHiRes(), last.beat, last.msPerQuarter);
+            this->hasPendingRewind = false;
+        }
+
         this->isPlaying = true;
-        this->lastUpdateTime = Time::getMillisecondCounterHiRes();
 
         if (this->isRecording.get())
         {
@@ -141,16 +168,22 @@ void MidiRecorder::onStop()
 
         this->isRecording = false;
 
-        // fixme handle buffers?
-        jassert(this->noteOnsBuffer.isEmpty());
-        jassert(this->noteOffsBuffer.isEmpty());
+        // the events received just before stopping are still recorded,
+        // the input callback is removed, so nothing more will come;
+        // if there's no track to record them into yet, it's created here
+        this->cancelPendingUpdate();
+        this->handleAsyncUpdate();
 
+        this->eventQueue.reset();
         this->holdingNotes.clear();
     }
 
     this->isPlaying = false;
-    this->lastUpdateTime = 0.0;
-    this->msPerQuarterNote = Globals::Defaults::msPerBeat;
+
+    const SpinLock::ScopedLockType lock(this->tempoAnchorsLock);
+    const auto &last = this->tempoAnchors[this->lastTempoAnchor.load()];
+    this->addTempoAnchor(Time::getMillisecondCounterHiRes(), last.beat, Globals::Defaults::msPerBeat);
+    this->hasPendingRewind = false;
 }
 
 static SerializedData createPianoTrackTemplate(const String &name,
@@ -177,8 +210,7 @@ static SerializedData createPianoTrackTemplate(const String &name,
 // the main recording logic goes here:
 void MidiRecorder::handleAsyncUpdate()
 {
-    if (this->noteOnsBuffer.isEmpty() &&
-        this->noteOffsBuffer.isEmpty())
+    if (this->eventQueue.getNumReady() == 0)
     {
         // nothing to do
         return;
@@ -227,7 +259,7 @@ void MidiRecorder::handleAsyncUpdate()
 
         String outTrackId;
         const auto trackTemplate = createPianoTrackTemplate(newName,
-            this->lastCorrectPosition.get(), this->lastValidInstrumentId, outTrackId);
+            float(this->getLastAnchorBeat()), this->lastValidInstrumentId, outTrackId);
 
         this->project.getUndoStack()->perform(
             new PianoTrackInsertAction(this->project,
@@ -237,82 +269,170 @@ void MidiRecorder::handleAsyncUpdate()
         this->activeClip = this->activeTrack->getPattern()->getUnchecked(0);
         this->shouldCheckpoint = false;
     }
-    
-    // handle note offs and fill unhandledNoteOffs
-    while (!this->noteOffsBuffer.isEmpty())
-    {
-        const auto last = this->noteOffsBuffer.size() - 1;
-        const auto i = this->noteOffsBuffer.removeAndReturn(last);
-        const bool wasHandled = this->finaliseHoldingNote(i.getNoteNumber());
-        if (!wasHandled)
-        {
-            this->unhandledNoteOffs.add(i);
-        }
-    }
 
-    // handle note ons
-    while (!this->noteOnsBuffer.isEmpty())
+    this->processRecordedEvents();
+}
+
+void MidiRecorder::processRecordedEvents()
+{
+    jassert(this->activeClip != nullptr);
+    jassert(this->activeTrack != nullptr);
+
+    LoopRewind rewind;
+    bool hasRewind = false;
+
     {
-        const auto last = this->noteOnsBuffer.size() - 1;
-        const auto i = this->noteOnsBuffer.removeAndReturn(last);
-        this->startHoldingNote(i);
+        const SpinLock::ScopedLockType lock(this->tempoAnchorsLock);
+        rewind = this->pendingRewind;
+        hasRewind = this->hasPendingRewind;
+        this->hasPendingRewind = false;
     }
 
-    // handle unhandledNoteOffs and clean
-    for (const auto &i : this->unhandledNoteOffs)
+    // the events are in the order they came in, and the loop rewind,
+    // if any, goes between the events before it and after it
+    this->eventQueue.read(this->eventQueue.getNumReady()).forEach([this, &rewind, &hasRewind](int index)
     {
-        this->finaliseHoldingNote(i.getNoteNumber());
-    }
+        const auto &event = this->recordedEvents[index];
 
-    this->unhandledNoteOffs.clearQuick();
-}
+        if (hasRewind && event.timeMs >= rewind.timeMs)
+        {
+            this->finaliseAllHoldingNotes(rewind.fromBeat);
+            hasRewind = false;
+        }
 
-struct SortMidiMessagesByTimestamp final
-{
-    static int compareElements(const MidiMessage &first, const MidiMessage &second)
+        if (event.isNoteOn)
+        {
+            this->startHoldingNote(event.key, event.velocity, event.beat);
+        }
+        else
+        {
+            this->finaliseHoldingNote(event.key, event.beat);
+        }
+    });
+
+    if (hasRewind)
     {
-        return int(first.getTimeStamp() - second.getTimeStamp());
+        this->finaliseAllHoldingNotes(rewind.fromBeat);
     }
-};
-
-static SortMidiMessagesByTimestamp tsSort;
+}
 
 // called from the high-priority system thread:
 void MidiRecorder::handleIncomingMidiMessage(MidiInput *, const MidiMessage &message)
 {
-    if (message.isNoteOn())
+    if (!message.isNoteOnOrOff())
     {
-        this->noteOnsBuffer.addSorted(tsSort,
-            message.withTimeStamp(this->getEstimatedPosition()));
+        return;
     }
-    else if (message.isNoteOff())
+
+    // the timestamps are taken by the driver when the messages arrive,
+    // (some drivers use the hardware timestamps), so the beats don't depend
+    // on how soon this callback or the message thread gets to them
+    const auto timeMs = message.getTimeStamp() > 0.0 ?
+        message.getTimeStamp() * 1000.0 : Time::getMillisecondCounterHiRes();
+
+    const RecordedEvent event{ timeMs, this->getBeatAtTime(timeMs),
+        float(message.getVelocity()) / 128.f,
+        int8(message.getNoteNumber()), message.isNoteOn() };
+
+    // if the message thread is stuck for that long, the events are lost
+    this->eventQueue.write(1).forEach([this, &event](int index)
     {
-        this->noteOffsBuffer.addSorted(tsSort,
-            message.withTimeStamp(this->getEstimatedPosition()));
-    }
+        this->recordedEvents[index] = event;
+    });
 
     this->triggerAsyncUpdate();
 }
 
-// current beat, estimated since the last known
-// midi event, including the tempo change events:
-double MidiRecorder::getEstimatedPosition() const
+//===----------------------------------------------------------------------===//
+// Tempo map
+//===----------------------------------------------------------------------===//
+
+// the caller holds tempoAnchorsLock
+void MidiRecorder::addTempoAnchor(double timeMs, double beat, double msPerQuarter) noexcept
 {
-    if (!this->isPlaying.get())
+    const auto version = this->tempoAnchorsVersion.load(std::memory_order_relaxed);
+    this->tempoAnchorsVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto index = (this->lastTempoAnchor.load(std::memory_order_relaxed) + 1) % MidiRecorder::numTempoAnchors;
+    this->tempoAnchors[index] = { timeMs, beat, msPerQuarter };
+    this->lastTempoAnchor.store(index, std::memory_order_relaxed);
+
+    this->tempoAnchorsVersion.store(version + 2, std::memory_order_release);
+}
+
+double MidiRecorder::getBeatAtTime(double timeMs) const noexcept
+{
+    while (true)
     {
-        return this->lastCorrectPosition.get();
+        const auto version = this->tempoAnchorsVersion.load(std::memory_order_acquire);
+        if ((version & 1) != 0)
+        {
+            continue; // a write is in progress
+        }
+
+        const auto lastIndex = this->lastTempoAnchor.load(std::memory_order_relaxed);
+        double result = this->tempoAnchors[lastIndex].beat;
+
+        if (this->isPlaying.get())
+        {
+            // the latest anchor not later than the given time,
+            // or the oldest one, if the history is not that long
+            auto index = lastIndex;
+            for (int i = 1; i < MidiRecorder::numTempoAnchors; ++i)
+            {
+                if (this->tempoAnchors[index].timeMs <= timeMs)
+                {
+                    break;
+                }
+
+                const auto previous = (index + MidiRecorder::numTempoAnchors - 1) % MidiRecorder::numTempoAnchors;
+                if (this->tempoAnchors[previous].timeMs == 0.0)
+                {
+                    break;
+                }
+
+                index = previous;
+            }
+
+            const auto &anchor = this->tempoAnchors[index];
+            result = anchor.beat + (timeMs - anchor.timeMs) / anchor.msPerQuarter;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (this->tempoAnchorsVersion.load(std::memory_order_relaxed) == version)
+        {
+            return result;
+        }
     }
+}
+
+double MidiRecorder::getLastAnchorBeat() const noexcept
+{
+    while (true)
+    {
+        const auto version = this->tempoAnchorsVersion.load(std::memory_order_acquire);
+        const auto beat = this->tempoAnchors[this->lastTempoAnchor.load(std::memory_order_relaxed)].beat;
 
-    const double timeOffsetMs = Time::getMillisecondCounterHiRes() - this->lastUpdateTime.get();
-    const double positionOffset = timeOffsetMs / this->msPerQuarterNote.get();
-    const double estimatedPosition = this->lastCorrectPosition.get() + positionOffset;
-    return estimatedPosition;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((version & 1) == 0 &&
+            this->tempoAnchorsVersion.load(std::memory_order_relaxed) == version)
+        {
+            return beat;
+        }
+    }
 }
 
 void MidiRecorder::timerCallback()
 {
+    // the queued events go first, so that they are
+    // inserted with a checkpoint and a new track, if needed
+    this->handleUpdateNowIfNeeded();
+
     if (this->activeTrack != nullptr)
     {
+        // picks up the loop rewinds, even if nothing is played
+        this->processRecordedEvents();
         this->updateLengthsOfHoldingNotes();
     }
 }
@@ -321,24 +441,21 @@ void MidiRecorder::timerCallback()
 // Helpers
 //===----------------------------------------------------------------------===//
 
-void MidiRecorder::startHoldingNote(MidiMessage message)
+void MidiRecorder::startHoldingNote(int key, float velocity, double beat)
 {
     jassert(this->activeClip != nullptr);
     jassert(this->activeTrack != nullptr);
 
-    const auto key = message.getNoteNumber();
-    
     if (this->holdingNotes.contains(key))
     {
         DBG("Found weird note-on/note-off order");
-        this->finaliseHoldingNote(key);
+        this->finaliseHoldingNote(key, beat);
     }
 
     const Note noteParams(this->activeTrack->getSequence(),
         key - this->activeClip->getKey(),
-        roundBeat(float(message.getTimeStamp()) - this->activeClip->getBeat()),
-        Globals::minNoteLength,
-        float(message.getVelocity()) / 128.f);
+        roundBeat(float(beat) - this->activeClip->getBeat()),
+        Globals::minNoteLength, velocity);
 
     this->getPianoSequence()->insert(noteParams, true);
     this->holdingNotes[key] = noteParams;
@@ -355,8 +472,9 @@ void MidiRecorder::updateLengthsOfHoldingNotes() const
         return;
     }
 
-    const auto currentBeat =
-        float(this->getEstimatedPosition() - this->activeClip->getBeat());
+    // only for the display, the note offs will set the exact lengths
+    const auto currentBeat = float(this->getBeatAtTime(Time::getMillisecondCounterHiRes()) -
+        this->activeClip->getBeat());
 
     Array<Note> groupBefore;
     Array<Note> groupAfter;
@@ -377,28 +495,31 @@ void MidiRecorder::updateLengthsOfHoldingNotes() const
     this->getPianoSequence()->changeGroup(groupBefore, groupAfter, true);
 }
 
-void MidiRecorder::finaliseAllHoldingNotes()
+void MidiRecorder::finaliseAllHoldingNotes(double beat)
 {
     if (this->activeTrack != nullptr) // a user cleared selection before hitting stop
     {
-        this->updateLengthsOfHoldingNotes();
+        while (!this->holdingNotes.empty())
+        {
+            this->finaliseHoldingNote(this->holdingNotes.begin()->first, beat);
+        }
     }
 
     this->holdingNotes.clear();
 }
 
-bool MidiRecorder::finaliseHoldingNote(int key)
+bool MidiRecorder::finaliseHoldingNote(int key, double beat)
 {
     jassert(this->activeClip != nullptr);
     jassert(this->activeTrack != nullptr);
 
-    const auto currentBeat =
-        float(this->getEstimatedPosition() - this->activeClip->getBeat());
+    const auto noteOffBeat = float(beat - this->activeClip->getBeat());
 
     if (this->holdingNotes.contains(key))
     {
         const auto &note = this->holdingNotes[key];
-        const auto newLength = roundBeat(currentBeat - note.getBeat());
+        const auto newLength = jmax(Globals::minNoteLength,
+            roundBeat(noteOffBeat - note.getBeat()));
         this->getPianoSequence()->change(note, note.withLength(newLength), true);
         this->holdingNotes.erase(key);
         return true;
@@ -54,7 +54,7 @@ private:
 
     void onTempoChanged(double) noexcept override;
     void onTotalTimeChanged(double) noexcept override {}
-    void onLoopModeChanged(bool, float, float) override {}
+    void onLoopModeChanged(bool hasLoop, float startBeat, float endBeat) override;
 
     void onSeek(float, double, double) noexcept override;
     void onPlay() noexcept override;
@@ -84,25 +84,81 @@ private:
 
     PianoSequence *getPianoSequence() const;
 
-    Array<MidiMessage, CriticalSection> noteOnsBuffer;
-    Array<MidiMessage, CriticalSection> noteOffsBuffer;
-    Array<MidiMessage> unhandledNoteOffs;
+    // the MIDI input thread only pushes the events into this queue,
+    // and the message thread inserts them into the sequence; the device
+    // manager calls the input callbacks under its own lock, so there's
+    // always a single producer and a single consumer
+    struct RecordedEvent final
+    {
+        double timeMs;
+        double beat;
+        float velocity;
+        int8 key;
+        bool isNoteOn;
+    };
+
+    static constexpr auto eventQueueSize = 1024;
+    AbstractFifo eventQueue { eventQueueSize };
+    HeapBlock<RecordedEvent> recordedEvents;
+
+    // drains the queue, message thread only
+    void processRecordedEvents();
 
     FlatHashMap<int, Note> holdingNotes;
-    void startHoldingNote(MidiMessage message);
+    void startHoldingNote(int key, float velocity, double beat);
     void updateLengthsOfHoldingNotes() const;
-    void finaliseAllHoldingNotes();
-    bool finaliseHoldingNote(int key);
-
-    double getEstimatedPosition() const;
-
+    void finaliseAllHoldingNotes(double beat);
+    bool finaliseHoldingNote(int key, double beat);
+
+    // the tempo map of the playback so far, as seen by the player thread:
+    // each seek and tempo change starts a segment of a constant tempo,
+    // and the input timestamps are mapped to beats by the segment
+    // they fall into, even if the events are handled a bit later
+    struct TempoAnchor final
+    {
+        double timeMs = 0.0;
+        double beat = 0.0;
+        double msPerQuarter = Globals::Defaults::msPerBeat;
+    };
+
+    void addTempoAnchor(double timeMs, double beat, double msPerQuarter) noexcept;
+    double getBeatAtTime(double timeMs) const noexcept;
+    double getLastAnchorBeat() const noexcept;
+
+    // the player thread seeks at every event, so the anchors of the same
+    // tempo are thinned out to keep a useful amount of the history
+    static constexpr auto numTempoAnchors = 64;
+    static constexpr auto minTempoAnchorIntervalMs = 10.0;
+    static constexpr auto maxTempoAnchorErrorBeats = 0.01;
+
+    // the anchors are written by the player and the message threads, which
+    // take the lock, and read by the midi input thread without locking:
+    // a reader retries if the version was odd (i.e. a write was in progress)
+    // or has changed while it was reading, which is rare and short
+    TempoAnchor tempoAnchors[numTempoAnchors];
+    std::atomic<int> lastTempoAnchor = { 0 };
+    std::atomic<uint32> tempoAnchorsVersion = { 0 };
+    SpinLock tempoAnchorsLock;
+
+    // the loop rewinds are detected by the player thread, and the holding
+    // notes are finalised by the message thread; under tempoAnchorsLock
+    struct LoopRewind final
+    {
+        double timeMs = 0.0;
+        double fromBeat = 0.0;
+    };
+
+    LoopRewind pendingRewind;
+    bool hasPendingRewind = false;
+
+    // the rewind happens at the loop end, or a bit later
+    Atomic<bool> hasLoop = false;
+    Atomic<float> loopEndBeat = 0.f;
+
+    // the UI displays the lengths of the holding notes,
     // no need for updating too often, I guess:
     static constexpr auto updateTimeHz = 15;
 
-    Atomic<float> lastCorrectPosition = 0.f;
-    Atomic<double> lastUpdateTime = 0.0;
-    Atomic<double> msPerQuarterNote = Globals::Defaults::msPerBeat;
-
     Atomic<bool> isPlaying = false;
     Atomic<bool> isRecording = false;
     Atomic<bool> shouldCheckpoint = false;
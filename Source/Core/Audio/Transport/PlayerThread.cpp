@@ -18,6 +18,11 @@
 #include "Common.h"
 
 #include "PlayerThread.h"
+#include "RealtimeSafety.h"
+#include "MidiOutputScheduler.h"
+#include "MidiClockFollower.h"
+#include "AudioCore.h"
+#include "Workspace.h"
 
 PlayerThread::PlayerThread(Transport &transport) :
     Thread("PlayerThread"),
@@ -36,6 +41,11 @@ void PlayerThread::startPlayback(Transport::PlaybackContext::Ptr context)
 {
     this->context = context;
     this->sequences = this->transport.getPlaybackCache();
+
+    auto &audioCore = App::Workspace().getAudioCore();
+    this->midiSync = audioCore.getMidiOutputScheduler();
+    this->clockFollower = audioCore.getMidiClockFollower();
+
     this->startThread(10);
 }
 
@@ -44,8 +54,11 @@ void PlayerThread::run()
     Array<Instrument *> uniqueInstruments;
     uniqueInstruments.addArray(this->sequences.getUniqueInstruments());
 
+    // the listeners only keep the position and trigger async updates,
+    // i.e. post a message, which takes the message queue's lock for a moment
     auto broadcastSeek = [this](Atomic<float> &beat)
     {
+        const RealtimeSafety::ScopedAllowance notifyingListeners;
         this->transport.broadcastSeek(beat.get(),
             this->context->startBeatTimeMs,
             this->context->totalTimeMs);
@@ -53,22 +66,18 @@ void PlayerThread::run()
 
     const bool isLooped = this->context->playbackLoopMode;
 
+    // the MIDI clock and timecode positions are counted from the project start
+    const auto firstBeat = this->transport.getProjectFirstBeat();
+    const bool isFollowingClock = this->clockFollower->isEnabled();
+    int syncSession = 0;
+
     this->sequences.seekToTime(this->context->startBeat);
 
     Atomic<float> previousEventBeat = this->context->startBeat;
     broadcastSeek(previousEventBeat);
 
-    // This hack is here to keep track of still playing events
-    // to be able to send noteOff's when playback interrupts.
-    struct HoldingNote final
-    {
-        int key;
-        int channel;
-        MidiMessageCollector *listener;
-    };
-    // (some plugins just don't understand allNotesOff message)
-    Array<HoldingNote> holdingNotes;
-    
+    HoldingNotes holdingNotes;
+
     // Some shorthands:
     auto sendMidiStart = [&uniqueInstruments]()
     {
@@ -102,14 +111,13 @@ void PlayerThread::run()
         }
     };
 
-    auto sendHoldingNotesOffAndMidiStop = [&holdingNotes, &uniqueInstruments]()
+    auto sendHoldingNotesOffAndMidiStop = [&holdingNotes, &uniqueInstruments, &syncSession, this]()
     {
-        for (const auto &holding : holdingNotes)
-        {
-            MidiMessage noteOff(MidiMessage::noteOff(holding.channel, holding.key, 0.f));
-            noteOff.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
-            holding.listener->addMessageToQueue(noteOff);
-        }
+        // the playback is over, so nothing here is time-critical
+        const RealtimeSafety::ScopedAllowance stopping;
+
+        this->midiSync->stopSync(syncSession);
+        holdingNotes.sendNotesOff();
         
         MidiMessage stopPlayback(MidiMessage::midiStop());
         stopPlayback.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
@@ -127,6 +135,8 @@ void PlayerThread::run()
     auto sendTempoChangeToEverybody =
         [&uniqueInstruments](const MidiMessage &tempoEvent)
     {
+        // see the comment in sendMessage
+        const RealtimeSafety::ScopedAllowance sendingToTheCollectors;
         for (auto &instrument : uniqueInstruments)
         {
             instrument->getProcessorPlayer().
@@ -143,6 +153,95 @@ void PlayerThread::run()
     auto currentTimeMs = this->context->startBeatTimeMs;
     Atomic<double> currentTempo = this->context->startBeatTempo;
 
+    // when following the incoming clock, the master sets the tempo
+    double reportedTempo = currentTempo.get();
+    {
+        double msPerQuarter = 0.0;
+        double masterBeat = 0.0;
+        bool isMasterPlaying = false;
+        if (isFollowingClock && this->clockFollower->getTempoAndPosition(
+            Time::getMillisecondCounterHiRes(), msPerQuarter, masterBeat, isMasterPlaying))
+        {
+            currentTempo = msPerQuarter;
+            reportedTempo = msPerQuarter;
+            this->transport.broadcastTempoChanged(msPerQuarter);
+        }
+    }
+
+    syncSession = this->midiSync->startSync(this->context->startBeat - firstBeat,
+        currentTimeMs, currentTempo.get());
+
+    // waits until the playback reaches the target beat, while the tempo
+    // follows the incoming clock, and the position is pulled towards
+    // the master's position; returns false if the thread should exit
+    auto waitFollowingClock = [&](float fromBeat, float toBeat, double fromTimeMs)
+    {
+        const RealtimeSafety::ScopedAllowance followingTheClock;
+
+        const auto startMs = Time::getMillisecondCounterHiRes();
+        auto lastStepMs = startMs;
+        double position = fromBeat;
+
+        while (position < toBeat)
+        {
+            if (this->threadShouldExit())
+            {
+                return false;
+            }
+
+            double msPerQuarter = 0.0;
+            double masterBeat = 0.0;
+            bool isMasterPlaying = false;
+            if (this->clockFollower->getTempoAndPosition(lastStepMs,
+                msPerQuarter, masterBeat, isMasterPlaying))
+            {
+                // the positions are only comparable when both sides play
+                // the same range, so the loops and the jumps are left alone
+                double correction = 0.0;
+                const auto positionError = masterBeat - (position - firstBeat);
+                if (isMasterPlaying && !isLooped && std::abs(positionError) < 1.0)
+                {
+                    const auto maxCorrection = double(PlayerThread::followingClockMaxCorrection);
+                    correction = jlimit(-maxCorrection, maxCorrection,
+                        positionError * PlayerThread::followingClockPhaseGain);
+                }
+
+                currentTempo = msPerQuarter / (1.0 + correction);
+
+                if (std::abs(msPerQuarter - reportedTempo) > PlayerThread::followingClockTempoThresholdMs)
+                {
+                    reportedTempo = msPerQuarter;
+                    this->transport.broadcastTempoChanged(msPerQuarter);
+                    this->midiSync->changeSyncTempo(syncSession, position - firstBeat,
+                        fromTimeMs + (lastStepMs - startMs), msPerQuarter);
+                }
+            }
+
+            const auto remainingMs = (toBeat - position) * currentTempo.get();
+            Thread::sleep(jlimit(1, int(PlayerThread::followingClockStepMs), int(remainingMs)));
+
+            const auto nowMs = Time::getMillisecondCounterHiRes();
+            position += (nowMs - lastStepMs) / currentTempo.get();
+            lastStepMs = nowMs;
+        }
+
+        currentTimeMs = fromTimeMs + (lastStepMs - startMs);
+        return true;
+    };
+
+    auto rewind = [&]()
+    {
+        this->sequences.seekToTime(this->context->rewindBeat);
+        previousEventBeat = this->context->rewindBeat;
+        currentTimeMs = this->context->rewindBeatTimeMs;
+        this->midiSync->seekSync(syncSession, this->context->rewindBeat - firstBeat, currentTimeMs);
+        broadcastSeek(previousEventBeat);
+    };
+
+    // everything above is the preparation, and the loop is where the timing
+    // matters, so it shouldn't allocate or lock, except for the waits below
+    const RealtimeSafety::ScopedRealtimeRegion realtimeRegion;
+
     while (1)
     {
         CachedMidiMessage wrapper;
@@ -150,35 +249,49 @@ void PlayerThread::run()
         // Handle playback from the last event to the end of track:
         if (!this->sequences.getNextMessage(wrapper))
         {
-            nextEventTimeDelta = currentTempo.get() *
-                (this->context->endBeat - previousEventBeat.get());
-
-            const uint32 targetTime =
-                Time::getMillisecondCounter() + uint32(nextEventTimeDelta);
-
-            // Give thread a chance to exit by checking at least once a, say, second
-            while (nextEventTimeDelta > PlayerThread::minStopCheckTimeMs)
+            if (isFollowingClock)
             {
-                nextEventTimeDelta -= PlayerThread::minStopCheckTimeMs;
-                Thread::sleep(PlayerThread::minStopCheckTimeMs);
-                if (this->threadShouldExit())
+                if (!waitFollowingClock(previousEventBeat.get(),
+                    this->context->endBeat, currentTimeMs))
                 {
                     sendHoldingNotesOffAndMidiStop();
-                    return; // the transport have already stopped
+                    return;
                 }
             }
+            else
+            {
+                nextEventTimeDelta = currentTempo.get() *
+                    (this->context->endBeat - previousEventBeat.get());
+
+                const uint32 targetTime =
+                    Time::getMillisecondCounter() + uint32(nextEventTimeDelta);
 
-            Time::waitForMillisecondCounter(targetTime);
+                // Give thread a chance to exit by checking at least once a, say, second
+                const RealtimeSafety::ScopedAllowance waitingForTheEnd;
+                while (nextEventTimeDelta > PlayerThread::minStopCheckTimeMs)
+                {
+                    nextEventTimeDelta -= PlayerThread::minStopCheckTimeMs;
+                    Thread::sleep(PlayerThread::minStopCheckTimeMs);
+                    if (this->threadShouldExit())
+                    {
+                        sendHoldingNotesOffAndMidiStop();
+                        return; // the transport have already stopped
+                    }
+                }
+
+                Time::waitForMillisecondCounter(targetTime);
+            }
 
             if (isLooped)
             {
-                this->sequences.seekToTime(this->context->rewindBeat);
-                previousEventBeat = this->context->rewindBeat;
-                broadcastSeek(previousEventBeat);
+                rewind();
                 continue;
             }
             else
             {
+                // the playback is over, so nothing here is time-critical
+                const RealtimeSafety::ScopedAllowance stopping;
+
                 while (this->transport.isRecording() && !this->threadShouldExit())
                 {
                     Thread::sleep(PlayerThread::minStopCheckTimeMs);
@@ -210,24 +323,42 @@ void PlayerThread::run()
         currentTimeMs += nextEventTimeDelta;
         
         jassert(previousEventBeat.get() <= nextEventBeat);
+        const auto lastEventBeat = previousEventBeat.get();
         previousEventBeat = nextEventBeat;
 
-        // Zero-delay check (we're playing a chord or so)
-        if (uint32(nextEventTimeDelta) != 0)
+        if (isFollowingClock)
         {
-            const uint32 targetTime = Time::getMillisecondCounter() + uint32(nextEventTimeDelta);
-            while (nextEventTimeDelta > PlayerThread::minStopCheckTimeMs)
+            if (nextEventBeat > lastEventBeat)
             {
-                nextEventTimeDelta -= PlayerThread::minStopCheckTimeMs;
-                Thread::sleep(PlayerThread::minStopCheckTimeMs);
-                if (this->threadShouldExit())
+                if (!waitFollowingClock(lastEventBeat, nextEventBeat,
+                    currentTimeMs - nextEventTimeDelta))
                 {
                     sendHoldingNotesOffAndMidiStop();
                     return;
                 }
+
+                broadcastSeek(previousEventBeat);
             }
+        }
+        // Zero-delay check (we're playing a chord or so)
+        else if (uint32(nextEventTimeDelta) != 0)
+        {
+            const uint32 targetTime = Time::getMillisecondCounter() + uint32(nextEventTimeDelta);
+            {
+                const RealtimeSafety::ScopedAllowance waitingForNextEvent;
+                while (nextEventTimeDelta > PlayerThread::minStopCheckTimeMs)
+                {
+                    nextEventTimeDelta -= PlayerThread::minStopCheckTimeMs;
+                    Thread::sleep(PlayerThread::minStopCheckTimeMs);
+                    if (this->threadShouldExit())
+                    {
+                        sendHoldingNotesOffAndMidiStop();
+                        return;
+                    }
+                }
 
-            Time::waitForMillisecondCounter(targetTime);
+                Time::waitForMillisecondCounter(targetTime);
+            }
 
             if (this->threadShouldExit())
             {
@@ -240,50 +371,194 @@ void PlayerThread::run()
         
         if (shouldRewind)
         {
-            this->sequences.seekToTime(this->context->rewindBeat);
-            previousEventBeat = this->context->rewindBeat;
-            broadcastSeek(previousEventBeat);
+            rewind();
         }
         else
         {
-            const int key = wrapper.message.getNoteNumber();
-            const int channel = wrapper.message.getChannel();
             wrapper.message.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
             
             // Master tempo event is sent to everybody
             if (wrapper.message.isTempoMetaEvent())
             {
-                currentTempo = wrapper.message.getTempoSecondsPerQuarterNote() * 1000.f;
-                this->transport.broadcastTempoChanged(currentTempo.get());
+                // when following the incoming clock, the master sets the tempo
+                if (!isFollowingClock)
+                {
+                    currentTempo = wrapper.message.getTempoSecondsPerQuarterNote() * 1000.f;
+
+                    {
+                        // the listeners only keep the tempo, see broadcastSeek
+                        const RealtimeSafety::ScopedAllowance notifyingListeners;
+                        this->transport.broadcastTempoChanged(currentTempo.get());
+                    }
 
-                // Sends this to everybody (need to do that for drum-machines) - TODO test
-                sendTempoChangeToEverybody(wrapper.message);
+                    this->midiSync->changeSyncTempo(syncSession,
+                        nextEventBeat - firstBeat, currentTimeMs, currentTempo.get());
+
+                    // Sends this to everybody (need to do that for drum-machines) - TODO test
+                    sendTempoChangeToEverybody(wrapper.message);
+                }
             }
             else
             {
-                wrapper.listener->addMessageToQueue(wrapper.message);
+                PlayerThread::sendMessage(wrapper, holdingNotes);
             }
-            
-            if (wrapper.message.isNoteOn())
+        }
+    }
+    
+    jassertfalse;
+}
+
+//===----------------------------------------------------------------------===//
+// Player loop
+//===----------------------------------------------------------------------===//
+
+void PlayerThread::sendMessage(const CachedMidiMessage &wrapper, HoldingNotes &holdingNotes)
+{
+    {
+        // the collector's lock is shared with the audio callback, which only
+        // holds it to move the queued messages into the block, and the queue
+        // keeps its storage between the blocks, so this wait is short and bounded
+        const RealtimeSafety::ScopedAllowance sendingToTheCollector;
+        wrapper.listener->addMessageToQueue(wrapper.message);
+    }
+
+    holdingNotes.update(wrapper.message, wrapper.listener);
+}
+
+PlayerThread::HoldingNotes::HoldingNotes()
+{
+    this->notes.ensureStorageAllocated(HoldingNotes::numPreallocatedNotes);
+}
+
+void PlayerThread::HoldingNotes::update(const MidiMessage &message, MidiMessageCollector *listener)
+{
+    const int key = message.getNoteNumber();
+    const int channel = message.getChannel();
+
+    if (message.isNoteOn())
+    {
+        this->notes.add({ key, channel, listener });
+    }
+    else if (message.isNoteOff())
+    {
+        for (int i = 0; i < this->notes.size(); ++i)
+        {
+            const auto &note = this->notes.getReference(i);
+            if (note.key == key && note.channel == channel && note.listener == listener)
             {
-                holdingNotes.add({ key, channel, wrapper.listener });
+                // the minimum allocated size keeps the array from shrinking here
+                this->notes.remove(i);
+                break;
             }
-            
-            if (wrapper.message.isNoteOff())
+        }
+    }
+}
+
+void PlayerThread::HoldingNotes::sendNotesOff()
+{
+    for (const auto &note : this->notes)
+    {
+        MidiMessage noteOff(MidiMessage::noteOff(note.channel, note.key, 0.f));
+        noteOff.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
+        note.listener->addMessageToQueue(noteOff);
+    }
+
+    this->notes.clearQuick();
+}
+
+int PlayerThread::HoldingNotes::size() const noexcept
+{
+    return this->notes.size();
+}
+
+#if JUCE_UNIT_TESTS && HELIO_REALTIME_SAFETY_CHECKS
+
+class PlayerThreadTests final : public UnitTest
+{
+public:
+
+    PlayerThreadTests() : UnitTest("Player thread tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        // the runner sets the policy to abort, so this counts silently
+        const auto previousPolicy = RealtimeSafety::getPolicy();
+        RealtimeSafety::setPolicy(RealtimeSafety::Policy::ignore);
+
+        MidiMessageCollector firstListener;
+        MidiMessageCollector secondListener;
+        firstListener.reset(44100.0);
+        secondListener.reset(44100.0);
+
+        TransportPlaybackCache cache;
+        cache.addWrapper(createSequence(firstListener, 1));
+        cache.addWrapper(createSequence(secondListener, 2));
+        cache.addWrapper(createSequence(secondListener, 3));
+
+        // the player thread plays its own copy of the cache
+        TransportPlaybackCache sequences(cache);
+        PlayerThread::HoldingNotes holdingNotes;
+
+        beginTest("Player loop doesn't allocate or lock");
+        const auto numViolations = RealtimeSafety::getNumViolations();
+        int numMessages = 0;
+        int maxHoldingNotes = 0;
+        {
+            const RealtimeSafety::ScopedRealtimeRegion realtimeRegion;
+
+            // the looped playback rewinds, so let's play it twice
+            for (int i = 0; i < 2; ++i)
             {
-                for (int i = 0; i < holdingNotes.size(); ++i)
+                sequences.seekToTime(0.0);
+
+                CachedMidiMessage wrapper;
+                while (sequences.getNextMessage(wrapper))
                 {
-                    if (holdingNotes[i].key == key &&
-                        holdingNotes[i].channel == channel &&
-                        holdingNotes[i].listener == wrapper.listener)
-                    {
-                        holdingNotes.remove(i);
-                        break;
-                    }
+                    wrapper.message.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
+                    PlayerThread::sendMessage(wrapper, holdingNotes);
+                    maxHoldingNotes = jmax(maxHoldingNotes, holdingNotes.size());
+                    numMessages++;
                 }
             }
         }
+        expectEquals(RealtimeSafety::getNumViolations(), numViolations);
+
+        beginTest("Player loop keeps track of the holding notes");
+        expectEquals(numMessages, 2 * 3 * numChords * chordSize * 2);
+        expectEquals(maxHoldingNotes, 3 * chordSize);
+        expectEquals(holdingNotes.size(), 0);
+
+        RealtimeSafety::setPolicy(previousPolicy);
     }
-    
-    jassertfalse;
-}
+
+private:
+
+    static constexpr auto numChords = 64;
+    static constexpr auto chordSize = 4;
+
+    static CachedMidiSequence::Ptr createSequence(MidiMessageCollector &listener, int channel)
+    {
+        CachedMidiSequence::Ptr sequence(new CachedMidiSequence());
+        sequence->currentIndex = 0;
+        sequence->listener = &listener;
+        sequence->instrument = nullptr;
+        sequence->track = nullptr;
+
+        for (int i = 0; i < numChords; ++i)
+        {
+            for (int j = 0; j < chordSize; ++j)
+            {
+                const auto key = 60 + j * 4;
+                sequence->midiMessages.addEvent(MidiMessage::noteOn(channel, key, 0.5f), double(i));
+                sequence->midiMessages.addEvent(MidiMessage::noteOff(channel, key), double(i) + 0.5);
+            }
+        }
+
+        sequence->midiMessages.updateMatchedPairs();
+        return sequence;
+    }
+};
+
+static PlayerThreadTests playerThreadTests;
+
+#endif
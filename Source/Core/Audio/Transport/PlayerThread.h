@@ -19,6 +19,9 @@
 
 #include "Transport.h"
 
+class MidiOutputScheduler;
+class MidiClockFollower;
+
 class PlayerThread final : public Thread
 {
 public:
@@ -28,6 +31,44 @@ public:
 
     void startPlayback(Transport::PlaybackContext::Ptr context);
 
+    //===------------------------------------------------------------------===//
+    // Player loop
+    //===------------------------------------------------------------------===//
+
+    // keeps track of the still playing notes to be able to send note-offs
+    // when the playback interrupts (some plugins just don't understand
+    // allNotesOff message); the storage is preallocated, so that
+    // the player loop doesn't allocate unless it's really crowded
+    class HoldingNotes final
+    {
+    public:
+
+        HoldingNotes();
+
+        void update(const MidiMessage &message, MidiMessageCollector *listener);
+        void sendNotesOff();
+
+        int size() const noexcept;
+
+    private:
+
+        struct Note final
+        {
+            int key;
+            int channel;
+            MidiMessageCollector *listener;
+        };
+
+        static constexpr auto numPreallocatedNotes = 512;
+        Array<Note, DummyCriticalSection, HoldingNotes::numPreallocatedNotes> notes;
+
+        JUCE_DECLARE_NON_COPYABLE(HoldingNotes)
+    };
+
+    // sends the next message of the playback cache to its instrument,
+    // except the tempo changes, which the player loop handles by itself
+    static void sendMessage(const CachedMidiMessage &wrapper, HoldingNotes &holdingNotes);
+
 private:
 
     void run() override;
@@ -37,6 +78,21 @@ private:
 
     Transport::PlaybackContext::Ptr context;
 
+    MidiOutputScheduler *midiSync = nullptr;
+    MidiClockFollower *clockFollower = nullptr;
+
+    // when following the incoming clock, the tempo may change at any
+    // moment, so the waits are split into short steps
+    static constexpr auto followingClockStepMs = 5;
+
+    // the position drifting away from the master's is corrected
+    // by playing slightly faster or slower, within these limits
+    static constexpr auto followingClockPhaseGain = 0.5;
+    static constexpr auto followingClockMaxCorrection = 0.1;
+
+    // the tempo changes smaller than this are not worth reporting
+    static constexpr auto followingClockTempoThresholdMs = 0.1;
+
     // checking if the thread needs to stop at least once a second
     static constexpr auto minStopCheckTimeMs = 1000;
 
@@ -54,6 +54,7 @@ public:
         auto playbackContext = this->transport.fillPlaybackContextAt(startBeat);
         playbackContext->endBeat = endBeat;
         playbackContext->rewindBeat = rewindBeat;
+        playbackContext->rewindBeatTimeMs = this->transport.findTimeAt(rewindBeat);
         playbackContext->playbackLoopMode = loopMode;
 
         // let listeners know about the tempo before the playback starts
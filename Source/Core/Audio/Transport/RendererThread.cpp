@@ -19,6 +19,8 @@
 #include "RendererThread.h"
 #include "Workspace.h"
 #include "AudioCore.h"
+#include "RealtimeSafety.h"
+#include "LatencyCompensator.h"
 
 RendererThread::RendererThread(Transport &transport) :
     Thread("RendererThread"),
@@ -35,12 +37,14 @@ float RendererThread::getPercentsComplete() const noexcept
 }
 
 bool RendererThread::startRendering(const URL &target, RenderFormat format,
-    Transport::PlaybackContext::Ptr playbackContext)
+    Transport::PlaybackContext::Ptr playbackContext,
+    TransportPlaybackCache playbackSequences)
 {
     this->stop();
 
     this->format = format;
     this->context = playbackContext;
+    this->sequences = move(playbackSequences);
 
     // keep the url copy alive while rendering,
     // since on iOS it contains a security bookmark:
@@ -102,6 +106,8 @@ void RendererThread::stop()
         const ScopedLock lock(this->writerLock);
         this->writer = nullptr;
     }
+
+    this->sequences.clear();
 }
 
 bool RendererThread::isRendering() const
@@ -118,11 +124,12 @@ struct RenderBuffer final
     Instrument *instrument;
     AudioBuffer<float> sampleBuffer;
     MidiBuffer midiBuffer;
+    UniquePointer<LatencyCompensator> latencyCompensator;
 };
 
 void RendererThread::run()
 {
-    auto sequences = this->transport.buildPlaybackCache(false);
+    auto &sequences = this->sequences;
     constexpr auto bufferSize = 512;
 
     // assuming that number of channels and sample rate is equal for all instruments
@@ -163,6 +170,27 @@ void RendererThread::run()
     // let the processor graphs handle their async updates
     Thread::sleep(200);
 
+    // the graphs know their latencies once they are rebuilt;
+    // the instruments are aligned with the slowest one, as in the playback,
+    // and then the whole mix is shifted back by its latency
+    // (the ones too long to compensate are ignored, the same way they are in the playback)
+    int maxLatency = 0;
+    for (auto *subBuffer : subBuffers)
+    {
+        maxLatency = jmax(maxLatency, LatencyCompensator::getCompensatedLatency(
+            subBuffer->instrument->getLatencySamples()));
+    }
+
+    for (auto *subBuffer : subBuffers)
+    {
+        const auto latency = LatencyCompensator::getCompensatedLatency(
+            subBuffer->instrument->getLatencySamples());
+        subBuffer->latencyCompensator = make<LatencyCompensator>(numOutChannels,
+            maxLatency - latency, bufferSize);
+    }
+
+    int numFramesToSkip = maxLatency;
+
     // the render loop itself
     sequences.seekToStart();
     
@@ -185,7 +213,7 @@ void RendererThread::run()
     double nextEventTickDelta = 0.0;
 
     const double firstFrame = prevEventTick * sampleRate;
-    const double lastFrame = firstFrame + totalFrames;
+    const double lastFrame = firstFrame + totalFrames + maxLatency;
 
     double currentFrame = firstFrame;
     int messageFrame = 0;
@@ -248,9 +276,15 @@ void RendererThread::run()
             auto *graph = subBuffer->instrument->getProcessorGraph();
             {
                 const ScopedLock lock(graph->getCallbackLock());
-                
+
+                // the renderer is free to block on the disk, but the graphs
+                // are the same as in the realtime playback, so they're checked
+                const RealtimeSafety::ScopedRealtimeRegion realtimeRegion;
                 graph->processBlock(subBuffer->sampleBuffer, subBuffer->midiBuffer);
                 subBuffer->midiBuffer.clear();
+
+                subBuffer->latencyCompensator->process(subBuffer->sampleBuffer.getArrayOfWritePointers(),
+                    numOutChannels, bufferSize);
                 //Thread::yield();
             }
         }
@@ -269,7 +303,11 @@ void RendererThread::run()
             }
         }
 
-        // write resulting buffer to disk
+        // write resulting buffer to disk, except for the latency at the start
+        const auto numSkippedFrames = jmin(numFramesToSkip, bufferSize);
+        numFramesToSkip -= numSkippedFrames;
+
+        if (numSkippedFrames < bufferSize)
         {
             const ScopedLock lock(this->writerLock);
             bool writtenSuccessfully = false;
@@ -277,14 +315,15 @@ void RendererThread::run()
             while (! writtenSuccessfully)
             {
                 writtenSuccessfully =
-                    this->writer->writeFromAudioSampleBuffer(mixingBuffer, 0, mixingBuffer.getNumSamples());
+                    this->writer->writeFromAudioSampleBuffer(mixingBuffer,
+                        numSkippedFrames, bufferSize - numSkippedFrames);
             }
         }
 
         // finally, update counters
         currentFrame += bufferSize;
 
-        this->percentsDone = float((currentFrame - firstFrame) / totalFrames);
+        this->percentsDone = float((currentFrame - firstFrame) / (lastFrame - firstFrame));
 
         // DBG("% done: " + String(this->percentsDone.get()));
     }
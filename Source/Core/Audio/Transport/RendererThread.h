@@ -29,8 +29,12 @@ public:
     
     float getPercentsComplete() const noexcept;
 
+    // the sequences are exported on the message thread beforehand,
+    // so that the rendering doesn't touch the tracks and clips,
+    // which might be edited or deleted in the meantime
     bool startRendering(const URL &target, RenderFormat format,
-        Transport::PlaybackContext::Ptr context);
+        Transport::PlaybackContext::Ptr context,
+        TransportPlaybackCache sequences);
 
     void stop();
     bool isRendering() const;
@@ -47,6 +51,7 @@ private:
 
     Transport &transport;
     Transport::PlaybackContext::Ptr context;
+    TransportPlaybackCache sequences;
     RenderFormat format;
 
     // this needs to be kept alive while rendering (why - because iOS)
@@ -26,6 +26,7 @@
 #include "Pattern.h"
 #include "Workspace.h"
 #include "AudioCore.h"
+#include "MidiClockFollower.h"
 #include "RollBase.h"
 #include "KeyboardMapping.h"
 #include "ProjectMetadata.h"
@@ -138,6 +139,7 @@ void Transport::seekToBeat(float beatPosition)
 void Transport::probeSoundAtBeat(float targetBeat, const MidiSequence *limitToSequence)
 {
     this->sleepTimer.setAwake();
+    this->loadLinkedInstrumentsIfNeeded();
     this->rebuildPlaybackCacheIfNeeded();
     
     const auto sequencesToProbe = this->playbackCache.getAllFor(limitToSequence);
@@ -178,6 +180,7 @@ void Transport::startPlayback()
 void Transport::startPlayback(float start)
 {
     this->sleepTimer.setAwake();
+    this->loadLinkedInstrumentsIfNeeded();
     this->rebuildPlaybackCacheIfNeeded();
 
     this->stopPlayback();
@@ -202,6 +205,7 @@ void Transport::startPlayback(float start)
 void Transport::startPlaybackFragment(float startBeat, float endBeat, bool looped)
 {
     this->sleepTimer.setAwake();
+    this->loadLinkedInstrumentsIfNeeded();
     this->rebuildPlaybackCacheIfNeeded();
     
     this->stopPlayback();
@@ -246,6 +250,7 @@ void Transport::startRecording()
     if (!this->isPlaying())
     {
         this->sleepTimer.setAwake();
+        this->loadLinkedInstrumentsIfNeeded();
         this->rebuildPlaybackCacheIfNeeded();
     }
 
@@ -357,10 +362,18 @@ bool Transport::startRender(const URL &renderTarget, RenderFormat format)
     {
         return false;
     }
+
+    // rendering with placeholders would just produce silence
+    // for their tracks, so it's better to fail and try again later:
+    if (!this->loadLinkedInstrumentsIfNeeded())
+    {
+        return false;
+    }
     
     this->sleepTimer.setCanSleepAfter(0);
     return this->renderer->startRendering(renderTarget, format,
-        this->fillPlaybackContextAt(this->getProjectFirstBeat()));
+        this->fillPlaybackContextAt(this->getProjectFirstBeat()),
+        this->buildPlaybackCache(false));
 }
 
 void Transport::stopRender()
@@ -479,6 +492,14 @@ void Transport::NotePreviewTimer::timerCallback()
         if (preview.noteOnTimeoutMs > 0)
         {
             canStop = false;
+
+            // the note is held back until the instrument has loaded all its nodes,
+            // so that it isn't sent into a graph which has no synth in it yet
+            if (preview.instrument != nullptr && !preview.instrument->isLoaded())
+            {
+                continue;
+            }
+
             preview.noteOnTimeoutMs -= NotePreviewTimer::timerTickMs;
 
             if (preview.noteOnTimeoutMs <= 0 && preview.instrument != nullptr)
@@ -539,6 +560,7 @@ void Transport::previewKey(WeakReference<Instrument> instrument,
     int key, float volume, float lengthInBeats) const
 {
     jassert(instrument != nullptr);
+    instrument->loadIfNeeded();
 
     // to calculate the note-off timeout interval, let's just use
     // the default 120 BPM for simplicity - instead of finding the tempo
@@ -719,6 +741,22 @@ void Transport::onPostRemoveMidiEvent(MidiSequence *const sequence)
     this->playbackCacheIsOutdated = true;
 }
 
+// All items of a batch belong to the same track, and the handlers above
+// only depend on the track, so any group edit is handled just once:
+
+void Transport::onAddMidiEvents(const MidiEventsBatch &events)
+{
+    this->onAddMidiEvent(*events.getFirst());
+}
+
+void Transport::onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    this->onChangeMidiEvent(*oldEvents.getFirst(), *newEvents.getFirst());
+}
+
+void Transport::onRemoveMidiEvents(const MidiEventsBatch &events) {}
+
 void Transport::onAddClip(const Clip &clip)
 {
     if (!this->isRecording())
@@ -745,6 +783,18 @@ void Transport::onPostRemoveClip(Pattern *const pattern)
     this->playbackCacheIsOutdated = true;
 }
 
+void Transport::onAddClips(const ClipsBatch &clips)
+{
+    this->onAddClip(*clips.getFirst());
+}
+
+void Transport::onChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips)
+{
+    this->onChangeClip(*oldClips.getFirst(), *newClips.getFirst());
+}
+
+void Transport::onRemoveClips(const ClipsBatch &clips) {}
+
 void Transport::onChangeTrackProperties(MidiTrack *const track)
 {
     // Stop playback only when instrument changes:
@@ -777,12 +827,16 @@ void Transport::updateTemperamentInfoForBuiltInSynth(int periodSize, double peri
 void Transport::onDeactivateProjectSubtree(const ProjectMetadata *meta)
 {
     this->stopPlaybackAndRecording();
+    App::Workspace().getAudioCore().getMidiClockFollower()->detachTransport(this);
 }
 
 void Transport::onActivateProjectSubtree(const ProjectMetadata *meta)
 {
     this->updateTemperamentInfoForBuiltInSynth(meta->getPeriodSize(), meta->getPeriodRange());
 
+    // the incoming MIDI clock controls the active project's playback
+    App::Workspace().getAudioCore().getMidiClockFollower()->setTransport(this);
+
     // let's reset midi caches, just in case some instrument's keyboard mapping
     // has changed in the meanwhile (no idea how to observe kbm changes in transport)
     this->playbackCacheIsOutdated = true;
@@ -1060,6 +1114,7 @@ void Transport::updateInstrumentLinkForTrack(const MidiTrack *track)
         {
             // corresponding node already exists, lets add
             this->instrumentLinks[track->getTrackId()] = instrument;
+            this->orchestra.prefetchInstrument(instrument);
             return;
         }
     }
@@ -1071,6 +1126,7 @@ void Transport::updateInstrumentLinkForTrack(const MidiTrack *track)
         if (track->getTrackInstrumentId().contains(instrument->getInstrumentHash()))
         {
             this->instrumentLinks[track->getTrackId()] = instrument;
+            this->orchestra.prefetchInstrument(instrument);
             return;
         }
     }
@@ -1079,6 +1135,24 @@ void Transport::updateInstrumentLinkForTrack(const MidiTrack *track)
     this->instrumentLinks[track->getTrackId()] = this->orchestra.getDefaultInstrument();
 }
 
+bool Transport::loadLinkedInstrumentsIfNeeded() const
+{
+    bool allLoaded = true;
+    for (const auto &link : this->instrumentLinks)
+    {
+        if (auto *instrument = link.second.get())
+        {
+            if (!instrument->isLoaded())
+            {
+                instrument->loadIfNeeded();
+                allLoaded = false;
+            }
+        }
+    }
+
+    return allLoaded;
+}
+
 void Transport::clearInstrumentLinkForTrack(const MidiTrack *track)
 {
     this->instrumentLinks.erase(track->getTrackId());
@@ -110,6 +110,7 @@ public:
 
         double startBeatTempo = 0.0; // ms per beat (or per quarter-note)
         double startBeatTimeMs = 0.0;
+        double rewindBeatTimeMs = 0.0;
         double totalTimeMs = 0.0;
 
         double sampleRate = 0.0;
@@ -181,11 +182,20 @@ public:
     void onRemoveMidiEvent(const MidiEvent &event) override;
     void onPostRemoveMidiEvent(MidiSequence *const layer) override;
 
+    void onAddMidiEvents(const MidiEventsBatch &events) override;
+    void onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+        const MidiEventsBatch &newEvents) override;
+    void onRemoveMidiEvents(const MidiEventsBatch &events) override;
+
     void onAddClip(const Clip &clip) override;
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
     void onRemoveClip(const Clip &clip) override;
     void onPostRemoveClip(Pattern *const pattern) override;
 
+    void onAddClips(const ClipsBatch &clips) override;
+    void onChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips) override;
+    void onRemoveClips(const ClipsBatch &clips) override;
+
     void onAddTrack(MidiTrack *const track) override;
     void onRemoveTrack(MidiTrack *const track) override;
     void onChangeTrackProperties(MidiTrack *const track) override;
@@ -255,6 +265,10 @@ private:
     
     void updateInstrumentLinkForTrack(const MidiTrack *track);
     void clearInstrumentLinkForTrack(const MidiTrack *track);
+
+    // the linked instruments may be placeholders not loaded yet,
+    // see Instrument::loadIfNeeded; returns true if all are loaded
+    bool loadLinkedInstrumentsIfNeeded() const;
     
     // a nasty hack, see the description in BuiltInSynth.h:
     void updateTemperamentInfoForBuiltInSynth(int periodSize, double periodRange) const;
@@ -170,14 +170,15 @@ public:
         }
     }
     
+    // the player and the renderer iterate their own copies of the cache,
+    // so this doesn't take the arrays' locks, which the player loop can't afford
     bool getNextMessage(CachedMidiMessage &target)
     {
         double minTimeStamp = DBL_MAX;
-        int targetSequenceIndex = -1;
+        CachedMidiSequence *foundWrapper = nullptr;
 
-        for (int i = 0; i < this->sequences.size(); ++i)
+        for (auto *wrapper : this->sequences)
         {
-            const auto *wrapper = this->sequences.getObjectPointer(i);
             if (wrapper->currentIndex < wrapper->midiMessages.getNumEvents())
             {
                 const auto &message = wrapper->midiMessages.getEventPointer(wrapper->currentIndex)->message;
@@ -185,19 +186,17 @@ public:
                 if (message.getTimeStamp() < minTimeStamp)
                 {
                     minTimeStamp = message.getTimeStamp();
-                    targetSequenceIndex = i;
+                    foundWrapper = wrapper;
                 }
             }
         }
 
-        if (targetSequenceIndex < 0)
+        if (foundWrapper == nullptr)
         {
             return false;
         }
 
-        auto *foundWrapper = this->sequences.getObjectPointer(targetSequenceIndex);
         jassert(foundWrapper->currentIndex < foundWrapper->midiMessages.getNumEvents());
-
         auto &foundMessage = foundWrapper->midiMessages.getEventPointer(foundWrapper->currentIndex)->message;
         foundWrapper->currentIndex++;
 
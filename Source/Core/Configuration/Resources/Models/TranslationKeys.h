@@ -281,8 +281,15 @@ namespace I18n
         static constexpr auto midiRecord = constexprHash("settings::midi::record");
         static constexpr auto midiOutput = constexprHash("settings::midi::output");
         static constexpr auto midiOutputNone = constexprHash("settings::midi::output::none");
+        static constexpr auto midiOutputLatency = constexprHash("settings::midi::output::latency");
+        static constexpr auto midiOutputCalibrate = constexprHash("settings::midi::output::calibrate");
+        static constexpr auto midiOutputCalibrationFailed = constexprHash("settings::midi::output::calibration::failed");
+        static constexpr auto midiClockFollow = constexprHash("settings::midi::clock::follow");
+        static constexpr auto midiClockSend = constexprHash("settings::midi::clock::send");
+        static constexpr auto midiTimecodeSend = constexprHash("settings::midi::timecode::send");
         static constexpr auto midiNoDevicesFound = constexprHash("settings::midi::nodevices");
         static constexpr auto midiRemap12ToneKeyboard = constexprHash("settings::midi::remap12tone");
+        static constexpr auto audioPluginSandboxing = constexprHash("settings::audio::sandbox");
         static constexpr auto languageHelp = constexprHash("settings::language::help");
         static constexpr auto rendererOpengl = constexprHash("settings::renderer::opengl");
         static constexpr auto sync = constexprHash("settings::sync");
@@ -312,6 +319,21 @@ namespace I18n
         static constexpr auto defultSynthTitle = constexprHash("instruments::defaultsynth::title");
         static constexpr auto metronomeTitle = constexprHash("instruments::metronome::title");
         static constexpr auto metronomeBuiltInSoundPlaceholder = constexprHash("instruments::metronome::builtin");
+        static constexpr auto polyphony = constexprHash("instruments::polyphony");
+        static constexpr auto voices = constexprHash("instruments::voices");
+        static constexpr auto voicesPeak = constexprHash("instruments::voices::peak");
+        static constexpr auto voicesStolen = constexprHash("instruments::voices::stolen");
+        static constexpr auto voicesUnderruns = constexprHash("instruments::voices::underruns");
+        static constexpr auto latency = constexprHash("instruments::latency");
+        static constexpr auto latencyCompensation = constexprHash("instruments::latency::compensation");
+        static constexpr auto loadTime = constexprHash("instruments::loadtime");
+        static constexpr auto sandboxUnderruns = constexprHash("instruments::sandbox::underruns");
+        static constexpr auto sandboxDroppedBlocks = constexprHash("instruments::sandbox::dropped");
+        static constexpr auto interpolationLive = constexprHash("instruments::interpolation::live");
+        static constexpr auto interpolationRender = constexprHash("instruments::interpolation::render");
+        static constexpr auto interpolationLinear = constexprHash("instruments::interpolation::linear");
+        static constexpr auto interpolationCubic = constexprHash("instruments::interpolation::cubic");
+        static constexpr auto interpolationSinc = constexprHash("instruments::interpolation::sinc");
     }
 
     namespace VCS
@@ -0,0 +1,141 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// The group edits of the sequences and the patterns insert, remove or move
+// lots of objects at once, and doing that one by one with addSorted/remove
+// would shift the whole array for each of them; instead, the batch is sorted
+// once and merged into the array, and the removed ones are nulled out
+// and compacted away, so that any group edit is a couple of linear passes.
+
+// The comparators are the same ones the arrays are sorted with,
+// i.e. the objects with static compareElements(a, b) methods.
+
+struct BatchEditing final
+{
+    template <typename T, typename Comparator>
+    static void sort(Array<T *> &batch, Comparator &comparator)
+    {
+        std::sort(batch.begin(), batch.end(), [&comparator](T *a, T *b)
+        {
+            return comparator.compareElements(a, b) < 0;
+        });
+    }
+
+    // takes the ownership of the objects in the sorted batch,
+    // returns the index where the first of them ends up
+    template <typename T, typename Comparator>
+    static int mergeSorted(OwnedArray<T> &target,
+        const Array<T *> &sortedBatch, Comparator &comparator)
+    {
+        const auto less = [&comparator](T *a, T *b)
+        {
+            return comparator.compareElements(a, b) < 0;
+        };
+
+        const auto numExisting = target.size();
+        if (sortedBatch.isEmpty())
+        {
+            return numExisting;
+        }
+
+        // the merge is stable, so the existing equal objects go first
+        const auto firstIndex = int(std::upper_bound(target.begin(),
+            target.end(), sortedBatch.getFirst(), less) - target.begin());
+
+        target.ensureStorageAllocated(numExisting + sortedBatch.size());
+
+        for (auto *object : sortedBatch)
+        {
+            target.add(object);
+        }
+
+        std::inplace_merge(target.begin(), target.begin() + numExisting, target.end(), less);
+        return firstIndex;
+    }
+
+    // finds the indices of the group's objects in the sorted array,
+    // sorted and unique, so the same object listed twice is edited once,
+    // and optionally, which group item each of the indices came from
+    template <typename T, typename P>
+    static Array<int> findSortedIndices(const OwnedArray<T> &target,
+        const Array<P> &group, Array<int> *outGroupIndices = nullptr)
+    {
+        struct Found final
+        {
+            int index;
+            int groupIndex;
+            bool operator< (const Found &other) const noexcept
+            {
+                return this->index < other.index;
+            }
+        };
+
+        Array<Found> found;
+        found.ensureStorageAllocated(group.size());
+
+        for (int i = 0; i < group.size(); ++i)
+        {
+            const auto &item = group.getReference(i);
+            const int index = target.indexOfSorted(item, &item);
+            jassert(index >= 0);
+            if (index >= 0)
+            {
+                found.add({ index, i });
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+
+        Array<int> indices;
+        indices.ensureStorageAllocated(found.size());
+        for (const auto &f : found)
+        {
+            if (indices.isEmpty() || indices.getLast() != f.index)
+            {
+                indices.add(f.index);
+                if (outGroupIndices != nullptr)
+                {
+                    outGroupIndices->add(f.groupIndex);
+                }
+            }
+        }
+
+        return indices;
+    }
+
+    // removes the null pointers, which the caller has put in place
+    // of the objects it has taken out of the array, keeping the order
+    template <typename T>
+    static void removeNulls(OwnedArray<T> &target) noexcept
+    {
+        auto **data = target.begin();
+        int numKept = 0;
+
+        for (int i = 0; i < target.size(); ++i)
+        {
+            if (data[i] != nullptr)
+            {
+                data[numKept++] = data[i];
+            }
+        }
+
+        // the tail is either nulls or the pointers already moved
+        target.removeLast(target.size() - numKept, false);
+    }
+};
@@ -0,0 +1,194 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "ParallelBatch.h"
+
+class ParallelBatch::Worker final : public ThreadPoolJob
+{
+public:
+
+    explicit Worker(std::shared_ptr<State> state) :
+        ThreadPoolJob("Parallel batch worker"),
+        state(move(state)) {}
+
+    JobStatus runJob() override
+    {
+        auto &batch = *this->state;
+        for (int i = batch.nextItem++; i < batch.numItems; i = batch.nextItem++)
+        {
+            if (batch.cancelled.load() || this->shouldExit())
+            {
+                break;
+            }
+
+            batch.task(i);
+            batch.numItemsDone++;
+        }
+
+        if (--batch.numWorkersLeft == 0)
+        {
+            batch.onDone(!batch.cancelled.load());
+        }
+
+        return jobHasFinished;
+    }
+
+private:
+
+    const std::shared_ptr<State> state;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Worker)
+};
+
+ParallelBatch::Pool::Pool() :
+    ThreadPool(jlimit(1, int(ParallelBatch::maxThreads), SystemStats::getNumCpus())) {}
+
+ParallelBatch::ParallelBatch(int numItems, Task task) :
+    state(std::make_shared<State>(numItems, move(task))) {}
+
+void ParallelBatch::start(Callback onDone)
+{
+    jassert(this->state->onDone == nullptr); // started twice?
+    this->state->onDone = move(onDone);
+
+    const auto numWorkers = jmin(this->state->numItems, this->pool->getNumThreads());
+    if (numWorkers <= 0)
+    {
+        this->state->onDone(!this->isCancelled());
+        return;
+    }
+
+    // all workers are counted before any of them is queued,
+    // so that the first one to finish doesn't think it's the last
+    this->state->numWorkersLeft = numWorkers;
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        this->pool->addJob(new Worker(this->state), true);
+    }
+}
+
+void ParallelBatch::cancel() noexcept
+{
+    this->state->cancelled = true;
+}
+
+bool ParallelBatch::isCancelled() const noexcept
+{
+    return this->state->cancelled.load();
+}
+
+float ParallelBatch::getProgress() const noexcept
+{
+    const auto numItems = this->state->numItems;
+    return numItems > 0 ? float(this->state->numItemsDone.load()) / float(numItems) : 1.f;
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class ParallelBatchTests final : public UnitTest
+{
+public:
+    ParallelBatchTests() : UnitTest("Parallel batch tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        // the workspace may not exist yet, so the test keeps the pool itself
+        SharedResourcePointer<ParallelBatch::Pool> pool;
+
+        beginTest("Each item is processed exactly once");
+        {
+            constexpr auto numItems = 1000;
+            Array<int> results;
+            results.insertMultiple(0, 0, numItems);
+
+            WaitableEvent finished;
+            bool wasComplete = false;
+
+            auto batch = make<ParallelBatch>(numItems, [&results](int i)
+            {
+                results.getReference(i) += i * 2;
+            });
+
+            batch->start([&finished, &wasComplete](bool isComplete)
+            {
+                wasComplete = isComplete;
+                finished.signal();
+            });
+
+            // the batch may go away before its workers are done
+            batch = nullptr;
+
+            expect(finished.wait(5000));
+            expect(wasComplete);
+
+            for (int i = 0; i < numItems; ++i)
+            {
+                expectEquals(results[i], i * 2);
+            }
+        }
+
+        beginTest("Cancelled batch stops taking new items");
+        {
+            constexpr auto numItems = 1000;
+            std::atomic<int> numProcessed{0};
+
+            WaitableEvent finished;
+            bool wasComplete = true;
+
+            ParallelBatch batch(numItems, [&batch, &numProcessed](int)
+            {
+                if (++numProcessed == 10)
+                {
+                    batch.cancel();
+                }
+            });
+
+            batch.start([&finished, &wasComplete](bool isComplete)
+            {
+                wasComplete = isComplete;
+                finished.signal();
+            });
+
+            expect(finished.wait(5000));
+            expect(!wasComplete);
+            expect(numProcessed.load() < numItems);
+            expect(batch.getProgress() > 0.f && batch.getProgress() < 1.f);
+        }
+
+        beginTest("Empty batch completes right away");
+        {
+            bool wasCalled = false;
+            ParallelBatch batch(0, [](int) {});
+            batch.start([&wasCalled](bool isComplete)
+            {
+                wasCalled = isComplete;
+            });
+
+            expect(wasCalled);
+            expectEquals(batch.getProgress(), 1.f);
+        }
+    }
+};
+
+static ParallelBatchTests parallelBatchTests;
+
+#endif
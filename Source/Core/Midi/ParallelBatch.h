@@ -0,0 +1,90 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// The project-wide operations, like the temperament remapping or the rescaling,
+// compute the new state of each track independently of the others, so that part
+// can run on the worker threads, while the message thread stays responsive
+// and only applies the results when they are ready, within a single undo
+// transaction, as the group edits of each track.
+
+// The tasks are expected to only read the immutable inputs, like the sequence
+// snapshots or the copies made before the start, and to write their results
+// into the slots of their own items, which the caller has allocated in advance.
+
+class ParallelBatch final
+{
+public:
+
+    using Task = Function<void(int itemIndex)>;
+    using Callback = Function<void(bool isComplete)>;
+
+    ParallelBatch(int numItems, Task task);
+
+    // returns immediately; when all items are done or the batch is cancelled,
+    // the callback is called on the pool thread which has finished last
+    // (or right away on the calling thread, if there's nothing to do);
+    // the batch object itself may be deleted before that: the workers
+    // only share the task, the counters and the callback with it
+    void start(Callback onDone);
+
+    // can be called from any thread, including the tasks themselves
+    void cancel() noexcept;
+    bool isCancelled() const noexcept;
+
+    // the share of the items done so far, from 0 to 1
+    float getProgress() const noexcept;
+
+    static constexpr auto maxThreads = 8;
+
+    // the threads are shared by all batches instead of being started for
+    // each one, and the workspace keeps them alive for the app's lifetime;
+    // deleting the pool drops the queued workers, so the callbacks
+    // of the batches still running then are never called:
+    class Pool final : public ThreadPool
+    {
+    public:
+        Pool();
+        JUCE_DECLARE_NON_COPYABLE(Pool)
+    };
+
+private:
+
+    struct State final
+    {
+        State(int numItems, Task task) :
+            numItems(numItems), task(move(task)) {}
+
+        const int numItems;
+        const Task task;
+        Callback onDone;
+
+        std::atomic<int> nextItem{0};
+        std::atomic<int> numItemsDone{0};
+        std::atomic<int> numWorkersLeft{0};
+        std::atomic<bool> cancelled{false};
+    };
+
+    std::shared_ptr<State> state;
+
+    SharedResourcePointer<Pool> pool;
+
+    class Worker;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParallelBatch)
+};
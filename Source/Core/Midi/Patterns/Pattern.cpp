@@ -18,6 +18,7 @@
 #include "Common.h"
 #include "Pattern.h"
 #include "PatternActions.h"
+#include "BatchEditing.h"
 #include "ProjectNode.h"
 #include "UndoStack.h"
 #include "SerializationKeys.h"
@@ -247,14 +248,19 @@ bool Pattern::insertGroup(Array<Clip> &group, bool undoable)
     }
     else
     {
-        for (int i = 0; i < group.size(); ++i)
+        Array<Clip *> newClips;
+        newClips.ensureStorageAllocated(group.size());
+        for (const auto &clipParams : group)
         {
-            const Clip &eventParams = group.getReference(i);
-            auto *ownedClip = new Clip(this, eventParams);
-            this->clips.addSorted(*ownedClip, ownedClip);
-            this->notifyClipAdded(*ownedClip);
+            newClips.add(new Clip(this, clipParams));
         }
 
+        static Clip comparator;
+        BatchEditing::sort(newClips, comparator);
+        BatchEditing::mergeSorted(this->clips, newClips, comparator);
+
+        this->notifyClipsAdded(ClipsBatch(newClips.begin(), newClips.size()));
+
         this->updateBeatRange(true);
     }
 
@@ -271,19 +277,26 @@ bool Pattern::removeGroup(Array<Clip> &group, bool undoable)
     }
     else
     {
-        for (int i = 0; i < group.size(); ++i)
+        const auto removedIndices = BatchEditing::findSortedIndices(this->clips, group);
+
+        ClipsBatch removedClips;
+        removedClips.ensureStorageAllocated(removedIndices.size());
+        for (const auto index : removedIndices)
+        {
+            removedClips.add(this->clips.getUnchecked(index));
+        }
+
+        this->notifyClipsRemoved(removedClips);
+
+        auto **ownedClips = this->clips.begin();
+        for (const auto index : removedIndices)
         {
-            const Clip &clip = group.getReference(i);
-            const int index = this->clips.indexOfSorted(clip, &clip);
-            jassert(index >= 0);
-            if (index >= 0)
-            {
-                auto *removedClip = this->clips.getUnchecked(index);
-                this->notifyClipRemoved(*removedClip);
-                this->clips.remove(index, true);
-            }
+            delete ownedClips[index];
+            ownedClips[index] = nullptr;
         }
 
+        BatchEditing::removeNulls(this->clips);
+
         this->updateBeatRange(true);
         this->notifyClipRemovedPostAction();
     }
@@ -303,22 +316,38 @@ bool Pattern::changeGroup(Array<Clip> &groupBefore, Array<Clip> &groupAfter, boo
     }
     else
     {
-        for (int i = 0; i < groupBefore.size(); ++i)
+        Array<int> groupIndices;
+        const auto changedIndices = BatchEditing::findSortedIndices(this->clips,
+            groupBefore, &groupIndices);
+
+        Array<Clip *> changedClips;
+        changedClips.ensureStorageAllocated(changedIndices.size());
+
+        auto **ownedClips = this->clips.begin();
+        for (int i = 0; i < changedIndices.size(); ++i)
         {
-            const Clip &oldParams = groupBefore.getReference(i);
-            const Clip &newParams = groupAfter.getReference(i);
-            const int index = this->clips.indexOfSorted(oldParams, &oldParams);
-            jassert(index >= 0);
-            if (index >= 0)
-            {
-                auto *changedClip = this->clips.getUnchecked(index);
-                changedClip->applyChanges(newParams);
-                this->clips.remove(index, false);
-                this->clips.addSorted(*changedClip, changedClip);
-                this->notifyClipChanged(oldParams, *changedClip);
-            }
+            auto *changedClip = ownedClips[changedIndices.getUnchecked(i)];
+            changedClip->applyChanges(groupAfter.getReference(groupIndices.getUnchecked(i)));
+            changedClips.add(changedClip);
+            ownedClips[changedIndices.getUnchecked(i)] = nullptr;
         }
 
+        BatchEditing::removeNulls(this->clips);
+
+        Array<Clip *> sortedClips(changedClips);
+        static Clip comparator;
+        BatchEditing::sort(sortedClips, comparator);
+        BatchEditing::mergeSorted(this->clips, sortedClips, comparator);
+
+        ClipsBatch oldClips;
+        oldClips.ensureStorageAllocated(groupIndices.size());
+        for (const auto groupIndex : groupIndices)
+        {
+            oldClips.add(&groupBefore.getReference(groupIndex));
+        }
+
+        this->notifyClipsChanged(oldClips, ClipsBatch(changedClips.begin(), changedClips.size()));
+
         this->updateBeatRange(true);
     }
 
@@ -375,6 +404,21 @@ void Pattern::notifyClipRemovedPostAction()
     this->eventDispatcher.dispatchPostRemoveClip(this);
 }
 
+void Pattern::notifyClipsChanged(const ClipsBatch &oldClips, const ClipsBatch &newClips)
+{
+    this->eventDispatcher.dispatchChangeClips(oldClips, newClips);
+}
+
+void Pattern::notifyClipsAdded(const ClipsBatch &clips)
+{
+    this->eventDispatcher.dispatchAddClips(clips);
+}
+
+void Pattern::notifyClipsRemoved(const ClipsBatch &clips)
+{
+    this->eventDispatcher.dispatchRemoveClips(clips);
+}
+
 void Pattern::updateBeatRange(bool shouldNotifyIfChanged)
 {
     if (this->lastStartBeat == this->getFirstBeat() &&
@@ -94,6 +94,10 @@ public:
     void notifyClipAdded(const Clip &clip);
     void notifyClipRemoved(const Clip &clip);
     void notifyClipRemovedPostAction();
+
+    void notifyClipsChanged(const ClipsBatch &oldClips, const ClipsBatch &newClips);
+    void notifyClipsAdded(const ClipsBatch &clips);
+    void notifyClipsRemoved(const ClipsBatch &clips);
     void updateBeatRange(bool shouldNotifyIfChanged);
 
     //===------------------------------------------------------------------===//
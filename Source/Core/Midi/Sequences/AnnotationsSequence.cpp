@@ -65,7 +65,8 @@ MidiEvent *AnnotationsSequence::insert(const AnnotationEvent &eventParams, bool
     else
     {
         auto* ownedEvent = new AnnotationEvent(this, eventParams);
-        this->midiEvents.addSorted(*ownedEvent, ownedEvent);
+        const auto index = this->midiEvents.addSorted(*ownedEvent, ownedEvent);
+        this->invalidateSnapshotFrom(index);
         this->eventDispatcher.dispatchAddEvent(*ownedEvent);
         this->updateBeatRange(true);
         return ownedEvent;
@@ -91,6 +92,7 @@ bool AnnotationsSequence::remove(const AnnotationEvent &eventParams, bool undoab
             jassert(removedEvent->isValid());
             this->eventDispatcher.dispatchRemoveEvent(*removedEvent);
             this->midiEvents.remove(index, true);
+            this->invalidateSnapshotFrom(index);
             this->updateBeatRange(true);
             this->eventDispatcher.dispatchPostRemoveEvent(this);
             return true;
@@ -119,7 +121,8 @@ bool AnnotationsSequence::change(const AnnotationEvent &oldParams,
             auto *changedEvent = static_cast<AnnotationEvent *>(this->midiEvents.getUnchecked(index));
             changedEvent->applyChanges(newParams);
             this->midiEvents.remove(index, false);
-            this->midiEvents.addSorted(*changedEvent, changedEvent);
+            const auto newIndex = this->midiEvents.addSorted(*changedEvent, changedEvent);
+            this->invalidateSnapshotFrom(jmin(index, newIndex));
             this->eventDispatcher.dispatchChangeEvent(oldParams, *changedEvent);
             this->updateBeatRange(true);
             return true;
@@ -198,4 +201,5 @@ void AnnotationsSequence::reset()
 {
     this->midiEvents.clear();
     this->usedEventIds.clear();
+    this->invalidateSnapshotFrom(0);
 }
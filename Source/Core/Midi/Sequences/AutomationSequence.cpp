@@ -18,6 +18,7 @@
 #include "Common.h"
 #include "AutomationSequence.h"
 #include "AutomationEventActions.h"
+#include "BatchEditing.h"
 
 #include "ProjectNode.h"
 #include "MidiTrackNode.h"
@@ -70,6 +71,40 @@ void AutomationSequence::importMidi(const MidiMessageSequence &sequence, short t
     this->updateBeatRange(false);
 }
 
+void AutomationSequence::exportMidi(MidiMessageSequence &outSequence,
+    const Clip &clip, const KeyboardMapping &keyMap,
+    bool soloPlaybackMode, bool exportMetronome,
+    float projectFirstBeat, float projectLastBeat,
+    double timeFactor /*= 1.0*/) const
+{
+    if (this->midiEvents.isEmpty() || clip.isMuted())
+    {
+        return;
+    }
+
+    // the snapshot copies can't look up their neighbours or their track,
+    // so the interpolation target and the track parameters are passed in
+    const auto snapshot = this->getSnapshot();
+
+    const auto *track = this->getTrack();
+    const AutomationEvent::TrackParameters parameters{
+        track->getTrackChannel(), track->getTrackControllerNumber(),
+        track->isTempoTrack(), track->isOnOffAutomationTrack() };
+
+    const auto numEvents = snapshot->size();
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const auto *event = static_cast<const AutomationEvent *>(snapshot->getUnchecked(i));
+        const auto *nextEvent = (i < numEvents - 1) ?
+            static_cast<const AutomationEvent *>(snapshot->getUnchecked(i + 1)) : nullptr;
+
+        AutomationEvent::exportMessages(outSequence, clip,
+            timeFactor, *event, nextEvent, parameters);
+    }
+
+    outSequence.updateMatchedPairs();
+}
+
 //===----------------------------------------------------------------------===//
 // Undoable track editing
 //===----------------------------------------------------------------------===//
@@ -85,7 +120,8 @@ MidiEvent *AutomationSequence::insert(const AutomationEvent &eventParams, bool u
     else
     {
         auto *ownedEvent = new AutomationEvent(this, eventParams);
-        this->midiEvents.addSorted(*ownedEvent, ownedEvent);
+        const auto index = this->midiEvents.addSorted(*ownedEvent, ownedEvent);
+        this->invalidateSnapshotFrom(index);
         this->eventDispatcher.dispatchAddEvent(*ownedEvent);
         this->updateBeatRange(true);
         return ownedEvent;
@@ -110,6 +146,7 @@ bool AutomationSequence::remove(const AutomationEvent &eventParams, bool undoabl
             MidiEvent *const removedEvent = this->midiEvents[index];
             this->eventDispatcher.dispatchRemoveEvent(*removedEvent);
             this->midiEvents.remove(index, true);
+            this->invalidateSnapshotFrom(index);
             this->updateBeatRange(true);
             this->eventDispatcher.dispatchPostRemoveEvent(this);
             return true;
@@ -138,7 +175,8 @@ bool AutomationSequence::change(const AutomationEvent &oldParams,
             const auto changedEvent = static_cast<AutomationEvent *>(this->midiEvents[index]);
             changedEvent->applyChanges(newParams);
             this->midiEvents.remove(index, false);
-            this->midiEvents.addSorted(*changedEvent, changedEvent);
+            const auto newIndex = this->midiEvents.addSorted(*changedEvent, changedEvent);
+            this->invalidateSnapshotFrom(jmin(index, newIndex));
             this->eventDispatcher.dispatchChangeEvent(oldParams, *changedEvent);
             this->updateBeatRange(true);
             return true;
@@ -160,13 +198,19 @@ bool AutomationSequence::insertGroup(Array<AutomationEvent> &group, bool undoabl
     }
     else
     {
-        for (int i = 0; i < group.size(); ++i)
+        Array<MidiEvent *> newEvents;
+        newEvents.ensureStorageAllocated(group.size());
+        for (const auto &eventParams : group)
         {
-            const auto &eventParams = group.getUnchecked(i);
-            auto *ownedEvent = new AutomationEvent(this, eventParams);
-            this->midiEvents.addSorted(*ownedEvent, ownedEvent);
-            this->eventDispatcher.dispatchAddEvent(*ownedEvent);
+            newEvents.add(new AutomationEvent(this, eventParams));
         }
+
+        static AutomationEvent comparator;
+        BatchEditing::sort(newEvents, comparator);
+        const auto firstIndex = BatchEditing::mergeSorted(this->midiEvents, newEvents, comparator);
+        this->invalidateSnapshotFrom(firstIndex);
+
+        this->eventDispatcher.dispatchAddEvents(MidiEventsBatch(newEvents.begin(), newEvents.size()));
         
         this->updateBeatRange(true);
     }
@@ -184,17 +228,26 @@ bool AutomationSequence::removeGroup(Array<AutomationEvent> &group, bool undoabl
     }
     else
     {
-        for (int i = 0; i < group.size(); ++i)
+        const auto removedIndices = BatchEditing::findSortedIndices(this->midiEvents, group);
+
+        MidiEventsBatch removedEvents;
+        removedEvents.ensureStorageAllocated(removedIndices.size());
+        for (const auto index : removedIndices)
         {
-            const AutomationEvent &autoEvent = group.getUnchecked(i);
-            const int index = this->midiEvents.indexOfSorted(autoEvent, &autoEvent);
-            if (index >= 0)
-            {
-                const auto removedEvent = this->midiEvents[index];
-                this->eventDispatcher.dispatchRemoveEvent(*removedEvent);
-                this->midiEvents.remove(index, true);
-            }
+            removedEvents.add(this->midiEvents.getUnchecked(index));
         }
+
+        this->eventDispatcher.dispatchRemoveEvents(removedEvents);
+
+        auto **events = this->midiEvents.begin();
+        for (const auto index : removedIndices)
+        {
+            delete events[index];
+            events[index] = nullptr;
+        }
+
+        BatchEditing::removeNulls(this->midiEvents);
+        this->invalidateSnapshotFrom(removedIndices.getFirst());
         
         this->updateBeatRange(true);
         this->eventDispatcher.dispatchPostRemoveEvent(this);
@@ -216,20 +269,41 @@ bool AutomationSequence::changeGroup(const Array<AutomationEvent> groupBefore,
     }
     else
     {
-        for (int i = 0; i < groupBefore.size(); ++i)
+        // all lookups go first, while the events are still sorted,
+        // then the changed events are taken out and merged back
+        Array<int> groupIndices;
+        const auto changedIndices = BatchEditing::findSortedIndices(this->midiEvents,
+            groupBefore, &groupIndices);
+
+        Array<MidiEvent *> changedEvents;
+        changedEvents.ensureStorageAllocated(changedIndices.size());
+
+        auto **events = this->midiEvents.begin();
+        for (int i = 0; i < changedIndices.size(); ++i)
         {
-            const AutomationEvent &oldParams = groupBefore.getUnchecked(i);
-            const AutomationEvent &newParams = groupAfter.getUnchecked(i);
-            const int index = this->midiEvents.indexOfSorted(oldParams, &oldParams);
-            if (index >= 0)
-            {
-                const auto changedEvent = static_cast<AutomationEvent *>(this->midiEvents[index]);
-                changedEvent->applyChanges(newParams);
-                this->midiEvents.remove(index, false);
-                this->midiEvents.addSorted(*changedEvent, changedEvent);
-                this->eventDispatcher.dispatchChangeEvent(oldParams, *changedEvent);
-            }
+            auto *changedEvent = static_cast<AutomationEvent *>(events[changedIndices.getUnchecked(i)]);
+            changedEvent->applyChanges(groupAfter.getReference(groupIndices.getUnchecked(i)));
+            changedEvents.add(changedEvent);
+            events[changedIndices.getUnchecked(i)] = nullptr;
         }
+
+        BatchEditing::removeNulls(this->midiEvents);
+
+        Array<MidiEvent *> sortedEvents(changedEvents);
+        static AutomationEvent comparator;
+        BatchEditing::sort(sortedEvents, comparator);
+        const auto firstMergedIndex = BatchEditing::mergeSorted(this->midiEvents, sortedEvents, comparator);
+        this->invalidateSnapshotFrom(jmin(changedIndices.getFirst(), firstMergedIndex));
+
+        MidiEventsBatch oldEvents;
+        oldEvents.ensureStorageAllocated(groupIndices.size());
+        for (const auto groupIndex : groupIndices)
+        {
+            oldEvents.add(&groupBefore.getReference(groupIndex));
+        }
+
+        this->eventDispatcher.dispatchChangeEvents(oldEvents,
+            MidiEventsBatch(changedEvents.begin(), changedEvents.size()));
         
         this->updateBeatRange(true);
     }
@@ -289,4 +363,5 @@ void AutomationSequence::reset()
 {
     this->midiEvents.clear();
     this->usedEventIds.clear();
+    this->invalidateSnapshotFrom(0);
 }
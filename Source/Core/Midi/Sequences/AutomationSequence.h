@@ -51,6 +51,12 @@ public:
 
     void importMidi(const MidiMessageSequence &sequence, short timeFormat) override;
 
+    void exportMidi(MidiMessageSequence &outSequence,
+        const Clip &clip, const KeyboardMapping &keyMap,
+        bool soloPlaybackMode, bool exportMetronome,
+        float projectFirstBeat, float projectLastBeat,
+        double timeFactor = 1.0) const override;
+
     //===------------------------------------------------------------------===//
     // Serializable
     //===------------------------------------------------------------------===//
@@ -59,46 +59,58 @@ float AutomationEvent::interpolateEvents(float cv1, float cv2, float factor, flo
 
 void AutomationEvent::exportMessages(MidiMessageSequence &outSequence,
     const Clip &clip, const KeyboardMapping &keyMap, double timeFactor) const noexcept
+{
+    const auto *sequence = this->getSequence();
+    const auto *track = sequence->getTrack();
+
+    const int indexOfThis = sequence->indexOfSorted(this);
+    const auto *nextEvent = (indexOfThis >= 0 && indexOfThis < (sequence->size() - 1)) ?
+        static_cast<const AutomationEvent *>(sequence->getUnchecked(indexOfThis + 1)) : nullptr;
+
+    AutomationEvent::exportMessages(outSequence, clip, timeFactor, *this, nextEvent,
+        { track->getTrackChannel(), track->getTrackControllerNumber(),
+            track->isTempoTrack(), track->isOnOffAutomationTrack() });
+}
+
+void AutomationEvent::exportMessages(MidiMessageSequence &outSequence,
+    const Clip &clip, double timeFactor, const AutomationEvent &event,
+    const AutomationEvent *nextEvent, const TrackParameters &track) noexcept
 {
     MidiMessage cc;
-    const bool isTempoTrack = this->getSequence()->getTrack()->isTempoTrack();
 
-    if (isTempoTrack)
+    if (track.isTempoTrack)
     {
-        cc = MidiMessage::tempoMetaEvent(Transport::getTempoByControllerValue(this->controllerValue));
+        cc = MidiMessage::tempoMetaEvent(Transport::getTempoByControllerValue(event.controllerValue));
     }
     else
     {
-        cc = MidiMessage::controllerEvent(this->getTrackChannel(),
-            this->getTrackControllerNumber(), int(this->controllerValue * 127));
+        cc = MidiMessage::controllerEvent(track.channel,
+            track.controllerNumber, int(event.controllerValue * 127));
     }
 
-    const double startTime = (this->beat + clip.getBeat()) * timeFactor;
+    const double startTime = (event.beat + clip.getBeat()) * timeFactor;
     cc.setTimeStamp(startTime);
     outSequence.addEvent(cc);
 
     // add interpolated events, if needed
-    const int indexOfThis = this->getSequence()->indexOfSorted(this);
-    const bool isPedalOrSwitchEvent = this->getSequence()->getTrack()->isOnOffAutomationTrack();
-    if (!isPedalOrSwitchEvent && indexOfThis >= 0 && indexOfThis < (this->getSequence()->size() - 1))
+    if (!track.isOnOffTrack && nextEvent != nullptr)
     {
-        const auto *nextEvent = static_cast<AutomationEvent *>(this->getSequence()->getUnchecked(indexOfThis + 1));
-        float interpolatedBeat = this->beat + AutomationEvent::curveInterpolationStepBeat;
-        float lastAppliedValue = this->controllerValue;
+        float interpolatedBeat = event.beat + AutomationEvent::curveInterpolationStepBeat;
+        float lastAppliedValue = event.controllerValue;
 
         while (interpolatedBeat < nextEvent->beat)
         {
-            const float factor = (interpolatedBeat - this->beat) / (nextEvent->beat - this->beat);
+            const float factor = (interpolatedBeat - event.beat) / (nextEvent->beat - event.beat);
 
             const float interpolatedValue =
-                AutomationEvent::interpolateEvents(this->controllerValue,
-                    nextEvent->controllerValue, factor, this->curvature);
+                AutomationEvent::interpolateEvents(event.controllerValue,
+                    nextEvent->controllerValue, factor, event.curvature);
 
             const float controllerDelta = fabsf(interpolatedValue - lastAppliedValue);
             if (controllerDelta > AutomationEvent::curveInterpolationThreshold)
             {
                 const double interpolatedTs = (interpolatedBeat + clip.getBeat()) * timeFactor;
-                if (isTempoTrack)
+                if (track.isTempoTrack)
                 {
                     MidiMessage ci(MidiMessage::tempoMetaEvent(Transport::getTempoByControllerValue(interpolatedValue)));
                     ci.setTimeStamp(interpolatedTs);
@@ -106,8 +118,8 @@ void AutomationEvent::exportMessages(MidiMessageSequence &outSequence,
                 }
                 else
                 {
-                    MidiMessage ci(MidiMessage::controllerEvent(this->getTrackChannel(),
-                        this->getTrackControllerNumber(), int(interpolatedValue * 127)));
+                    MidiMessage ci(MidiMessage::controllerEvent(track.channel,
+                        track.controllerNumber, int(interpolatedValue * 127)));
                     ci.setTimeStamp(interpolatedTs);
                     outSequence.addEvent(ci);
                 }
@@ -41,6 +41,21 @@ public:
     void exportMessages(MidiMessageSequence &outSequence, const Clip &clip,
         const KeyboardMapping &keyMap, double timeFactor) const noexcept override;
 
+    struct TrackParameters final
+    {
+        int channel;
+        int controllerNumber;
+        bool isTempoTrack;
+        bool isOnOffTrack;
+    };
+
+    // the same for the event copies, see SequenceSnapshot, which don't
+    // access their sequence: the next event to interpolate towards, if any,
+    // and the parameters of the track are passed in
+    static void exportMessages(MidiMessageSequence &outSequence,
+        const Clip &clip, double timeFactor, const AutomationEvent &event,
+        const AutomationEvent *nextEvent, const TrackParameters &track) noexcept;
+
     static float interpolateEvents(float cv1, float cv2, float factor, float easing);
 
     static constexpr auto curveInterpolationStepBeat = 0.25f;
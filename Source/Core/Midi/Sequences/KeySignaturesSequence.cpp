@@ -84,7 +84,8 @@ MidiEvent *KeySignaturesSequence::insert(const KeySignatureEvent &eventParams, b
     else
     {
         auto *ownedSignature = new KeySignatureEvent(this, eventParams);
-        this->midiEvents.addSorted(*ownedSignature, ownedSignature);
+        const auto index = this->midiEvents.addSorted(*ownedSignature, ownedSignature);
+        this->invalidateSnapshotFrom(index);
         this->eventDispatcher.dispatchAddEvent(*ownedSignature);
         this->updateBeatRange(true);
         return ownedSignature;
@@ -109,6 +110,7 @@ bool KeySignaturesSequence::remove(const KeySignatureEvent &signature, bool undo
             auto *removedEvent = this->midiEvents.getUnchecked(index);
             this->eventDispatcher.dispatchRemoveEvent(*removedEvent);
             this->midiEvents.remove(index, true);
+            this->invalidateSnapshotFrom(index);
             this->updateBeatRange(true);
             this->eventDispatcher.dispatchPostRemoveEvent(this);
             return true;
@@ -137,7 +139,8 @@ bool KeySignaturesSequence::change(const KeySignatureEvent &oldParams,
             auto *changedEvent = static_cast<KeySignatureEvent *>(this->midiEvents.getUnchecked(index));
             changedEvent->applyChanges(newParams);
             this->midiEvents.remove(index, false);
-            this->midiEvents.addSorted(*changedEvent, changedEvent);
+            const auto newIndex = this->midiEvents.addSorted(*changedEvent, changedEvent);
+            this->invalidateSnapshotFrom(jmin(index, newIndex));
             this->eventDispatcher.dispatchChangeEvent(oldParams, *changedEvent);
             this->updateBeatRange(true);
             return true;
@@ -203,4 +206,5 @@ void KeySignaturesSequence::reset()
 {
     this->midiEvents.clear();
     this->usedEventIds.clear();
+    this->invalidateSnapshotFrom(0);
 }
@@ -42,13 +42,15 @@ struct EventIdGenerator final
 MidiSequence::MidiSequence(MidiTrack &parentTrack,
     ProjectEventDispatcher &dispatcher) noexcept :
     track(parentTrack),
-    eventDispatcher(dispatcher) {}
+    eventDispatcher(dispatcher),
+    snapshot(std::make_shared<SequenceSnapshot>()) {}
 
 void MidiSequence::sort()
 {
     if (this->midiEvents.size() > 0)
     {
         this->midiEvents.sort(*this->midiEvents.getFirst());
+        this->invalidateSnapshotFrom(0);
     }
 }
 
@@ -111,10 +113,13 @@ void MidiSequence::exportMidi(MidiMessageSequence &outSequence,
     // and TimeSignatureSequence overrides this method
     // to emit the "virtual" metronome track, if needed
 
-    for (const auto *event : this->midiEvents)
+    // this might be called from the background threads, hence the snapshot
+    const auto snapshot = this->getSnapshot();
+
+    snapshot->forEach([&](const MidiEvent &event)
     {
-        event->exportMessages(outSequence, clip, keyMap, timeFactor);
-    }
+        event.exportMessages(outSequence, clip, keyMap, timeFactor);
+    });
 
     outSequence.updateMatchedPairs();
 }
@@ -156,6 +161,22 @@ float MidiSequence::getLengthInBeats() const noexcept
     return this->getLastBeat() - this->getFirstBeat();
 }
 
+int MidiSequence::lowerBound(float beat) const noexcept
+{
+    const auto *found = std::lower_bound(this->begin(), this->end(), beat,
+        [](const MidiEvent *event, float b) { return event->getBeat() < b; });
+
+    return int(found - this->begin());
+}
+
+int MidiSequence::upperBound(float beat) const noexcept
+{
+    const auto *found = std::upper_bound(this->begin(), this->end(), beat,
+        [](float b, const MidiEvent *event) { return b < event->getBeat(); });
+
+    return int(found - this->begin());
+}
+
 MidiTrack *MidiSequence::getTrack() const noexcept
 {
     return &this->track;
@@ -217,6 +238,46 @@ MidiEvent::Id MidiSequence::createUniqueEventId() const noexcept
     return eventId;
 }
 
+//===----------------------------------------------------------------------===//
+// Snapshots
+//===----------------------------------------------------------------------===//
+
+SequenceSnapshot::Ptr MidiSequence::getSnapshot() const
+{
+    if (MessageManager::existsAndIsCurrentThread())
+    {
+        this->publishSnapshot();
+    }
+
+    return std::atomic_load(&this->snapshot);
+}
+
+void MidiSequence::publishSnapshot() const
+{
+    // only the message thread writes the snapshot
+    jassert(MessageManager::existsAndIsCurrentThread());
+
+    const auto firstOutdatedIndex = this->firstOutdatedSnapshotIndex.get();
+    if (firstOutdatedIndex == snapshotIsUpToDate)
+    {
+        return;
+    }
+
+    // the previous snapshot is always alive here,
+    // so the chunks before the first edited event are shared
+    const auto previousSnapshot = std::atomic_load(&this->snapshot);
+    auto newSnapshot = std::make_shared<SequenceSnapshot>(previousSnapshot.get(),
+        firstOutdatedIndex, this->midiEvents);
+
+    std::atomic_store(&this->snapshot, SequenceSnapshot::Ptr(move(newSnapshot)));
+    this->firstOutdatedSnapshotIndex = snapshotIsUpToDate;
+}
+
+void MidiSequence::handleAsyncUpdate()
+{
+    this->publishSnapshot();
+}
+
 //===----------------------------------------------------------------------===//
 // Helpers
 //===----------------------------------------------------------------------===//
@@ -19,6 +19,7 @@
 
 #include "Clip.h"
 #include "MidiEvent.h"
+#include "SequenceSnapshot.h"
 #include "ProjectEventDispatcher.h"
 #include "UndoActionIDs.h"
 
@@ -27,7 +28,7 @@ class MidiTrack;
 class UndoStack;
 class KeyboardMapping;
 
-class MidiSequence : public Serializable
+class MidiSequence : public Serializable, private AsyncUpdater
 {
 public:
 
@@ -79,7 +80,10 @@ public:
         }
 
         static T comparator;
-        this->midiEvents.addSorted(comparator, new T(this, event));
+        auto *ownedEvent = new T(this, event);
+        const auto index = this->midiEvents.addSorted(comparator, ownedEvent);
+        this->invalidateSnapshotFrom(index);
+        this->onEventImported(*ownedEvent, index);
     }
 
     template<typename T>
@@ -97,7 +101,10 @@ public:
 
         static T comparator;
         this->usedEventIds.insert(event->getId());
-        this->midiEvents.addSorted(comparator, event.release());
+        auto *ownedEvent = event.release();
+        const auto index = this->midiEvents.addSorted(comparator, ownedEvent);
+        this->invalidateSnapshotFrom(index);
+        this->onEventImported(*ownedEvent, index);
     }
 
     //===------------------------------------------------------------------===//
@@ -152,6 +159,24 @@ public:
         return index;
     }
 
+    // The events are sorted by beat, so these are binary searches:
+    // the index of the first event at or after the given beat,
+    // and the index of the first event after the given beat
+    int lowerBound(float beat) const noexcept;
+    int upperBound(float beat) const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Snapshots
+    //===------------------------------------------------------------------===//
+
+    // The immutable copy of the events for the background readers,
+    // see SequenceSnapshot; the message thread publishes a new one
+    // asynchronously after the edits, copying only the edited chunks,
+    // so the other threads always get the last published one in O(1),
+    // without waiting for the message thread; on the message thread
+    // itself, the pending edits are published first, if any
+    SequenceSnapshot::Ptr getSnapshot() const;
+
     //===------------------------------------------------------------------===//
     // Helpers
     //===------------------------------------------------------------------===//
@@ -179,6 +204,19 @@ protected:
     virtual float findFirstBeat() const noexcept;
     virtual float findLastBeat() const noexcept;
 
+    // called after an event is added bypassing the undoable editing methods
+    virtual void onEventImported(const MidiEvent &event, int index) {}
+
+    // to be called by all edits of the events array,
+    // with the index of the first event they have touched;
+    // all edits made within one message loop iteration, e.g. an undo
+    // transaction, are published as a single new snapshot
+    inline void invalidateSnapshotFrom(int index)
+    {
+        this->firstOutdatedSnapshotIndex = jmin(this->firstOutdatedSnapshotIndex.get(), index);
+        this->triggerAsyncUpdate();
+    }
+
     ProjectEventDispatcher &eventDispatcher;
     ProjectNode *getProject() const noexcept;
     UndoStack *getUndoStack() const noexcept;
@@ -189,6 +227,15 @@ protected:
     
 private:
 
+    static constexpr int snapshotIsUpToDate = std::numeric_limits<int>::max();
+    mutable Atomic<int> firstOutdatedSnapshotIndex { 0 };
+    // only accessed via std::atomic_load/atomic_store,
+    // written on the message thread, read on any thread
+    mutable SequenceSnapshot::Ptr snapshot;
+    void publishSnapshot() const;
+
+    void handleAsyncUpdate() override;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiSequence)
     JUCE_DECLARE_WEAK_REFERENCEABLE(MidiSequence)
 };
@@ -0,0 +1,271 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "NoteIntervalIndex.h"
+#include "Note.h"
+
+NoteIntervalIndex::NoteIntervalIndex(const OwnedArray<MidiEvent> &notes) noexcept :
+    notes(notes) {}
+
+static inline float getNoteEndBeat(const MidiEvent *event) noexcept
+{
+    jassert(event->isTypeOf(MidiEvent::Type::Note));
+    const auto *note = static_cast<const Note *>(event);
+    return note->getBeat() + note->getLength();
+}
+
+void NoteIntervalIndex::findOverlapping(float startBeat, float endBeat, Array<int> &outIndices) const
+{
+    this->updateIfNeeded();
+
+    // the start beats are sorted, so the end is a binary search away,
+    // but the long notes may start anywhere before the range,
+    // so the start is the first block which ends after the range start
+    const auto *lastCandidate = std::lower_bound(this->notes.begin(), this->notes.end(), endBeat,
+        [](const MidiEvent *event, float b) { return event->getBeat() < b; });
+
+    const auto numCandidates = int(lastCandidate - this->notes.begin());
+    const auto *firstBlock = std::upper_bound(this->blockPrefixEnds.begin(),
+        this->blockPrefixEnds.end(), startBeat);
+
+    for (auto block = int(firstBlock - this->blockPrefixEnds.begin());
+        block * blockSize < numCandidates; ++block)
+    {
+        if (this->blockEnds.getUnchecked(block) <= startBeat)
+        {
+            continue;
+        }
+
+        const auto blockEnd = jmin((block + 1) * blockSize, numCandidates);
+        for (int i = block * blockSize; i < blockEnd; ++i)
+        {
+            if (getNoteEndBeat(this->notes.getUnchecked(i)) > startBeat)
+            {
+                outIndices.add(i);
+            }
+        }
+    }
+}
+
+float NoteIntervalIndex::getLastBeat() const
+{
+    jassert(!this->notes.isEmpty());
+    this->updateIfNeeded();
+    return this->blockPrefixEnds.getLast();
+}
+
+void NoteIntervalIndex::updateIfNeeded() const
+{
+    const auto numNotes = this->notes.size();
+    const auto numBlocks = (numNotes + blockSize - 1) / blockSize;
+    this->blockEnds.resize(numBlocks);
+    this->blockPrefixEnds.resize(numBlocks);
+
+    for (int block = this->firstOutdatedBlock; block < numBlocks; ++block)
+    {
+        const auto blockEnd = jmin((block + 1) * blockSize, numNotes);
+        auto maxEnd = std::numeric_limits<float>::lowest();
+        for (int i = block * blockSize; i < blockEnd; ++i)
+        {
+            maxEnd = jmax(maxEnd, getNoteEndBeat(this->notes.getUnchecked(i)));
+        }
+
+        this->blockEnds.setUnchecked(block, maxEnd);
+        this->blockPrefixEnds.setUnchecked(block, block == 0 ? maxEnd :
+            jmax(maxEnd, this->blockPrefixEnds.getUnchecked(block - 1)));
+    }
+
+    this->firstOutdatedBlock = numBlocks;
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class NoteIntervalIndexTests final : public UnitTest
+{
+public:
+    NoteIntervalIndexTests() : UnitTest("Note interval index tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        static Note comparator;
+
+        beginTest("Range queries and the last beat");
+        {
+            OwnedArray<MidiEvent> notes;
+            NoteIntervalIndex index(notes);
+
+            notes.addSorted(comparator, new Note(nullptr, 60, 4.f, 1.f, 0.5f));
+            notes.addSorted(comparator, new Note(nullptr, 62, 0.f, 8.f, 0.5f));
+            notes.addSorted(comparator, new Note(nullptr, 64, 16.f, 1.f, 0.5f));
+            index.invalidateFrom(0);
+
+            Array<int> found;
+            index.findOverlapping(6.f, 10.f, found);
+            expectEquals(found.size(), 1); // the long one, starting at 0
+            expectEquals(found.getFirst(), 0);
+
+            expectEquals(index.getLastBeat(), 17.f);
+
+            notes.remove(0);
+            index.invalidateFrom(0);
+            expectEquals(index.getLastBeat(), 17.f);
+
+            notes.remove(1);
+            index.invalidateFrom(1);
+            expectEquals(index.getLastBeat(), 5.f);
+        }
+
+        beginTest("Interval index after edits");
+        {
+            Random random(42);
+            OwnedArray<MidiEvent> notes;
+            NoteIntervalIndex index(notes);
+
+            for (int i = 0; i < 1000; ++i)
+            {
+                // mostly short notes, and some very long ones
+                const auto length = random.nextInt(20) == 0 ?
+                    float(random.nextInt(64)) : 0.25f * float(1 + random.nextInt(4));
+
+                auto *note = new Note(nullptr, random.nextInt(128),
+                    float(random.nextInt(1000)) * 0.5f, length, 0.5f);
+
+                index.invalidateFrom(notes.addSorted(comparator, note));
+
+                if (i % 3 == 0)
+                {
+                    const auto removedIndex = random.nextInt(notes.size());
+                    notes.remove(removedIndex);
+                    index.invalidateFrom(removedIndex);
+                }
+
+                const auto startBeat = float(random.nextInt(500));
+                const auto endBeat = startBeat + float(random.nextInt(16));
+
+                Array<int> found;
+                index.findOverlapping(startBeat, endBeat, found);
+
+                Array<int> expected;
+                for (int j = 0; j < notes.size(); ++j)
+                {
+                    const auto *n = static_cast<const Note *>(notes.getUnchecked(j));
+                    if (n->getBeat() < endBeat && n->getBeat() + n->getLength() > startBeat)
+                    {
+                        expected.add(j);
+                    }
+                }
+
+                expect(found == expected);
+            }
+        }
+    }
+};
+
+static NoteIntervalIndexTests noteIntervalIndexTests;
+
+// Not a part of the default test run, see UnitTestCategories::helioBenchmarks
+class NoteIntervalIndexBenchmarks final : public UnitTest
+{
+public:
+    NoteIntervalIndexBenchmarks() :
+        UnitTest("Note interval index benchmarks", UnitTestCategories::helioBenchmarks) {}
+
+    void runTest() override
+    {
+        beginTest("1M notes range query benchmark");
+        {
+            static constexpr auto numNotes = 1000000;
+
+            Random random(numNotes);
+
+            // in a real sequence, the notes are allocated in the order
+            // they were added or edited, which is not the order of their beats,
+            // so the objects are allocated in a shuffled order here as well,
+            // and only then sorted, like the sequence does
+            Array<int> beatOrder;
+            beatOrder.ensureStorageAllocated(numNotes);
+            for (int i = 0; i < numNotes; ++i)
+            {
+                beatOrder.add(i);
+            }
+
+            for (int i = numNotes - 1; i > 0; --i)
+            {
+                beatOrder.swap(i, random.nextInt(i + 1));
+            }
+
+            OwnedArray<MidiEvent> notes;
+            notes.ensureStorageAllocated(numNotes);
+            for (const auto beatIndex : beatOrder)
+            {
+                notes.add(new Note(nullptr, random.nextInt(128),
+                    float(beatIndex) * 0.25f, 0.25f + float(random.nextInt(16)) * 0.25f,
+                    random.nextFloat()));
+            }
+
+            static Note comparator;
+            notes.sort(comparator);
+
+            NoteIntervalIndex index(notes);
+
+            logMessage("Bytes per note: " + String(int(sizeof(Note) + sizeof(Note *))) +
+                " for the objects (plus the allocator overhead), plus " +
+                String(float(sizeof(float) * 2) / float(NoteIntervalIndex::blockSize), 3) +
+                " for the index");
+
+            const auto startBeat = float(numNotes) * 0.1f;
+            const auto endBeat = float(numNotes) * 0.15f;
+
+            auto timeMs = Time::getMillisecondCounterHiRes();
+            int scanFound = 0;
+            for (const auto *event : notes)
+            {
+                const auto *note = static_cast<const Note *>(event);
+                if (note->getBeat() < endBeat && note->getBeat() + note->getLength() > startBeat)
+                {
+                    scanFound++;
+                }
+            }
+            const auto scanMs = Time::getMillisecondCounterHiRes() - timeMs;
+
+            // the first query builds the index, the next ones only search
+            timeMs = Time::getMillisecondCounterHiRes();
+            index.getLastBeat();
+            const auto buildMs = Time::getMillisecondCounterHiRes() - timeMs;
+
+            timeMs = Time::getMillisecondCounterHiRes();
+            Array<int> indexFound;
+            index.findOverlapping(startBeat, endBeat, indexFound);
+            const auto queryMs = Time::getMillisecondCounterHiRes() - timeMs;
+
+            logMessage("Range query: " + String(scanMs, 2) + " ms for the linear scan, " +
+                String(buildMs, 2) + " ms to build the index, " +
+                String(queryMs, 2) + " ms over the index");
+
+            expectEquals(indexFound.size(), scanFound);
+        }
+    }
+};
+
+static NoteIntervalIndexBenchmarks noteIntervalIndexBenchmarks;
+
+#endif
@@ -0,0 +1,81 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "MidiEvent.h"
+
+// The index of a piano sequence's notes for the beat range queries,
+// like the lasso, the knife tool and the range operations: the notes are
+// sorted by the start beat, but the long notes may start anywhere before
+// the range, so without the index, each query would be a linear scan.
+
+// The notes are split into the fixed size blocks, and for each block,
+// there's the max end beat of its notes, and the max end beat of it and
+// all the blocks before it, which is never decreasing, so the first block
+// which can overlap the range is a binary search away, and the blocks
+// of the short notes within the range are skipped quickly.
+
+// Any edit shifts the blocks after it, so they're rebuilt lazily,
+// on the next query, from the first block the edits have touched;
+// which means that an edit near the start costs a full O(n) rebuild,
+// but that's one pass per query, not per edit, so the batched edits,
+// like a paste or a transform, pay for it once; the appends,
+// as in recording, only touch the last block.
+
+// The index reads the notes right from the sequence's array, and only
+// keeps two floats per block, not per note; the notes themselves are still
+// the Note objects, since the UI, the undo actions and the version control
+// all hold references to them, and moving them into the contiguous columns
+// with the stable handles for all those is a separate, larger change.
+
+class NoteIntervalIndex final
+{
+public:
+
+    // the sequence's events, which are all notes, sorted
+    explicit NoteIntervalIndex(const OwnedArray<MidiEvent> &notes) noexcept;
+
+    // to be called by all edits of the notes array,
+    // with the index of the first note they have touched
+    inline void invalidateFrom(int noteIndex) noexcept
+    {
+        this->firstOutdatedBlock = jmin(this->firstOutdatedBlock, noteIndex / blockSize);
+    }
+
+    // the notes which start before the end beat and end after the start beat,
+    // in O(log n + k) for the most part, see the comment above
+    void findOverlapping(float startBeat, float endBeat, Array<int> &outIndices) const;
+
+    // the max end beat of all notes, which is not necessarily
+    // the end of the last note, since the notes are sorted by start beat
+    float getLastBeat() const;
+
+    static constexpr int blockSize = 64;
+
+private:
+
+    const OwnedArray<MidiEvent> &notes;
+
+    mutable Array<float> blockEnds;
+    mutable Array<float> blockPrefixEnds;
+    mutable int firstOutdatedBlock = 0;
+
+    void updateIfNeeded() const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoteIntervalIndex)
+};
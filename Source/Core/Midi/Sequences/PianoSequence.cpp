@@ -20,12 +20,14 @@
 
 #include "PianoRoll.h"
 #include "NoteActions.h"
+#include "BatchEditing.h"
 #include "SerializationKeys.h"
 #include "UndoStack.h"
 
 PianoSequence::PianoSequence(MidiTrack &track,
     ProjectEventDispatcher &dispatcher) noexcept :
-    MidiSequence(track, dispatcher) {}
+    MidiSequence(track, dispatcher),
+    noteIndex(this->midiEvents) {}
 
 //===----------------------------------------------------------------------===//
 // Import/export
@@ -75,6 +77,24 @@ void PianoSequence::exportMidi(MidiMessageSequence &outSequence,
         return;
     }
 
+    // the notes are edited on the message thread, so the background
+    // threads, like the VCS or the export, read the immutable snapshot instead
+    if (!MessageManager::existsAndIsCurrentThread())
+    {
+        const auto snapshot = this->getSnapshot();
+
+        outSequence.ensureStorageAllocated(outSequence.getNumEvents() + snapshot->size() * 2);
+        snapshot->forEach([&](const MidiEvent &event)
+        {
+            event.exportMessages(outSequence, clip, keyMap, timeFactor);
+        });
+
+        outSequence.updateMatchedPairs();
+        return;
+    }
+
+    outSequence.ensureStorageAllocated(outSequence.getNumEvents() + this->midiEvents.size() * 2);
+
     for (const auto *event : this->midiEvents)
     {
         event->exportMessages(outSequence, clip, keyMap, timeFactor);
@@ -98,7 +118,9 @@ MidiEvent *PianoSequence::insert(const Note &eventParams, const bool undoable)
     else
     {
         auto *ownedNote = new Note(this, eventParams);
-        this->midiEvents.addSorted(*ownedNote, ownedNote);
+        const auto index = this->midiEvents.addSorted(*ownedNote, ownedNote);
+        this->noteIndex.invalidateFrom(index);
+        this->invalidateSnapshotFrom(index);
         this->eventDispatcher.dispatchAddEvent(*ownedNote);
         this->updateBeatRange(true);
         return ownedNote;
@@ -125,6 +147,8 @@ bool PianoSequence::remove(const Note &eventParams, const bool undoable)
             jassert(removedNote->isValid());
             this->eventDispatcher.dispatchRemoveEvent(*removedNote);
             this->midiEvents.remove(index, true);
+            this->noteIndex.invalidateFrom(index);
+            this->invalidateSnapshotFrom(index);
             this->updateBeatRange(true);
             this->eventDispatcher.dispatchPostRemoveEvent(this);
             return true;
@@ -154,7 +178,9 @@ bool PianoSequence::change(const Note &oldParams,
             auto *changedNote = static_cast<Note *>(this->midiEvents.getUnchecked(index));
             changedNote->applyChanges(newParams);
             this->midiEvents.remove(index, false);
-            this->midiEvents.addSorted(*changedNote, changedNote);
+            const auto newIndex = this->midiEvents.addSorted(*changedNote, changedNote);
+            this->noteIndex.invalidateFrom(jmin(index, newIndex));
+            this->invalidateSnapshotFrom(jmin(index, newIndex));
             this->eventDispatcher.dispatchChangeEvent(oldParams, *changedNote);
             this->updateBeatRange(true);
             return true;
@@ -176,14 +202,21 @@ bool PianoSequence::insertGroup(Array<Note> &group, bool undoable)
     }
     else
     {
-        for (int i = 0; i < group.size(); ++i)
+        Array<MidiEvent *> newNotes;
+        newNotes.ensureStorageAllocated(group.size());
+        for (const auto &eventParams : group)
         {
-            const Note &eventParams = group.getUnchecked(i);
-            auto *ownedNote = new Note(this, eventParams);
-            this->midiEvents.addSorted(*ownedNote, ownedNote);
-            this->eventDispatcher.dispatchAddEvent(*ownedNote);
+            newNotes.add(new Note(this, eventParams));
         }
 
+        static Note comparator;
+        BatchEditing::sort(newNotes, comparator);
+        const auto firstIndex = BatchEditing::mergeSorted(this->midiEvents, newNotes, comparator);
+        this->noteIndex.invalidateFrom(firstIndex);
+        this->invalidateSnapshotFrom(firstIndex);
+
+        this->eventDispatcher.dispatchAddEvents(MidiEventsBatch(newNotes.begin(), newNotes.size()));
+
         this->updateBeatRange(true);
     }
 
@@ -200,23 +233,32 @@ bool PianoSequence::removeGroup(Array<Note> &group, bool undoable)
     }
     else
     {
-        for (int i = 0; i < group.size(); ++i)
+        // Hitting an assertion in there almost likely means that target note array
+        // contains more than one instance of the same note, but from different clips.
+        // All the code here and in SequencerOperations class assumes this never happens,
+        // so make sure PianoRoll restricts editing scope to a single clip instance.
+        const auto removedIndices = BatchEditing::findSortedIndices(this->midiEvents, group);
+
+        MidiEventsBatch removedNotes;
+        removedNotes.ensureStorageAllocated(removedIndices.size());
+        for (const auto index : removedIndices)
         {
-            const Note &note = group.getUnchecked(i);
-            const int index = this->midiEvents.indexOfSorted(note, &note);
-            // Hitting this assertion almost likely means that target note array
-            // contains more than one instance of the same note, but from different clips.
-            // All the code here and in SequencerOperations class assumes this never happens,
-            // so make sure PianoRoll restricts editing scope to a single clip instance.
-            jassert(index >= 0);
-            if (index >= 0)
-            {
-                auto *removedNote = this->midiEvents.getUnchecked(index);
-                this->eventDispatcher.dispatchRemoveEvent(*removedNote);
-                this->midiEvents.remove(index, true);
-            }
+            removedNotes.add(this->midiEvents.getUnchecked(index));
+        }
+
+        this->eventDispatcher.dispatchRemoveEvents(removedNotes);
+
+        auto **events = this->midiEvents.begin();
+        for (const auto index : removedIndices)
+        {
+            delete events[index];
+            events[index] = nullptr;
         }
 
+        BatchEditing::removeNulls(this->midiEvents);
+        this->noteIndex.invalidateFrom(removedIndices.getFirst());
+        this->invalidateSnapshotFrom(removedIndices.getFirst());
+
         this->updateBeatRange(true);
         this->eventDispatcher.dispatchPostRemoveEvent(this);
     }
@@ -237,27 +279,44 @@ bool PianoSequence::changeGroup(Array<Note> &groupBefore,
     }
     else
     {
-        for (int i = 0; i < groupBefore.size(); ++i)
+        // all lookups go first, while the events are still sorted
+        // (see the comment in removeGroup about the assertions)
+        Array<int> groupIndices;
+        const auto changedIndices = BatchEditing::findSortedIndices(this->midiEvents,
+            groupBefore, &groupIndices);
+
+        // then the changed notes are taken out, and merged back in their new places
+        Array<MidiEvent *> changedNotes;
+        changedNotes.ensureStorageAllocated(changedIndices.size());
+
+        auto **events = this->midiEvents.begin();
+        for (int i = 0; i < changedIndices.size(); ++i)
         {
-            const Note &oldParams = groupBefore.getReference(i);
-            const Note &newParams = groupAfter.getReference(i);
-            const int index = this->midiEvents.indexOfSorted(oldParams, &oldParams);
-            // if you're hitting this assertion, one of the reasons might be
-            // allowing user to somehow select notes of different clips simultaneously,
-            // and then editing the selection, which leads to applying the same
-            // transformation to one set of notes twice, which is kinda nonsense,
-            // so make sure the selection is always limited to active track and clip:
-            jassert(index >= 0);
-            if (index >= 0)
-            {
-                auto *changedNote = static_cast<Note *>(this->midiEvents.getUnchecked(index));
-                changedNote->applyChanges(newParams);
-                this->midiEvents.remove(index, false);
-                this->midiEvents.addSorted(*changedNote, changedNote);
-                this->eventDispatcher.dispatchChangeEvent(oldParams, *changedNote);
-            }
+            auto *changedNote = static_cast<Note *>(events[changedIndices.getUnchecked(i)]);
+            changedNote->applyChanges(groupAfter.getReference(groupIndices.getUnchecked(i)));
+            changedNotes.add(changedNote);
+            events[changedIndices.getUnchecked(i)] = nullptr;
         }
 
+        BatchEditing::removeNulls(this->midiEvents);
+
+        Array<MidiEvent *> sortedNotes(changedNotes);
+        static Note comparator;
+        BatchEditing::sort(sortedNotes, comparator);
+        const auto firstMergedIndex = BatchEditing::mergeSorted(this->midiEvents, sortedNotes, comparator);
+        this->noteIndex.invalidateFrom(jmin(changedIndices.getFirst(), firstMergedIndex));
+        this->invalidateSnapshotFrom(jmin(changedIndices.getFirst(), firstMergedIndex));
+
+        MidiEventsBatch oldNotes;
+        oldNotes.ensureStorageAllocated(groupIndices.size());
+        for (const auto groupIndex : groupIndices)
+        {
+            oldNotes.add(&groupBefore.getReference(groupIndex));
+        }
+
+        this->eventDispatcher.dispatchChangeEvents(oldNotes,
+            MidiEventsBatch(changedNotes.begin(), changedNotes.size()));
+
         this->updateBeatRange(true);
     }
 
@@ -275,21 +334,16 @@ float PianoSequence::findLastBeat() const noexcept
         return 0.f;
     }
 
-    // FIXME:
-    // sometimes the last event is not the one that lasts longer
-    // (as events *must* be sorted by start beat, not by end beat),
-    // so here we have to iterate through a number of last events
-    // to guess where the sequence really ends, with still no guarantee
-    // we'll end up with right event (not sure how to fix it at the moment):
-    float lastBeat = -FLT_MAX;
-    const int checkStart = jmax(0, this->midiEvents.size() - 20);
-    for (int i = checkStart; i < this->midiEvents.size(); ++i)
-    {
-        const auto *n = static_cast<const Note *>(this->midiEvents.getUnchecked(i));
-        lastBeat = jmax(lastBeat, n->getBeat() + n->getLength());
-    }
+    // the notes are sorted by start beat, so the last one
+    // is not necessarily the one that ends last, but the interval
+    // interval index keeps track of the max end beat:
+    return this->noteIndex.getLastBeat();
+}
 
-    return lastBeat;
+void PianoSequence::onEventImported(const MidiEvent &event, int index)
+{
+    jassert(event.isTypeOf(MidiEvent::Type::Note));
+    this->noteIndex.invalidateFrom(index);
 }
 
 //===----------------------------------------------------------------------===//
@@ -335,11 +389,15 @@ void PianoSequence::deserialize(const SerializedData &data)
     }
 
     this->sort();
+    this->noteIndex.invalidateFrom(0);
+
     this->updateBeatRange(false);
 }
 
 void PianoSequence::reset()
 {
     this->midiEvents.clear();
+    this->noteIndex.invalidateFrom(0);
     this->usedEventIds.clear();
+    this->invalidateSnapshotFrom(0);
 }
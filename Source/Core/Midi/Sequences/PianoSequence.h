@@ -18,6 +18,7 @@
 #pragma once
 
 #include "MidiSequence.h"
+#include "NoteIntervalIndex.h"
 #include "Note.h"
 
 class PianoRoll;
@@ -53,6 +54,21 @@ public:
     bool removeGroup(Array<Note> &notes, bool undoable);
     bool changeGroup(Array<Note> &eventsBefore,
         Array<Note> &eventsAfter, bool undoable);
+
+    //===------------------------------------------------------------------===//
+    // Accessors
+    //===------------------------------------------------------------------===//
+
+    // the beat range queries over the notes, see NoteIntervalIndex
+    inline const NoteIntervalIndex &getNoteIndex() const noexcept
+    {
+        return this->noteIndex;
+    }
+
+    inline Note *getNoteUnchecked(int index) const noexcept
+    {
+        return static_cast<Note *>(this->getUnchecked(index));
+    }
     
     //===------------------------------------------------------------------===//
     // Serializable
@@ -65,6 +81,9 @@ public:
 private:
 
     float findLastBeat() const noexcept override;
+    void onEventImported(const MidiEvent &event, int index) override;
+
+    NoteIntervalIndex noteIndex;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoSequence);
     JUCE_DECLARE_WEAK_REFERENCEABLE(PianoSequence);
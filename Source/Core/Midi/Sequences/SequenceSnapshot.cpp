@@ -0,0 +1,177 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "SequenceSnapshot.h"
+#include "Note.h"
+#include "AutomationEvent.h"
+#include "AnnotationEvent.h"
+#include "TimeSignatureEvent.h"
+#include "KeySignatureEvent.h"
+
+SequenceSnapshot::SequenceSnapshot(const SequenceSnapshot *previous,
+    int firstOutdatedIndex, const OwnedArray<MidiEvent> &events) :
+    numEvents(events.size())
+{
+    const auto numChunks = (this->numEvents + chunkSize - 1) / chunkSize;
+    this->chunks.ensureStorageAllocated(numChunks);
+
+    // all events before the first outdated one are the same as in
+    // the previous snapshot, so are all the full chunks before it
+    if (previous != nullptr)
+    {
+        const auto numSharedChunks = jmin(firstOutdatedIndex / chunkSize,
+            previous->chunks.size(), numChunks);
+
+        for (int i = 0; i < numSharedChunks; ++i)
+        {
+            auto *chunk = previous->chunks.getObjectPointerUnchecked(i);
+            jassert(chunk->numEvents == chunkSize);
+            this->chunks.add(chunk);
+        }
+    }
+
+    for (int i = this->chunks.size(); i < numChunks; ++i)
+    {
+        const auto chunkEnd = jmin((i + 1) * chunkSize, this->numEvents);
+        auto *chunk = new Chunk(chunkEnd - i * chunkSize);
+
+        for (int j = i * chunkSize; j < chunkEnd; ++j)
+        {
+            chunk->add(*events.getUnchecked(j));
+        }
+
+        this->chunks.add(chunk);
+    }
+}
+
+int SequenceSnapshot::countSharedChunks(const SequenceSnapshot &other) const noexcept
+{
+    int numShared = 0;
+    const auto numCommon = jmin(this->chunks.size(), other.chunks.size());
+    while (numShared < numCommon &&
+        this->chunks.getObjectPointerUnchecked(numShared) ==
+        other.chunks.getObjectPointerUnchecked(numShared))
+    {
+        numShared++;
+    }
+
+    return numShared;
+}
+
+//===----------------------------------------------------------------------===//
+// Chunk
+//===----------------------------------------------------------------------===//
+
+// the slot fits any event type, and keeps the next slots aligned
+static constexpr size_t maxEventSize = jmax(jmax(sizeof(Note),
+    sizeof(AutomationEvent), sizeof(AnnotationEvent)),
+    sizeof(TimeSignatureEvent), sizeof(KeySignatureEvent));
+
+static constexpr size_t eventSlotSize = (maxEventSize + alignof(std::max_align_t) - 1) /
+    alignof(std::max_align_t) * alignof(std::max_align_t);
+
+SequenceSnapshot::Chunk::Chunk(int numEventsToAllocate) :
+    storage(size_t(numEventsToAllocate) * eventSlotSize) {}
+
+SequenceSnapshot::Chunk::~Chunk()
+{
+    for (int i = 0; i < this->numEvents; ++i)
+    {
+        this->events[i]->~MidiEvent();
+    }
+}
+
+void SequenceSnapshot::Chunk::add(const MidiEvent &event)
+{
+    auto *slot = this->storage.getData() + this->numEvents * eventSlotSize;
+
+    switch (event.getType())
+    {
+    case MidiEvent::Type::Note:
+        this->events[this->numEvents++] = new (slot) Note(static_cast<const Note &>(event));
+        break;
+    case MidiEvent::Type::Auto:
+        this->events[this->numEvents++] = new (slot) AutomationEvent(static_cast<const AutomationEvent &>(event));
+        break;
+    case MidiEvent::Type::Annotation:
+        this->events[this->numEvents++] = new (slot) AnnotationEvent(static_cast<const AnnotationEvent &>(event));
+        break;
+    case MidiEvent::Type::TimeSignature:
+        this->events[this->numEvents++] = new (slot) TimeSignatureEvent(static_cast<const TimeSignatureEvent &>(event));
+        break;
+    case MidiEvent::Type::KeySignature:
+        this->events[this->numEvents++] = new (slot) KeySignatureEvent(static_cast<const KeySignatureEvent &>(event));
+        break;
+    default:
+        jassertfalse;
+        break;
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class SequenceSnapshotTests final : public UnitTest
+{
+public:
+    SequenceSnapshotTests() : UnitTest("Sequence snapshot tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        beginTest("Snapshots share the chunks before the first edit");
+        {
+            OwnedArray<MidiEvent> events;
+            for (int i = 0; i < 200; ++i)
+            {
+                events.add(new Note(nullptr, 60, float(i), 1.f, 0.5f));
+            }
+
+            const SequenceSnapshot::Ptr first(new SequenceSnapshot(nullptr, 0, events));
+            expectEquals(first->size(), 200);
+            expectEquals(first->getLast()->getBeat(), 199.f);
+
+            // edit the event #150, so that only the last chunks are copied
+            events.set(150, new Note(nullptr, 62, 150.f, 2.f, 0.5f), true);
+            events.add(new Note(nullptr, 60, 200.f, 1.f, 0.5f));
+
+            const SequenceSnapshot::Ptr second(new SequenceSnapshot(first.get(), 150, events));
+            expectEquals(second->size(), 201);
+            expectEquals(second->countSharedChunks(*first), 2);
+
+            // the previous snapshot is intact
+            expectEquals(first->size(), 200);
+            expectEquals(static_cast<const Note *>(first->getUnchecked(150))->getKey(), 60);
+            expectEquals(static_cast<const Note *>(second->getUnchecked(150))->getKey(), 62);
+
+            int numVisited = 0;
+            second->forEach([&numVisited](const MidiEvent &)
+            {
+                numVisited++;
+            });
+
+            expectEquals(numVisited, 201);
+        }
+    }
+};
+
+static SequenceSnapshotTests sequenceSnapshotTests;
+
+#endif
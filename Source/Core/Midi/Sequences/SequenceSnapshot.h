@@ -0,0 +1,109 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "MidiEvent.h"
+
+// An immutable copy of the sequence's events, which the background threads,
+// like the VCS diff or the renderer, can hold and read for as long as they
+// need, while the message thread keeps editing the sequence itself.
+
+// The copies are stored in the fixed size chunks, and each new snapshot
+// shares all the chunks before the first event edited since the previous
+// one, so the edits near the end of a long track only copy a few events,
+// and a sequence which hasn't changed just returns the same snapshot;
+// each chunk places its copies in a single block of memory, which is
+// allocated and freed at once, instead of the allocation per event.
+
+// The sequence keeps its last published snapshot, so the readers never
+// wait for the message thread, and each new snapshot only copies the chunks
+// touched since the previous one; the older ones are freed as soon as
+// the readers are done with them.
+
+class SequenceSnapshot final
+{
+public:
+
+    // the readers may release it on any thread, hence the shared_ptr,
+    // which the sequence publishes and the readers pick up atomically
+    using Ptr = std::shared_ptr<const SequenceSnapshot>;
+
+    SequenceSnapshot() = default;
+
+    // copies the events starting from firstOutdatedIndex,
+    // and takes the chunks before it from the previous snapshot
+    SequenceSnapshot(const SequenceSnapshot *previous,
+        int firstOutdatedIndex, const OwnedArray<MidiEvent> &events);
+
+    inline int size() const noexcept { return this->numEvents; }
+    inline bool isEmpty() const noexcept { return this->numEvents == 0; }
+
+    inline const MidiEvent *getUnchecked(int index) const noexcept
+    {
+        return this->chunks.getObjectPointerUnchecked(index / chunkSize)->
+            events[index % chunkSize];
+    }
+
+    inline const MidiEvent *getFirst() const noexcept
+    {
+        return this->numEvents > 0 ? this->getUnchecked(0) : nullptr;
+    }
+
+    inline const MidiEvent *getLast() const noexcept
+    {
+        return this->numEvents > 0 ? this->getUnchecked(this->numEvents - 1) : nullptr;
+    }
+
+    template <typename F>
+    void forEach(F &&callback) const
+    {
+        for (const auto *chunk : this->chunks)
+        {
+            for (int i = 0; i < chunk->numEvents; ++i)
+            {
+                callback(*chunk->events[i]);
+            }
+        }
+    }
+
+    // how many chunks are shared with the given snapshot
+    int countSharedChunks(const SequenceSnapshot &other) const noexcept;
+
+private:
+
+    static constexpr int chunkSize = 64;
+
+    struct Chunk final : public ReferenceCountedObject
+    {
+        explicit Chunk(int numEventsToAllocate);
+        ~Chunk();
+
+        void add(const MidiEvent &event);
+
+        HeapBlock<char> storage;
+        MidiEvent *events[chunkSize];
+        int numEvents = 0;
+
+        JUCE_DECLARE_NON_COPYABLE(Chunk)
+    };
+
+    ReferenceCountedArray<Chunk> chunks;
+    int numEvents = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SequenceSnapshot)
+};
@@ -62,7 +62,10 @@ void TimeSignaturesSequence::exportMidi(MidiMessageSequence &outSequence,
     double timeFactor /*= 1.0*/) const
 {
     // This method pretty much duplicates the base method, except for
-    // emitting the "virtual" metronome track, if it's needed
+    // emitting the "virtual" metronome track, if it's needed;
+    // it might be called from the renderer thread, hence the snapshot
+    const auto snapshot = this->getSnapshot();
+
     if (exportMetronome)
     {
         // I'm too lazy to take timeFactor into account here,
@@ -89,7 +92,7 @@ void TimeSignaturesSequence::exportMidi(MidiMessageSequence &outSequence,
             // Synthesiser class automatically stops/starts the voices when the same note repeats
         };
 
-        if (this->midiEvents.isEmpty())
+        if (snapshot->isEmpty())
         {
             int syllableIndex = 0;
             const MetronomeScheme defaultScheme;
@@ -100,7 +103,7 @@ void TimeSignaturesSequence::exportMidi(MidiMessageSequence &outSequence,
         }
         else
         {
-            const auto *firstEvent = static_cast<const TimeSignatureEvent *>(this->midiEvents.getFirst());
+            const auto *firstEvent = static_cast<const TimeSignatureEvent *>(snapshot->getFirst());
             jassert(firstEvent->getBeat() >= projectFirstBeat);
 
             {
@@ -115,11 +118,11 @@ void TimeSignaturesSequence::exportMidi(MidiMessageSequence &outSequence,
                 }
             }
 
-            for (int i = 0; i < this->midiEvents.size(); ++i)
+            for (int i = 0; i < snapshot->size(); ++i)
             {
-                const auto *event = static_cast<const TimeSignatureEvent *>(this->midiEvents.getUnchecked(i));
-                const auto nextBeat = (i < this->midiEvents.size() - 1) ?
-                    this->midiEvents.getUnchecked(i + 1)->getBeat() : projectLastBeat;
+                const auto *event = static_cast<const TimeSignatureEvent *>(snapshot->getUnchecked(i));
+                const auto nextBeat = (i < snapshot->size() - 1) ?
+                    snapshot->getUnchecked(i + 1)->getBeat() : projectLastBeat;
 
                 int syllableIndex = 0;
                 const auto metronomeScheme = event->getMeter().getMetronome();
@@ -134,10 +137,10 @@ void TimeSignaturesSequence::exportMidi(MidiMessageSequence &outSequence,
         }
     }
 
-    for (const auto *event : this->midiEvents)
+    snapshot->forEach([&](const MidiEvent &event)
     {
-        event->exportMessages(outSequence, clip, keyMap, timeFactor);
-    }
+        event.exportMessages(outSequence, clip, keyMap, timeFactor);
+    });
 
     outSequence.updateMatchedPairs();
 }
@@ -157,7 +160,8 @@ MidiEvent *TimeSignaturesSequence::insert(const TimeSignatureEvent &eventParams,
     else
     {
         auto *ownedEvent = new TimeSignatureEvent(this, eventParams);
-        this->midiEvents.addSorted(*ownedEvent, ownedEvent);
+        const auto index = this->midiEvents.addSorted(*ownedEvent, ownedEvent);
+        this->invalidateSnapshotFrom(index);
         this->eventDispatcher.dispatchAddEvent(*ownedEvent);
         this->updateBeatRange(true);
         return ownedEvent;
@@ -170,6 +174,7 @@ MidiEvent *TimeSignaturesSequence::appendUnsafe(const TimeSignatureEvent &eventP
 {
     auto *ownedEvent = new TimeSignatureEvent(this, eventParams);
     this->midiEvents.add(ownedEvent);
+    this->invalidateSnapshotFrom(this->midiEvents.size() - 1);
     this->eventDispatcher.dispatchAddEvent(*ownedEvent);
     this->updateBeatRange(true);
     return ownedEvent;
@@ -191,6 +196,7 @@ bool TimeSignaturesSequence::remove(const TimeSignatureEvent &signature, bool un
             auto *removedEvent = this->midiEvents.getUnchecked(index);
             this->eventDispatcher.dispatchRemoveEvent(*removedEvent);
             this->midiEvents.remove(index, true);
+            this->invalidateSnapshotFrom(index);
             this->updateBeatRange(true);
             this->eventDispatcher.dispatchPostRemoveEvent(this);
             return true;
@@ -219,7 +225,8 @@ bool TimeSignaturesSequence::change(const TimeSignatureEvent &oldParams,
             auto *changedEvent = static_cast<TimeSignatureEvent *>(this->midiEvents.getUnchecked(index));
             changedEvent->applyChanges(newParams);
             this->midiEvents.remove(index, false);
-            this->midiEvents.addSorted(*changedEvent, changedEvent);
+            const auto newIndex = this->midiEvents.addSorted(*changedEvent, changedEvent);
+            this->invalidateSnapshotFrom(jmin(index, newIndex));
             this->eventDispatcher.dispatchChangeEvent(oldParams, *changedEvent);
             this->updateBeatRange(true);
             return true;
@@ -303,4 +310,5 @@ void TimeSignaturesSequence::reset()
 {
     this->midiEvents.clear();
     this->usedEventIds.clear();
+    this->invalidateSnapshotFrom(0);
 }
@@ -150,6 +150,7 @@ namespace Serialization
         static const Identifier node = "node";
         static const Identifier nodeId = "id";
         static const Identifier nodeHash = "hash";
+        static const Identifier nodeLoadTime = "loadTime"; // not saved, shown in the instrument editor
         static const Identifier sourceNodeId = "sourceNodeId";
         static const Identifier destinationNodeId = "destinationNodeId";
         static const Identifier sourceChannel = "sourceChannel";
@@ -181,8 +182,20 @@ namespace Serialization
         static const Identifier midiInputReadjusting = "midiInputReadjusting";
         static const Identifier midiOutputName = "midiOutputName";
         static const Identifier midiOutputId = "midiOutputId";
+        static const Identifier midiOutputLatency = "midiOutputLatency";
+        static const Identifier midiOutputLatencyMs = "latencyMs";
+        static const Identifier midiClockOutput = "midiClockOutput";
+        static const Identifier midiTimecodeOutput = "midiTimecodeOutput";
+        static const Identifier midiClockInput = "midiClockInput";
+
+        static const Identifier pluginSandboxing = "pluginSandboxing";
 
         static const Identifier pluginsList = "plugins";
+        static const Identifier pluginsScanCache = "scanCache";
+        static const Identifier scannedFile = "scannedFile";
+        static const Identifier scannedFileSize = "size";
+        static const Identifier scannedNumPlugins = "numPlugins";
+        static const Identifier scanResult = "result";
         static const Identifier audioCore = "audioCore";
         static const Identifier orchestra = "orchestra";
 
@@ -208,6 +221,9 @@ namespace Serialization
             static const Identifier soundFontConfig = "soundFontPlayer";
             static const Identifier filePath = "filePath";
             static const Identifier programIndex = "programIndex";
+            static const Identifier polyphony = "polyphony";
+            static const Identifier liveInterpolation = "liveInterpolation";
+            static const Identifier renderInterpolation = "renderInterpolation";
         } // namespace SoundFont
     } // namespace Audio
 
@@ -631,6 +647,8 @@ namespace Serialization
     {
         static const Identifier undoStack = "undoStack";
         static const Identifier transaction = "transaction";
+        static const Identifier journalSize = "journalSize";
+        static const Identifier journalLastRecord = "journalLastRecord";
 
         static const Identifier name = "name";
         static const Identifier xPath = "path";
@@ -18,12 +18,211 @@
 #include "Common.h"
 #include "SerializedData.h"
 
+// The serialized trees are mostly built and dropped as a whole, e.g. a track's
+// VCS delta has a node per note, so the nodes are taken from the slabs of
+// a few hundred nodes each, instead of allocating them one by one;
+// each slab keeps its own free list and the count of the nodes in use,
+// and each node is prefixed with its slab pointer, so that a slab which
+// becomes fully free is returned to the heap, except for a few of them
+// cached for the next tree; the pool itself is never deleted, so that
+// it is still valid for any static trees destroyed after it
+template <typename T, int nodesPerSlab>
+class SerializedDataNodePool final
+{
+public:
+
+    // the fully free slabs kept for reuse, the rest are freed
+    static constexpr int maxFreeSlabs = 4;
+
+    void *allocate()
+    {
+        const SpinLock::ScopedLockType lock(this->poolLock);
+
+        if (this->availableSlabs == nullptr)
+        {
+            this->linkSlab(this->createSlab());
+            this->numFreeSlabs++;
+        }
+
+        auto *slab = this->availableSlabs;
+        if (slab->numUsedNodes == 0)
+        {
+            this->numFreeSlabs--;
+        }
+
+        auto *node = slab->freeList;
+        slab->freeList = node->next;
+        slab->numUsedNodes++;
+
+        if (slab->freeList == nullptr)
+        {
+            this->unlinkSlab(slab); // full now
+        }
+
+        return node;
+    }
+
+    void deallocate(void *ptr) noexcept
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+
+        auto *slab = *reinterpret_cast<Slab **>(static_cast<char *>(ptr) - nodeHeaderSize);
+        Slab *slabToFree = nullptr;
+
+        {
+            const SpinLock::ScopedLockType lock(this->poolLock);
+
+            if (slab->freeList == nullptr)
+            {
+                this->linkSlab(slab); // was full
+            }
+
+            auto *node = static_cast<FreeNode *>(ptr);
+            node->next = slab->freeList;
+            slab->freeList = node;
+            slab->numUsedNodes--;
+
+            if (slab->numUsedNodes == 0)
+            {
+                if (this->numFreeSlabs < maxFreeSlabs)
+                {
+                    this->numFreeSlabs++;
+                }
+                else
+                {
+                    this->unlinkSlab(slab);
+                    this->numSlabs--;
+                    slabToFree = slab;
+                }
+            }
+        }
+
+        std::free(slabToFree);
+    }
+
+    int getNumSlabs() const noexcept
+    {
+        const SpinLock::ScopedLockType lock(this->poolLock);
+        return this->numSlabs;
+    }
+
+private:
+
+    struct FreeNode final
+    {
+        FreeNode *next;
+    };
+
+    struct Slab final
+    {
+        Slab *previous;
+        Slab *next;
+        FreeNode *freeList;
+        int numUsedNodes;
+    };
+
+    static constexpr size_t nodeAlignment = alignof(std::max_align_t);
+    static constexpr size_t nodeHeaderSize = (sizeof(Slab *) +
+        nodeAlignment - 1) / nodeAlignment * nodeAlignment;
+    static constexpr size_t nodeSize = nodeHeaderSize + (jmax(sizeof(T), sizeof(FreeNode)) +
+        nodeAlignment - 1) / nodeAlignment * nodeAlignment;
+    static constexpr size_t slabHeaderSize = (sizeof(Slab) +
+        nodeAlignment - 1) / nodeAlignment * nodeAlignment;
+
+    Slab *createSlab()
+    {
+        auto *memory = static_cast<char *>(std::malloc(slabHeaderSize + nodeSize * nodesPerSlab));
+        if (memory == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        auto *slab = reinterpret_cast<Slab *>(memory);
+        slab->previous = nullptr;
+        slab->next = nullptr;
+        slab->freeList = nullptr;
+        slab->numUsedNodes = 0;
+
+        for (int i = nodesPerSlab; --i >= 0;)
+        {
+            auto *header = memory + slabHeaderSize + i * nodeSize;
+            *reinterpret_cast<Slab **>(header) = slab;
+            auto *node = reinterpret_cast<FreeNode *>(header + nodeHeaderSize);
+            node->next = slab->freeList;
+            slab->freeList = node;
+        }
+
+        this->numSlabs++;
+        return slab;
+    }
+
+    // the slabs with any free nodes are in the list, the full ones are not
+    void linkSlab(Slab *slab) noexcept
+    {
+        slab->previous = nullptr;
+        slab->next = this->availableSlabs;
+        if (this->availableSlabs != nullptr)
+        {
+            this->availableSlabs->previous = slab;
+        }
+
+        this->availableSlabs = slab;
+    }
+
+    void unlinkSlab(Slab *slab) noexcept
+    {
+        if (slab->previous != nullptr)
+        {
+            slab->previous->next = slab->next;
+        }
+        else
+        {
+            this->availableSlabs = slab->next;
+        }
+
+        if (slab->next != nullptr)
+        {
+            slab->next->previous = slab->previous;
+        }
+
+        slab->previous = nullptr;
+        slab->next = nullptr;
+    }
+
+    Slab *availableSlabs = nullptr;
+    int numSlabs = 0;
+    int numFreeSlabs = 0;
+    mutable SpinLock poolLock;
+};
+
 class SerializedData::SharedData final : public ReferenceCountedObject
 {
 public:
 
     using Ptr = ReferenceCountedObjectPtr<SharedData>;
 
+    static void *operator new(size_t size)
+    {
+        jassert(size == sizeof(SharedData));
+        return getPool().allocate();
+    }
+
+    static void operator delete(void *ptr) noexcept
+    {
+        getPool().deallocate(ptr);
+    }
+
+    using Pool = SerializedDataNodePool<SharedData, 256>;
+    static Pool &getPool()
+    {
+        // never deleted, see the comment above
+        static auto *pool = new Pool();
+        return *pool;
+    }
+
     explicit SharedData(const Identifier &t) noexcept : type(t) {}
 
     SharedData(const SharedData &other) :
@@ -462,3 +661,139 @@ SerializedData SerializedData::readFromData(const void *data, size_t numBytes)
     MemoryInputStream in(data, numBytes, false);
     return readFromStream(in);
 }
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+#include "RealtimeSafety.h"
+
+class SerializedDataTests final : public UnitTest
+{
+public:
+    SerializedDataTests() : UnitTest("Serialized data tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        const Identifier rootType("root");
+        const Identifier nodeType("node");
+        const Identifier beatProperty("beat");
+        const Identifier keyProperty("key");
+
+        beginTest("Pooled nodes are reused");
+        {
+            SerializedData root(rootType);
+            for (int i = 0; i < 1000; ++i)
+            {
+                root.appendChild(SerializedData(nodeType).setProperty(keyProperty, i));
+            }
+
+            const auto copy = root.createCopy();
+            expect(copy.isEquivalentTo(root));
+            expectEquals(int(copy.getChild(999).getProperty(keyProperty)), 999);
+        }
+
+        beginTest("Free slabs are returned");
+        {
+            using Pool = SerializedData::SharedData::Pool;
+            static constexpr auto numNodes = 5000;
+
+            const auto numSlabsBefore = SerializedData::SharedData::getPool().getNumSlabs();
+
+            {
+                SerializedData root(rootType);
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    root.appendChild(SerializedData(nodeType));
+                }
+
+                expectGreaterThan(SerializedData::SharedData::getPool().getNumSlabs(),
+                    numSlabsBefore + Pool::maxFreeSlabs);
+            }
+
+            expectLessOrEqual(SerializedData::SharedData::getPool().getNumSlabs(),
+                numSlabsBefore + Pool::maxFreeSlabs);
+        }
+    }
+};
+
+static SerializedDataTests serializedDataTests;
+
+// Not a part of the default test run, see UnitTestCategories::helioBenchmarks
+class SerializedDataBenchmarks final : public UnitTest
+{
+public:
+    SerializedDataBenchmarks() :
+        UnitTest("Serialized data benchmarks", UnitTestCategories::helioBenchmarks) {}
+
+    void runTest() override
+    {
+        const Identifier rootType("root");
+        const Identifier nodeType("node");
+        const Identifier beatProperty("beat");
+        const Identifier keyProperty("key");
+
+        beginTest("100K nodes tree allocation benchmark");
+        {
+            static constexpr auto numNodes = 100000;
+
+            // the heap calls are counted as the violations within a realtime region,
+            // and the baseline is the same properties set up without the nodes,
+            // which is the part of each node that the pool doesn't cover
+            const auto previousPolicy = RealtimeSafety::getPolicy();
+            RealtimeSafety::setPolicy(RealtimeSafety::Policy::ignore);
+
+            const auto numBaselineCallsBefore = RealtimeSafety::getNumViolations();
+
+            {
+                const RealtimeSafety::ScopedRealtimeRegion region;
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    NamedValueSet properties;
+                    properties.set(beatProperty, float(i));
+                    properties.set(keyProperty, i % 128);
+                }
+            }
+
+            const auto numBaselineCalls = RealtimeSafety::getNumViolations() - numBaselineCallsBefore;
+
+            const auto numSlabsBefore = SerializedData::SharedData::getPool().getNumSlabs();
+            const auto numHeapCallsBefore = RealtimeSafety::getNumViolations();
+            const auto timeMs = Time::getMillisecondCounterHiRes();
+
+            {
+                const RealtimeSafety::ScopedRealtimeRegion region;
+                SerializedData root(rootType);
+                for (int i = 0; i < numNodes; ++i)
+                {
+                    SerializedData node(nodeType);
+                    node.setProperty(beatProperty, float(i));
+                    node.setProperty(keyProperty, i % 128);
+                    root.appendChild(node);
+                }
+            }
+
+            const auto elapsedMs = Time::getMillisecondCounterHiRes() - timeMs;
+            const auto numHeapCalls = RealtimeSafety::getNumViolations() - numHeapCallsBefore;
+            const auto numSlabsAfter = SerializedData::SharedData::getPool().getNumSlabs();
+            RealtimeSafety::setPolicy(previousPolicy);
+
+            logMessage("Built and freed " + String(numNodes) + " nodes in " +
+                String(elapsedMs, 2) + " ms, with " + String(numHeapCalls) +
+                " heap calls against the baseline of " + String(numBaselineCalls) +
+                ", and " + String(numSlabsAfter - numSlabsBefore) + " slabs left cached");
+
+            // what's on top of the baseline is the slabs, allocated and freed,
+            // and the root's children array growing, so it's a fraction of a call per node
+            expectLessThan(numHeapCalls - numBaselineCalls, numNodes / 10);
+            expectLessOrEqual(numSlabsAfter - numSlabsBefore,
+                SerializedData::SharedData::Pool::maxFreeSlabs);
+        }
+    }
+};
+
+static SerializedDataBenchmarks serializedDataBenchmarks;
+
+#endif
@@ -93,6 +93,8 @@ private:
     ReferenceCountedObjectPtr<SharedData> data;
     
     friend class SharedData;
+    friend class SerializedDataTests;
+    friend class SerializedDataBenchmarks;
     explicit SerializedData(ReferenceCountedObjectPtr<SharedData>) noexcept;
     explicit SerializedData(SharedData &) noexcept;
 };
@@ -248,11 +248,14 @@ SerializedData AutomationTrackNode::serializeEventsDelta() const
 {
     SerializedData tree(Serialization::VCS::AutoSequenceDeltas::eventsAdded);
 
-    for (int i = 0; i < this->getSequence()->size(); ++i)
+    // called from the VCS thread as well, hence the snapshot,
+    // which is not available if that thread is being stopped
+    const auto snapshot = this->getSequence()->getSnapshot();
+
+    snapshot->forEach([&tree](const MidiEvent &event)
     {
-        const MidiEvent *event = this->getSequence()->getUnchecked(i);
-        tree.appendChild(event->serialize());
-    }
+        tree.appendChild(event.serialize());
+    });
 
     return tree;
 }
@@ -67,6 +67,9 @@ void InstrumentNode::showPage()
         return;
     }
 
+    // the editor will be updated when the nodes are loaded:
+    this->instrument->loadIfNeeded();
+
     App::Layout().showPage(this->instrumentEditor.get(), this);
 }
 
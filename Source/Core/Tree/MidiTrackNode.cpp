@@ -429,6 +429,31 @@ void MidiTrackNode::dispatchPostRemoveEvent(MidiSequence *const layer)
     }
 }
 
+void MidiTrackNode::dispatchAddEvents(const MidiEventsBatch &events)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastAddEvents(events);
+    }
+}
+
+void MidiTrackNode::dispatchChangeEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastChangeEvents(oldEvents, newEvents);
+    }
+}
+
+void MidiTrackNode::dispatchRemoveEvents(const MidiEventsBatch &events)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastRemoveEvents(events);
+    }
+}
+
 void MidiTrackNode::dispatchChangeTrackProperties()
 {
     if (this->lastFoundParent != nullptr)
@@ -486,6 +511,30 @@ void MidiTrackNode::dispatchPostRemoveClip(Pattern *const pattern)
     }
 }
 
+void MidiTrackNode::dispatchAddClips(const ClipsBatch &clips)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastAddClips(clips);
+    }
+}
+
+void MidiTrackNode::dispatchChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastChangeClips(oldClips, newClips);
+    }
+}
+
+void MidiTrackNode::dispatchRemoveClips(const ClipsBatch &clips)
+{
+    if (this->lastFoundParent != nullptr)
+    {
+        this->lastFoundParent->broadcastRemoveClips(clips);
+    }
+}
+
 ProjectNode *MidiTrackNode::getProject() const noexcept
 {
     jassert(this->lastFoundParent != nullptr);
@@ -92,11 +92,19 @@ public:
     void dispatchRemoveEvent(const MidiEvent &event) override;
     void dispatchPostRemoveEvent(MidiSequence *const layer) override;
 
+    void dispatchAddEvents(const MidiEventsBatch &events) override;
+    void dispatchChangeEvents(const MidiEventsBatch &oldEvents, const MidiEventsBatch &newEvents) override;
+    void dispatchRemoveEvents(const MidiEventsBatch &events) override;
+
     void dispatchAddClip(const Clip &clip) override;
     void dispatchChangeClip(const Clip &oldClip, const Clip &newClip) override;
     void dispatchRemoveClip(const Clip &clip) override;
     void dispatchPostRemoveClip(Pattern *const pattern) override;
 
+    void dispatchAddClips(const ClipsBatch &clips) override;
+    void dispatchChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips) override;
+    void dispatchRemoveClips(const ClipsBatch &clips) override;
+
     void dispatchChangeTrackProperties() override;
     void dispatchChangeTrackBeatRange() override;
     void dispatchChangeProjectBeatRange() override;
@@ -237,11 +237,15 @@ void PianoTrackNode::deserialize(const SerializedData &data)
 SerializedData PianoTrackNode::serializeEventsDelta() const
 {
     SerializedData tree(Serialization::VCS::PianoSequenceDeltas::notesAdded);
-    for (int i = 0; i < this->getSequence()->size(); ++i)
+
+    // called from the VCS thread as well, hence the snapshot,
+    // which is not available if that thread is being stopped
+    const auto snapshot = this->getSequence()->getSnapshot();
+
+    snapshot->forEach([&tree](const MidiEvent &event)
     {
-        const MidiEvent *event = this->getSequence()->getUnchecked(i);
-        tree.appendChild(event->serialize());
-    }
+        tree.appendChild(event.serialize());
+    });
 
     return tree;
 }
@@ -38,12 +38,21 @@ public:
     virtual void dispatchRemoveEvent(const MidiEvent &event) = 0;
     virtual void dispatchPostRemoveEvent(MidiSequence *const sequence) = 0;
 
+    // Group edits, see the batch callbacks in ProjectListener
+    virtual void dispatchAddEvents(const MidiEventsBatch &events) = 0;
+    virtual void dispatchChangeEvents(const MidiEventsBatch &oldEvents, const MidiEventsBatch &newEvents) = 0;
+    virtual void dispatchRemoveEvents(const MidiEventsBatch &events) = 0;
+
     // Patterns and clips
     virtual void dispatchAddClip(const Clip &clip) = 0;
     virtual void dispatchChangeClip(const Clip &oldClip, const Clip &newClip) = 0;
     virtual void dispatchRemoveClip(const Clip &clip) = 0;
     virtual void dispatchPostRemoveClip(Pattern *const pattern) = 0;
 
+    virtual void dispatchAddClips(const ClipsBatch &clips) = 0;
+    virtual void dispatchChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips) = 0;
+    virtual void dispatchRemoveClips(const ClipsBatch &clips) = 0;
+
     // Sent on lightweight changes like mute/unmute, instrument change
     virtual void dispatchChangeTrackProperties() = 0;
     virtual void dispatchChangeTrackBeatRange() = 0;
@@ -63,11 +72,19 @@ public:
     void dispatchRemoveEvent(const MidiEvent &event) noexcept override {}
     void dispatchPostRemoveEvent(MidiSequence *const layer) noexcept override {}
 
+    void dispatchAddEvents(const MidiEventsBatch &events) noexcept override {}
+    void dispatchChangeEvents(const MidiEventsBatch &oldEvents, const MidiEventsBatch &newEvents) noexcept override {}
+    void dispatchRemoveEvents(const MidiEventsBatch &events) noexcept override {}
+
     void dispatchAddClip(const Clip &clip) noexcept override {}
     void dispatchChangeClip(const Clip &oldClip, const Clip &newClip) noexcept override {}
     void dispatchRemoveClip(const Clip &clip) noexcept override {}
     void dispatchPostRemoveClip(Pattern *const pattern) noexcept override {}
 
+    void dispatchAddClips(const ClipsBatch &clips) noexcept override {}
+    void dispatchChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips) noexcept override {}
+    void dispatchRemoveClips(const ClipsBatch &clips) noexcept override {}
+
     void dispatchChangeTrackProperties() noexcept override {}
     void dispatchChangeProjectBeatRange() noexcept override {}
     void dispatchChangeTrackBeatRange() noexcept override {}
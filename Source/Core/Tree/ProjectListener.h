@@ -24,6 +24,13 @@ class Pattern;
 class Clip;
 class ProjectMetadata;
 
+// The group edits are sent as batches of pointers, which are only valid
+// during the callback; all items of a batch belong to the same sequence
+// or pattern, and in the change callbacks, both batches are of the same
+// size, and the new items are at the same indices as the old ones
+using MidiEventsBatch = Array<const MidiEvent *>;
+using ClipsBatch = Array<const Clip *>;
+
 class ProjectListener
 {
 public:
@@ -36,11 +43,65 @@ public:
     virtual void onRemoveMidiEvent(const MidiEvent &event) = 0;
     virtual void onPostRemoveMidiEvent(MidiSequence *const layer) {}
 
+    // Sent once per group edit instead of the callbacks above; by default,
+    // these just fall back to them, so only override them when a listener
+    // can do better than handling the same group one event at a time
+    virtual void onAddMidiEvents(const MidiEventsBatch &events)
+    {
+        for (const auto *event : events)
+        {
+            this->onAddMidiEvent(*event);
+        }
+    }
+
+    virtual void onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+        const MidiEventsBatch &newEvents)
+    {
+        jassert(oldEvents.size() == newEvents.size());
+        for (int i = 0; i < newEvents.size(); ++i)
+        {
+            this->onChangeMidiEvent(*oldEvents.getUnchecked(i), *newEvents.getUnchecked(i));
+        }
+    }
+
+    virtual void onRemoveMidiEvents(const MidiEventsBatch &events)
+    {
+        for (const auto *event : events)
+        {
+            this->onRemoveMidiEvent(*event);
+        }
+    }
+
     virtual void onAddClip(const Clip &clip) = 0;
     virtual void onChangeClip(const Clip &oldClip, const Clip &newClip) = 0;
     virtual void onRemoveClip(const Clip &clip) = 0;
     virtual void onPostRemoveClip(Pattern *const pattern) {}
 
+    virtual void onAddClips(const ClipsBatch &clips)
+    {
+        for (const auto *clip : clips)
+        {
+            this->onAddClip(*clip);
+        }
+    }
+
+    virtual void onChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips)
+    {
+        jassert(oldClips.size() == newClips.size());
+        for (int i = 0; i < newClips.size(); ++i)
+        {
+            this->onChangeClip(*oldClips.getUnchecked(i), *newClips.getUnchecked(i));
+        }
+    }
+
+    virtual void onRemoveClips(const ClipsBatch &clips)
+    {
+        for (const auto *clip : clips)
+        {
+            this->onRemoveClip(*clip);
+        }
+    }
+
     virtual void onAddTrack(MidiTrack *const track) = 0;
     virtual void onRemoveTrack(MidiTrack *const track) = 0;
     virtual void onChangeTrackProperties(MidiTrack *const track) = 0;
@@ -286,6 +286,8 @@ void ProjectNode::setEditableScope(const Clip &activeClip, bool shouldFocusToAre
         // so that roll's scope is updated twice :(
         this->changeListeners.call(&ProjectListener::onChangeViewEditableScope,
             activeTrack, activeClip, shouldFocusToArea);
+        this->callAllTrackListeners(&ProjectListener::onChangeViewEditableScope,
+            activeTrack, activeClip, shouldFocusToArea);
 
         this->setMidiRecordingTarget(&activeClip);
     }
@@ -428,28 +430,13 @@ Range<float> ProjectNode::getProjectBeatRange() const
 
 Range<float> ProjectNode::calculateProjectBeatRange() const
 {
-    float lastBeat = -FLT_MAX;
-    float firstBeat = FLT_MAX;
-
     this->rebuildTracksRefsCacheIfNeeded();
 
-    for (const auto &i : this->tracksRefsCache)
-    {
-        const auto *track = i.second.get();
-        if (track->getSequence()->isEmpty())
-        {
-            // ignore empty tracks as they affect the project range in a misleading way
-            continue;
-        }
+    // ignore empty tracks as they affect the project range in a misleading way,
+    // they are just not present in the aggregate
+    float firstBeat = this->tracksFirstBeats.empty() ? FLT_MAX : *this->tracksFirstBeats.begin();
+    float lastBeat = this->tracksLastBeats.empty() ? -FLT_MAX : *this->tracksLastBeats.rbegin();
 
-        const float sequenceFirstBeat = track->getSequence()->getFirstBeat();
-        const float sequenceLastBeat = track->getSequence()->getLastBeat();
-        const float patternFirstBeat = track->getPattern() ? track->getPattern()->getFirstBeat() : 0.f;
-        const float patternLastBeat = track->getPattern() ? track->getPattern()->getLastBeat() : 0.f;
-        firstBeat = jmin(firstBeat, sequenceFirstBeat + patternFirstBeat);
-        lastBeat = jmax(lastBeat, sequenceLastBeat + patternLastBeat);
-    }
-    
     if (firstBeat == FLT_MAX)
     {
         firstBeat = 0;
@@ -467,6 +454,51 @@ Range<float> ProjectNode::calculateProjectBeatRange() const
     return { firstBeat, lastBeat };
 }
 
+void ProjectNode::insertTrackBeatRange(const MidiTrack *track) const
+{
+    const auto *sequence = track->getSequence();
+    if (sequence->isEmpty())
+    {
+        return;
+    }
+
+    const auto *pattern = track->getPattern();
+    const float patternFirstBeat = pattern != nullptr ? pattern->getFirstBeat() : 0.f;
+    const float patternLastBeat = pattern != nullptr ? pattern->getLastBeat() : 0.f;
+
+    const TrackBeatRange range{ sequence->getFirstBeat() + patternFirstBeat,
+        sequence->getLastBeat() + patternLastBeat };
+
+    this->trackBeatRanges[track->getTrackId()] = range;
+    this->tracksFirstBeats.insert(range.firstBeat);
+    this->tracksLastBeats.insert(range.lastBeat);
+}
+
+void ProjectNode::eraseTrackBeatRange(const String &trackId) const
+{
+    const auto found = this->trackBeatRanges.find(trackId);
+    if (found == this->trackBeatRanges.end())
+    {
+        return;
+    }
+
+    // erase a single instance, the other tracks may have the same beats
+    this->tracksFirstBeats.erase(this->tracksFirstBeats.find(found->second.firstBeat));
+    this->tracksLastBeats.erase(this->tracksLastBeats.find(found->second.lastBeat));
+    this->trackBeatRanges.erase(found);
+}
+
+void ProjectNode::updateTrackBeatRange(const MidiTrack *track)
+{
+    if (this->isTracksCacheOutdated)
+    {
+        return; // will be rebuilt anyway
+    }
+
+    this->eraseTrackBeatRange(track->getTrackId());
+    this->insertTrackBeatRange(track);
+}
+
 StringArray ProjectNode::getAllTrackNames() const
 {
     StringArray names;
@@ -535,7 +567,7 @@ void ProjectNode::reset()
     this->vcsItems.clear();
     this->vcsItems.add(this->metadata.get());
     this->vcsItems.add(this->timeline.get());
-    this->undoStack->clearUndoHistory();
+    this->undoStack->reset();
     TreeNode::reset();
 }
 
@@ -723,8 +755,98 @@ void ProjectNode::removeAllListeners()
 {
     jassert(MessageManager::getInstance()->currentThreadHasLockedMessageManager());
     this->changeListeners.clear();
+    jassert(this->trackListenersCallDepth == 0);
+    this->trackListeners.clear();
+    this->pendingTrackListeners.clearQuick();
+    this->hasEmptyTrackListeners = false;
+}
+
+void ProjectNode::addTrackListener(const String &trackId, ProjectListener *listener)
+{
+    jassert(MessageManager::getInstance()->currentThreadHasLockedMessageManager());
+
+    const auto found = this->trackListeners.find(trackId);
+    if (found != this->trackListeners.end())
+    {
+        found->second->add(listener);
+    }
+    else if (this->trackListenersCallDepth > 0)
+    {
+        // adding a list might rehash the map being iterated
+        this->pendingTrackListeners.add({ trackId, listener });
+    }
+    else
+    {
+        auto list = make<TrackListeners>();
+        list->add(listener);
+        this->trackListeners[trackId] = move(list);
+    }
 }
 
+void ProjectNode::removeTrackListener(const String &trackId, ProjectListener *listener)
+{
+    jassert(MessageManager::getInstance()->currentThreadHasLockedMessageManager());
+
+    for (int i = this->pendingTrackListeners.size(); --i >= 0;)
+    {
+        const auto &pending = this->pendingTrackListeners.getReference(i);
+        if (pending.second == listener && pending.first == trackId)
+        {
+            this->pendingTrackListeners.remove(i);
+        }
+    }
+
+    const auto found = this->trackListeners.find(trackId);
+    if (found == this->trackListeners.end())
+    {
+        return;
+    }
+
+    found->second->remove(listener);
+    if (!found->second->isEmpty())
+    {
+        return;
+    }
+
+    if (this->trackListenersCallDepth > 0)
+    {
+        // the list might be the one being called
+        this->hasEmptyTrackListeners = true;
+    }
+    else
+    {
+        this->trackListeners.erase(found);
+    }
+}
+
+void ProjectNode::endTrackListenersCall()
+{
+    jassert(this->trackListenersCallDepth > 0);
+    if (--this->trackListenersCallDepth > 0)
+    {
+        return;
+    }
+
+    if (this->hasEmptyTrackListeners)
+    {
+        this->hasEmptyTrackListeners = false;
+        for (auto it = this->trackListeners.begin(); it != this->trackListeners.end();)
+        {
+            it = it->second->isEmpty() ? this->trackListeners.erase(it) : std::next(it);
+        }
+    }
+
+    if (!this->pendingTrackListeners.isEmpty())
+    {
+        // moved out first, since adding them goes through the same checks
+        const auto pending = move(this->pendingTrackListeners);
+        this->pendingTrackListeners.clearQuick();
+        for (const auto &it : pending)
+        {
+            this->addTrackListener(it.first, it.second);
+        }
+    }
+}
 
 //===----------------------------------------------------------------------===//
 // Broadcaster
@@ -734,27 +856,72 @@ void ProjectNode::broadcastChangeEvent(const MidiEvent &oldEvent, const MidiEven
 {
     //jassert(oldEvent.isValid()); // old event is allowed to be un-owned
     jassert(newEvent.isValid());
-    this->changeListeners.call(&ProjectListener::onChangeMidiEvent, oldEvent, newEvent);
+    this->callTrackListeners(newEvent.getSequence()->getTrackId(),
+        &ProjectListener::onChangeMidiEvent, oldEvent, newEvent);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastAddEvent(const MidiEvent &event)
 {
     jassert(event.isValid());
-    this->changeListeners.call(&ProjectListener::onAddMidiEvent, event);
+    this->callTrackListeners(event.getSequence()->getTrackId(),
+        &ProjectListener::onAddMidiEvent, event);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastRemoveEvent(const MidiEvent &event)
 {
     jassert(event.isValid());
-    this->changeListeners.call(&ProjectListener::onRemoveMidiEvent, event);
+    this->callTrackListeners(event.getSequence()->getTrackId(),
+        &ProjectListener::onRemoveMidiEvent, event);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastPostRemoveEvent(MidiSequence *const layer)
 {
-    this->changeListeners.call(&ProjectListener::onPostRemoveMidiEvent, layer);
+    this->callTrackListeners(layer->getTrackId(),
+        &ProjectListener::onPostRemoveMidiEvent, layer);
+    this->sendChangeMessage();
+}
+
+// The batched versions only differ in that there's only one change message,
+// and only one virtual call per listener, whatever the size of the group
+
+void ProjectNode::broadcastAddEvents(const MidiEventsBatch &events)
+{
+    if (events.isEmpty())
+    {
+        return;
+    }
+
+    this->callTrackListeners(events.getFirst()->getSequence()->getTrackId(),
+        &ProjectListener::onAddMidiEvents, events);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastChangeEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    jassert(oldEvents.size() == newEvents.size());
+    if (newEvents.isEmpty())
+    {
+        return;
+    }
+
+    this->callTrackListeners(newEvents.getFirst()->getSequence()->getTrackId(),
+        &ProjectListener::onChangeMidiEvents, oldEvents, newEvents);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastRemoveEvents(const MidiEventsBatch &events)
+{
+    if (events.isEmpty())
+    {
+        return;
+    }
+
+    this->callTrackListeners(events.getFirst()->getSequence()->getTrackId(),
+        &ProjectListener::onRemoveMidiEvents, events);
     this->sendChangeMessage();
 }
 
@@ -768,13 +935,14 @@ void ProjectNode::broadcastAddTrack(MidiTrack *const track)
         this->vcsItems.addIfNotAlreadyThere(tracked);
     }
 
-    this->changeListeners.call(&ProjectListener::onAddTrack, track);
+    this->callTrackListeners(track->getTrackId(), &ProjectListener::onAddTrack, track);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastRemoveTrack(MidiTrack *const track)
 {
     this->isTracksCacheOutdated = true;
+    this->eraseTrackBeatRange(track->getTrackId());
 
     if (auto *tracked = dynamic_cast<VCS::TrackedItem *>(track))
     {
@@ -782,49 +950,90 @@ void ProjectNode::broadcastRemoveTrack(MidiTrack *const track)
         this->vcsItems.removeAllInstancesOf(tracked);
     }
 
-    this->changeListeners.call(&ProjectListener::onRemoveTrack, track);
+    this->callTrackListeners(track->getTrackId(), &ProjectListener::onRemoveTrack, track);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastChangeTrackProperties(MidiTrack *const track)
 {
-    this->changeListeners.call(&ProjectListener::onChangeTrackProperties, track);
+    this->callTrackListeners(track->getTrackId(), &ProjectListener::onChangeTrackProperties, track);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastChangeTrackBeatRange(MidiTrack *const track)
 {
-    this->changeListeners.call(&ProjectListener::onChangeTrackBeatRange, track);
+    this->updateTrackBeatRange(track);
+    this->callTrackListeners(track->getTrackId(), &ProjectListener::onChangeTrackBeatRange, track);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastAddClip(const Clip &clip)
 {
-    this->changeListeners.call(&ProjectListener::onAddClip, clip);
+    this->callTrackListeners(clip.getTrackId(), &ProjectListener::onAddClip, clip);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastChangeClip(const Clip &oldClip, const Clip &newClip)
 {
-    this->changeListeners.call(&ProjectListener::onChangeClip, oldClip, newClip);
+    this->callTrackListeners(newClip.getTrackId(),
+        &ProjectListener::onChangeClip, oldClip, newClip);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastRemoveClip(const Clip &clip)
 {
-    this->changeListeners.call(&ProjectListener::onRemoveClip, clip);
+    this->callTrackListeners(clip.getTrackId(), &ProjectListener::onRemoveClip, clip);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastPostRemoveClip(Pattern *const pattern)
 {
-    this->changeListeners.call(&ProjectListener::onPostRemoveClip, pattern);
+    this->callTrackListeners(pattern->getTrackId(),
+        &ProjectListener::onPostRemoveClip, pattern);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastAddClips(const ClipsBatch &clips)
+{
+    if (clips.isEmpty())
+    {
+        return;
+    }
+
+    this->callTrackListeners(clips.getFirst()->getTrackId(),
+        &ProjectListener::onAddClips, clips);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips)
+{
+    jassert(oldClips.size() == newClips.size());
+    if (newClips.isEmpty())
+    {
+        return;
+    }
+
+    this->callTrackListeners(newClips.getFirst()->getTrackId(),
+        &ProjectListener::onChangeClips, oldClips, newClips);
+    this->sendChangeMessage();
+}
+
+void ProjectNode::broadcastRemoveClips(const ClipsBatch &clips)
+{
+    if (clips.isEmpty())
+    {
+        return;
+    }
+
+    this->callTrackListeners(clips.getFirst()->getTrackId(),
+        &ProjectListener::onRemoveClips, clips);
     this->sendChangeMessage();
 }
 
 void ProjectNode::broadcastChangeProjectInfo(const ProjectMetadata *info)
 {
     this->changeListeners.call(&ProjectListener::onChangeProjectInfo, info);
+    this->callAllTrackListeners(&ProjectListener::onChangeProjectInfo, info);
     this->sendChangeMessage();
 }
 
@@ -843,6 +1052,8 @@ Range<float> ProjectNode::broadcastChangeProjectBeatRange()
         this->transport->onChangeProjectBeatRange(this->beatRange.getStart(), this->beatRange.getEnd());
         this->changeListeners.callExcluding(this->transport.get(),
             &ProjectListener::onChangeProjectBeatRange, this->beatRange.getStart(), this->beatRange.getEnd());
+        this->callAllTrackListeners(&ProjectListener::onChangeProjectBeatRange,
+            this->beatRange.getStart(), this->beatRange.getEnd());
 
         this->sendChangeMessage();
     }
@@ -853,6 +1064,7 @@ Range<float> ProjectNode::broadcastChangeProjectBeatRange()
 void ProjectNode::broadcastBeforeReloadProjectContent()
 {
     this->changeListeners.call(&ProjectListener::onBeforeReloadProjectContent);
+    this->callAllTrackListeners(&ProjectListener::onBeforeReloadProjectContent);
 }
 
 void ProjectNode::broadcastReloadProjectContent()
@@ -861,6 +1073,8 @@ void ProjectNode::broadcastReloadProjectContent()
 
     this->changeListeners.call(&ProjectListener::onReloadProjectContent,
         this->getTracks(), this->metadata.get());
+    this->callAllTrackListeners(&ProjectListener::onReloadProjectContent,
+        this->getTracks(), this->metadata.get());
 
     this->sendChangeMessage();
 }
@@ -868,16 +1082,19 @@ void ProjectNode::broadcastReloadProjectContent()
 void ProjectNode::broadcastActivateProjectSubtree()
 {
     this->changeListeners.call(&ProjectListener::onActivateProjectSubtree, this->metadata.get());
+    this->callAllTrackListeners(&ProjectListener::onActivateProjectSubtree, this->metadata.get());
 }
 
 void ProjectNode::broadcastDeactivateProjectSubtree()
 {
     this->changeListeners.call(&ProjectListener::onDeactivateProjectSubtree, this->metadata.get());
+    this->callAllTrackListeners(&ProjectListener::onDeactivateProjectSubtree, this->metadata.get());
 }
 
 void ProjectNode::broadcastChangeViewBeatRange(float firstBeat, float lastBeat)
 {
     this->changeListeners.call(&ProjectListener::onChangeViewBeatRange, firstBeat, lastBeat);
+    this->callAllTrackListeners(&ProjectListener::onChangeViewBeatRange, firstBeat, lastBeat);
     // this->sendChangeMessage(); the project itself didn't change, so dont call this
 }
 
@@ -905,6 +1122,7 @@ bool ProjectNode::onDocumentLoad(const File &file)
 
 bool ProjectNode::onDocumentSave(const File &file)
 {
+    this->undoStack->flushToJournal();
     const auto projectNode = this->save();
 #if DEBUG
     DocumentHelpers::save<XmlSerializer>(file.withFileExtension("xml"), projectNode);
@@ -1163,6 +1381,14 @@ void ProjectNode::rebuildTracksRefsCacheIfNeeded() const
             MidiTrack *const track = children.getUnchecked(i);
             this->tracksRefsCache[track->getTrackId()] = track;
         }
+
+        this->trackBeatRanges.clear();
+        this->tracksFirstBeats.clear();
+        this->tracksLastBeats.clear();
+        for (const auto &i : this->tracksRefsCache)
+        {
+            this->insertTrackBeatRange(i.second.get());
+        }
         
         this->isTracksCacheOutdated = false;
     }
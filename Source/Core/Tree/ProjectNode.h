@@ -133,6 +133,12 @@ public:
     void removeListener(ProjectListener *listener);
     void removeAllListeners();
 
+    // The listeners which only care about a single track, like the clip
+    // components, only get the event, clip and track notifications of that
+    // track, and all the project-wide notifications, like the global ones
+    void addTrackListener(const String &trackId, ProjectListener *listener);
+    void removeTrackListener(const String &trackId, ProjectListener *listener);
+
     //===------------------------------------------------------------------===//
     // Broadcaster
     //===------------------------------------------------------------------===//
@@ -142,16 +148,28 @@ public:
     void broadcastRemoveEvent(const MidiEvent &event);
     void broadcastPostRemoveEvent(MidiSequence *const layer);
 
+    void broadcastAddEvents(const MidiEventsBatch &events);
+    void broadcastChangeEvents(const MidiEventsBatch &oldEvents, const MidiEventsBatch &newEvents);
+    void broadcastRemoveEvents(const MidiEventsBatch &events);
+
     void broadcastAddTrack(MidiTrack *const track);
     void broadcastRemoveTrack(MidiTrack *const track);
     void broadcastChangeTrackProperties(MidiTrack *const track);
     void broadcastChangeTrackBeatRange(MidiTrack *const track);
 
+    // the timeline tracks don't broadcast their range changes,
+    // but they still count for the project range
+    void updateTrackBeatRange(const MidiTrack *track);
+
     void broadcastAddClip(const Clip &clip);
     void broadcastChangeClip(const Clip &oldClip, const Clip &newClip);
     void broadcastRemoveClip(const Clip &clip);
     void broadcastPostRemoveClip(Pattern *const pattern);
 
+    void broadcastAddClips(const ClipsBatch &clips);
+    void broadcastChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips);
+    void broadcastRemoveClips(const ClipsBatch &clips);
+
     void broadcastChangeProjectInfo(const ProjectMetadata *info);
     void broadcastChangeViewBeatRange(float firstBeat, float lastBeat);
     Range<float> broadcastChangeProjectBeatRange();
@@ -219,6 +237,46 @@ private:
     RollEditMode rollEditMode;
 
     ListenerList<ProjectListener> changeListeners;
+
+    // the map is iterated directly, so while any of the lists is being called,
+    // the new lists are only added, and the empty ones are only erased,
+    // after the outermost call returns, see endTrackListenersCall()
+    using TrackListeners = ListenerList<ProjectListener>;
+    FlatHashMap<String, UniquePointer<TrackListeners>, StringHash> trackListeners;
+    Array<std::pair<String, ProjectListener *>> pendingTrackListeners;
+    bool hasEmptyTrackListeners = false;
+    int trackListenersCallDepth = 0;
+
+    void endTrackListenersCall();
+
+    template <typename... MethodArgs, typename... Args>
+    void callTrackListeners(const String &trackId,
+        void (ProjectListener::*callback)(MethodArgs...), Args &&... args)
+    {
+        this->changeListeners.call(callback, args...);
+
+        const auto found = this->trackListeners.find(trackId);
+        if (found != this->trackListeners.end())
+        {
+            this->trackListenersCallDepth++;
+            found->second->call(callback, args...);
+            this->endTrackListenersCall();
+        }
+    }
+
+    template <typename... MethodArgs, typename... Args>
+    void callAllTrackListeners(void (ProjectListener::*callback)(MethodArgs...), Args &&... args)
+    {
+        this->trackListenersCallDepth++;
+
+        for (const auto &it : this->trackListeners)
+        {
+            it.second->call(callback, args...);
+        }
+
+        this->endTrackListenersCall();
+    }
+
     UniquePointer<ProjectPage> projectPage;
     ReadWriteLock tracksListLock;
 
@@ -249,6 +307,23 @@ private:
     mutable Range<float> beatRange = { 0.f, Globals::Defaults::projectLength };
     Range<float> calculateProjectBeatRange() const;
 
+    // The range of each non-empty track, its sequence range shifted
+    // by its pattern range, and all their first and last beats sorted,
+    // so that a change in one track updates the project range
+    // in O(log tracks) instead of walking all the tracks each time;
+    // it's rebuilt from scratch along with the tracks cache below
+    struct TrackBeatRange final
+    {
+        float firstBeat;
+        float lastBeat;
+    };
+
+    mutable FlatHashMap<String, TrackBeatRange, StringHash> trackBeatRanges;
+    mutable std::multiset<float> tracksFirstBeats;
+    mutable std::multiset<float> tracksLastBeats;
+    void insertTrackBeatRange(const MidiTrack *track) const;
+    void eraseTrackBeatRange(const String &trackId) const;
+
     mutable bool isTracksCacheOutdated = true;
     mutable FlatHashMap<String, WeakReference<MidiTrack>, StringHash> tracksRefsCache;
     void rebuildTracksRefsCacheIfNeeded() const;
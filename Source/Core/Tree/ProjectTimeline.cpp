@@ -300,6 +300,22 @@ void ProjectTimeline::dispatchPostRemoveEvent(MidiSequence *const layer)
     this->project.broadcastPostRemoveEvent(layer);
 }
 
+void ProjectTimeline::dispatchAddEvents(const MidiEventsBatch &events)
+{
+    this->project.broadcastAddEvents(events);
+}
+
+void ProjectTimeline::dispatchChangeEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    this->project.broadcastChangeEvents(oldEvents, newEvents);
+}
+
+void ProjectTimeline::dispatchRemoveEvents(const MidiEventsBatch &events)
+{
+    this->project.broadcastRemoveEvents(events);
+}
+
 void ProjectTimeline::dispatchChangeTrackProperties()
 {
     jassertfalse; // should never be called
@@ -307,7 +323,11 @@ void ProjectTimeline::dispatchChangeTrackProperties()
 
 void ProjectTimeline::dispatchChangeTrackBeatRange()
 {
-    this->project.broadcastChangeProjectBeatRange();
+    // not sure which one has changed, but there are only three of them,
+    // and the project range is broadcast right after this
+    this->project.updateTrackBeatRange(this->getAnnotations());
+    this->project.updateTrackBeatRange(this->getKeySignatures());
+    this->project.updateTrackBeatRange(this->getTimeSignatures());
 }
 
 void ProjectTimeline::dispatchChangeProjectBeatRange()
@@ -322,6 +342,9 @@ void ProjectTimeline::dispatchAddClip(const Clip &clip) {}
 void ProjectTimeline::dispatchChangeClip(const Clip &oldClip, const Clip &newClip) {}
 void ProjectTimeline::dispatchRemoveClip(const Clip &clip) {}
 void ProjectTimeline::dispatchPostRemoveClip(Pattern *const pattern) {}
+void ProjectTimeline::dispatchAddClips(const ClipsBatch &clips) {}
+void ProjectTimeline::dispatchChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips) {}
+void ProjectTimeline::dispatchRemoveClips(const ClipsBatch &clips) {}
 
 ProjectNode *ProjectTimeline::getProject() const noexcept
 {
@@ -417,11 +440,14 @@ SerializedData ProjectTimeline::serializeAnnotationsDelta() const
 {
     SerializedData tree(Serialization::VCS::AnnotationDeltas::annotationsAdded);
 
-    for (int i = 0; i < this->annotationsSequence->size(); ++i)
+    // called from the VCS thread as well, hence the snapshot,
+    // which is not available if that thread is being stopped
+    const auto snapshot = this->annotationsSequence->getSnapshot();
+
+    snapshot->forEach([&tree](const MidiEvent &event)
     {
-        const MidiEvent *event = this->annotationsSequence->getUnchecked(i);
-        tree.appendChild(event->serialize());
-    }
+        tree.appendChild(event.serialize());
+    });
 
     return tree;
 }
@@ -443,11 +469,14 @@ SerializedData ProjectTimeline::serializeTimeSignaturesDelta() const
 {
     SerializedData tree(Serialization::VCS::TimeSignatureDeltas::timeSignaturesAdded);
 
-    for (int i = 0; i < this->timeSignaturesSequence->size(); ++i)
+    // called from the VCS thread as well, hence the snapshot,
+    // which is not available if that thread is being stopped
+    const auto snapshot = this->timeSignaturesSequence->getSnapshot();
+
+    snapshot->forEach([&tree](const MidiEvent &event)
     {
-        const MidiEvent *event = this->timeSignaturesSequence->getUnchecked(i);
-        tree.appendChild(event->serialize());
-    }
+        tree.appendChild(event.serialize());
+    });
     
     return tree;
 }
@@ -469,11 +498,14 @@ SerializedData ProjectTimeline::serializeKeySignaturesDelta() const
 {
     SerializedData tree(Serialization::VCS::KeySignatureDeltas::keySignaturesAdded);
 
-    for (int i = 0; i < this->keySignaturesSequence->size(); ++i)
+    // called from the VCS thread as well, hence the snapshot,
+    // which is not available if that thread is being stopped
+    const auto snapshot = this->keySignaturesSequence->getSnapshot();
+
+    snapshot->forEach([&tree](const MidiEvent &event)
     {
-        const MidiEvent *event = this->keySignaturesSequence->getUnchecked(i);
-        tree.appendChild(event->serialize());
-    }
+        tree.appendChild(event.serialize());
+    });
 
     return tree;
 }
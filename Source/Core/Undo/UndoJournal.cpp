@@ -0,0 +1,305 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "UndoJournal.h"
+#include "SerializationKeys.h"
+
+UndoJournal::UndoJournal(const File &file) :
+    file(file) {}
+
+File UndoJournal::getFileFor(const File &projectFile)
+{
+    return projectFile.getSiblingFile(projectFile.getFileName() + ".undo");
+}
+
+int64 UndoJournal::getTotalSize() const noexcept
+{
+    if (this->records.isEmpty())
+    {
+        return 0;
+    }
+
+    const auto &last = this->records.getReference(this->records.size() - 1);
+    return last.offset + last.size + UndoJournal::trailerSize;
+}
+
+int64 UndoJournal::getLastRecordId() const noexcept
+{
+    return this->records.isEmpty() ? 0 :
+        this->records.getReference(this->records.size() - 1).recordId;
+}
+
+UndoActionId UndoJournal::getLastTransactionId() const noexcept
+{
+    return this->records.isEmpty() ? UndoActionIDs::None :
+        this->records.getReference(this->records.size() - 1).transactionId;
+}
+
+bool UndoJournal::push(const SerializedData &transaction, UndoActionId transactionId)
+{
+    MemoryOutputStream payload;
+    transaction.writeToStream(payload);
+
+    Record record;
+    record.offset = this->getTotalSize();
+    record.size = int64(payload.getDataSize());
+    record.transactionId = transactionId;
+    // the zero id is reserved for the empty journal
+    record.recordId = Random::getSystemRandom().nextInt64() | 1;
+
+    {
+        FileOutputStream out(this->file);
+        if (out.failedToOpen() ||
+            !out.setPosition(record.offset) ||
+            out.truncate().failed())
+        {
+            return false;
+        }
+
+        const bool writtenOk = out.write(payload.getData(), payload.getDataSize()) &&
+            out.writeInt64(record.size) &&
+            out.writeInt64(record.transactionId) &&
+            out.writeInt64(record.recordId);
+
+        out.flush();
+
+        if (!writtenOk || out.getStatus().failed())
+        {
+            return false;
+        }
+    }
+
+    this->records.add(record);
+    return true;
+}
+
+SerializedData UndoJournal::pop(UndoActionId &outTransactionId)
+{
+    if (this->records.isEmpty())
+    {
+        return {};
+    }
+
+    const auto record = this->records.getLast();
+    MemoryBlock payload;
+
+    {
+        FileInputStream in(this->file);
+        if (!in.openedOk() ||
+            !in.setPosition(record.offset) ||
+            in.readIntoMemoryBlock(payload, ssize_t(record.size)) != size_t(record.size))
+        {
+            jassertfalse;
+            this->clear();
+            return {};
+        }
+    }
+
+    // the file is truncated by the next push or trim()
+    this->records.removeLast();
+
+    outTransactionId = record.transactionId;
+    return SerializedData::readFromData(payload.getData(), payload.getSize());
+}
+
+void UndoJournal::restore(int64 expectedSize, int64 expectedLastRecordId)
+{
+    this->records.clearQuick();
+
+    Array<Record> found;
+    bool isValid = expectedSize > 0;
+
+    if (isValid)
+    {
+        FileInputStream in(this->file);
+        isValid = in.openedOk() && in.getTotalLength() >= expectedSize;
+
+        // walk the trailers back from where the saved project
+        // expects the journal to end, down to the first record
+        auto position = expectedSize;
+        while (isValid && position > 0)
+        {
+            Record record;
+            isValid = position >= UndoJournal::trailerSize &&
+                in.setPosition(position - UndoJournal::trailerSize);
+
+            if (isValid)
+            {
+                record.size = in.readInt64();
+                record.transactionId = in.readInt64();
+                record.recordId = in.readInt64();
+                record.offset = position - UndoJournal::trailerSize - record.size;
+
+                isValid = record.size >= 0 && record.offset >= 0 &&
+                    (!found.isEmpty() || record.recordId == expectedLastRecordId);
+
+                found.add(record);
+                position = record.offset;
+            }
+        }
+    }
+
+    if (!isValid)
+    {
+        this->clear();
+        return;
+    }
+
+    std::reverse(found.begin(), found.end());
+    this->records.swapWith(found);
+
+    // cut off whatever was written after the project was saved
+    this->truncate(expectedSize);
+}
+
+void UndoJournal::trim()
+{
+    if (this->records.isEmpty())
+    {
+        this->file.deleteFile();
+    }
+    else if (this->file.getSize() > this->getTotalSize())
+    {
+        this->truncate(this->getTotalSize());
+    }
+}
+
+void UndoJournal::clear()
+{
+    this->records.clearQuick();
+    this->file.deleteFile();
+}
+
+bool UndoJournal::moveTo(const File &newFile)
+{
+    if (this->file.existsAsFile() && !this->file.moveFileTo(newFile))
+    {
+        this->clear();
+        this->file = newFile;
+        return false;
+    }
+
+    this->file = newFile;
+    return true;
+}
+
+bool UndoJournal::truncate(int64 newSize)
+{
+    FileOutputStream out(this->file);
+    return !out.failedToOpen() &&
+        out.setPosition(newSize) &&
+        out.truncate().wasOk();
+}
+
+//===----------------------------------------------------------------------===//
+// Tests
+//===----------------------------------------------------------------------===//
+
+#if JUCE_UNIT_TESTS
+
+class UndoJournalTests final : public UnitTest
+{
+public:
+    UndoJournalTests() : UnitTest("Undo journal tests", UnitTestCategories::helio) {}
+
+    void runTest() override
+    {
+        const TemporaryFile temp;
+
+        const auto makeTransaction = [](int value)
+        {
+            SerializedData tree(Serialization::Undo::transaction);
+            tree.setProperty(Serialization::Undo::name, value);
+            return tree;
+        };
+
+        beginTest("Journal records are popped in the reverse order");
+        {
+            UndoJournal journal(temp.getFile());
+            expect(journal.push(makeTransaction(1), 1));
+            expect(journal.push(makeTransaction(2), 2));
+            expect(journal.push(makeTransaction(3), 3));
+            expectEquals(journal.size(), 3);
+            expectEquals(journal.getLastTransactionId(), UndoActionId(3));
+            expectEquals(temp.getFile().getSize(), journal.getTotalSize());
+
+            UndoActionId id = 0;
+            const auto last = journal.pop(id);
+            expectEquals(id, UndoActionId(3));
+            expectEquals(int(last.getProperty(Serialization::Undo::name)), 3);
+            expectEquals(journal.size(), 2);
+        }
+
+        beginTest("Popped records are cut off lazily");
+        {
+            UndoJournal journal(temp.getFile());
+            journal.restore(0, 0);
+            expect(journal.push(makeTransaction(1), 1));
+            expect(journal.push(makeTransaction(2), 2));
+            const auto fullSize = journal.getTotalSize();
+
+            UndoActionId id = 0;
+            journal.pop(id);
+            expectEquals(temp.getFile().getSize(), fullSize);
+            expectLessThan(journal.getTotalSize(), fullSize);
+
+            // the next push overwrites the popped record
+            expect(journal.push(makeTransaction(3), 3));
+            expectEquals(temp.getFile().getSize(), journal.getTotalSize());
+
+            journal.pop(id);
+            expectEquals(id, UndoActionId(3));
+            journal.trim();
+            expectEquals(temp.getFile().getSize(), journal.getTotalSize());
+
+            journal.pop(id);
+            expectEquals(id, UndoActionId(1));
+            journal.trim();
+            expect(!temp.getFile().existsAsFile());
+        }
+
+        beginTest("Journal is restored up to the saved size");
+        {
+            UndoJournal journal(temp.getFile());
+            journal.restore(0, 0);
+            expect(journal.push(makeTransaction(1), 1));
+            expect(journal.push(makeTransaction(2), 2));
+
+            const auto savedSize = journal.getTotalSize();
+            const auto savedRecordId = journal.getLastRecordId();
+
+            // written after the save, and then the app has quit
+            expect(journal.push(makeTransaction(3), 3));
+
+            UndoJournal restored(temp.getFile());
+            restored.restore(savedSize, savedRecordId);
+            expectEquals(restored.size(), 2);
+            expectEquals(restored.getLastTransactionId(), UndoActionId(2));
+            expectEquals(temp.getFile().getSize(), savedSize);
+
+            UndoJournal mismatching(temp.getFile());
+            mismatching.restore(savedSize, savedRecordId + 2);
+            expect(mismatching.isEmpty());
+            expect(!temp.getFile().existsAsFile());
+        }
+    }
+};
+
+static UndoJournalTests undoJournalTests;
+
+#endif
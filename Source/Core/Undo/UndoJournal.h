@@ -0,0 +1,88 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "UndoActionIDs.h"
+
+// An append-only file next to the project, where the undo stack moves
+// the transactions it doesn't keep in memory, the oldest ones first,
+// and takes them back from the end as the user undoes past them;
+// each record is the transaction in the binary serialization format,
+// followed by the fixed size trailer, so the records can be indexed
+// from the end of the file without reading the transactions themselves.
+
+// Popping a record doesn't shrink the file, since the user often undoes
+// and then redoes or edits again: the popped records past the logical end
+// are overwritten by the next push, or cut off by trim() before saving.
+
+// The project only saves the journal's size and the id of its last record:
+// if the app quits without saving, the journal can have more records
+// than the saved project expects, or different ones, so on load,
+// the extra ones are cut off, and the mismatching journal is dropped.
+
+class UndoJournal final
+{
+public:
+
+    explicit UndoJournal(const File &file);
+
+    static File getFileFor(const File &projectFile);
+
+    inline const File &getFile() const noexcept { return this->file; }
+    inline bool isEmpty() const noexcept { return this->records.isEmpty(); }
+    inline int size() const noexcept { return this->records.size(); }
+
+    // the logical size in bytes and the id of the last record,
+    // which the project saves to check the journal against
+    int64 getTotalSize() const noexcept;
+    int64 getLastRecordId() const noexcept;
+
+    UndoActionId getLastTransactionId() const noexcept;
+
+    bool push(const SerializedData &transaction, UndoActionId transactionId);
+    SerializedData pop(UndoActionId &outTransactionId);
+
+    // reads the records index of the existing file, up to the given size
+    void restore(int64 expectedSize, int64 expectedLastRecordId);
+
+    // cuts off the popped records past the logical end of the file
+    void trim();
+
+    void clear();
+    bool moveTo(const File &newFile);
+
+private:
+
+    struct Record final
+    {
+        int64 offset;
+        int64 size;
+        UndoActionId transactionId;
+        int64 recordId;
+    };
+
+    // the payload size, the transaction id and the record id
+    static constexpr int64 trailerSize = sizeof(int64) * 3;
+
+    bool truncate(int64 newSize);
+
+    File file;
+    Array<Record> records;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UndoJournal)
+};
@@ -63,6 +63,11 @@ bool UndoStack::Transaction::undo() const
     
 int UndoStack::Transaction::getTotalSize() const
 {
+    if (this->encodedSize >= 0)
+    {
+        return this->encodedSize;
+    }
+
     int total = 0;
     for (int i = this->actions.size(); --i >= 0;)
     {
@@ -72,6 +77,51 @@ int UndoStack::Transaction::getTotalSize() const
     return total;
 }
     
+// only counts the bytes written, see Transaction::seal()
+class UndoTransactionSizeCounter final : public OutputStream
+{
+public:
+
+    UndoTransactionSizeCounter() = default;
+
+    void flush() override {}
+    bool setPosition(int64) override { return false; }
+    int64 getPosition() override { return this->numBytes; }
+
+    bool write(const void *, size_t numBytesToWrite) override
+    {
+        this->numBytes += int64(numBytesToWrite);
+        return true;
+    }
+
+private:
+
+    int64 numBytes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(UndoTransactionSizeCounter)
+};
+
+int UndoStack::Transaction::seal()
+{
+    if (this->encodedSize >= 0)
+    {
+        return 0;
+    }
+
+    const auto estimatedSize = this->getTotalSize();
+
+    UndoTransactionSizeCounter counter;
+    this->serialize().writeToStream(counter);
+    this->encodedSize = int(counter.getPosition());
+
+    return this->encodedSize - estimatedSize;
+}
+
+void UndoStack::Transaction::unseal() noexcept
+{
+    this->encodedSize = -1;
+}
+
 SerializedData UndoStack::Transaction::serialize() const
 {
     SerializedData tree(Serialization::Undo::transaction);
@@ -160,6 +210,11 @@ void UndoStack::clearUndoHistory()
     this->transactions.clear();
     this->totalUnitsStored = 0;
     this->nextIndex = 0;
+
+    if (auto *journal = this->getJournal())
+    {
+        journal->clear();
+    }
 }
 
 bool UndoStack::perform(UndoAction *const newAction, UndoActionId transactionId)
@@ -196,6 +251,11 @@ bool UndoStack::perform(UndoAction *const newAction)
             
             if (actionSet != nullptr && !this->hasNewEmptyTransaction)
             {
+                // normally, the current transaction is not sealed yet
+                const auto sealedSize = actionSet->getTotalSize();
+                actionSet->unseal();
+                this->totalUnitsStored += actionSet->getTotalSize() - sealedSize;
+
                 if (auto *lastAction = actionSet->actions.getLast())
                 {
                     if (auto *coalescedAction = lastAction->createCoalescedAction(action.get()))
@@ -208,6 +268,12 @@ bool UndoStack::perform(UndoAction *const newAction)
             }
             else
             {
+                // the previous transaction is complete now
+                if (actionSet != nullptr)
+                {
+                    this->totalUnitsStored += actionSet->seal();
+                }
+
                 actionSet = new Transaction(this->project, this->newUndoActionId);
                 this->transactions.insert(nextIndex, actionSet);
                 this->nextIndex++;
@@ -237,9 +303,7 @@ void UndoStack::clearFutureTransactions()
            && this->totalUnitsStored > this->maxNumUnitsToKeep
            && this->transactions.size() > this->minimumTransactionsToKeep)
     {
-        this->totalUnitsStored -= this->transactions.getFirst()->getTotalSize();
-        this->transactions.remove(0);
-        --this->nextIndex;
+        this->moveFirstTransactionToJournal();
         
         // if this fails, then some actions may not be returning
         // consistent results from their getSizeInUnits() method
@@ -247,6 +311,104 @@ void UndoStack::clearFutureTransactions()
     }
 }
 
+//===----------------------------------------------------------------------===//
+// Journal
+//===----------------------------------------------------------------------===//
+
+UndoJournal *UndoStack::getJournal()
+{
+    const auto projectPath = this->project.getDocument()->getFullPath();
+    if (projectPath.isEmpty())
+    {
+        return nullptr;
+    }
+
+    const auto journalFile = UndoJournal::getFileFor(File(projectPath));
+
+    if (this->journal == nullptr)
+    {
+        this->journal = make<UndoJournal>(journalFile);
+    }
+    else if (this->journal->getFile() != journalFile)
+    {
+        // the project has been renamed
+        this->journal->moveTo(journalFile);
+    }
+
+    return this->journal.get();
+}
+
+bool UndoStack::hasJournalledTransactions() const noexcept
+{
+    return this->journal != nullptr && !this->journal->isEmpty();
+}
+
+bool UndoStack::moveFirstTransactionToJournal()
+{
+    auto *journal = this->getJournal();
+    const auto *first = this->transactions.getFirst();
+    jassert(first != nullptr);
+
+    const bool journalledOk = journal != nullptr &&
+        journal->push(first->serialize(), first->id);
+
+    if (!journalledOk && journal != nullptr)
+    {
+        // the journal has to end right before the first transaction in memory,
+        // so if there's a gap, all the history behind it is useless
+        journal->clear();
+    }
+
+    this->totalUnitsStored -= first->getTotalSize();
+    this->transactions.remove(0);
+    --this->nextIndex;
+
+    return journalledOk;
+}
+
+bool UndoStack::restoreLastTransactionFromJournal()
+{
+    jassert(this->nextIndex == 0);
+
+    auto *journal = this->getJournal();
+    if (journal == nullptr || journal->isEmpty())
+    {
+        return false;
+    }
+
+    UndoActionId transactionId = UndoActionIDs::None;
+    const auto data = journal->pop(transactionId);
+    if (!data.isValid())
+    {
+        return false;
+    }
+
+    auto *transaction = new Transaction(this->project, transactionId);
+    transaction->deserialize(data);
+    transaction->seal();
+    this->transactions.insert(0, transaction);
+    this->totalUnitsStored += transaction->getTotalSize();
+    this->nextIndex = 1;
+    return true;
+}
+
+void UndoStack::flushToJournal()
+{
+    if (this->getJournal() == nullptr)
+    {
+        return;
+    }
+
+    while (this->nextIndex > UndoStack::maxTransactionsToSerialize)
+    {
+        this->moveFirstTransactionToJournal();
+    }
+
+    // the project saves the journal's size, so the popped records
+    // past its logical end are not needed anymore
+    this->journal->trim();
+}
+
 void UndoStack::beginNewTransaction() noexcept
 {
     this->beginNewTransaction(UndoActionIDs::None);
@@ -282,7 +444,8 @@ UndoStack::Transaction *UndoStack::getNextSet() const noexcept
 
 bool UndoStack::canUndo() const noexcept
 {
-    return this->getCurrentSet() != nullptr;
+    return this->getCurrentSet() != nullptr ||
+        this->hasJournalledTransactions();
 }
 
 bool UndoStack::canRedo() const noexcept
@@ -292,6 +455,11 @@ bool UndoStack::canRedo() const noexcept
 
 bool UndoStack::undo()
 {
+    if (this->getCurrentSet() == nullptr)
+    {
+        this->restoreLastTransactionFromJournal();
+    }
+
     if (const auto *s = this->getCurrentSet())
     {
         const ScopedValueSetter<bool> setter(this->reentrancyCheck, true);
@@ -340,6 +508,11 @@ UndoActionId UndoStack::getUndoActionId() const
     {
         return s->id;
     }
+
+    if (this->hasJournalledTransactions())
+    {
+        return this->journal->getLastTransactionId();
+    }
     
     return 0;
 }
@@ -408,6 +581,17 @@ SerializedData UndoStack::serialize() const
         --currentIndex;
         ++numStoredTransactions;
     }
+
+    // the journal is only valid for the project file if it
+    // ends right before the first of the stored transactions,
+    // which is what flushToJournal() makes sure of
+    if (this->journal != nullptr && currentIndex < 0)
+    {
+        tree.setProperty(Serialization::Undo::journalSize,
+            this->journal->getTotalSize());
+        tree.setProperty(Serialization::Undo::journalLastRecord,
+            this->journal->getLastRecordId());
+    }
     
     return tree;
 }
@@ -426,14 +610,27 @@ void UndoStack::deserialize(const SerializedData &data)
     {
         auto *actionSet = new Transaction(this->project, {});
         actionSet->deserialize(childTransaction);
+        actionSet->seal();
+        this->totalUnitsStored += actionSet->getTotalSize();
         this->transactions.insert(this->nextIndex, actionSet);
         ++this->nextIndex;
     }
+
+    if (auto *journal = this->getJournal())
+    {
+        journal->restore(root.getProperty(Serialization::Undo::journalSize, 0),
+            root.getProperty(Serialization::Undo::journalLastRecord, 0));
+    }
 }
 
 void UndoStack::reset()
 {
-    this->clearUndoHistory();
+    // unlike clearUndoHistory(), keeps the journal file,
+    // which the deserialization will check and pick up
+    this->transactions.clear();
+    this->totalUnitsStored = 0;
+    this->nextIndex = 0;
+    this->journal = nullptr;
 }
 
 bool UndoStack::mergeTransactionsUpTo(UndoActionId transactionId)
@@ -467,6 +664,13 @@ bool UndoStack::mergeTransactionsUpTo(UndoActionId transactionId)
 
     DBG("Merging " + String(this->nextIndex - targetActionIndex) + " transactions");
 
+    // the merged transaction is going to be filled in further,
+    // so it's back to the estimate until the next one begins
+    for (int i = targetActionIndex; i < this->nextIndex; ++i)
+    {
+        this->totalUnitsStored -= this->transactions.getUnchecked(i)->getTotalSize();
+    }
+
     for (int i = targetActionIndex + 1; i < this->nextIndex;)
     {
         if (auto *t = this->transactions[i])
@@ -481,5 +685,7 @@ bool UndoStack::mergeTransactionsUpTo(UndoActionId transactionId)
         this->nextIndex--;
     }
 
+    targetTransaction->unseal();
+    this->totalUnitsStored += targetTransaction->getTotalSize();
     return true;
 }
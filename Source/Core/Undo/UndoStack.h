@@ -21,10 +21,20 @@ class ProjectNode;
 
 #include "UndoAction.h"
 #include "UndoActionIDs.h"
+#include "UndoJournal.h"
 
 // Basically the same JUCE's UndoManager, but serializable;
 // plus most actions need a reference to project, which it has
 
+// The older transactions are not dropped, but moved to the journal file
+// next to the project, and paged back in when undoing past the ones
+// in memory; the project file itself only keeps the last few of them
+
+// The memory is counted in the bytes of the transactions' binary
+// serialization, i.e. what they would take in the journal: the actions'
+// getSizeInUnits() are only the estimates for the transaction which
+// is still being filled in, and which is measured once it's complete
+
 class UndoStack final : public Serializable
 {
 public:
@@ -70,6 +80,10 @@ public:
     // for multi-step interactive actions which might involve >1 checkpoints
     bool mergeTransactionsUpTo(UndoActionId transactionId);
 
+    // called before saving the project: moves all the transactions
+    // older than the ones the project file keeps to the journal
+    void flushToJournal();
+
 private:
 
     void getActionsInCurrentTransaction(Array<const UndoAction *> &actionsFound) const;
@@ -84,8 +98,15 @@ private:
 
         bool perform() const;
         bool undo() const;
+
+        // the estimate while the transaction is being filled in,
+        // and the encoded size since it's sealed, see the comment above
         int getTotalSize() const;
 
+        // measures the encoded size, and returns how far the estimate was off
+        int seal();
+        void unseal() noexcept;
+
         SerializedData serialize() const;
         void deserialize(const SerializedData &data);
         void reset();
@@ -94,6 +115,7 @@ private:
 
         OwnedArray<UndoAction> actions;
         UndoActionId id;
+        int encodedSize = -1;
 
         ProjectNode &project;
 
@@ -135,6 +157,12 @@ private:
 
     void clearFutureTransactions();
 
+    UniquePointer<UndoJournal> journal;
+    UndoJournal *getJournal();
+    bool hasJournalledTransactions() const noexcept;
+    bool moveFirstTransactionToJournal();
+    bool restoreLastTransactionFromJournal();
+
     JUCE_DECLARE_WEAK_REFERENCEABLE(UndoStack)
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UndoStack)
 };
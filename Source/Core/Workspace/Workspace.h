@@ -27,6 +27,7 @@ class CommandPaletteProjectsList;
 #include "UserProfile.h"
 #include "NavigationHistory.h"
 #include "CommandPaletteModel.h"
+#include "ParallelBatch.h"
 
 class Workspace final : public CommandPaletteModel, private Serializable
 {
@@ -91,6 +92,9 @@ private:
     
     UniquePointer<AudioCore> audioCore;
     UniquePointer<PluginScanner> pluginManager;
+
+    // keeps the worker threads of the project-wide operations alive
+    SharedResourcePointer<ParallelBatch::Pool> batchPool;
     
     UniquePointer<RootNode> treeRoot;
     NavigationHistory navigationHistory;
@@ -201,6 +201,10 @@ CommandIDs::Id CommandIDs::getIdForName(const String &command)
         CASE_FOR(SelectPreset)
         CASE_FOR(OpenMetronomeSample)
         CASE_FOR(ResetMetronomeSample)
+        CASE_FOR(CalibrateMidiOutputLatency)
+        CASE_FOR(ToggleMidiClockInput)
+        CASE_FOR(ToggleMidiClockOutput)
+        CASE_FOR(ToggleMidiTimecodeOutput)
         default: return None;
     }
 }
@@ -394,6 +398,10 @@ I18n::Key CommandIDs::getTranslationKeyFor(CommandIDs::Id id)
         TRANS_NONE(SelectPreset)
         TRANS_NONE(OpenMetronomeSample)
         TRANS_NONE(ResetMetronomeSample)
+        TRANS_NONE(CalibrateMidiOutputLatency)
+        TRANS_NONE(ToggleMidiClockInput)
+        TRANS_NONE(ToggleMidiClockOutput)
+        TRANS_NONE(ToggleMidiTimecodeOutput)
         default: return 0;
     }
 }
@@ -235,7 +235,12 @@ namespace CommandIDs
         MakeLegatoOverlapping           = 0x4604, // connect notes together, but with a slight overlap for use in certain VSTs
         Glue                            = 0x4605, // glue overlapping notes
 
-        YourNextCommandId               = 0x4700
+        CalibrateMidiOutputLatency      = 0x4700,
+        ToggleMidiClockInput            = 0x4701,
+        ToggleMidiClockOutput           = 0x4702,
+        ToggleMidiTimecodeOutput        = 0x4703,
+
+        YourNextCommandId               = 0x4704
     };
 
     CommandIDs::Id getIdForName(const String &command);
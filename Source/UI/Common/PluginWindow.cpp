@@ -22,6 +22,7 @@
 #include "RootNode.h"
 #include "InstrumentNode.h"
 #include "AudioCore.h"
+#include "SandboxedPluginInstance.h"
 
 static OwnedArray<PluginWindow> activePluginWindows;
 
@@ -133,6 +134,17 @@ bool PluginWindow::showWindowFor(const String &instrumentId)
 {
     if (auto *instrument = App::Workspace().getAudioCore().findInstrumentById(instrumentId))
     {
+        if (!instrument->isLoaded())
+        {
+            // a placeholder, so load it first and try again:
+            instrument->loadIfNeeded([instrumentId](Instrument *)
+            {
+                PluginWindow::showWindowFor(instrumentId);
+            });
+
+            return true;
+        }
+
         if (auto node = instrument->findMainPluginNode())
         {
             return PluginWindow::showWindowFor(node);
@@ -146,6 +158,18 @@ bool PluginWindow::showWindowFor(AudioProcessorGraph::Node::Ptr node)
 {
 #if PLATFORM_DESKTOP
 
+    // sandboxed plugins show their editors in their own processes:
+    if (auto *sandboxed = dynamic_cast<SandboxedPluginInstance *>(node->getProcessor()))
+    {
+        if (sandboxed->hasRemoteEditor())
+        {
+            sandboxed->showRemoteEditor();
+            return true;
+        }
+
+        return false;
+    }
+
     if (auto *window = PluginWindow::getWindowFor(node))
     {
         // this callAsync trick is needed, because this may be called by a modal component,
@@ -374,32 +374,47 @@ void ProjectMenu::showTemperamentsMenu(bool convertTracks)
             closesMenu()->
             withAction([this, currentTemperament, otherTemperament, convertTracks]()
         {
-            if (convertTracks)
+            // the menu is closed by the time the notes are remapped,
+            // so the rest of the changes don't refer to it:
+            const auto updateTemperament =
+                [currentTemperament, otherTemperament](ProjectNode &project)
             {
-                const bool hasMadeChanges =
-                    SequencerOperations::remapNotesToTemperament(this->project, otherTemperament, true);
+                // let's also update key signatures (todo move this code somewhere):
+                auto *keySignatures = static_cast<KeySignaturesSequence *>(project.
+                    getTimeline()->getKeySignatures()->getSequence());
 
-                if (!hasMadeChanges)
-                {
-                    this->project.checkpoint();
-                }
-            }
-            else
+                SequencerOperations::remapKeySignaturesToTemperament(keySignatures,
+                    currentTemperament, otherTemperament, App::Config().getScales()->getAll(),
+                    false); // false == already did checkpoint earlier
+
+                // finally, the temperament itself:
+                project.getUndoStack()->perform(
+                    new ProjectTemperamentChangeAction(project, *otherTemperament));
+            };
+
+            if (!convertTracks)
             {
                 this->project.checkpoint();
+                updateTemperament(this->project);
+                return;
             }
 
-            // let's also update key signatures (todo move this code somewhere):
-            auto *keySignatures = static_cast<KeySignaturesSequence *>(this->project.
-                getTimeline()->getKeySignatures()->getSequence());
+            WeakReference<ProjectNode> weakProject(&this->project);
+            SequencerOperations::remapNotesToTemperament(this->project, otherTemperament,
+                [weakProject, updateTemperament](bool hasMadeChanges)
+            {
+                if (weakProject == nullptr)
+                {
+                    return;
+                }
 
-            SequencerOperations::remapKeySignaturesToTemperament(keySignatures,
-                currentTemperament, otherTemperament, App::Config().getScales()->getAll(),
-                false); // false == already did checkpoint earlier
+                if (!hasMadeChanges)
+                {
+                    weakProject->checkpoint();
+                }
 
-            // finally, the temperament itself:
-            this->project.getUndoStack()->perform(
-                new ProjectTemperamentChangeAction(this->project, *otherTemperament));
+                updateTemperament(*weakProject);
+            }, true);
         }));
     }
 
@@ -20,6 +20,7 @@
 #include "InstrumentEditor.h"
 #include "InstrumentEditorPin.h"
 #include "PluginWindow.h"
+#include "SerializationKeys.h"
 
 #if PLATFORM_DESKTOP
 #   define CHANNELS_NUMBER_LIMIT 12
@@ -129,7 +130,16 @@ void InstrumentComponent::paint(Graphics &g)
 
     g.setFont(this->font);
     g.setColour(Colours::black.withAlpha(0.75f));
-    g.drawFittedText(this->getName(), getLocalBounds().reduced(this->pinSize * 2, this->pinSize), Justification::centred, 3, 1.f);
+    const auto textArea = this->getLocalBounds().reduced(this->pinSize * 2, this->pinSize);
+    g.drawFittedText(this->getName(), textArea, Justification::centred, 3, 1.f);
+
+    if (this->loadTimeText.isNotEmpty())
+    {
+        g.setFont(Globals::UI::Fonts::S);
+        g.setColour(Colours::black.withAlpha(0.5f));
+        g.drawText(this->loadTimeText, textArea.withTrimmedTop(textArea.getHeight() / 2 +
+            int(this->font.getHeight() * 1.5f)), Justification::centredTop, false);
+    }
 }
 
 void InstrumentComponent::resized()
@@ -202,6 +212,10 @@ void InstrumentComponent::update()
     const String translatedName = TRANS(node->getProcessor()->getName());
     this->setName(translatedName);
 
+    const auto loadTimeMs = double(node->properties[Serialization::Audio::nodeLoadTime]);
+    this->loadTimeText = loadTimeMs > 0.0 ? TRANS(I18n::Instruments::loadTime) +
+        ": " + String(loadTimeMs, 0) + " ms" : String();
+
     const int textWidth = this->font.getStringWidth(translatedName);
     const auto smallScreenMode = App::isRunningOnPhone();
     const auto minSize = smallScreenMode ? 120 : 180;
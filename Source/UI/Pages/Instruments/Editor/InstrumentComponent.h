@@ -59,6 +59,9 @@ private:
     int numInputs = 0;
     int numOutputs = 0;
 
+    // how long it took to create the plugin, to see which ones slow down the loading
+    String loadTimeText;
+
     bool hitTest(int x, int y) override;
 
     InstrumentEditor *getParentEditor() const noexcept;
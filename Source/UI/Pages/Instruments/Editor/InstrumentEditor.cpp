@@ -28,6 +28,7 @@
 
 #include "AudioCore.h"
 #include "MainLayout.h"
+#include "SandboxedPluginInstance.h"
 
 static const AudioProcessorGraph::NodeID idZero;
 
@@ -39,6 +40,12 @@ InstrumentEditor::InstrumentEditor(WeakReference<Instrument> instrument,
     this->background = make<PanelBackgroundC>();
     this->addAndMakeVisible(this->background.get());
 
+    this->latencyLabel = make<Label>();
+    this->latencyLabel->setFont(Globals::UI::Fonts::S);
+    this->latencyLabel->setJustificationType(Justification::bottomLeft);
+    this->latencyLabel->setInterceptsMouseClicks(false, false);
+    this->addAndMakeVisible(this->latencyLabel.get());
+
     this->contextMenuController = make<HeadlineContextMenuController>(*this);
 
     this->instrument->addChangeListener(this);
@@ -48,10 +55,17 @@ InstrumentEditor::InstrumentEditor(WeakReference<Instrument> instrument,
     
     this->setWantsKeyboardFocus(false);
     this->setFocusContainerType(Component::FocusContainerType::none);
+
+    // the latencies are polled, because plugins don't always
+    // notify anyone when they change, see AudioCore
+    this->updateLatencyLabel();
+    this->startTimer(1000);
 }
 
 InstrumentEditor::~InstrumentEditor()
 {
+    this->stopTimer();
+
     this->audioCore->getDevice().removeChangeListener(this);
 
     if (this->instrument != nullptr)
@@ -60,6 +74,7 @@ InstrumentEditor::~InstrumentEditor()
     }
     
     this->draggingConnector = nullptr;
+    this->latencyLabel = nullptr;
     this->background = nullptr;
     this->deleteAllChildren();
 }
@@ -72,6 +87,7 @@ void InstrumentEditor::mouseDown(const MouseEvent &e)
 void InstrumentEditor::resized()
 {
     this->background->setBounds(0, 0, this->getWidth(), this->getHeight());
+    this->latencyLabel->setBounds(this->getLocalBounds().reduced(8).removeFromBottom(24));
     this->updateComponents();
 }
 
@@ -230,6 +246,61 @@ void InstrumentEditor::updateComponents()
     }
 }
 
+//===----------------------------------------------------------------------===//
+// Latency
+//===----------------------------------------------------------------------===//
+
+void InstrumentEditor::timerCallback()
+{
+    this->updateLatencyLabel();
+}
+
+void InstrumentEditor::updateLatencyLabel()
+{
+    if (this->instrument == nullptr)
+    {
+        return;
+    }
+
+    auto *device = this->audioCore->getDevice().getCurrentAudioDevice();
+    const auto sampleRate = device != nullptr ? device->getCurrentSampleRate() : 0.0;
+
+    const auto formatLatency = [sampleRate](int numSamples)
+    {
+        return sampleRate > 0.0 ?
+            String(numSamples * 1000.0 / sampleRate, 1) + " ms" :
+            String(numSamples);
+    };
+
+    String text;
+    text << TRANS(I18n::Instruments::latency) << ": "
+        << formatLatency(this->instrument->getLatencySamples()) << ", "
+        << TRANS(I18n::Instruments::latencyCompensation) << ": "
+        << formatLatency(this->instrument->getLatencyCompensation());
+
+    // sandboxed plugins may not keep up, and then they just go silent
+    uint32 numUnderruns = 0;
+    uint32 numDroppedBlocks = 0;
+    bool hasSandboxedPlugins = false;
+    for (auto *node : this->instrument->getProcessorGraph()->getNodes())
+    {
+        if (auto *sandboxed = dynamic_cast<SandboxedPluginInstance *>(node->getProcessor()))
+        {
+            hasSandboxedPlugins = true;
+            numUnderruns += sandboxed->getNumUnderruns();
+            numDroppedBlocks += sandboxed->getNumDroppedBlocks();
+        }
+    }
+
+    if (hasSandboxedPlugins)
+    {
+        text << ", " << TRANS(I18n::Instruments::sandboxUnderruns) << ": " << int(numUnderruns)
+            << ", " << TRANS(I18n::Instruments::sandboxDroppedBlocks) << ": " << int(numDroppedBlocks);
+    }
+
+    this->latencyLabel->setText(text, dontSendNotification);
+}
+
 //===----------------------------------------------------------------------===//
 // Dragging
 //===----------------------------------------------------------------------===//
@@ -30,7 +30,8 @@ class AudioCore;
 class InstrumentEditor final :
     public Component,
     public ChangeListener,
-    public HeadlineItemDataSource
+    public HeadlineItemDataSource,
+    private Timer // updates the latency and the sandboxed plugins' info
 {
 public:
 
@@ -76,9 +77,13 @@ private:
     void dragConnector(const MouseEvent &e);
     void endDraggingConnector(const MouseEvent &e);
 
+    void timerCallback() override;
+    void updateLatencyLabel();
+
     ComponentFader fader;
     WeakReference<Instrument> instrument;
     UniquePointer<Component> background;
+    UniquePointer<Label> latencyLabel;
     UniquePointer<InstrumentEditorConnector> draggingConnector;
     WeakReference<AudioCore> audioCore;
 
@@ -18,7 +18,9 @@
 #include "Common.h"
 #include "AudioSettings.h"
 #include "AudioCore.h"
-#include "Workspace.h"
+#include "MidiOutputScheduler.h"
+#include "MidiClockFollower.h"
+#include "MainLayout.h"
 
 AudioSettings::AudioSettings(AudioCore &core) : audioCore(core)
 {
@@ -88,12 +90,12 @@ AudioSettings::AudioSettings(AudioCore &core) : audioCore(core)
     // "record microtonal notes from 12-tone keyboard" checkbox
     this->midiInputRemappingCheckbox = make<ToggleButton>(TRANS(I18n::Settings::midiRemap12ToneKeyboard));
     this->addAndMakeVisible(this->midiInputRemappingCheckbox.get());
-    const auto isFilteringMidi = App::Workspace().getAudioCore().isFilteringMidiInput();
+    const auto isFilteringMidi = this->audioCore.isFilteringMidiInput();
     this->midiInputRemappingCheckbox->setToggleState(isFilteringMidi, dontSendNotification);
     this->midiInputRemappingCheckbox->onClick = [this]
     {
         const auto shouldFilterMidi = this->midiInputRemappingCheckbox->getToggleState();
-        App::Workspace().getAudioCore().setFilteringMidiInput(shouldFilterMidi);
+        this->audioCore.setFilteringMidiInput(shouldFilterMidi);
     };
 
     this->midiOutputEditor = make<TextEditor>();
@@ -105,8 +107,27 @@ AudioSettings::AudioSettings(AudioCore &core) : audioCore(core)
     this->midiOutputEditor->setInterceptsMouseClicks(false, true);
     this->midiOutputEditor->setFont(Globals::UI::Fonts::M);
 
+#if PLATFORM_DESKTOP
+
+    // "run plugins in separate processes" checkbox
+    this->pluginSandboxingCheckbox = make<ToggleButton>(TRANS(I18n::Settings::audioPluginSandboxing));
+    this->addAndMakeVisible(this->pluginSandboxingCheckbox.get());
+    const auto isSandboxing = this->audioCore.isSandboxingPlugins();
+    this->pluginSandboxingCheckbox->setToggleState(isSandboxing, dontSendNotification);
+    this->pluginSandboxingCheckbox->onClick = [this]
+    {
+        const auto shouldSandbox = this->pluginSandboxingCheckbox->getToggleState();
+        this->audioCore.setSandboxingPlugins(shouldSandbox);
+    };
+
+    this->setSize(550, 360);
+
+#elif PLATFORM_MOBILE
+
     this->setSize(550, 320);
 
+#endif
+
     MenuPanel::Menu emptyMenu;
     this->deviceTypeCombo->initWith(this->deviceTypeEditor.get(), emptyMenu);
     this->deviceCombo->initWith(this->deviceEditor.get(), emptyMenu);
@@ -140,6 +161,11 @@ void AudioSettings::resized()
     this->midiInputRemappingCheckbox->setBounds(editorBounds.withY(238).translated(4, 0));
 
     this->midiOutputEditor->setBounds(editorBounds.withY(280));
+
+    if (this->pluginSandboxingCheckbox != nullptr)
+    {
+        this->pluginSandboxingCheckbox->setBounds(editorBounds.withY(320).translated(4, 0));
+    }
 }
 
 void AudioSettings::parentHierarchyChanged()
@@ -206,6 +232,36 @@ void AudioSettings::handleCommandMessage(int commandId)
         return;
     }
 
+    if (commandId == CommandIDs::CalibrateMidiOutputLatency)
+    {
+        this->calibrateMidiOutput(deviceManager);
+        return;
+    }
+
+    if (commandId == CommandIDs::ToggleMidiClockInput)
+    {
+        auto *follower = this->audioCore.getMidiClockFollower();
+        follower->setEnabled(!follower->isEnabled());
+        this->syncMidiInputsList(deviceManager);
+        return;
+    }
+
+    if (commandId == CommandIDs::ToggleMidiClockOutput)
+    {
+        auto *scheduler = this->audioCore.getMidiOutputScheduler();
+        scheduler->setSendingMidiClock(!scheduler->isSendingMidiClock());
+        this->syncMidiOutputsList(deviceManager);
+        return;
+    }
+
+    if (commandId == CommandIDs::ToggleMidiTimecodeOutput)
+    {
+        auto *scheduler = this->audioCore.getMidiOutputScheduler();
+        scheduler->setSendingMidiTimecode(!scheduler->isSendingMidiTimecode());
+        this->syncMidiOutputsList(deviceManager);
+        return;
+    }
+
     if (commandId == CommandIDs::SelectMidiNoOutputDevice)
     {
         this->applyMidiOutput(deviceManager, {});
@@ -291,6 +347,35 @@ void AudioSettings::applyMidiOutput(AudioDeviceManager &deviceManager, const Str
     this->syncMidiOutputsList(deviceManager);
 }
 
+void AudioSettings::calibrateMidiOutput(AudioDeviceManager &deviceManager)
+{
+    auto *scheduler = this->audioCore.getMidiOutputScheduler();
+    // the page may be closed while calibrating, which takes a few seconds
+    SafePointer<AudioSettings> page(this);
+    const auto onCalibrated = [page, &deviceManager](bool success, double)
+    {
+        if (!success)
+        {
+            App::Layout().showTooltip(TRANS(I18n::Settings::midiOutputCalibrationFailed),
+                MainLayout::TooltipIcon::Failure);
+            return;
+        }
+
+        if (page != nullptr)
+        {
+            page->syncMidiOutputsList(deviceManager);
+        }
+
+        App::Layout().showTooltip({}, MainLayout::TooltipIcon::Success);
+    };
+
+    if (!scheduler->startCalibration(onCalibrated))
+    {
+        App::Layout().showTooltip(TRANS(I18n::Settings::midiOutputCalibrationFailed),
+            MainLayout::TooltipIcon::Failure);
+    }
+}
+
 void AudioSettings::applyMidiInput(AudioDeviceManager &deviceManager, const String &deviceId)
 {
     this->audioCore.resetActiveMidiPlayer();
@@ -465,6 +550,11 @@ void AudioSettings::syncMidiInputsList(AudioDeviceManager &deviceManager)
             CommandIDs::SelectMidiInputDevice + i, devices[i].name));
     }
 
+    // the clock from any enabled input controls the playback
+    const bool isFollowingClock = this->audioCore.getMidiClockFollower()->isEnabled();
+    menu.add(MenuItem::item(isFollowingClock ? Icons::apply : Icons::empty,
+        CommandIDs::ToggleMidiClockInput, TRANS(I18n::Settings::midiClockFollow)));
+
     const auto selectedDeviceName = areNoMidiInputsSelected(deviceManager, devices) ?
         TRANS(I18n::Settings::midiNoDevicesFound) :
         getFirstSelectedMidiInputDevice(deviceManager, devices);
@@ -498,9 +588,33 @@ void AudioSettings::syncMidiOutputsList(AudioDeviceManager &deviceManager)
             CommandIDs::SelectMidiOutputDevice + i, devices[i].name));
     }
 
-    const auto selectedDeviceName = defaultOutputDeviceId.isEmpty() ?
+    auto selectedDeviceName = defaultOutputDeviceId.isEmpty() ?
         TRANS(I18n::Settings::midiOutputNone) : defaultOutputDeviceName;
 
+    if (defaultOutputDeviceId.isNotEmpty())
+    {
+        // the loopback calibration measures how late the device sounds
+        menu.add(MenuItem::item(Icons::metronome,
+            CommandIDs::CalibrateMidiOutputLatency,
+            TRANS(I18n::Settings::midiOutputCalibrate))->closesMenu());
+
+        const auto *scheduler = this->audioCore.getMidiOutputScheduler();
+
+        menu.add(MenuItem::item(scheduler->isSendingMidiClock() ? Icons::apply : Icons::empty,
+            CommandIDs::ToggleMidiClockOutput, TRANS(I18n::Settings::midiClockSend)));
+
+        menu.add(MenuItem::item(scheduler->isSendingMidiTimecode() ? Icons::apply : Icons::empty,
+            CommandIDs::ToggleMidiTimecodeOutput, TRANS(I18n::Settings::midiTimecodeSend)));
+
+        const auto latencyMs = scheduler->getDeviceLatency(defaultOutputDeviceId);
+
+        if (latencyMs > 0.0)
+        {
+            selectedDeviceName << ", " << TRANS(I18n::Settings::midiOutputLatency)
+                << ": " << String(latencyMs, 1) << " ms";
+        }
+    }
+
     this->midiOutputEditor->setText(TRANS(I18n::Settings::midiOutput) +
         ": " + selectedDeviceName, dontSendNotification);
 
@@ -40,6 +40,7 @@ private:
     void applyBufferSize(AudioDeviceManager &deviceManager, int bufferSize);
     void applyMidiInput(AudioDeviceManager &deviceManager, const String &deviceId);
     void applyMidiOutput(AudioDeviceManager &deviceManager, const String &deviceId);
+    void calibrateMidiOutput(AudioDeviceManager &deviceManager);
 
     void syncDeviceTypesList(AudioDeviceManager &deviceManager);
     void syncDevicesList(AudioDeviceManager &deviceManager);
@@ -63,6 +64,7 @@ private:
     UniquePointer<TextEditor> midiInputEditor;
     UniquePointer<TextEditor> midiOutputEditor;
     UniquePointer<ToggleButton> midiInputRemappingCheckbox;
+    UniquePointer<ToggleButton> pluginSandboxingCheckbox;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioSettings)
 };
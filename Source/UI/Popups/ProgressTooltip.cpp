@@ -37,6 +37,19 @@ void ProgressTooltip::paint(Graphics& g)
     g.fillRoundedRectangle(this->getLocalBounds().toFloat(), 15.000f);
 }
 
+void ProgressTooltip::paintOverChildren(Graphics &g)
+{
+    if (this->shownPercentage < 0)
+    {
+        return;
+    }
+
+    g.setFont(Globals::UI::Fonts::S);
+    g.setColour(Colours::white.withAlpha(0.85f));
+    g.drawText(String(this->shownPercentage) + "%",
+        this->getLocalBounds(), Justification::centred, false);
+}
+
 void ProgressTooltip::resized()
 {
     Rectangle<int> imageBounds(0, 0, ProgressTooltip::imageSize, ProgressTooltip::imageSize);
@@ -69,7 +82,26 @@ bool ProgressTooltip::keyPressed(const KeyPress& key)
 
 void ProgressTooltip::inputAttemptWhenModal()
 {
-    this->postCommandMessage(CommandIDs::DismissModalDialogAsync);
+    if (this->cancelsOnClick)
+    {
+        this->postCommandMessage(CommandIDs::DismissModalDialogAsync);
+    }
+}
+
+void ProgressTooltip::timerCallback()
+{
+    const auto percentage = roundToInt(jlimit(0.f, 1.f, this->progressSource()) * 100.f);
+    if (percentage != this->shownPercentage)
+    {
+        this->shownPercentage = percentage;
+        this->repaint();
+    }
+}
+
+void ProgressTooltip::finish()
+{
+    this->stopTimer();
+    this->dismiss();
 }
 
 void ProgressTooltip::cancel()
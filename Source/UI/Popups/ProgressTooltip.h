@@ -22,7 +22,7 @@
 
 using SimpleCloseCallback = Function<void()>;
 
-class ProgressTooltip final : public CenteredTooltipComponent
+class ProgressTooltip final : public CenteredTooltipComponent, private Timer
 {
 public:
 
@@ -35,7 +35,25 @@ public:
         return tooltip;
     }
 
+    // shows the percentage polled from the given source; since the work
+    // can take a while, only the escape key cancels it, not any stray click
+    using ProgressSource = Function<float()>;
+    static UniquePointer<ProgressTooltip> withProgress(ProgressSource progressSource,
+        SimpleCloseCallback callback)
+    {
+        auto tooltip = make<ProgressTooltip>(true);
+        tooltip->onCancel = callback;
+        tooltip->progressSource = progressSource;
+        tooltip->cancelsOnClick = false;
+        tooltip->startTimerHz(15);
+        return tooltip;
+    }
+
+    // when the work is done: dismisses the tooltip without cancelling
+    void finish();
+
     void paint(Graphics &g) override;
+    void paintOverChildren(Graphics &g) override;
     void resized() override;
     void parentHierarchyChanged() override;
     void handleCommandMessage (int commandId) override;
@@ -49,8 +67,13 @@ private:
 
     SimpleCloseCallback onCancel;
     const bool isCancellable;
+    bool cancelsOnClick = true;
     void cancel();
 
+    void timerCallback() override;
+    ProgressSource progressSource;
+    int shownPercentage = -1;
+
     UniquePointer<ProgressIndicator> progressIndicator;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProgressTooltip)
@@ -159,19 +159,23 @@ QuickRescaleMenu::QuickRescaleMenu(const ProjectNode &project,
             const auto scales = App::Config().getScales()->getAll();
             if (!scales[i]->isEquivalentTo(this->event.getScale()))
             {
-                const bool hasMadeChanges = 
-                    SequencerOperations::rescale(this->project, this->event.getBeat(), this->endBeat,
-                    this->event.getRootKey(), this->event.getScale(), scales[i], true);
+                // the menu is gone by the time the rescaling is done
+                this->dismissCalloutAsync();
 
-                auto *keySequence = static_cast<KeySignaturesSequence *>(this->event.getSequence());
-                if (!hasMadeChanges)
+                const auto event = this->event;
+                const auto newScale = scales[i];
+                SequencerOperations::rescale(this->project, event.getBeat(), this->endBeat,
+                    event.getRootKey(), event.getScale(), newScale,
+                    [event, newScale](bool hasMadeChanges)
                 {
-                    keySequence->checkpoint();
-                }
-
-                keySequence->change(this->event, this->event.withScale(scales[i]), true);
-
-                this->dismissCalloutAsync();
+                    auto *keySequence = static_cast<KeySignaturesSequence *>(event.getSequence());
+                    if (!hasMadeChanges)
+                    {
+                        keySequence->checkpoint();
+                    }
+
+                    keySequence->change(event, event.withScale(newScale), true);
+                }, true);
             }
         }));
     }
@@ -37,6 +37,9 @@
 #include "KeySignaturesSequence.h"
 
 #include "Pattern.h"
+#include "SequenceSnapshot.h"
+#include "ParallelBatch.h"
+#include "ProgressTooltip.h"
 
 #include "UndoStack.h"
 #include "AutomationTrackActions.h"
@@ -1924,66 +1927,173 @@ void SequencerOperations::rescale(Lasso &selection, Note::Key rootKey,
     sequence->changeGroup(groupBefore, groupAfter, true);
 }
 
-bool SequencerOperations::rescale(const ProjectNode &project, float startBeat, float endBeat,
-    Note::Key rootKey, Scale::Ptr scaleA, Scale::Ptr scaleB, bool shouldCheckpoint /*= true*/)
+// The project-wide operations below process each track in parallel, reading only
+// the snapshot of its notes and the copies of its clips, taken on the message thread.
+// The user can't edit anything while the progress tooltip is shown, but the notes
+// may still change in the meantime (e.g. by the midi recorder), so when the results
+// are applied, the outdated tracks are re-read and processed again right away.
+
+struct ProjectTrackSnapshot
 {
-    bool hasMadeChanges = false;
-    bool didCheckpoint = !shouldCheckpoint;
+    void read(PianoTrackNode *pianoTrack)
+    {
+        this->track = pianoTrack;
+        this->notes = pianoTrack->getSequence()->getSnapshot();
+        this->clips.clearQuick();
+        for (const auto *clip : pianoTrack->getPattern()->getClips())
+        {
+            this->clips.add(*clip);
+        }
+    }
+
+    bool isOutdated() const
+    {
+        return this->notes != this->track->getSequence()->getSnapshot();
+    }
+
+    WeakReference<PianoTrackNode> track;
+    SequenceSnapshot::Ptr notes;
+    Array<Clip> clips;
+};
 
+template <typename T, typename ProcessFn, typename ApplyFn>
+static void runProjectTracksBatch(const ProjectNode &project,
+    ProcessFn process, ApplyFn apply)
+{
     const auto pianoTracks = project.findChildrenOfType<PianoTrackNode>();
-    for (const auto *track : pianoTracks)
+
+    auto items = std::make_shared<Array<T>>();
+    items->resize(pianoTracks.size());
+    for (int i = 0; i < pianoTracks.size(); ++i)
+    {
+        items->getReference(i).read(pianoTracks.getUnchecked(i));
+    }
+
+    auto batch = std::make_shared<ParallelBatch>(items->size(),
+        [items, process](int itemIndex)
+    {
+        process(items->getReference(itemIndex));
+    });
+
+    // the tooltip owns the batch, so that dismissing it abandons the results
+    const std::weak_ptr<ParallelBatch> weakBatch(batch);
+    auto tooltip = ProgressTooltip::withProgress([batch]()
+    {
+        return batch->getProgress();
+    },
+    [batch]()
+    {
+        batch->cancel();
+    });
+
+    const Component::SafePointer<ProgressTooltip> tooltipPointer(tooltip.get());
+    App::showModalComponent(move(tooltip));
+
+    batch->start([items, process, apply, weakBatch, tooltipPointer](bool isComplete)
+    {
+        MessageManager::callAsync([items, process, apply, weakBatch, tooltipPointer, isComplete]()
+        {
+            const auto batch = weakBatch.lock();
+            if (!isComplete || batch == nullptr || batch->isCancelled())
+            {
+                return;
+            }
+
+            // only this batch's own tooltip, which also releases the batch,
+            // while the other modal components, if any, are left alone
+            if (tooltipPointer != nullptr)
+            {
+                tooltipPointer->finish();
+            }
+
+            for (auto &item : *items)
+            {
+                if (item.track != nullptr && item.isOutdated())
+                {
+                    item.read(item.track.get());
+                    process(item);
+                }
+            }
+
+            apply(*items);
+        });
+    });
+}
+
+void SequencerOperations::rescale(const ProjectNode &project, float startBeat, float endBeat,
+    Note::Key rootKey, Scale::Ptr scaleA, Scale::Ptr scaleB,
+    Function<void(bool hasMadeChanges)> onDone, bool shouldCheckpoint /*= true*/)
+{
+    struct TrackRescale final : ProjectTrackSnapshot
     {
-        auto *sequence = static_cast<PianoSequence *>(track->getSequence());
+        PianoChangeGroup groupBefore;
+        PianoChangeGroup groupAfter;
+    };
 
-        PianoChangeGroup groupBefore, groupAfter;
+    const auto process = [startBeat, endBeat, rootKey, scaleA, scaleB](TrackRescale &rescale)
+    {
+        rescale.groupBefore.clearQuick();
+        rescale.groupAfter.clearQuick();
 
         // find events in between (only consider events of one clip!),
         // skipping clips of the same track if already processed any other:
 
         FlatHashSet<MidiEvent::Id> usedClips;
 
-        for (int i = 0; i < sequence->size(); ++i)
+        rescale.notes->forEach([&](const MidiEvent &event)
         {
-            const auto *note = static_cast<Note *>(sequence->getUnchecked(i));
-            for (const auto *clip : track->getPattern()->getClips())
+            const auto &note = static_cast<const Note &>(event);
+            for (const auto &clip : rescale.clips)
             {
-                if (usedClips.contains(clip->getId()) || usedClips.size() == 0)
+                if (usedClips.contains(clip.getId()) || usedClips.size() == 0)
                 {
-                    if ((note->getBeat() + clip->getBeat()) >= startBeat &&
-                        (note->getBeat() + clip->getBeat()) < endBeat)
+                    if ((note.getBeat() + clip.getBeat()) >= startBeat &&
+                        (note.getBeat() + clip.getBeat()) < endBeat)
                     {
-                        const auto keyOffset = rootKey - clip->getKey();
-                        doRescaleLogic(groupBefore, groupAfter, *note, keyOffset, scaleA, scaleB);
-                        usedClips.insert(clip->getId());
+                        const auto keyOffset = rootKey - clip.getKey();
+                        doRescaleLogic(rescale.groupBefore, rescale.groupAfter,
+                            note, keyOffset, scaleA, scaleB);
+                        usedClips.insert(clip.getId());
                     }
                 }
             }
-        }
+        });
+    };
 
-        if (groupBefore.size() == 0)
-        {
-            continue;
-        }
+    const auto apply = [onDone, shouldCheckpoint](Array<TrackRescale> &rescales)
+    {
+        bool hasMadeChanges = false;
+        bool didCheckpoint = !shouldCheckpoint;
 
-        if (!didCheckpoint)
+        for (const auto &rescale : rescales)
         {
-            sequence->checkpoint();
-            didCheckpoint = true;
+            if (rescale.track == nullptr || rescale.groupBefore.size() == 0)
+            {
+                continue;
+            }
+
+            auto *sequence = static_cast<PianoSequence *>(rescale.track->getSequence());
+
+            if (!didCheckpoint)
+            {
+                sequence->checkpoint();
+                didCheckpoint = true;
+            }
+
+            hasMadeChanges = true;
+            sequence->changeGroup(rescale.groupBefore, rescale.groupAfter, true);
         }
 
-        hasMadeChanges = true;
-        sequence->changeGroup(groupBefore, groupAfter, true);
-    }
+        onDone(hasMadeChanges);
+    };
 
-    return hasMadeChanges;
+    runProjectTracksBatch<TrackRescale>(project, process, apply);
 }
 
-bool SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
-    Temperament::Ptr temperament, bool shouldCheckpoint)
+void SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
+    Temperament::Ptr temperament, Function<void(bool hasMadeChanges)> onDone,
+    bool shouldCheckpoint /*= true*/)
 {
-    bool hasMadeChanges = false;
-    bool didCheckpoint = !shouldCheckpoint;
-
     const auto currentTemperament = project.getProjectInfo()->getTemperament();
     const auto chromaticMapFrom = currentTemperament->getChromaticMap();
     const auto chromaticMapTo = temperament->getChromaticMap();
@@ -1992,15 +2102,19 @@ bool SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
         !chromaticMapFrom->isValid() || !chromaticMapTo->isValid())
     {
         jassertfalse;
-        return false;
+        onDone(false);
+        return;
     }
 
     const auto periodSizeBefore = currentTemperament->getPeriodSize();
     const auto periodSizeAfter = temperament->getPeriodSize();
 
     // a helper to find a key signature at certain beat
-    // works similarly to findHarmonicContext, but simpler:
-    auto *keySignatures = project.getTimeline()->getKeySignatures()->getSequence();
+    // works similarly to findHarmonicContext, but simpler;
+    // it is called from the worker threads, so it reads the snapshot:
+    const auto keySignatures = project.getTimeline()->
+        getKeySignatures()->getSequence()->getSnapshot();
+
     const auto findRootKey = [keySignatures](float beat)
     {
         if (keySignatures->size() == 0)
@@ -2012,12 +2126,12 @@ bool SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
 
         for (int i = 0; i < keySignatures->size(); ++i)
         {
-            auto *ks = keySignatures->getUnchecked(i);
+            const auto *ks = keySignatures->getUnchecked(i);
             if (context == nullptr || ks->getBeat() <= beat)
             {
                 // take the first one no matter where it resides;
                 // if event is still before the sequence beat, update the context anyway:
-                context = static_cast<KeySignatureEvent *>(ks);
+                context = static_cast<const KeySignatureEvent *>(ks);
             }
             else if (ks->getBeat() >= beat)
             {
@@ -2035,24 +2149,32 @@ bool SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
         return 0;
     };
 
-    const auto pianoTracks = project.findChildrenOfType<PianoTrackNode>();
-    for (const auto *track : pianoTracks)
+    struct TrackRemap final : ProjectTrackSnapshot
+    {
+        Array<Note> notesBefore, notesAfter;
+        Array<Clip> clipsBefore, clipsAfter;
+    };
+
+    const auto process = [=](TrackRemap &remap)
     {
+        remap.notesBefore.clearQuick();
+        remap.notesAfter.clearQuick();
+        remap.clipsBefore.clearQuick();
+        remap.clipsAfter.clearQuick();
+
         // upscaling temperament from twelve-tone is really straightforward,
         // but we'll also support downscaling from larger temperament to smaller one:
         // for that we'll just round each key to the nearest key of chromatic approximation scale
-        auto *sequence = static_cast<PianoSequence *>(track->getSequence());
 
-        Array<Note> notesBefore, notesAfter;
-        for (int n = 0; n < sequence->size(); ++n)
+        remap.notes->forEach([&](const MidiEvent &event)
         {
-            const auto *note = static_cast<Note *>(sequence->getUnchecked(n));
+            const auto &note = static_cast<const Note &>(event);
 
-            const auto rootKeyBefore = findRootKey(note->getBeat());
+            const auto rootKeyBefore = findRootKey(note.getBeat());
             const auto rootIndexInChromaticMap = chromaticMapFrom->getNearestScaleKey(rootKeyBefore);
             const auto rootKeyAfter = chromaticMapTo->getChromaticKey(rootIndexInChromaticMap, 0, true);
 
-            const auto key = note->getKey() - rootKeyBefore;
+            const auto key = note.getKey() - rootKeyBefore;
             const auto periodNum = key / periodSizeBefore;
             const auto relativeKey = key % periodSizeBefore;
 
@@ -2061,21 +2183,15 @@ bool SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
             const auto newRelativeKey = chromaticMapTo->getChromaticKey(keyIndexInChromaticMap, rootKeyAfter, false);
             const auto newKey = periodNum * periodSizeAfter + newRelativeKey;
 
-            notesBefore.add(*note);
-            notesAfter.add(note->withKey(newKey));
-        }
+            remap.notesBefore.add(note);
+            remap.notesAfter.add(note.withKey(newKey));
+        });
 
         // same mapping rules apply to any keys, so we will adjust clip key offsets as well
 
-        auto *pattern = track->getPattern();
-
-        Array<Clip> clipsBefore, clipsAfter;
-
-        for (int i = 0; i < pattern->size(); ++i)
+        for (const auto &clip : remap.clips)
         {
-            const auto *clip = pattern->getUnchecked(i);
-
-            const auto key = clip->getKey();
+            const auto key = clip.getKey();
             const auto periodNum = key / periodSizeBefore;
             const auto relativeKey = key % periodSizeBefore;
             const auto keySign = (key > 0) - (key < 0); // key offset can be negative
@@ -2084,37 +2200,52 @@ bool SequencerOperations::remapNotesToTemperament(const ProjectNode &project,
             const auto newRelativeKey = chromaticMapTo->getChromaticKey(keyIndexInChromaticMap, 0, false);
             const auto newKey = periodNum * periodSizeAfter + newRelativeKey * keySign;
 
-            clipsBefore.add(*clip);
-            clipsAfter.add(clip->withKey(newKey));
+            remap.clipsBefore.add(clip);
+            remap.clipsAfter.add(clip.withKey(newKey));
         }
+    };
 
-        // now just apply changes
+    // now just apply changes
 
-        if (notesBefore.isEmpty() && clipsBefore.isEmpty())
-        {
-            continue;
-        }
+    const auto apply = [onDone, shouldCheckpoint](Array<TrackRemap> &remaps)
+    {
+        bool hasMadeChanges = false;
+        bool didCheckpoint = !shouldCheckpoint;
 
-        if (!didCheckpoint)
+        for (const auto &remap : remaps)
         {
-            sequence->checkpoint();
-            didCheckpoint = true;
-        }
+            if (remap.track == nullptr ||
+                (remap.notesBefore.isEmpty() && remap.clipsBefore.isEmpty()))
+            {
+                continue;
+            }
 
-        hasMadeChanges = true;
+            auto *track = remap.track.get();
+            auto *sequence = static_cast<PianoSequence *>(track->getSequence());
 
-        if (!notesBefore.isEmpty())
-        {
-            sequence->changeGroup(notesBefore, notesAfter, true);
-        }
+            if (!didCheckpoint)
+            {
+                sequence->checkpoint();
+                didCheckpoint = true;
+            }
 
-        if (!clipsBefore.isEmpty())
-        {
-            pattern->changeGroup(clipsBefore, clipsAfter, true);
+            hasMadeChanges = true;
+
+            if (!remap.notesBefore.isEmpty())
+            {
+                sequence->changeGroup(remap.notesBefore, remap.notesAfter, true);
+            }
+
+            if (!remap.clipsBefore.isEmpty())
+            {
+                track->getPattern()->changeGroup(remap.clipsBefore, remap.clipsAfter, true);
+            }
         }
-    }
 
-    return hasMadeChanges;
+        onDone(hasMadeChanges);
+    };
+
+    runProjectTracksBatch<TrackRemap>(project, process, apply);
 }
 
 bool SequencerOperations::remapKeySignaturesToTemperament(KeySignaturesSequence *keySignatures,
@@ -2204,36 +2335,24 @@ bool SequencerOperations::findHarmonicContext(float startBeat, float endBeat,
             return false;
         }
 
-        const KeySignatureEvent *context = nullptr;
+        // The context is the last key signature at or before the start beat,
+        // or, if there are none, the first one, no matter where it resides:
+        const auto firstAfterStart = keySignatures->upperBound(startBeat);
+        const auto contextIndex = jmax(0, firstAfterStart - 1);
+        const auto nextIndex = contextIndex + 1;
 
-        for (int i = 0; i < keySignatures->size(); ++i)
+        if (nextIndex < keySignatures->size() &&
+            keySignatures->getUnchecked(nextIndex)->getBeat() < endBeat)
         {
-            const auto event = keySignatures->getUnchecked(i);
-            if (context == nullptr || event->getBeat() <= startBeat)
-            {
-                // Take the first one no matter where it resides;
-                // If event is still before the sequence start, update the context anyway:
-                context = static_cast<KeySignatureEvent *>(event);
-            }
-            else if (event->getBeat() > startBeat && event->getBeat() < endBeat)
-            {
-                // Harmonic context is already here and changes within a sequence:
-                return false;
-            }
-            else if (event->getBeat() >= endBeat)
-            {
-                // No need to look further
-                break;
-            }
+            // Harmonic context is already here and changes within a sequence:
+            return false;
         }
 
-        if (context != nullptr)
-        {
-            // We've found the only context that doesn't change within a sequence:
-            outScale = context->getScale();
-            outRootKey = context->getRootKey();
-            return true;
-        }
+        // We've found the only context that doesn't change within a sequence:
+        const auto *context = static_cast<KeySignatureEvent *>(keySignatures->getUnchecked(contextIndex));
+        outScale = context->getScale();
+        outRootKey = context->getRootKey();
+        return true;
     }
 
     return false;
@@ -109,11 +109,16 @@ struct SequencerOperations final
     static void rescale(Lasso &selection, Note::Key rootKey,
         Scale::Ptr scaleA, Scale::Ptr scaleB, bool shouldCheckpoint = true);
 
-    static bool rescale(const ProjectNode &project, float startBeat, float endBeat,
-        Note::Key rootKey, Scale::Ptr scaleA, Scale::Ptr scaleB, bool shouldCheckpoint = true);
-
-    static bool remapNotesToTemperament(const ProjectNode &project,
-        Temperament::Ptr temperament, bool shouldCheckpoint = true);
+    // these two process the tracks in the background, showing a cancellable
+    // progress tooltip, and apply the changes later on the message thread,
+    // calling back after that; if cancelled, nothing is changed or called
+    static void rescale(const ProjectNode &project, float startBeat, float endBeat,
+        Note::Key rootKey, Scale::Ptr scaleA, Scale::Ptr scaleB,
+        Function<void(bool hasMadeChanges)> onDone, bool shouldCheckpoint = true);
+
+    static void remapNotesToTemperament(const ProjectNode &project,
+        Temperament::Ptr temperament, Function<void(bool hasMadeChanges)> onDone,
+        bool shouldCheckpoint = true);
 
     static bool remapKeySignaturesToTemperament(KeySignaturesSequence *keySignatures,
         Temperament::Ptr currentTemperament, Temperament::Ptr otherTemperament,
@@ -433,15 +433,39 @@ void VelocityProjectMap::mouseWheelMove(const MouseEvent &e, const MouseWheelDet
 
 void VelocityProjectMap::onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2)
 {
-    if (e1.isTypeOf(MidiEvent::Type::Note))
+    this->onChangeMidiEvents(MidiEventsBatch(&e1), MidiEventsBatch(&e2));
+}
+
+void VelocityProjectMap::onAddMidiEvent(const MidiEvent &event)
+{
+    this->onAddMidiEvents(MidiEventsBatch(&event));
+}
+
+void VelocityProjectMap::onRemoveMidiEvent(const MidiEvent &event)
+{
+    this->onRemoveMidiEvents(MidiEventsBatch(&event));
+}
+
+// all events of a batch belong to the same sequence,
+// so they are either all notes, or all something else
+
+void VelocityProjectMap::onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    if (newEvents.isEmpty() || !newEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(e1);
-        const Note &newNote = static_cast<const Note &>(e2);
-        const auto *track = newNote.getSequence()->getTrack();
+        return;
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    const auto *track = newEvents.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (int i = 0; i < newEvents.size(); ++i)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
+            const auto &newNote = static_cast<const Note &>(*newEvents.getUnchecked(i));
             if (auto *component = sequenceMap[note].release())
             {
                 sequenceMap.erase(note);
@@ -452,55 +476,65 @@ void VelocityProjectMap::onChangeMidiEvent(const MidiEvent &e1, const MidiEvent
     }
 }
 
-void VelocityProjectMap::onAddMidiEvent(const MidiEvent &event)
+void VelocityProjectMap::onAddMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() || !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        VELOCITY_MAP_BULK_REPAINT_START
+    const auto *track = events.getFirst()->getSequence()->getTrack();
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
-        {
-            auto &componentsMap = *c.second.get();
-            const int i = track->getPattern()->indexOfSorted(&c.first);
-            jassert(i >= 0);
+    VELOCITY_MAP_BULK_REPAINT_START
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &componentsMap = *c.second.get();
+        const int i = track->getPattern()->indexOfSorted(&c.first);
+        jassert(i >= 0);
 
-            const auto *clip = track->getPattern()->getUnchecked(i);
-            const bool editable = this->activeClip == *clip;
+        const auto *clip = track->getPattern()->getUnchecked(i);
+        const bool editable = this->activeClip == *clip;
 
+        for (const auto *event : events)
+        {
+            const auto &note = static_cast<const Note &>(*event);
             auto *noteComponent = new VelocityMapNoteComponent(note, *clip);
             noteComponent->setEditable(editable);
             componentsMap[note] = UniquePointer<VelocityMapNoteComponent>(noteComponent);
             this->addAndMakeVisible(noteComponent);
             this->triggerBatchRepaintFor(noteComponent);
         }
-
-        VELOCITY_MAP_BULK_REPAINT_END
     }
+
+    VELOCITY_MAP_BULK_REPAINT_END
 }
 
-void VelocityProjectMap::onRemoveMidiEvent(const MidiEvent &event)
+void VelocityProjectMap::onRemoveMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() || !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        VELOCITY_MAP_BULK_REPAINT_START
+    const auto *track = events.getFirst()->getSequence()->getTrack();
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    VELOCITY_MAP_BULK_REPAINT_START
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*event);
             if (sequenceMap.contains(note))
             {
                 sequenceMap.erase(note);
             }
         }
-
-        VELOCITY_MAP_BULK_REPAINT_END
     }
+
+    VELOCITY_MAP_BULK_REPAINT_END
 }
 
 void VelocityProjectMap::onAddClip(const Clip &clip)
@@ -56,6 +56,10 @@ public:
     void onAddMidiEvent(const MidiEvent &event) override;
     void onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2) override;
     void onRemoveMidiEvent(const MidiEvent &event) override;
+    void onAddMidiEvents(const MidiEventsBatch &events) override;
+    void onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+        const MidiEventsBatch &newEvents) override;
+    void onRemoveMidiEvents(const MidiEventsBatch &events) override;
 
     void onAddClip(const Clip &clip) override;
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
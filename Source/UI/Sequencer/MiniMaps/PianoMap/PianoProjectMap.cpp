@@ -105,61 +105,93 @@ void PianoProjectMap::paint(Graphics &g)
 
 void PianoProjectMap::onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2)
 {
-    if (e1.isTypeOf(MidiEvent::Type::Note))
+    this->onChangeMidiEvents(MidiEventsBatch(&e1), MidiEventsBatch(&e2));
+}
+
+void PianoProjectMap::onAddMidiEvent(const MidiEvent &event)
+{
+    this->onAddMidiEvents(MidiEventsBatch(&event));
+}
+
+void PianoProjectMap::onRemoveMidiEvent(const MidiEvent &event)
+{
+    this->onRemoveMidiEvents(MidiEventsBatch(&event));
+}
+
+// all events of a batch belong to the same sequence,
+// so they are either all notes, or all something else
+
+void PianoProjectMap::onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    if (newEvents.isEmpty() || !newEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(e1);
-        const Note &newNote = static_cast<const Note &>(e2);
-        const auto *track = newNote.getSequence()->getTrack();
+        return;
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    const auto *track = newEvents.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (int i = 0; i < newEvents.size(); ++i)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
             if (sequenceMap.contains(note))
             {
                 sequenceMap.erase(note);
-                sequenceMap.insert(newNote);
+                sequenceMap.insert(static_cast<const Note &>(*newEvents.getUnchecked(i)));
             }
         }
-
-        this->triggerAsyncUpdate();
     }
+
+    this->triggerAsyncUpdate();
 }
 
-void PianoProjectMap::onAddMidiEvent(const MidiEvent &event)
+void PianoProjectMap::onAddMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() || !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    const auto *track = events.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
-            sequenceMap.insert(note);
+            sequenceMap.insert(static_cast<const Note &>(*event));
         }
-
-        this->triggerAsyncUpdate();
     }
+
+    this->triggerAsyncUpdate();
 }
 
-void PianoProjectMap::onRemoveMidiEvent(const MidiEvent &event)
+void PianoProjectMap::onRemoveMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() || !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        return;
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    const auto *track = events.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*event);
             if (sequenceMap.contains(note))
             {
                 sequenceMap.erase(note);
             }
         }
-
-        this->triggerAsyncUpdate();
     }
+
+    this->triggerAsyncUpdate();
 }
 
 void PianoProjectMap::onAddClip(const Clip &clip)
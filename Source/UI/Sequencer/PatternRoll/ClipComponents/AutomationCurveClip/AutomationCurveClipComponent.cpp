@@ -33,6 +33,7 @@ AutomationCurveClipComponent::AutomationCurveClipComponent(ProjectNode &project,
     ClipComponent(roll, clip),
     project(project),
     sequence(sequence),
+    trackId(clip.getTrackId()),
     draggingEvent(nullptr),
     addNewEventMode(false)
 {
@@ -41,12 +42,12 @@ AutomationCurveClipComponent::AutomationCurveClipComponent(ProjectNode &project,
 
     this->reloadTrack();
 
-    this->project.addListener(this);
+    this->project.addTrackListener(this->trackId, this);
 }
 
 AutomationCurveClipComponent::~AutomationCurveClipComponent()
 {
-    this->project.removeListener(this);
+    this->project.removeTrackListener(this->trackId, this);
 }
 
 //===----------------------------------------------------------------------===//
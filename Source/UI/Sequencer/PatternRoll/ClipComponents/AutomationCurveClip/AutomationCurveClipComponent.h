@@ -102,6 +102,9 @@ private:
     ProjectNode &project;
     WeakReference<MidiSequence> sequence;
 
+    // only this track's notifications are of interest
+    const String trackId;
+
     OwnedArray<AutomationCurveEventComponent> eventComponents;
     FlatHashMap<AutomationEvent, AutomationCurveEventComponent *, MidiEventHash> eventsHash;
 
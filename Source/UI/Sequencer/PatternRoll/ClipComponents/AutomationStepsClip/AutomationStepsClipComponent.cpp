@@ -30,7 +30,8 @@ AutomationStepsClipComponent::AutomationStepsClipComponent(ProjectNode &project,
     MidiSequence *sequence, RollBase &roll, const Clip &clip) :
     ClipComponent(roll, clip),
     project(project),
-    sequence(sequence)
+    sequence(sequence),
+    trackId(clip.getTrackId())
 {
     this->setPaintingIsUnclipped(false);
     this->setMouseClickGrabsKeyboardFocus(false);
@@ -38,12 +39,12 @@ AutomationStepsClipComponent::AutomationStepsClipComponent(ProjectNode &project,
 
     this->reloadTrack();
 
-    this->project.addListener(this);
+    this->project.addTrackListener(this->trackId, this);
 }
 
 AutomationStepsClipComponent::~AutomationStepsClipComponent()
 {
-    this->project.removeListener(this);
+    this->project.removeTrackListener(this->trackId, this);
 }
 
 //===----------------------------------------------------------------------===//
@@ -95,6 +95,9 @@ private:
     ProjectNode &project;
     WeakReference<MidiSequence> sequence;
 
+    // only this track's notifications are of interest
+    const String trackId;
+
     OwnedArray<AutomationStepEventComponent> eventComponents;
     FlatHashMap<AutomationEvent, AutomationStepEventComponent *, MidiEventHash> eventsHash;
 
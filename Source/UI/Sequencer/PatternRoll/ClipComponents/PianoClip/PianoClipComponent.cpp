@@ -31,16 +31,17 @@ PianoClipComponent::PianoClipComponent(ProjectNode &project, MidiSequence *seque
     RollBase &roll, const Clip &clip) :
     ClipComponent(roll, clip),
     project(project),
-    sequence(sequence)
+    sequence(sequence),
+    trackId(clip.getTrackId())
 {
     this->setPaintingIsUnclipped(true);
     this->reloadTrackMap();
-    this->project.addListener(this);
+    this->project.addTrackListener(this->trackId, this);
 }
 
 PianoClipComponent::~PianoClipComponent()
 {
-    this->project.removeListener(this);
+    this->project.removeTrackListener(this->trackId, this);
 }
 
 //===----------------------------------------------------------------------===//
@@ -72,48 +73,81 @@ void PianoClipComponent::paint(Graphics &g)
 
 void PianoClipComponent::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent)
 {
-    if (oldEvent.isTypeOf(MidiEvent::Type::Note))
+    this->onChangeMidiEvents(MidiEventsBatch(&oldEvent), MidiEventsBatch(&newEvent));
+}
+
+void PianoClipComponent::onAddMidiEvent(const MidiEvent &event)
+{
+    this->onAddMidiEvents(MidiEventsBatch(&event));
+}
+
+void PianoClipComponent::onRemoveMidiEvent(const MidiEvent &event)
+{
+    this->onRemoveMidiEvents(MidiEventsBatch(&event));
+}
+
+// all events of a batch belong to the same sequence, so
+// the ones of the other sequences are skipped right away
+
+void PianoClipComponent::onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    if (newEvents.isEmpty() ||
+        newEvents.getFirst()->getSequence() != this->sequence ||
+        !newEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(oldEvent);
-        const Note &newNote = static_cast<const Note &>(newEvent);
-        if (newNote.getSequence() != this->sequence) { return; }
+        return;
+    }
 
+    for (int i = 0; i < newEvents.size(); ++i)
+    {
+        const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
         if (this->displayedNotes.contains(note))
         {
             this->displayedNotes.erase(note);
-            this->displayedNotes.insert(newNote);
+            this->displayedNotes.insert(static_cast<const Note &>(*newEvents.getUnchecked(i)));
         }
-
-        this->roll.triggerBatchRepaintFor(this);
     }
+
+    this->roll.triggerBatchRepaintFor(this);
 }
 
-void PianoClipComponent::onAddMidiEvent(const MidiEvent &event)
+void PianoClipComponent::onAddMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() ||
+        events.getFirst()->getSequence() != this->sequence ||
+        !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        if (note.getSequence() != this->sequence) { return; }
+        return;
+    }
 
-        this->displayedNotes.insert(note);
-        this->roll.triggerBatchRepaintFor(this);
+    for (const auto *event : events)
+    {
+        this->displayedNotes.insert(static_cast<const Note &>(*event));
     }
+
+    this->roll.triggerBatchRepaintFor(this);
 }
 
-void PianoClipComponent::onRemoveMidiEvent(const MidiEvent &event)
+void PianoClipComponent::onRemoveMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() ||
+        events.getFirst()->getSequence() != this->sequence ||
+        !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        if (note.getSequence() != this->sequence) { return; }
+        return;
+    }
 
+    for (const auto *event : events)
+    {
+        const auto &note = static_cast<const Note &>(*event);
         if (this->displayedNotes.contains(note))
         {
             this->displayedNotes.erase(note);
         }
-
-        this->roll.triggerBatchRepaintFor(this);
     }
+
+    this->roll.triggerBatchRepaintFor(this);
 }
 
 void PianoClipComponent::onChangeClip(const Clip &oldClip, const Clip &newClip)
@@ -49,6 +49,10 @@ public:
     void onChangeMidiEvent(const MidiEvent &e1, const MidiEvent &e2) override;
     void onAddMidiEvent(const MidiEvent &event) override;
     void onRemoveMidiEvent(const MidiEvent &event) override;
+    void onAddMidiEvents(const MidiEventsBatch &events) override;
+    void onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+        const MidiEventsBatch &newEvents) override;
+    void onRemoveMidiEvents(const MidiEventsBatch &events) override;
 
     void onAddClip(const Clip &clip) override {}
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
@@ -70,6 +74,9 @@ private:
 
     ProjectNode &project;
     WeakReference<MidiSequence> sequence;
+
+    // only this track's notifications are of interest
+    const String trackId;
     FlatHashSet<Note, MidiEventHash> displayedNotes;
 
     int keyboardSize = Globals::twelveToneKeyboardSize;
@@ -437,6 +437,26 @@ void PatternRoll::onChangeClip(const Clip &clip, const Clip &newClip)
     RollBase::onChangeClip(clip, newClip);
 }
 
+void PatternRoll::onChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips)
+{
+    for (int i = 0; i < newClips.size(); ++i)
+    {
+        const auto &clip = *oldClips.getUnchecked(i);
+        if (const auto component = this->clipComponents[clip].release())
+        {
+            this->clipComponents.erase(clip);
+            this->clipComponents[*newClips.getUnchecked(i)] = UniquePointer<ClipComponent>(component);
+            this->triggerBatchRepaintFor(component);
+        }
+    }
+
+    // notifies the selection listeners, once per batch
+    if (!newClips.isEmpty())
+    {
+        RollBase::onChangeClip(*oldClips.getFirst(), *newClips.getFirst());
+    }
+}
+
 void PatternRoll::onRemoveClip(const Clip &clip)
 {
     if (const auto deletedComponent = this->clipComponents[clip].get())
@@ -56,6 +56,7 @@ public:
     void onAddClip(const Clip &clip) override;
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
     void onRemoveClip(const Clip &clip) override;
+    void onChangeClips(const ClipsBatch &oldClips, const ClipsBatch &newClips) override;
     void onPostRemoveClip(Pattern *const pattern) override;
 
     void onAddTrack(MidiTrack *const track) override;
@@ -474,17 +474,91 @@ void PianoRoll::moveDragHelpers(const float deltaBeat, const int deltaKey)
 // ProjectListener
 //===----------------------------------------------------------------------===//
 
+// The single notes are handled as the batches of one note,
+// and the batches of the other events, as separate events
+
 void PianoRoll::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent)
 {
     if (oldEvent.isTypeOf(MidiEvent::Type::Note))
     {
-        const auto &note = static_cast<const Note &>(oldEvent);
-        const auto &newNote = static_cast<const Note &>(newEvent);
-        const auto *track = newEvent.getSequence()->getTrack();
+        this->onChangeMidiEvents(MidiEventsBatch(&oldEvent), MidiEventsBatch(&newEvent));
+        return;
+    }
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    if (oldEvent.isTypeOf(MidiEvent::Type::KeySignature))
+    {
+        const auto &oldKey = static_cast<const KeySignatureEvent &>(oldEvent);
+        const auto &newKey = static_cast<const KeySignatureEvent &>(newEvent);
+        if (oldKey.getRootKey() != newKey.getRootKey() ||
+            !oldKey.getScale()->isEquivalentTo(newKey.getScale()))
         {
-            auto &sequenceMap = *c.second.get();
+            this->removeBackgroundCacheFor(oldKey);
+            this->updateBackgroundCacheFor(newKey);
+        }
+        this->repaint();
+    }
+
+    RollBase::onChangeMidiEvent(oldEvent, newEvent);
+}
+
+void PianoRoll::onAddMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onAddMidiEvents(MidiEventsBatch(&event));
+        return;
+    }
+
+    if (event.isTypeOf(MidiEvent::Type::KeySignature))
+    {
+        // Repainting background caches on the fly may be costly
+        const auto &key = static_cast<const KeySignatureEvent &>(event);
+        this->updateBackgroundCacheFor(key);
+        this->repaint();
+    }
+
+    RollBase::onAddMidiEvent(event);
+}
+
+void PianoRoll::onRemoveMidiEvent(const MidiEvent &event)
+{
+    if (event.isTypeOf(MidiEvent::Type::Note))
+    {
+        this->onRemoveMidiEvents(MidiEventsBatch(&event));
+        return;
+    }
+
+    if (event.isTypeOf(MidiEvent::Type::KeySignature))
+    {
+        const KeySignatureEvent &key = static_cast<const KeySignatureEvent &>(event);
+        this->removeBackgroundCacheFor(key);
+        this->repaint();
+    }
+
+    RollBase::onRemoveMidiEvent(event);
+}
+
+// All events of a batch belong to the same sequence, so they are either
+// all notes, or all something else, and the track is only looked up once
+
+void PianoRoll::onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+    const MidiEventsBatch &newEvents)
+{
+    if (newEvents.isEmpty() || !newEvents.getFirst()->isTypeOf(MidiEvent::Type::Note))
+    {
+        RollBase::onChangeMidiEvents(oldEvents, newEvents);
+        return;
+    }
+
+    const auto *track = newEvents.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (int i = 0; i < newEvents.size(); ++i)
+        {
+            const auto &note = static_cast<const Note &>(*oldEvents.getUnchecked(i));
+            const auto &newNote = static_cast<const Note &>(*newEvents.getUnchecked(i));
             if (auto *component = sequenceMap[note].release())
             {
                 // Pass ownership to another key:
@@ -499,47 +573,42 @@ void PianoRoll::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &ne
             }
         }
     }
-    else if (oldEvent.isTypeOf(MidiEvent::Type::KeySignature))
-    {
-        const auto &oldKey = static_cast<const KeySignatureEvent &>(oldEvent);
-        const auto &newKey = static_cast<const KeySignatureEvent &>(newEvent);
-        if (oldKey.getRootKey() != newKey.getRootKey() ||
-            !oldKey.getScale()->isEquivalentTo(newKey.getScale()))
-        {
-            this->removeBackgroundCacheFor(oldKey);
-            this->updateBackgroundCacheFor(newKey);
-        }
-        this->repaint();
-    }
 
-    RollBase::onChangeMidiEvent(oldEvent, newEvent);
+    // notifies the selection listeners, once per batch
+    RollBase::onChangeMidiEvent(*oldEvents.getFirst(), *newEvents.getFirst());
 }
 
-void PianoRoll::onAddMidiEvent(const MidiEvent &event)
+void PianoRoll::onAddMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() || !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
+    {
+        RollBase::onAddMidiEvents(events);
+        return;
+    }
+
+    const auto *track = events.getFirst()->getSequence()->getTrack();
+
+    // TODO check this in a more elegant way
+    // (needed not to break shift+drag note copying)
+    const bool isCurrentlyDraggingNote = this->draggingHelper->isVisible();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
     {
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+        auto &sequenceMap = *c.second.get();
+        const auto *targetParams = &c.first;
+        const int i = track->getPattern()->indexOfSorted(targetParams);
+        jassert(i >= 0);
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+        const Clip *realClip = track->getPattern()->getUnchecked(i);
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
-            const auto *targetParams = &c.first;
-            const int i = track->getPattern()->indexOfSorted(targetParams);
-            jassert(i >= 0);
-            
-            const Clip *realClip = track->getPattern()->getUnchecked(i);
+            const auto &note = static_cast<const Note &>(*event);
             auto *component = new NoteComponent(*this, note, *realClip);
             sequenceMap[note] = UniquePointer<NoteComponent>(component);
             this->addAndMakeVisible(component);
 
             this->fader.fadeIn(component, Globals::UI::fadeInLong);
 
-            // TODO check this in a more elegant way
-            // (needed not to break shift+drag note copying)
-            const bool isCurrentlyDraggingNote = this->draggingHelper->isVisible();
-
             const bool isActive = component->belongsTo(this->activeTrack, this->activeClip);
             component->setActive(isActive, true);
 
@@ -559,30 +628,27 @@ void PianoRoll::onAddMidiEvent(const MidiEvent &event)
             }
         }
     }
-    else if (event.isTypeOf(MidiEvent::Type::KeySignature))
-    {
-        // Repainting background caches on the fly may be costly
-        const auto &key = static_cast<const KeySignatureEvent &>(event);
-        this->updateBackgroundCacheFor(key);
-        this->repaint();
-    }
-
-    RollBase::onAddMidiEvent(event);
 }
 
-void PianoRoll::onRemoveMidiEvent(const MidiEvent &event)
+void PianoRoll::onRemoveMidiEvents(const MidiEventsBatch &events)
 {
-    if (event.isTypeOf(MidiEvent::Type::Note))
+    if (events.isEmpty() || !events.getFirst()->isTypeOf(MidiEvent::Type::Note))
     {
-        this->hideDragHelpers();
-        this->hideAllGhostNotes(); // Avoids crash
+        RollBase::onRemoveMidiEvents(events);
+        return;
+    }
 
-        const Note &note = static_cast<const Note &>(event);
-        const auto *track = note.getSequence()->getTrack();
+    this->hideDragHelpers();
+    this->hideAllGhostNotes(); // Avoids crash
 
-        forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    const auto *track = events.getFirst()->getSequence()->getTrack();
+
+    forEachSequenceMapOfGivenTrack(this->patternMap, c, track)
+    {
+        auto &sequenceMap = *c.second.get();
+        for (const auto *event : events)
         {
-            auto &sequenceMap = *c.second.get();
+            const auto &note = static_cast<const Note &>(*event);
             if (sequenceMap.contains(note))
             {
                 NoteComponent *deletedComponent = sequenceMap[note].get();
@@ -592,14 +658,6 @@ void PianoRoll::onRemoveMidiEvent(const MidiEvent &event)
             }
         }
     }
-    else if (event.isTypeOf(MidiEvent::Type::KeySignature))
-    {
-        const KeySignatureEvent &key = static_cast<const KeySignatureEvent &>(event);
-        this->removeBackgroundCacheFor(key);
-        this->repaint();
-    }
-
-    RollBase::onRemoveMidiEvent(event);
 }
 
 void PianoRoll::onAddClip(const Clip &clip)
@@ -879,23 +937,57 @@ void PianoRoll::selectEventsInRange(float startBeat, float endBeat, bool shouldC
         this->selection.deselectAll();
     }
 
-    forEachEventComponent(this->patternMap, e)
+    // only the active clip's notes are selectable, and they are sorted
+    // by beat, so the range is just a couple of binary searches away
+    auto *sequenceMap = this->getActiveSequenceMap();
+    if (sequenceMap == nullptr)
+    {
+        return;
+    }
+
+    const auto *sequence = static_cast<const PianoSequence *>(this->activeTrack->getSequence());
+    const auto clipBeat = this->activeClip.getBeat();
+    const auto lastIndex = sequence->lowerBound(endBeat - clipBeat);
+
+    for (int i = sequence->lowerBound(startBeat - clipBeat); i < lastIndex; ++i)
     {
-        auto *component = e.second.get();
-        if (component->isActive() &&
-            (component->getNote().getBeat() + component->getClip().getBeat()) >= startBeat &&
-            (component->getNote().getBeat() + component->getClip().getBeat()) < endBeat)
+        const auto found = sequenceMap->find(*sequence->getNoteUnchecked(i));
+        if (found != sequenceMap->end() && found->second->isActive())
         {
-            this->selectEvent(component, false);
+            this->selectEvent(found->second.get(), false);
         }
     }
 }
 
 void PianoRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound, const Rectangle<int> &rectangle)
 {
-    forEachEventComponent(this->patternMap, e)
+    auto *sequenceMap = this->getActiveSequenceMap();
+    if (sequenceMap == nullptr)
     {
-        auto *component = e.second.get();
+        return;
+    }
+
+    // the notes overlapping the lasso horizontally come from the index,
+    // with a bit of a margin, and the components check the rest
+    const auto *sequence = static_cast<const PianoSequence *>(this->activeTrack->getSequence());
+    const auto clipBeat = this->activeClip.getBeat();
+    const auto startBeat = float(rectangle.getX()) / this->beatWidth +
+        this->firstBeat - clipBeat - Globals::minNoteLength;
+    const auto endBeat = float(rectangle.getRight()) / this->beatWidth +
+        this->firstBeat - clipBeat + Globals::minNoteLength;
+
+    Array<int> overlapping;
+    sequence->getNoteIndex().findOverlapping(startBeat, endBeat, overlapping);
+
+    for (const auto i : overlapping)
+    {
+        const auto found = sequenceMap->find(*sequence->getNoteUnchecked(i));
+        if (found == sequenceMap->end())
+        {
+            continue;
+        }
+
+        auto *component = found->second.get();
         if (rectangle.intersects(component->getBounds()) && component->isActive())
         {
             jassert(!itemsFound.contains(component));
@@ -904,6 +996,17 @@ void PianoRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound, c
     }
 }
 
+PianoRoll::SequenceMap *PianoRoll::getActiveSequenceMap() const
+{
+    if (this->activeTrack == nullptr)
+    {
+        return nullptr;
+    }
+
+    const auto found = this->patternMap.find(this->activeClip);
+    return found == this->patternMap.end() ? nullptr : found->second.get();
+}
+
 float PianoRoll::getLassoStartBeat() const
 {
     return this->activeClip.getBeat() + SequencerOperations::findStartBeat(this->selection);
@@ -1614,36 +1717,63 @@ void PianoRoll::continueCuttingEvents(const Point<float> &mousePosition)
         this->knifeToolHelper->setEndPosition(mousePosition);
         this->knifeToolHelper->updateBounds();
 
-        bool addsPoint;
+        auto *sequenceMap = this->getActiveSequenceMap();
+        if (sequenceMap == nullptr)
+        {
+            return;
+        }
+
+        // only the active clip's notes can be cut, and only the ones
+        // under the knife line horizontally (with a bit of a margin,
+        // like in the lasso selection) can intersect it at all
+        const auto *sequence = static_cast<const PianoSequence *>(this->activeTrack->getSequence());
+        const auto knifeLine = this->knifeToolHelper->getLine();
+        const auto clipBeat = this->activeClip.getBeat();
+        const auto startBeat = jmin(knifeLine.getStartX(), knifeLine.getEndX()) / this->beatWidth +
+            this->firstBeat - clipBeat - Globals::minNoteLength;
+        const auto endBeat = jmax(knifeLine.getStartX(), knifeLine.getEndX()) / this->beatWidth +
+            this->firstBeat - clipBeat + Globals::minNoteLength;
+
+        Array<int> candidates;
+        sequence->getNoteIndex().findOverlapping(startBeat, endBeat, candidates);
+
+        FlatHashSet<Note, MidiEventHash> cutNotes;
         Point<float> intersection;
-        forEachEventComponent(this->patternMap, e)
+        for (const auto i : candidates)
         {
-            addsPoint = false;
-            auto *nc = e.second.get();
-            if (!nc->isActive())
+            const auto found = sequenceMap->find(*sequence->getNoteUnchecked(i));
+            if (found == sequenceMap->end() || !found->second->isActive())
             {
                 continue;
             }
 
+            auto *nc = found->second.get();
             const int h2 = nc->getHeight() / 2;
             const Line<float> noteLine(nc->getPosition().translated(0, h2).toFloat(),
                 nc->getPosition().translated(nc->getWidth(), h2).toFloat());
 
-            if (this->knifeToolHelper->getLine().intersects(noteLine, intersection))
+            if (knifeLine.intersects(noteLine, intersection))
             {
                 const float relativeCutBeat = this->getRoundBeatSnapByXPosition(int(intersection.getX()))
-                    - this->activeClip.getBeat() - nc->getBeat();
+                    - clipBeat - nc->getBeat();
  
                 if (relativeCutBeat > 0.f && relativeCutBeat < nc->getLength())
                 {
-                    addsPoint = true;
+                    cutNotes.insert(nc->getNote());
                     this->knifeToolHelper->addOrUpdateCutPoint(nc, relativeCutBeat);
                 }
             }
+        }
 
-            if (!addsPoint)
+        // and the notes the knife line has left since the last time
+        Array<Note> previouslyCutNotes;
+        Array<float> previousCutBeats;
+        this->knifeToolHelper->getCutPoints(previouslyCutNotes, previousCutBeats);
+        for (const auto &note : previouslyCutNotes)
+        {
+            if (!cutNotes.contains(note))
             {
-                this->knifeToolHelper->removeCutPointIfExists(nc->getNote());
+                this->knifeToolHelper->removeCutPointIfExists(note);
             }
         }
     }
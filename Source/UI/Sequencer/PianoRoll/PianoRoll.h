@@ -101,6 +101,11 @@ public:
     void onAddMidiEvent(const MidiEvent &event) override;
     void onRemoveMidiEvent(const MidiEvent &event) override;
 
+    void onChangeMidiEvents(const MidiEventsBatch &oldEvents,
+        const MidiEventsBatch &newEvents) override;
+    void onAddMidiEvents(const MidiEventsBatch &events) override;
+    void onRemoveMidiEvents(const MidiEventsBatch &events) override;
+
     void onAddClip(const Clip &clip) override;
     void onChangeClip(const Clip &oldClip, const Clip &newClip) override;
     void onRemoveClip(const Clip &clip) override;
@@ -274,6 +279,9 @@ private:
     using PatternMap = FlatHashMap<Clip, UniquePointer<SequenceMap>, ClipHash>;
     PatternMap patternMap;
 
+    // the components of the active clip, if any
+    SequenceMap *getActiveSequenceMap() const;
+
 private:
 
 #if PLATFORM_DESKTOP